@@ -213,7 +213,8 @@ void ApprovalDialog::setupUI()
     m_mainLayout->addWidget(m_timeoutLabel);
     
     // Setup remember option
-    m_rememberCheckBox = new QCheckBox(tr("Remember my decision for this session"), this);
+    m_rememberCheckBox = new QCheckBox(
+        tr("Remember my decision for requests from the same technician, file type and size"), this);
     m_rememberCheckBox->setVisible(false); // Hidden by default
     m_mainLayout->addWidget(m_rememberCheckBox);
     
@@ -79,6 +79,11 @@ public:
      * @return true if remember option is checked
      */
     bool shouldRememberDecision() const;
+    
+    /**
+     * @brief File extensions that can execute code, lower case without the dot
+     */
+    static const QStringList DANGEROUS_EXTENSIONS;
 
 protected:
     /**
@@ -248,7 +253,6 @@ private:
     static const int DEFAULT_TIMEOUT = 60; // seconds
     static const int MIN_DIALOG_WIDTH = 500;
     static const int MIN_DIALOG_HEIGHT = 400;
-    static const QStringList DANGEROUS_EXTENSIONS;
 };
 
 #endif // APPROVALDIALOG_H
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "ApprovalPolicyCache.h"
+#include "FileTransferManager.h"
+#include <QSettings>
+#include <QFileInfo>
+#include <QUrl>
+#include <QCoreApplication>
+
+static const char *const POLICY_GROUP = "ApprovalPolicies";
+
+int ApprovalPolicyCache::sizeClassFor(qint64 fileSize)
+{
+    int sizeClass = 0;
+    qint64 bound = SMALLEST_SIZE_CLASS;
+    while (fileSize >= bound && sizeClass < SIZE_CLASS_COUNT - 1) {
+        bound *= 16;
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+QString ApprovalPolicyCache::sizeClassName(int sizeClass)
+{
+    switch (sizeClass) {
+        case 0:
+            return QCoreApplication::translate("ApprovalPolicyCache", "under 1 MB");
+        case 1:
+            return QCoreApplication::translate("ApprovalPolicyCache", "1 MB to 16 MB");
+        case 2:
+            return QCoreApplication::translate("ApprovalPolicyCache", "16 MB to 256 MB");
+        case 3:
+            return QCoreApplication::translate("ApprovalPolicyCache", "256 MB to 4 GB");
+        default:
+            return QCoreApplication::translate("ApprovalPolicyCache", "over 4 GB");
+    }
+}
+
+QString ApprovalPolicyCache::extensionFor(const QString &filename)
+{
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    return suffix.isEmpty() ? QString() : "." + suffix;
+}
+
+QString ApprovalPolicyCache::policyKey(const QString &technician, const QString &extension, int sizeClass)
+{
+    // Extension and class are the last fields, a '|' in the name stays unambiguous
+    QString ext = extension.trimmed().toLower();
+    if (!ext.isEmpty() && !ext.startsWith('.')) {
+        ext.prepend('.');
+    }
+    int boundedClass = qBound(0, sizeClass, SIZE_CLASS_COUNT - 1);
+    return technician.trimmed().toLower() + '|' + ext + '|' + QString::number(boundedClass);
+}
+
+QString ApprovalPolicyCache::policyKey(const FileTransferRequest &request)
+{
+    return policyKey(request.technician, extensionFor(request.filename), sizeClassFor(request.fileSize));
+}
+
+bool ApprovalPolicyCache::lookup(const FileTransferRequest &request, bool &approved) const
+{
+    auto it = m_policies.constFind(policyKey(request));
+    if (it == m_policies.cend()) {
+        return false;
+    }
+    
+    approved = it.value();
+    return true;
+}
+
+void ApprovalPolicyCache::remember(const FileTransferRequest &request, bool approved)
+{
+    m_policies.insert(policyKey(request), approved);
+}
+
+void ApprovalPolicyCache::setPolicy(const QString &technician, const QString &extension, int sizeClass, bool approved)
+{
+    m_policies.insert(policyKey(technician, extension, sizeClass), approved);
+}
+
+bool ApprovalPolicyCache::removePolicy(const QString &technician, const QString &extension, int sizeClass)
+{
+    return m_policies.remove(policyKey(technician, extension, sizeClass));
+}
+
+void ApprovalPolicyCache::clear()
+{
+    m_policies.clear();
+}
+
+int ApprovalPolicyCache::getPolicyCount() const
+{
+    return m_policies.size();
+}
+
+void ApprovalPolicyCache::load(QSettings *settings)
+{
+    m_policies.clear();
+    
+    settings->beginGroup(POLICY_GROUP);
+    const QStringList keys = settings->childKeys();
+    for (const QString &key : keys) {
+        m_policies.insert(QUrl::fromPercentEncoding(key.toLatin1()), settings->value(key).toBool());
+    }
+    settings->endGroup();
+}
+
+void ApprovalPolicyCache::save(QSettings *settings) const
+{
+    // Rewritten whole, removed policies must not come back on the next load
+    settings->beginGroup(POLICY_GROUP);
+    settings->remove(QString());
+    for (auto it = m_policies.cbegin(); it != m_policies.cend(); ++it) {
+        settings->setValue(QString::fromLatin1(QUrl::toPercentEncoding(it.key())), it.value());
+    }
+    settings->endGroup();
+}
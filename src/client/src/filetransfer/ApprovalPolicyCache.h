@@ -0,0 +1,51 @@
+#ifndef APPROVALPOLICYCACHE_H
+#define APPROVALPOLICYCACHE_H
+
+#include <QString>
+#include <QHash>
+
+class QSettings;
+struct FileTransferRequest;
+
+// Remembered approval decisions that outlive the request they were made on.
+//
+// A decision is keyed on the technician, the file extension and a coarse
+// size class rather than the transfer ID, so "remember" on one request
+// decides every later one of the same kind: the same technician pushing
+// more .log files of a similar size is approved without a dialog. Size
+// classes grow by a factor of 16 from 1 MB, so a decision made on a small
+// file does not approve a multi-gigabyte one. Not thread-safe, the manager
+// guards it with its own mutex.
+class ApprovalPolicyCache
+{
+public:
+    static const int SIZE_CLASS_COUNT = 5;
+    static const qint64 SMALLEST_SIZE_CLASS = 1024 * 1024; // Upper bound of class 0
+    
+    // Class of a file size: 0 below 1 MB, then up to 16 MB, 256 MB, 4 GB
+    // and anything larger
+    static int sizeClassFor(qint64 fileSize);
+    static QString sizeClassName(int sizeClass);
+    // Lower case extension with the dot, empty for none
+    static QString extensionFor(const QString &filename);
+    
+    static QString policyKey(const QString &technician, const QString &extension, int sizeClass);
+    static QString policyKey(const FileTransferRequest &request);
+    
+    bool lookup(const FileTransferRequest &request, bool &approved) const;
+    void remember(const FileTransferRequest &request, bool approved);
+    void setPolicy(const QString &technician, const QString &extension, int sizeClass, bool approved);
+    bool removePolicy(const QString &technician, const QString &extension, int sizeClass);
+    void clear();
+    int getPolicyCount() const;
+    
+    // Persisted in their own group of the settings store, the keys escaped
+    // as QSettings reads '/' and '\' as separators
+    void load(QSettings *settings);
+    void save(QSettings *settings) const;
+
+private:
+    QHash<QString, bool> m_policies;
+};
+
+#endif // APPROVALPOLICYCACHE_H
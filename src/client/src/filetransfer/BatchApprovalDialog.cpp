@@ -0,0 +1,418 @@
+#include "BatchApprovalDialog.h"
+#include "ApprovalDialog.h"
+#include "ApprovalPolicyCache.h"
+#include <QApplication>
+#include <QScreen>
+#include <QHeaderView>
+#include <QKeyEvent>
+#include <QLocale>
+#include <QFileInfo>
+#include <QStyle>
+#include <QSet>
+
+enum RequestColumn {
+    FileColumn,
+    SizeColumn,
+    TypeColumn,
+    TechnicianColumn,
+    ColumnCount
+};
+
+BatchApprovalDialog::BatchApprovalDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_timeoutTimer(new QTimer(this))
+    , m_displayTimer(new QTimer(this))
+    , m_timeoutSeconds(DEFAULT_TIMEOUT)
+    , m_remainingSeconds(DEFAULT_TIMEOUT)
+{
+    setWindowTitle(tr("File Transfer Requests"));
+    setWindowIcon(QIcon(":/icons/file_transfer.png"));
+    setModal(true);
+    setMinimumSize(MIN_DIALOG_WIDTH, MIN_DIALOG_HEIGHT);
+    
+    // Setup UI
+    setupUI();
+    connectSignals();
+    onSelectionChanged();
+    
+    // Center on screen
+    QScreen *screen = QApplication::primaryScreen();
+    if (screen) {
+        QRect screenGeometry = screen->availableGeometry();
+        move((screenGeometry.width() - width()) / 2,
+             (screenGeometry.height() - height()) / 2);
+    }
+    
+    // Set focus to reject button by default for security
+    m_rejectAllButton->setFocus();
+}
+
+BatchApprovalDialog::~BatchApprovalDialog()
+{
+    if (m_timeoutTimer) {
+        m_timeoutTimer->stop();
+    }
+    if (m_displayTimer) {
+        m_displayTimer->stop();
+    }
+}
+
+void BatchApprovalDialog::addRequest(const FileTransferRequest &request)
+{
+    if (m_requests.contains(request.id)) {
+        return;
+    }
+    
+    bool dangerous = ApprovalDialog::DANGEROUS_EXTENSIONS.contains(QFileInfo(request.filename).suffix().toLower());
+    
+    QTreeWidgetItem *item = new QTreeWidgetItem();
+    item->setText(FileColumn, request.filename);
+    item->setText(SizeColumn, QLocale().formattedDataSize(request.fileSize));
+    item->setText(TypeColumn, request.type == TransferType::Upload ? tr("Upload") : tr("Download"));
+    item->setText(TechnicianColumn, request.technician);
+    item->setData(FileColumn, Qt::UserRole, request.id);
+    item->setTextAlignment(SizeColumn, Qt::AlignRight | Qt::AlignVCenter);
+    
+    if (dangerous) {
+        item->setIcon(FileColumn, style()->standardIcon(QStyle::SP_MessageBoxWarning));
+        item->setToolTip(FileColumn, tr("This file type can execute code on your computer"));
+        m_securityWarningLabel->setVisible(true);
+    } else {
+        item->setIcon(FileColumn, style()->standardIcon(QStyle::SP_FileIcon));
+    }
+    
+    m_requestTree->addTopLevelItem(item);
+    m_requests.insert(request.id, request);
+    m_items.insert(request.id, item);
+    updateSummary();
+    
+    // Every new arrival gets the full time
+    if (m_timeoutSeconds > 0 && m_timeoutTimer->isActive()) {
+        setAutoTimeout(m_timeoutSeconds);
+    }
+}
+
+bool BatchApprovalDialog::removeRequest(const QString &transferId)
+{
+    if (!m_requests.remove(transferId)) {
+        return false;
+    }
+    
+    delete m_items.take(transferId);
+    updateSummary();
+    
+    if (m_requests.isEmpty()) {
+        done(QDialog::Rejected);
+    }
+    return true;
+}
+
+QStringList BatchApprovalDialog::getMatchingRequests(const QString &transferId) const
+{
+    QStringList matching;
+    auto it = m_requests.constFind(transferId);
+    if (it == m_requests.cend()) {
+        return matching;
+    }
+    
+    QString key = ApprovalPolicyCache::policyKey(it.value());
+    for (auto candidate = m_requests.cbegin(); candidate != m_requests.cend(); ++candidate) {
+        if (ApprovalPolicyCache::policyKey(candidate.value()) == key) {
+            matching.append(candidate.key());
+        }
+    }
+    return matching;
+}
+
+void BatchApprovalDialog::setAutoTimeout(int seconds)
+{
+    m_timeoutSeconds = seconds;
+    m_remainingSeconds = seconds;
+    
+    if (seconds > 0) {
+        m_timeoutTimer->setInterval(seconds * 1000);
+        m_timeoutTimer->setSingleShot(true);
+        m_timeoutTimer->start();
+        
+        m_displayTimer->setInterval(1000); // Update every second
+        m_displayTimer->start();
+        
+        m_timeoutLabel->setText(tr("Auto-reject in %1 seconds").arg(m_remainingSeconds));
+        m_timeoutLabel->setVisible(true);
+    } else {
+        m_timeoutTimer->stop();
+        m_displayTimer->stop();
+        m_timeoutLabel->setVisible(false);
+    }
+}
+
+void BatchApprovalDialog::setRememberOptionEnabled(bool enabled)
+{
+    m_rememberCheckBox->setVisible(enabled);
+}
+
+bool BatchApprovalDialog::shouldRememberDecision() const
+{
+    return m_rememberCheckBox->isVisible() && m_rememberCheckBox->isChecked();
+}
+
+void BatchApprovalDialog::done(int result)
+{
+    // Close, escape and timeout leave nothing undecided
+    if (!m_requests.isEmpty()) {
+        decide(m_requests.keys(), false, tr("Request cancelled by user"), false);
+        return;
+    }
+    
+    m_timeoutTimer->stop();
+    m_displayTimer->stop();
+    QDialog::done(result);
+}
+
+void BatchApprovalDialog::keyPressEvent(QKeyEvent *event)
+{
+    switch (event->key()) {
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        if (event->modifiers() & Qt::ControlModifier) {
+            onApproveSelectedClicked();
+        } else {
+            // Default to reject for security
+            onRejectSelectedClicked();
+        }
+        break;
+    default:
+        QDialog::keyPressEvent(event);
+        break;
+    }
+}
+
+void BatchApprovalDialog::onApproveSelectedClicked()
+{
+    decide(getSelectedRequests(), true, tr("Approved by user"), shouldRememberDecision());
+}
+
+void BatchApprovalDialog::onApproveMatchingClicked()
+{
+    QSet<QString> matching;
+    const QStringList selected = getSelectedRequests();
+    for (const QString &transferId : selected) {
+        const QStringList ids = getMatchingRequests(transferId);
+        matching.unite(QSet<QString>(ids.cbegin(), ids.cend()));
+    }
+    
+    decide(QStringList(matching.cbegin(), matching.cend()), true, tr("Approved by user"), shouldRememberDecision());
+}
+
+void BatchApprovalDialog::onApproveAllClicked()
+{
+    decide(m_requests.keys(), true, tr("Approved by user"), shouldRememberDecision());
+}
+
+void BatchApprovalDialog::onRejectSelectedClicked()
+{
+    decide(getSelectedRequests(), false, tr("Rejected by user"), shouldRememberDecision());
+}
+
+void BatchApprovalDialog::onRejectAllClicked()
+{
+    decide(m_requests.keys(), false, tr("Rejected by user"), shouldRememberDecision());
+}
+
+void BatchApprovalDialog::onTimeout()
+{
+    // Auto-reject on timeout for security
+    decide(m_requests.keys(), false, tr("Request timed out"), false);
+}
+
+void BatchApprovalDialog::updateTimeoutDisplay()
+{
+    m_remainingSeconds--;
+    
+    if (m_remainingSeconds <= 0) {
+        m_timeoutLabel->setText(tr("Request timed out"));
+        m_displayTimer->stop();
+    } else {
+        m_timeoutLabel->setText(tr("Auto-reject in %1 seconds").arg(m_remainingSeconds));
+    }
+}
+
+void BatchApprovalDialog::onSelectionChanged()
+{
+    bool hasSelection = !m_requestTree->selectedItems().isEmpty();
+    m_rejectSelectedButton->setEnabled(hasSelection);
+    m_approveSelectedButton->setEnabled(hasSelection);
+    m_approveMatchingButton->setEnabled(hasSelection);
+}
+
+void BatchApprovalDialog::setupUI()
+{
+    m_mainLayout = new QVBoxLayout(this);
+    m_mainLayout->setSpacing(12);
+    m_mainLayout->setContentsMargins(16, 16, 16, 16);
+    
+    // Pending count
+    m_summaryLabel = new QLabel(this);
+    m_summaryLabel->setStyleSheet("QLabel { font-weight: bold; }");
+    m_mainLayout->addWidget(m_summaryLabel);
+    
+    // Security warning, shown once a dangerous file is listed
+    m_securityWarningLabel = new QLabel(
+        tr("<b>⚠️ SECURITY WARNING:</b> Some of these file types can execute code on your computer. "
+           "Only approve them if you trust the technician and understand the risks."), this);
+    m_securityWarningLabel->setWordWrap(true);
+    m_securityWarningLabel->setStyleSheet(
+        "QLabel { "
+        "  border: 2px solid #ff9800; "
+        "  background-color: #fff3e0; "
+        "  border-radius: 4px; "
+        "  padding: 8px; "
+        "}"
+    );
+    m_securityWarningLabel->setVisible(false);
+    m_mainLayout->addWidget(m_securityWarningLabel);
+    
+    // Request list
+    m_requestTree = new QTreeWidget(this);
+    m_requestTree->setColumnCount(ColumnCount);
+    m_requestTree->setHeaderLabels({tr("File"), tr("Size"), tr("Type"), tr("Technician")});
+    m_requestTree->setRootIsDecorated(false);
+    m_requestTree->setUniformRowHeights(true);
+    m_requestTree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_requestTree->setSortingEnabled(true);
+    m_requestTree->sortByColumn(FileColumn, Qt::AscendingOrder);
+    m_requestTree->header()->setSectionResizeMode(FileColumn, QHeaderView::Stretch);
+    m_requestTree->header()->setStretchLastSection(false);
+    m_mainLayout->addWidget(m_requestTree, 1);
+    
+    // Timeout label
+    m_timeoutLabel = new QLabel(this);
+    m_timeoutLabel->setAlignment(Qt::AlignCenter);
+    m_timeoutLabel->setStyleSheet("QLabel { color: #d32f2f; font-weight: bold; }");
+    m_timeoutLabel->setVisible(false);
+    m_mainLayout->addWidget(m_timeoutLabel);
+    
+    // Remember checkbox
+    m_rememberCheckBox = new QCheckBox(
+        tr("Remember my decisions for requests from the same technician, file type and size"), this);
+    m_rememberCheckBox->setVisible(false); // Hidden by default
+    m_mainLayout->addWidget(m_rememberCheckBox);
+    
+    // Setup buttons
+    setupButtonSection();
+    
+    updateSummary();
+}
+
+void BatchApprovalDialog::setupButtonSection()
+{
+    m_buttonLayout = new QHBoxLayout();
+    m_buttonLayout->setSpacing(12);
+    
+    // Reject buttons
+    m_rejectAllButton = new QPushButton(tr("Reject All"));
+    m_rejectAllButton->setIcon(style()->standardIcon(QStyle::SP_DialogCancelButton));
+    m_rejectAllButton->setStyleSheet(
+        "QPushButton { "
+        "  background-color: #f44336; "
+        "  color: white; "
+        "  border: none; "
+        "  padding: 8px 16px; "
+        "  border-radius: 4px; "
+        "  font-weight: bold; "
+        "} "
+        "QPushButton:hover { "
+        "  background-color: #d32f2f; "
+        "} "
+        "QPushButton:pressed { "
+        "  background-color: #b71c1c; "
+        "}"
+    );
+    m_buttonLayout->addWidget(m_rejectAllButton);
+    
+    m_rejectSelectedButton = new QPushButton(tr("Reject Selected"));
+    m_buttonLayout->addWidget(m_rejectSelectedButton);
+    
+    m_buttonLayout->addStretch();
+    
+    // Approve buttons
+    m_approveSelectedButton = new QPushButton(tr("Approve Selected"));
+    m_buttonLayout->addWidget(m_approveSelectedButton);
+    
+    m_approveMatchingButton = new QPushButton(tr("Approve Matching"));
+    m_approveMatchingButton->setToolTip(
+        tr("Approve every request from the same technician with the file type and size of the selection"));
+    m_buttonLayout->addWidget(m_approveMatchingButton);
+    
+    m_approveAllButton = new QPushButton(tr("Approve All"));
+    m_approveAllButton->setIcon(style()->standardIcon(QStyle::SP_DialogOkButton));
+    m_approveAllButton->setStyleSheet(
+        "QPushButton { "
+        "  background-color: #4caf50; "
+        "  color: white; "
+        "  border: none; "
+        "  padding: 8px 16px; "
+        "  border-radius: 4px; "
+        "  font-weight: bold; "
+        "} "
+        "QPushButton:hover { "
+        "  background-color: #388e3c; "
+        "} "
+        "QPushButton:pressed { "
+        "  background-color: #2e7d32; "
+        "}"
+    );
+    m_buttonLayout->addWidget(m_approveAllButton);
+    
+    m_mainLayout->addLayout(m_buttonLayout);
+}
+
+void BatchApprovalDialog::connectSignals()
+{
+    connect(m_approveSelectedButton, &QPushButton::clicked, this, &BatchApprovalDialog::onApproveSelectedClicked);
+    connect(m_approveMatchingButton, &QPushButton::clicked, this, &BatchApprovalDialog::onApproveMatchingClicked);
+    connect(m_approveAllButton, &QPushButton::clicked, this, &BatchApprovalDialog::onApproveAllClicked);
+    connect(m_rejectSelectedButton, &QPushButton::clicked, this, &BatchApprovalDialog::onRejectSelectedClicked);
+    connect(m_rejectAllButton, &QPushButton::clicked, this, &BatchApprovalDialog::onRejectAllClicked);
+    connect(m_timeoutTimer, &QTimer::timeout, this, &BatchApprovalDialog::onTimeout);
+    connect(m_displayTimer, &QTimer::timeout, this, &BatchApprovalDialog::updateTimeoutDisplay);
+    connect(m_requestTree, &QTreeWidget::itemSelectionChanged, this, &BatchApprovalDialog::onSelectionChanged);
+}
+
+void BatchApprovalDialog::decide(const QStringList &transferIds, bool approved, const QString &message, bool remember)
+{
+    QStringList decided;
+    for (const QString &transferId : transferIds) {
+        if (m_requests.remove(transferId)) {
+            delete m_items.take(transferId);
+            decided.append(transferId);
+        }
+    }
+    
+    if (decided.isEmpty()) {
+        return;
+    }
+    
+    updateSummary();
+    emit requestsDecided(decided, approved, message, remember);
+    
+    // Nothing left to decide
+    if (m_requests.isEmpty()) {
+        done(approved ? QDialog::Accepted : QDialog::Rejected);
+    }
+}
+
+QStringList BatchApprovalDialog::getSelectedRequests() const
+{
+    QStringList selected;
+    const QList<QTreeWidgetItem *> items = m_requestTree->selectedItems();
+    for (QTreeWidgetItem *item : items) {
+        selected.append(item->data(FileColumn, Qt::UserRole).toString());
+    }
+    return selected;
+}
+
+void BatchApprovalDialog::updateSummary()
+{
+    m_summaryLabel->setText(tr("%n pending file transfer request(s)", nullptr, m_requests.size()));
+}
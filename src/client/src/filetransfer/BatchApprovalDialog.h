@@ -0,0 +1,219 @@
+#ifndef BATCHAPPROVALDIALOG_H
+#define BATCHAPPROVALDIALOG_H
+
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QCheckBox>
+#include <QTimer>
+#include <QHash>
+#include <QStringList>
+#include "FileTransferManager.h"
+
+/**
+ * @brief Dialog for deciding many pending file transfer requests at once
+ *
+ * Shown instead of one ApprovalDialog per request when requests arrive in
+ * bulk, e.g. a technician pushing a folder. Requests can be added while the
+ * dialog is open. Features:
+ * - One row per pending request (file, size, direction, technician)
+ * - Approve or reject the selection, or everything at once
+ * - Approve matching: every request with the same technician, file type
+ *   and size class as the selection
+ * - Optional "remember" that turns the decisions into approval policies
+ * - Auto-timeout, rejecting whatever is still undecided
+ */
+class BatchApprovalDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor
+     * @param parent Parent widget
+     */
+    explicit BatchApprovalDialog(QWidget *parent = nullptr);
+    
+    /**
+     * @brief Destructor
+     */
+    ~BatchApprovalDialog();
+    
+    /**
+     * @brief Add a pending request, restarting the auto-timeout
+     * @param request File transfer request to approve/reject
+     */
+    void addRequest(const FileTransferRequest &request);
+    
+    /**
+     * @brief Drop a request decided elsewhere, without a decision
+     * @param transferId Transfer ID of the request
+     * @return true if the request was listed
+     */
+    bool removeRequest(const QString &transferId);
+    
+    /**
+     * @brief Get the number of undecided requests
+     */
+    int getPendingCount() const { return m_requests.size(); }
+    
+    /**
+     * @brief Get the undecided requests sharing the policy of a request
+     * @param transferId Transfer ID of the request to match
+     * @return Transfer IDs, the request itself included
+     */
+    QStringList getMatchingRequests(const QString &transferId) const;
+    
+    /**
+     * @brief Set auto-timeout for the dialog
+     * @param seconds Timeout in seconds (0 to disable)
+     */
+    void setAutoTimeout(int seconds);
+    
+    /**
+     * @brief Set whether to offer remembering decisions as policies
+     * @param enabled Whether to show the "remember" option
+     */
+    void setRememberOptionEnabled(bool enabled);
+    
+    /**
+     * @brief Check if user wants to remember the decisions
+     * @return true if remember option is checked
+     */
+    bool shouldRememberDecision() const;
+
+signals:
+    /**
+     * @brief Requests were approved or rejected
+     * @param transferIds Transfer IDs of the decided requests
+     * @param approved Decision for all of them
+     * @param message Message for the technician
+     * @param remember Whether the decision should become a policy
+     */
+    void requestsDecided(const QStringList &transferIds, bool approved, const QString &message, bool remember);
+
+public slots:
+    /**
+     * @brief Close the dialog, rejecting the undecided requests
+     */
+    void done(int result) override;
+
+protected:
+    /**
+     * @brief Handle key press events
+     */
+    void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+    /**
+     * @brief Approve the selected requests
+     */
+    void onApproveSelectedClicked();
+    
+    /**
+     * @brief Approve the requests matching the selection
+     */
+    void onApproveMatchingClicked();
+    
+    /**
+     * @brief Approve every listed request
+     */
+    void onApproveAllClicked();
+    
+    /**
+     * @brief Reject the selected requests
+     */
+    void onRejectSelectedClicked();
+    
+    /**
+     * @brief Reject every listed request
+     */
+    void onRejectAllClicked();
+    
+    /**
+     * @brief Handle timeout timer
+     */
+    void onTimeout();
+    
+    /**
+     * @brief Update timeout display
+     */
+    void updateTimeoutDisplay();
+    
+    /**
+     * @brief Enable the actions that need a selection
+     */
+    void onSelectionChanged();
+
+private:
+    /**
+     * @brief Setup the user interface
+     */
+    void setupUI();
+    
+    /**
+     * @brief Setup action buttons
+     */
+    void setupButtonSection();
+    
+    /**
+     * @brief Connect signals and slots
+     */
+    void connectSignals();
+    
+    /**
+     * @brief Remove decided requests and report them
+     * @param transferIds Requests to decide
+     * @param approved Decision for all of them
+     * @param message Message for the technician
+     * @param remember Whether the decision should become a policy
+     */
+    void decide(const QStringList &transferIds, bool approved, const QString &message, bool remember);
+    
+    /**
+     * @brief Get the transfer IDs of the selected rows
+     */
+    QStringList getSelectedRequests() const;
+    
+    /**
+     * @brief Refresh the pending count
+     */
+    void updateSummary();
+
+private:
+    // Undecided requests and their rows, by transfer ID
+    QHash<QString, FileTransferRequest> m_requests;
+    QHash<QString, QTreeWidgetItem *> m_items;
+    
+    // Auto-timeout
+    QTimer *m_timeoutTimer;
+    QTimer *m_displayTimer;
+    int m_timeoutSeconds;
+    int m_remainingSeconds;
+    
+    // UI Components
+    QVBoxLayout *m_mainLayout;
+    QLabel *m_summaryLabel;
+    QLabel *m_securityWarningLabel;
+    QTreeWidget *m_requestTree;
+    QCheckBox *m_rememberCheckBox;
+    QLabel *m_timeoutLabel;
+    
+    // Buttons
+    QHBoxLayout *m_buttonLayout;
+    QPushButton *m_rejectAllButton;
+    QPushButton *m_rejectSelectedButton;
+    QPushButton *m_approveSelectedButton;
+    QPushButton *m_approveMatchingButton;
+    QPushButton *m_approveAllButton;
+    
+    // Constants
+    static const int DEFAULT_TIMEOUT = 120; // seconds
+    static const int MIN_DIALOG_WIDTH = 640;
+    static const int MIN_DIALOG_HEIGHT = 420;
+};
+
+#endif // BATCHAPPROVALDIALOG_H
@@ -0,0 +1,103 @@
+#include "ChunkBufferPool.h"
+
+ChunkBufferPool::ChunkBufferPool(qint64 maxPoolBytes)
+    : m_maxPoolBytes(qMax<qint64>(0, maxPoolBytes))
+    , m_pooledBytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+QByteArray ChunkBufferPool::acquire(int payloadSize)
+{
+    qsizetype needed = HEADROOM + qMax(0, payloadSize) + TAILROOM;
+    
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        // Most recently returned first, it is the likeliest to still be cached
+        for (qsizetype i = m_buffers.size() - 1; i >= 0; --i) {
+            const QByteArray &candidate = m_buffers.at(i);
+            if (candidate.capacity() < needed || !candidate.isDetached()) {
+                continue;
+            }
+            
+            QByteArray buffer = m_buffers.takeAt(i);
+            m_pooledBytes -= buffer.capacity();
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            
+            // Shrinking keeps the allocation
+            buffer.resize(HEADROOM);
+            return buffer;
+        }
+    }
+    
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    QByteArray buffer;
+    buffer.reserve(needed);
+    buffer.resize(HEADROOM);
+    return buffer;
+}
+
+void ChunkBufferPool::release(QByteArray buffer)
+{
+    // Views into mappings or frames own no allocation worth keeping
+    if (buffer.capacity() <= HEADROOM + TAILROOM) {
+        return;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    m_pooledBytes += buffer.capacity();
+    m_buffers.append(std::move(buffer));
+    trim();
+}
+
+void ChunkBufferPool::setMaxPoolBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxPoolBytes = qMax<qint64>(0, bytes);
+    trim();
+}
+
+qint64 ChunkBufferPool::getMaxPoolBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxPoolBytes;
+}
+
+qint64 ChunkBufferPool::getPooledBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pooledBytes;
+}
+
+int ChunkBufferPool::getPooledBufferCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_buffers.size();
+}
+
+void ChunkBufferPool::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_buffers.clear();
+    m_pooledBytes = 0;
+}
+
+quint64 ChunkBufferPool::getHitCount() const
+{
+    return m_hits.load(std::memory_order_relaxed);
+}
+
+quint64 ChunkBufferPool::getMissCount() const
+{
+    return m_misses.load(std::memory_order_relaxed);
+}
+
+void ChunkBufferPool::trim()
+{
+    while (m_pooledBytes > m_maxPoolBytes && !m_buffers.isEmpty()) {
+        m_pooledBytes -= m_buffers.first().capacity();
+        m_buffers.removeFirst();
+    }
+}
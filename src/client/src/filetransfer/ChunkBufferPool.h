@@ -0,0 +1,62 @@
+#ifndef CHUNKBUFFERPOOL_H
+#define CHUNKBUFFERPOOL_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <atomic>
+#include "ChunkCodec.h"
+#include "ChunkCipher.h"
+
+// Recycled frame buffers for the chunk send path.
+//
+// A buffer has room for the binary chunk header ahead of the payload and
+// for the AEAD tag behind it, so an upload chunk is read, compressed,
+// sealed and framed in one allocation that is then handed to the socket
+// as is. Buffers come back once their frame is written. Qt may still hold
+// a reference for a moment (a queued chunkReady() copy), so a returned
+// buffer is handed out again only when the pool holds its last reference.
+//
+// Pooled bytes are bounded, the least recently returned buffers are
+// dropped first. The pool is shared between transfer threads, every call
+// locks.
+class ChunkBufferPool
+{
+public:
+    static const int HEADROOM = ChunkCodec::BINARY_HEADER_SIZE;
+    static const int TAILROOM = ChunkCipher::TAG_SIZE;
+    static const qint64 DEFAULT_MAX_POOL_BYTES = 64 * 1024 * 1024; // 64MB
+    
+    explicit ChunkBufferPool(qint64 maxPoolBytes = DEFAULT_MAX_POOL_BYTES);
+    
+    // Buffer of HEADROOM bytes with room for payloadSize more and the tag;
+    // the payload is appended behind the header room
+    QByteArray acquire(int payloadSize);
+    void release(QByteArray buffer);
+    
+    // Size limit in bytes, shrinking it drops buffers right away
+    void setMaxPoolBytes(qint64 bytes);
+    qint64 getMaxPoolBytes() const;
+    qint64 getPooledBytes() const;
+    int getPooledBufferCount() const;
+    void clear();
+    
+    // Acquires served from the pool and those that had to allocate
+    quint64 getHitCount() const;
+    quint64 getMissCount() const;
+
+private:
+    // m_mutex must be held
+    void trim();
+    
+    QList<QByteArray> m_buffers; // Least recently returned first
+    qint64 m_maxPoolBytes;
+    qint64 m_pooledBytes;
+    
+    std::atomic<quint64> m_hits;
+    std::atomic<quint64> m_misses;
+    
+    mutable QMutex m_mutex;
+};
+
+#endif // CHUNKBUFFERPOOL_H
@@ -0,0 +1,182 @@
+#include "ChunkCipher.h"
+#include <QMessageAuthenticationCode>
+#include <QtEndian>
+#include <QDebug>
+#include <openssl/evp.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHUNKCIPHER_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) && defined(Q_OS_LINUX)
+#define CHUNKCIPHER_ARM_LINUX
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace {
+
+const EVP_CIPHER *evpCipher(ChunkCipher::Cipher cipher)
+{
+    switch (cipher) {
+        case ChunkCipher::Cipher::Aes256Gcm: return EVP_aes_256_gcm();
+        case ChunkCipher::Cipher::ChaCha20Poly1305: return EVP_chacha20_poly1305();
+        case ChunkCipher::Cipher::None:
+        default: return nullptr;
+    }
+}
+
+void chunkNonce(int chunkIndex, uchar *nonce)
+{
+    // 32 zero bits followed by the 64-bit chunk index
+    qToBigEndian<quint32>(0, nonce);
+    qToBigEndian<quint64>(static_cast<quint64>(chunkIndex), nonce + 4);
+}
+
+} // namespace
+
+ChunkCipher::ChunkCipher()
+    : m_context(EVP_CIPHER_CTX_new())
+{
+}
+
+ChunkCipher::~ChunkCipher()
+{
+    EVP_CIPHER_CTX_free(m_context);
+}
+
+void ChunkCipher::setKey(const QByteArray &key)
+{
+    m_key = key;
+}
+
+bool ChunkCipher::hasKey() const
+{
+    return m_key.size() == KEY_SIZE;
+}
+
+bool ChunkCipher::encrypt(Cipher cipher, int chunkIndex, const QByteArray &associatedData, QByteArray &data)
+{
+    return encrypt(cipher, chunkIndex, associatedData, data, 0);
+}
+
+bool ChunkCipher::encrypt(Cipher cipher, int chunkIndex, const QByteArray &associatedData, QByteArray &buffer, qsizetype offset)
+{
+    const EVP_CIPHER *evp = evpCipher(cipher);
+    if (!evp || !hasKey() || !m_context || offset < 0 || offset > buffer.size()) {
+        return false;
+    }
+    
+    uchar nonce[NONCE_SIZE];
+    chunkNonce(chunkIndex, nonce);
+    
+    const uchar *key = reinterpret_cast<const uchar *>(m_key.constData());
+    int length = 0;
+    if (EVP_EncryptInit_ex(m_context, evp, nullptr, nullptr, nullptr) != 1 ||
+        EVP_CIPHER_CTX_ctrl(m_context, EVP_CTRL_AEAD_SET_IVLEN, NONCE_SIZE, nullptr) != 1 ||
+        EVP_EncryptInit_ex(m_context, nullptr, nullptr, key, nonce) != 1 ||
+        EVP_EncryptUpdate(m_context, nullptr, &length,
+                          reinterpret_cast<const uchar *>(associatedData.constData()),
+                          static_cast<int>(associatedData.size())) != 1) {
+        qWarning() << "Failed to initialize chunk encryption";
+        return false;
+    }
+    
+    // Room for the tag; views into mappings or frames are detached here,
+    // buffers with spare capacity are not reallocated
+    int plainSize = static_cast<int>(buffer.size() - offset);
+    buffer.resize(buffer.size() + TAG_SIZE);
+    uchar *plain = reinterpret_cast<uchar *>(buffer.data()) + offset;
+    
+    int finalLength = 0;
+    if (EVP_EncryptUpdate(m_context, plain, &length, plain, plainSize) != 1 ||
+        EVP_EncryptFinal_ex(m_context, plain + length, &finalLength) != 1 ||
+        EVP_CIPHER_CTX_ctrl(m_context, EVP_CTRL_AEAD_GET_TAG, TAG_SIZE, plain + plainSize) != 1) {
+        qWarning() << "Failed to encrypt chunk" << chunkIndex;
+        buffer.clear();
+        return false;
+    }
+    
+    return true;
+}
+
+bool ChunkCipher::decrypt(Cipher cipher, int chunkIndex, const QByteArray &associatedData,
+                          const QByteArray &sealed, QByteArray &data)
+{
+    const EVP_CIPHER *evp = evpCipher(cipher);
+    if (!evp || !hasKey() || !m_context || sealed.size() < TAG_SIZE) {
+        return false;
+    }
+    
+    uchar nonce[NONCE_SIZE];
+    chunkNonce(chunkIndex, nonce);
+    
+    const uchar *key = reinterpret_cast<const uchar *>(m_key.constData());
+    int length = 0;
+    if (EVP_DecryptInit_ex(m_context, evp, nullptr, nullptr, nullptr) != 1 ||
+        EVP_CIPHER_CTX_ctrl(m_context, EVP_CTRL_AEAD_SET_IVLEN, NONCE_SIZE, nullptr) != 1 ||
+        EVP_DecryptInit_ex(m_context, nullptr, nullptr, key, nonce) != 1 ||
+        EVP_DecryptUpdate(m_context, nullptr, &length,
+                          reinterpret_cast<const uchar *>(associatedData.constData()),
+                          static_cast<int>(associatedData.size())) != 1) {
+        qWarning() << "Failed to initialize chunk decryption";
+        return false;
+    }
+    
+    int cipherSize = static_cast<int>(sealed.size()) - TAG_SIZE;
+    const uchar *input = reinterpret_cast<const uchar *>(sealed.constData());
+    data.resize(cipherSize);
+    uchar *output = reinterpret_cast<uchar *>(data.data());
+    
+    // Final fails when the tag does not authenticate the chunk
+    int finalLength = 0;
+    if (EVP_DecryptUpdate(m_context, output, &length, input, cipherSize) != 1 ||
+        EVP_CIPHER_CTX_ctrl(m_context, EVP_CTRL_AEAD_SET_TAG, TAG_SIZE,
+                            const_cast<uchar *>(input + cipherSize)) != 1 ||
+        EVP_DecryptFinal_ex(m_context, output + length, &finalLength) != 1) {
+        data.clear();
+        return false;
+    }
+    
+    return true;
+}
+
+QByteArray ChunkCipher::deriveTransferKey(const QByteArray &sessionSecret, const QString &transferId)
+{
+    // HKDF extract and a single expand block (RFC 5869)
+    QByteArray pseudoRandomKey = QMessageAuthenticationCode::hash(sessionSecret, transferId.toUtf8(),
+                                                                  QCryptographicHash::Sha256);
+    QByteArray info("onlidesk-chunk-key-v1");
+    info.append('\x01');
+    return QMessageAuthenticationCode::hash(info, pseudoRandomKey, QCryptographicHash::Sha256);
+}
+
+ChunkCipher::Cipher ChunkCipher::preferredCipher()
+{
+#if defined(CHUNKCIPHER_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool hasAes = (info[2] & (1 << 25)) != 0 && (info[2] & (1 << 1)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    bool hasAes = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) != 0 && (ecx & bit_PCLMUL) != 0;
+#endif
+    return hasAes ? Cipher::Aes256Gcm : Cipher::ChaCha20Poly1305;
+#elif defined(CHUNKCIPHER_ARM_LINUX)
+    bool hasAes = (getauxval(AT_HWCAP) & HWCAP_AES) && (getauxval(AT_HWCAP) & HWCAP_PMULL);
+    return hasAes ? Cipher::Aes256Gcm : Cipher::ChaCha20Poly1305;
+#elif defined(__aarch64__) && defined(Q_OS_MACOS)
+    return Cipher::Aes256Gcm;
+#else
+    return Cipher::ChaCha20Poly1305;
+#endif
+}
+
+QString ChunkCipher::algorithmName()
+{
+    return "aead-v1";
+}
@@ -0,0 +1,56 @@
+#ifndef CHUNKCIPHER_H
+#define CHUNKCIPHER_H
+
+#include <QByteArray>
+#include <QString>
+
+struct evp_cipher_ctx_st;
+
+// Authenticated chunk encryption, end to end through the relay server.
+// Keys are derived per transfer from a secret shared by the two peers and
+// never sent to the server. Each chunk is sealed with a nonce built from
+// its index, so a retransmission reproduces the same ciphertext instead
+// of reusing a nonce for different data. The tag is appended to the
+// ciphertext and authenticates the chunk header fields as well.
+class ChunkCipher
+{
+public:
+    enum class Cipher {
+        None = 0,
+        Aes256Gcm,        // Preferred with AES-NI or ARMv8 crypto extensions
+        ChaCha20Poly1305  // Constant time in software on older CPUs
+    };
+    
+    static const int KEY_SIZE = 32;
+    static const int NONCE_SIZE = 12;
+    static const int TAG_SIZE = 16;
+    
+    ChunkCipher();
+    ~ChunkCipher();
+    
+    ChunkCipher(const ChunkCipher &) = delete;
+    ChunkCipher &operator=(const ChunkCipher &) = delete;
+    
+    void setKey(const QByteArray &key);
+    bool hasKey() const;
+    
+    // Encrypts data in place and appends the tag
+    bool encrypt(Cipher cipher, int chunkIndex, const QByteArray &associatedData, QByteArray &data);
+    // Same for the bytes of buffer from offset on, e.g. behind a frame header
+    bool encrypt(Cipher cipher, int chunkIndex, const QByteArray &associatedData, QByteArray &buffer, qsizetype offset);
+    bool decrypt(Cipher cipher, int chunkIndex, const QByteArray &associatedData,
+                 const QByteArray &sealed, QByteArray &data);
+    
+    // HKDF-SHA256 of the session secret, salted with the transfer id
+    static QByteArray deriveTransferKey(const QByteArray &sessionSecret, const QString &transferId);
+    static Cipher preferredCipher();
+    
+    // Name used for the chunk_encryption negotiation
+    static QString algorithmName();
+
+private:
+    evp_cipher_ctx_st *m_context;
+    QByteArray m_key;
+};
+
+#endif // CHUNKCIPHER_H
@@ -0,0 +1,177 @@
+#include "ChunkCodec.h"
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+#include <QDebug>
+
+bool ChunkCodec::isBinaryFrame(const QByteArray &frame)
+{
+    return frame.size() >= BINARY_HEADER_SIZE &&
+           frame[0] == MAGIC_0 && frame[1] == MAGIC_1 &&
+           static_cast<unsigned char>(frame[2]) == BINARY_HEADER_VERSION;
+}
+
+QByteArray ChunkCodec::encodeBinaryFrame(quint32 transferHandle, const FileChunk &chunk)
+{
+    QByteArray frame(BINARY_HEADER_SIZE + chunk.data.size(), Qt::Uninitialized);
+    uchar *header = reinterpret_cast<uchar *>(frame.data());
+    writeBinaryHeader(header, transferHandle, chunk);
+    memcpy(header + BINARY_HEADER_SIZE, chunk.data.constData(), chunk.data.size());
+    return frame;
+}
+    
+void ChunkCodec::writeBinaryHeader(uchar *header, quint32 transferHandle, const FileChunk &chunk)
+{
+    header[0] = MAGIC_0;
+    header[1] = MAGIC_1;
+    header[2] = BINARY_HEADER_VERSION;
+    header[3] = 0; // reserved
+    
+    quint32 flags = (chunk.isLast ? LastChunk : 0) | (chunk.compressed ? Compressed : 0);
+    if (chunk.cipher == ChunkCipher::Cipher::Aes256Gcm) {
+        flags |= Encrypted;
+    } else if (chunk.cipher == ChunkCipher::Cipher::ChaCha20Poly1305) {
+        flags |= Encrypted | ChaCha20;
+    }
+    qToBigEndian<quint32>(transferHandle, header + 4);
+    qToBigEndian<quint32>(static_cast<quint32>(chunk.chunkIndex), header + 8);
+    qToBigEndian<quint32>(flags, header + 12);
+    
+    // Raw digest, zero padded if the chunk carries none
+    memset(header + 16, 0, DIGEST_SIZE);
+    memcpy(header + 16, chunk.checksum.constData(), qMin(chunk.checksum.size(), static_cast<qsizetype>(DIGEST_SIZE)));
+}
+    
+quint32 ChunkCodec::frameTransferHandle(const QByteArray &frame)
+{
+    if (!isBinaryFrame(frame)) {
+        return 0;
+    }
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(frame.constData()) + 4);
+}
+
+bool ChunkCodec::decodeBinaryFrame(const QByteArray &frame, quint32 &transferHandle, FileChunk &chunk)
+{
+    if (!isBinaryFrame(frame)) {
+        return false;
+    }
+    
+    const uchar *header = reinterpret_cast<const uchar *>(frame.constData());
+    
+    // Indices that do not fit an int would wrap negative
+    quint32 chunkIndex = qFromBigEndian<quint32>(header + 8);
+    if (chunkIndex > static_cast<quint32>(std::numeric_limits<int>::max())) {
+        qWarning() << "Chunk frame index out of range:" << chunkIndex;
+        return false;
+    }
+    
+    transferHandle = qFromBigEndian<quint32>(header + 4);
+    chunk.chunkIndex = static_cast<int>(chunkIndex);
+    quint32 flags = qFromBigEndian<quint32>(header + 12);
+    
+    chunk.frame = frame;
+    chunk.checksum = frameView(frame, 16, DIGEST_SIZE);
+    chunk.isLast = (flags & LastChunk) != 0;
+    chunk.compressed = (flags & Compressed) != 0;
+    if (flags & Encrypted) {
+        chunk.cipher = (flags & ChaCha20) ? ChunkCipher::Cipher::ChaCha20Poly1305 : ChunkCipher::Cipher::Aes256Gcm;
+    } else {
+        chunk.cipher = ChunkCipher::Cipher::None;
+    }
+    chunk.data = frameView(frame, BINARY_HEADER_SIZE, frame.size() - BINARY_HEADER_SIZE);
+    
+    return true;
+}
+
+QByteArray ChunkCodec::encodeJsonFrame(const FileChunk &chunk)
+{
+    // Create chunk header
+    QJsonObject header;
+    header["transfer_id"] = chunk.transferId;
+    header["chunk_index"] = chunk.chunkIndex;
+    header["checksum"] = QString::fromLatin1(chunk.checksum.toHex());
+    header["is_last"] = chunk.isLast;
+    if (chunk.compressed) {
+        header["compressed"] = true;
+    }
+    if (chunk.cipher != ChunkCipher::Cipher::None) {
+        header["cipher"] = static_cast<int>(chunk.cipher);
+    }
+    
+    QJsonDocument headerDoc(header);
+    QByteArray headerData = headerDoc.toJson(QJsonDocument::Compact);
+    
+    // Create binary message: [header_length(4 bytes)][header][chunk_data]
+    QByteArray message;
+    message.reserve(4 + headerData.size() + chunk.data.size());
+    
+    // Header length (4 bytes, big-endian)
+    int headerLength = headerData.size();
+    message.append(static_cast<char>((headerLength >> 24) & 0xFF));
+    message.append(static_cast<char>((headerLength >> 16) & 0xFF));
+    message.append(static_cast<char>((headerLength >> 8) & 0xFF));
+    message.append(static_cast<char>(headerLength & 0xFF));
+    
+    // Header and chunk data
+    message.append(headerData);
+    message.append(chunk.data);
+    
+    return message;
+}
+
+bool ChunkCodec::decodeJsonFrame(const QByteArray &frame, FileChunk &chunk)
+{
+    if (frame.size() < 4) {
+        qWarning() << "Binary message too short";
+        return false;
+    }
+    
+    // Extract header length (first 4 bytes)
+    int headerLength = (static_cast<unsigned char>(frame[0]) << 24) |
+                      (static_cast<unsigned char>(frame[1]) << 16) |
+                      (static_cast<unsigned char>(frame[2]) << 8) |
+                      static_cast<unsigned char>(frame[3]);
+    
+    if (headerLength < 0 || headerLength > frame.size() - 4) {
+        qWarning() << "Invalid header length in binary message";
+        return false;
+    }
+    
+    // Parse header
+    QByteArray headerData = frameView(frame, 4, headerLength);
+    
+    QJsonParseError parseError;
+    QJsonDocument headerDoc = QJsonDocument::fromJson(headerData, &parseError);
+    
+    if (parseError.error != QJsonParseError::NoError) {
+        qWarning() << "Failed to parse chunk header:" << parseError.errorString();
+        return false;
+    }
+    
+    QJsonObject header = headerDoc.object();
+    
+    chunk.transferId = header["transfer_id"].toString();
+    chunk.chunkIndex = header["chunk_index"].toInt();
+    chunk.frame = frame;
+    chunk.data = frameView(frame, 4 + headerLength, frame.size() - 4 - headerLength);
+    chunk.checksum = QByteArray::fromHex(header["checksum"].toString().toLatin1());
+    chunk.isLast = header["is_last"].toBool();
+    chunk.compressed = header["compressed"].toBool();
+    
+    int cipher = header["cipher"].toInt(0);
+    if (cipher < 0 || cipher > static_cast<int>(ChunkCipher::Cipher::ChaCha20Poly1305)) {
+        qWarning() << "Unknown chunk cipher:" << cipher;
+        return false;
+    }
+    chunk.cipher = static_cast<ChunkCipher::Cipher>(cipher);
+    
+    return true;
+}
+
+QByteArray ChunkCodec::frameView(const QByteArray &frame, qsizetype offset, qsizetype size)
+{
+    // Non-owning view, valid for as long as the frame is referenced
+    return QByteArray::fromRawData(frame.constData() + offset, size);
+}
@@ -0,0 +1,63 @@
+#ifndef CHUNKCODEC_H
+#define CHUNKCODEC_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include "FileTransferManager.h"
+
+// Chunk frame formats
+//
+// JSON (version 0, legacy servers):
+//   [header_length(4 bytes, big-endian)][JSON header][chunk_data]
+//
+// Binary (version 1), fixed 48 byte header, all integers big-endian:
+//   [magic(2) "OD"][version(1)][reserved(1)]
+//   [transfer_handle(4)][chunk_index(4)][flags(4)][digest(32)][chunk_data]
+//
+// JSON frames always start with a zero byte (header length < 16MB), so the
+// two formats can be told apart from the first byte of the frame.
+//
+// Decoding does not copy: the chunk keeps a reference to the frame and its
+// data and checksum are raw views into it. Uploads can be framed in place
+// the same way, with the payload already behind BINARY_HEADER_SIZE bytes
+// of a buffer (see ChunkBufferPool) and the header written in front.
+class ChunkCodec
+{
+public:
+    // Chunk header versions
+    static const int JSON_HEADER_VERSION = 0;
+    static const int BINARY_HEADER_VERSION = 1;
+    static const int LATEST_HEADER_VERSION = BINARY_HEADER_VERSION;
+    
+    static const int BINARY_HEADER_SIZE = 48;
+    static const int DIGEST_SIZE = 32; // Largest chunk digest, shorter ones are zero padded
+    
+    // Binary header flags
+    enum Flag : quint32 {
+        LastChunk = 0x1,
+        Compressed = 0x2,
+        Encrypted = 0x4,  // AES-256-GCM unless ChaCha20 is also set
+        ChaCha20 = 0x8
+    };
+    
+    // Binary frames
+    static bool isBinaryFrame(const QByteArray &frame);
+    static QByteArray encodeBinaryFrame(quint32 transferHandle, const FileChunk &chunk);
+    static bool decodeBinaryFrame(const QByteArray &frame, quint32 &transferHandle, FileChunk &chunk);
+    // Header only, into the first BINARY_HEADER_SIZE bytes at header
+    static void writeBinaryHeader(uchar *header, quint32 transferHandle, const FileChunk &chunk);
+    // Handle in a binary frame's header, 0 for anything else
+    static quint32 frameTransferHandle(const QByteArray &frame);
+    
+    // JSON frames
+    static QByteArray encodeJsonFrame(const FileChunk &chunk);
+    static bool decodeJsonFrame(const QByteArray &frame, FileChunk &chunk);
+
+private:
+    static QByteArray frameView(const QByteArray &frame, qsizetype offset, qsizetype size);
+    
+    static const char MAGIC_0 = 'O';
+    static const char MAGIC_1 = 'D';
+};
+
+#endif // CHUNKCODEC_H
@@ -0,0 +1,147 @@
+#include "ChunkCompressor.h"
+#include <QFileInfo>
+#include <QSet>
+#include <QDebug>
+#include <zlib.h>
+#include <cstring>
+
+// Adaptive bypass
+static const int SAMPLE_CHUNKS = 4;
+static const double MAX_SAMPLE_RATIO = 0.9; // Must save at least 10%
+
+ChunkCompressor::ChunkCompressor()
+    : m_deflate(nullptr)
+    , m_inflate(nullptr)
+    , m_sampledChunks(0)
+    , m_sampledOriginalBytes(0)
+    , m_sampledCompressedBytes(0)
+    , m_bypass(false)
+{
+}
+
+ChunkCompressor::~ChunkCompressor()
+{
+    if (m_deflate) {
+        deflateEnd(m_deflate.get());
+    }
+    if (m_inflate) {
+        inflateEnd(m_inflate.get());
+    }
+}
+
+bool ChunkCompressor::compress(const QByteArray &data, QByteArray &compressed)
+{
+    if (!m_deflate) {
+        auto stream = std::make_unique<z_stream_s>();
+        memset(stream.get(), 0, sizeof(z_stream_s));
+        
+        // Fastest level, the link is the bottleneck we are trading CPU for
+        if (deflateInit(stream.get(), Z_BEST_SPEED) != Z_OK) {
+            qWarning() << "Failed to initialize chunk compression";
+            return false;
+        }
+        m_deflate = std::move(stream);
+    } else {
+        deflateReset(m_deflate.get());
+    }
+    
+    compressed.resize(static_cast<qsizetype>(deflateBound(m_deflate.get(), static_cast<uLong>(data.size()))));
+    
+    m_deflate->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    m_deflate->avail_in = static_cast<uInt>(data.size());
+    m_deflate->next_out = reinterpret_cast<Bytef *>(compressed.data());
+    m_deflate->avail_out = static_cast<uInt>(compressed.size());
+    
+    if (deflate(m_deflate.get(), Z_FINISH) != Z_STREAM_END) {
+        qWarning() << "Failed to compress chunk";
+        return false;
+    }
+    
+    compressed.resize(static_cast<qsizetype>(m_deflate->total_out));
+    return true;
+}
+
+bool ChunkCompressor::decompress(const QByteArray &compressed, QByteArray &data, qint64 maxSize)
+{
+    if (!m_inflate) {
+        auto stream = std::make_unique<z_stream_s>();
+        memset(stream.get(), 0, sizeof(z_stream_s));
+        
+        if (inflateInit(stream.get()) != Z_OK) {
+            qWarning() << "Failed to initialize chunk decompression";
+            return false;
+        }
+        m_inflate = std::move(stream);
+    } else {
+        inflateReset(m_inflate.get());
+    }
+    
+    m_inflate->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.constData()));
+    m_inflate->avail_in = static_cast<uInt>(compressed.size());
+    
+    // Grow the output as needed, but never past what the caller expects
+    qint64 capacity = qMin(maxSize, qMax<qint64>(compressed.size() * 4, 4096));
+    data.resize(static_cast<qsizetype>(capacity));
+    
+    int result = Z_OK;
+    while (result == Z_OK) {
+        if (m_inflate->total_out == static_cast<uLong>(data.size())) {
+            if (data.size() >= maxSize) {
+                break;
+            }
+            data.resize(static_cast<qsizetype>(qMin(maxSize, static_cast<qint64>(data.size()) * 2)));
+        }
+        
+        m_inflate->next_out = reinterpret_cast<Bytef *>(data.data()) + m_inflate->total_out;
+        m_inflate->avail_out = static_cast<uInt>(data.size() - static_cast<qsizetype>(m_inflate->total_out));
+        result = inflate(m_inflate.get(), Z_NO_FLUSH);
+    }
+    
+    if (result != Z_STREAM_END) {
+        qWarning() << "Failed to decompress chunk:" << result;
+        data.clear();
+        return false;
+    }
+    
+    data.resize(static_cast<qsizetype>(m_inflate->total_out));
+    return true;
+}
+
+void ChunkCompressor::recordSample(qint64 originalBytes, qint64 compressedBytes)
+{
+    if (m_sampledChunks >= SAMPLE_CHUNKS) {
+        return;
+    }
+    
+    m_sampledChunks++;
+    m_sampledOriginalBytes += originalBytes;
+    m_sampledCompressedBytes += compressedBytes;
+    
+    if (m_sampledChunks == SAMPLE_CHUNKS &&
+        m_sampledCompressedBytes > m_sampledOriginalBytes * MAX_SAMPLE_RATIO) {
+        qDebug() << "Chunks do not compress, sending the rest uncompressed";
+        m_bypass = true;
+    }
+}
+
+bool ChunkCompressor::shouldCompress() const
+{
+    return !m_bypass;
+}
+
+bool ChunkCompressor::isCompressibleFile(const QString &fileName)
+{
+    // Archives, media and zip based office formats
+    static const QSet<QString> compressedExtensions = {
+        "zip", "rar", "7z", "gz", "tgz", "bz2", "xz", "zst", "lz4",
+        "jpg", "jpeg", "png", "gif", "webp", "mp3", "mp4", "mkv", "avi", "mov",
+        "docx", "xlsx", "pptx", "odt", "ods", "odp"
+    };
+    
+    return !compressedExtensions.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+QString ChunkCompressor::algorithmName()
+{
+    return "deflate";
+}
@@ -0,0 +1,47 @@
+#ifndef CHUNKCOMPRESSOR_H
+#define CHUNKCOMPRESSOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+struct z_stream_s;
+
+// Per-transfer chunk compression. The deflate and inflate streams live as
+// long as the transfer and are reset between chunks, so every chunk
+// decompresses on its own even when it is retransmitted or arrives out of
+// order. The first chunks are sampled and compression is bypassed for the
+// rest of the transfer if they do not shrink enough.
+class ChunkCompressor
+{
+public:
+    ChunkCompressor();
+    ~ChunkCompressor();
+    
+    ChunkCompressor(const ChunkCompressor &) = delete;
+    ChunkCompressor &operator=(const ChunkCompressor &) = delete;
+    
+    bool compress(const QByteArray &data, QByteArray &compressed);
+    bool decompress(const QByteArray &compressed, QByteArray &data, qint64 maxSize);
+    
+    // Adaptive bypass
+    void recordSample(qint64 originalBytes, qint64 compressedBytes);
+    bool shouldCompress() const;
+    
+    // Already compressed formats are never worth another pass
+    static bool isCompressibleFile(const QString &fileName);
+    
+    // Name used for the chunk_compression negotiation
+    static QString algorithmName();
+
+private:
+    std::unique_ptr<z_stream_s> m_deflate;
+    std::unique_ptr<z_stream_s> m_inflate;
+    
+    int m_sampledChunks;
+    qint64 m_sampledOriginalBytes;
+    qint64 m_sampledCompressedBytes;
+    bool m_bypass;
+};
+
+#endif // CHUNKCOMPRESSOR_H
@@ -0,0 +1,156 @@
+#include "ChunkIntegrity.h"
+#include <QCryptographicHash>
+#include <QtEndian>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHUNKINTEGRITY_HAS_SSE42_PATH
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CRC32C_SSE42_TARGET
+#else
+#include <cpuid.h>
+#define CRC32C_SSE42_TARGET __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace {
+
+// Castagnoli polynomial, reflected
+const quint32 CRC32C_POLYNOMIAL = 0x82F63B78;
+
+struct Crc32cTable
+{
+    quint32 entries[256];
+    
+    Crc32cTable()
+    {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+quint32 crc32cSoftware(quint32 crc, const uchar *data, qsizetype size)
+{
+    static const Crc32cTable table;
+    
+    for (qsizetype i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHUNKINTEGRITY_HAS_SSE42_PATH
+bool cpuHasSse42()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+CRC32C_SSE42_TARGET quint32 crc32cSse42(quint32 crc, const uchar *data, qsizetype size)
+{
+    quint64 crc64 = crc;
+    while (size >= 8) {
+        quint64 word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        size -= 8;
+    }
+    
+    crc = static_cast<quint32>(crc64);
+    while (size > 0) {
+        crc = _mm_crc32_u8(crc, *data);
+        ++data;
+        --size;
+    }
+    return crc;
+}
+#endif
+
+} // namespace
+
+QByteArray ChunkIntegrity::digest(Algorithm algorithm, const QByteArray &data)
+{
+    switch (algorithm) {
+        case Algorithm::Crc32c: {
+            QByteArray result(sizeof(quint32), Qt::Uninitialized);
+            qToBigEndian<quint32>(crc32c(data.constData(), data.size()), result.data());
+            return result;
+        }
+        case Algorithm::Blake2s:
+            return QCryptographicHash::hash(data, QCryptographicHash::Blake2s_256);
+        case Algorithm::Sha256:
+        default:
+            return QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+    }
+}
+
+bool ChunkIntegrity::verify(Algorithm algorithm, const QByteArray &data, const QByteArray &digest)
+{
+    // Binary headers zero pad short digests to the fixed digest field
+    QByteArray expected = ChunkIntegrity::digest(algorithm, data);
+    return digest.size() >= expected.size() &&
+           memcmp(digest.constData(), expected.constData(), expected.size()) == 0;
+}
+
+QStringList ChunkIntegrity::supportedAlgorithms()
+{
+    return {
+        algorithmToString(Algorithm::Crc32c),
+        algorithmToString(Algorithm::Blake2s),
+        algorithmToString(Algorithm::Sha256)
+    };
+}
+
+QString ChunkIntegrity::algorithmToString(Algorithm algorithm)
+{
+    switch (algorithm) {
+        case Algorithm::Crc32c: return "crc32c";
+        case Algorithm::Blake2s: return "blake2s";
+        case Algorithm::Sha256:
+        default: return "sha256";
+    }
+}
+
+ChunkIntegrity::Algorithm ChunkIntegrity::stringToAlgorithm(const QString &name, bool *ok)
+{
+    if (ok) {
+        *ok = true;
+    }
+    
+    if (name == "sha256") return Algorithm::Sha256;
+    if (name == "crc32c") return Algorithm::Crc32c;
+    if (name == "blake2s") return Algorithm::Blake2s;
+    
+    if (ok) {
+        *ok = false;
+    }
+    return Algorithm::Sha256;
+}
+
+quint32 ChunkIntegrity::crc32c(const char *data, qsizetype size)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+
+#ifdef CHUNKINTEGRITY_HAS_SSE42_PATH
+    static const bool hasSse42 = cpuHasSse42();
+    if (hasSse42) {
+        return ~crc32cSse42(0xFFFFFFFF, bytes, size);
+    }
+#endif
+
+    return ~crc32cSoftware(0xFFFFFFFF, bytes, size);
+}
@@ -0,0 +1,33 @@
+#ifndef CHUNKINTEGRITY_H
+#define CHUNKINTEGRITY_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Per-chunk integrity check, negotiated with the server at session
+// registration. The WebSocket is already protected by TLS, so the chunk
+// digest only has to catch corruption; the whole-file digest stays SHA-256.
+class ChunkIntegrity
+{
+public:
+    enum class Algorithm {
+        Sha256,  // Legacy default, understood by every server
+        Crc32c,  // Hardware accelerated where SSE4.2 is available
+        Blake2s  // Cryptographic, considerably cheaper than SHA-256
+    };
+    
+    static QByteArray digest(Algorithm algorithm, const QByteArray &data);
+    static bool verify(Algorithm algorithm, const QByteArray &data, const QByteArray &digest);
+    
+    // Algorithm names in client preference order
+    static QStringList supportedAlgorithms();
+    
+    static QString algorithmToString(Algorithm algorithm);
+    static Algorithm stringToAlgorithm(const QString &name, bool *ok = nullptr);
+
+private:
+    static quint32 crc32c(const char *data, qsizetype size);
+};
+
+#endif // CHUNKINTEGRITY_H
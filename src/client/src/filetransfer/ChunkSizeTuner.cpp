@@ -0,0 +1,110 @@
+#include "ChunkSizeTuner.h"
+
+// Weight of the newest sample
+static const double SAMPLE_WEIGHT = 0.2;
+
+// Retransmit rates above which the chunk is halved or quartered
+static const double LOW_LOSS_RATE = 0.005;
+static const double HIGH_LOSS_RATE = 0.02;
+
+ChunkSizeTuner::ChunkSizeTuner(int baseChunkSize)
+    : m_baseChunkSize(clamp(baseChunkSize))
+    , m_rtt(0)
+    , m_throughput(0)
+    , m_retransmitRate(0)
+    , m_hasRtt(false)
+    , m_hasThroughput(false)
+{
+}
+
+void ChunkSizeTuner::setBaseChunkSize(int bytes)
+{
+    m_baseChunkSize = clamp(bytes);
+}
+
+int ChunkSizeTuner::getBaseChunkSize() const
+{
+    return m_baseChunkSize;
+}
+
+void ChunkSizeTuner::recordSample(qint64 rttMs, qint64 bytes, qint64 elapsedMs, int chunksSent, int chunksRetransmitted)
+{
+    if (rttMs > 0) {
+        m_rtt = m_hasRtt ? m_rtt + SAMPLE_WEIGHT * (rttMs - m_rtt) : rttMs;
+        m_hasRtt = true;
+    }
+    
+    // Idle periods (paused, waiting for the peer) say nothing about the link
+    if (elapsedMs > 0 && bytes > 0) {
+        double throughput = bytes * 1000.0 / elapsedMs;
+        m_throughput = m_hasThroughput ? m_throughput + SAMPLE_WEIGHT * (throughput - m_throughput) : throughput;
+        m_hasThroughput = true;
+    }
+    
+    if (chunksSent > 0) {
+        double rate = qMin(1.0, static_cast<double>(chunksRetransmitted) / chunksSent);
+        m_retransmitRate += SAMPLE_WEIGHT * (rate - m_retransmitRate);
+    }
+}
+
+bool ChunkSizeTuner::hasSamples() const
+{
+    return m_hasThroughput;
+}
+
+int ChunkSizeTuner::recommendedChunkSize(int windowChunks) const
+{
+    if (!m_hasThroughput) {
+        return m_baseChunkSize;
+    }
+    
+    // Long enough on the wire to amortise per-chunk overhead...
+    double size = m_throughput * TARGET_CHUNK_TIME_MS / 1000.0;
+    
+    // ...and large enough for the window to keep the pipe full
+    if (m_hasRtt) {
+        size = qMax(size, m_throughput * m_rtt / 1000.0 / qMax(1, windowChunks));
+    }
+    
+    // Smaller chunks lose less to each retransmission
+    if (m_retransmitRate > HIGH_LOSS_RATE) {
+        size /= 4;
+    } else if (m_retransmitRate > LOW_LOSS_RATE) {
+        size /= 2;
+    }
+    
+    int chunkSize = MIN_CHUNK_SIZE;
+    while (chunkSize < MAX_CHUNK_SIZE && chunkSize * 2.0 <= size) {
+        chunkSize *= 2;
+    }
+    return chunkSize;
+}
+
+double ChunkSizeTuner::getRtt() const
+{
+    return m_rtt;
+}
+
+double ChunkSizeTuner::getThroughput() const
+{
+    return m_throughput;
+}
+
+double ChunkSizeTuner::getRetransmitRate() const
+{
+    return m_retransmitRate;
+}
+
+void ChunkSizeTuner::reset()
+{
+    m_rtt = 0;
+    m_throughput = 0;
+    m_retransmitRate = 0;
+    m_hasRtt = false;
+    m_hasThroughput = false;
+}
+
+int ChunkSizeTuner::clamp(int bytes)
+{
+    return qBound(static_cast<int>(MIN_CHUNK_SIZE), bytes, static_cast<int>(MAX_CHUNK_SIZE));
+}
@@ -0,0 +1,53 @@
+#ifndef CHUNKSIZETUNER_H
+#define CHUNKSIZETUNER_H
+
+#include <QtGlobal>
+
+// Picks the chunk size for new transfers from what the link did recently.
+//
+// Workers report round trips, bytes moved and retransmissions; the tuner
+// keeps exponentially weighted averages of RTT, throughput and the share of
+// chunks sent again. A new transfer gets a chunk that takes about
+// TARGET_CHUNK_TIME_MS to move, so fast links spread the per-chunk cost over
+// large chunks, and that lets the send window cover the bandwidth-delay
+// product. Loss shrinks the chunk so a retransmission costs less. Sizes are
+// powers of two between MIN_CHUNK_SIZE and MAX_CHUNK_SIZE.
+//
+// Not thread safe, the manager calls it with its mutex held.
+class ChunkSizeTuner
+{
+public:
+    static const int DEFAULT_CHUNK_SIZE = 64 * 1024;      // 64KB, also what legacy peers use
+    static const int MIN_CHUNK_SIZE = 16 * 1024;          // 16KB
+    static const int MAX_CHUNK_SIZE = 4 * 1024 * 1024;    // 4MB
+    static const int TARGET_CHUNK_TIME_MS = 50;
+    
+    explicit ChunkSizeTuner(int baseChunkSize = DEFAULT_CHUNK_SIZE);
+    
+    // Used until the first samples arrive
+    void setBaseChunkSize(int bytes);
+    int getBaseChunkSize() const;
+    
+    // One sampling period of a transfer; rttMs is 0 when no chunk was timed
+    void recordSample(qint64 rttMs, qint64 bytes, qint64 elapsedMs, int chunksSent, int chunksRetransmitted);
+    bool hasSamples() const;
+    int recommendedChunkSize(int windowChunks) const;
+    
+    double getRtt() const;            // ms
+    double getThroughput() const;     // bytes/s
+    double getRetransmitRate() const; // 0..1
+    
+    void reset();
+    
+    static int clamp(int bytes);
+
+private:
+    int m_baseChunkSize;
+    double m_rtt;
+    double m_throughput;
+    double m_retransmitRate;
+    bool m_hasRtt;
+    bool m_hasThroughput;
+};
+
+#endif // CHUNKSIZETUNER_H
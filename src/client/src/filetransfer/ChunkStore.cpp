@@ -0,0 +1,275 @@
+#include "ChunkStore.h"
+#include "ChunkIntegrity.h"
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QList>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <QDebug>
+
+// Index layout, big-endian:
+//   [magic(4) "ODCS"][version(4)][count(4)][use_clock(8)]
+//   count * [key(32)][size(4)][last_used(8)]
+static const char INDEX_MAGIC[] = "ODCS";
+static const quint32 INDEX_VERSION = 1;
+static const int INDEX_HEADER_SIZE = 20;
+static const int INDEX_ENTRY_SIZE = ChunkStore::KEY_SIZE + 12;
+static const char *INDEX_FILE_NAME = "index";
+static const int INDEX_SAVE_INTERVAL = 64; // changes between index writes
+static const int EVICTION_TARGET_PERCENT = 90; // evict down to, avoids evicting on every put
+
+ChunkStore::ChunkStore(const QString &directory, qint64 maxSize)
+    : m_directory(directory)
+    , m_maxSize(maxSize)
+    , m_size(0)
+    , m_useClock(0)
+    , m_unsavedChanges(0)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    QDir().mkpath(m_directory);
+    loadIndex();
+    evict();
+}
+
+ChunkStore::~ChunkStore()
+{
+    saveIndex();
+}
+
+QByteArray ChunkStore::keyFor(const QByteArray &data)
+{
+    return ChunkIntegrity::digest(ChunkIntegrity::Algorithm::Blake2s, data);
+}
+
+QString ChunkStore::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/chunkstore";
+}
+
+bool ChunkStore::contains(const QByteArray &key) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.contains(key);
+}
+
+bool ChunkStore::get(const QByteArray &key, QByteArray &data)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return false;
+    }
+    
+    QFile file(pathFor(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        removeEntry(key);
+        return false;
+    }
+    
+    data = file.read(it->size);
+    if (data.size() != it->size || keyFor(data) != key) {
+        qWarning() << "Dropping corrupt cached chunk" << key.toHex();
+        file.close();
+        QFile::remove(pathFor(key));
+        removeEntry(key);
+        data.clear();
+        return false;
+    }
+    
+    it->lastUsed = ++m_useClock;
+    m_unsavedChanges++;
+    return true;
+}
+
+bool ChunkStore::put(const QByteArray &key, const QByteArray &data)
+{
+    if (key.size() != KEY_SIZE || data.isEmpty()) {
+        return false;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        it->lastUsed = ++m_useClock;
+        m_unsavedChanges++;
+        return true;
+    }
+    
+    if (data.size() > m_maxSize) {
+        return false;
+    }
+    
+    // Written without the lock, other transfers keep using the store; a
+    // concurrent put of the same key writes the same bytes
+    QString path = pathFor(key);
+    locker.unlock();
+    
+    QDir().mkpath(path.left(path.lastIndexOf('/')));
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "Failed to cache chunk" << path << ":" << file.errorString();
+        return false;
+    }
+    
+    locker.relock();
+    it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        it->lastUsed = ++m_useClock;
+        m_unsavedChanges++;
+        return true;
+    }
+    
+    m_entries.insert(key, Entry{data.size(), ++m_useClock});
+    m_size += data.size();
+    
+    evict();
+    
+    if (++m_unsavedChanges >= INDEX_SAVE_INTERVAL) {
+        writeIndex();
+    }
+    return true;
+}
+
+void ChunkStore::setMaxSize(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxSize = qMax<qint64>(0, bytes);
+    evict();
+}
+
+qint64 ChunkStore::getMaxSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxSize;
+}
+
+qint64 ChunkStore::getSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
+
+int ChunkStore::getChunkCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+bool ChunkStore::saveIndex()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_unsavedChanges == 0 || writeIndex();
+}
+
+void ChunkStore::loadIndex()
+{
+    QFile file(m_directory + '/' + INDEX_FILE_NAME);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    QByteArray index = file.readAll();
+    const uchar *data = reinterpret_cast<const uchar *>(index.constData());
+    
+    if (index.size() < INDEX_HEADER_SIZE || memcmp(data, INDEX_MAGIC, 4) != 0 ||
+        qFromBigEndian<quint32>(data + 4) != INDEX_VERSION) {
+        qWarning() << "Ignoring unreadable chunk store index" << file.fileName();
+        return;
+    }
+    
+    quint32 count = qFromBigEndian<quint32>(data + 8);
+    if (index.size() != INDEX_HEADER_SIZE + static_cast<qint64>(count) * INDEX_ENTRY_SIZE) {
+        qWarning() << "Ignoring truncated chunk store index" << file.fileName();
+        return;
+    }
+    
+    m_useClock = qFromBigEndian<quint64>(data + 12);
+    m_entries.reserve(count);
+    
+    const uchar *entry = data + INDEX_HEADER_SIZE;
+    for (quint32 i = 0; i < count; ++i, entry += INDEX_ENTRY_SIZE) {
+        QByteArray key(reinterpret_cast<const char *>(entry), KEY_SIZE);
+        qint64 size = qFromBigEndian<quint32>(entry + KEY_SIZE);
+        quint64 lastUsed = qFromBigEndian<quint64>(entry + KEY_SIZE + 4);
+        
+        m_entries.insert(key, Entry{size, lastUsed});
+        m_size += size;
+        m_useClock = qMax(m_useClock, lastUsed);
+    }
+}
+
+bool ChunkStore::writeIndex()
+{
+    QByteArray index(INDEX_HEADER_SIZE + static_cast<qsizetype>(m_entries.size()) * INDEX_ENTRY_SIZE, Qt::Uninitialized);
+    uchar *data = reinterpret_cast<uchar *>(index.data());
+    
+    memcpy(data, INDEX_MAGIC, 4);
+    qToBigEndian<quint32>(INDEX_VERSION, data + 4);
+    qToBigEndian<quint32>(static_cast<quint32>(m_entries.size()), data + 8);
+    qToBigEndian<quint64>(m_useClock, data + 12);
+    
+    uchar *entry = data + INDEX_HEADER_SIZE;
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it, entry += INDEX_ENTRY_SIZE) {
+        memcpy(entry, it.key().constData(), KEY_SIZE);
+        qToBigEndian<quint32>(static_cast<quint32>(it->size), entry + KEY_SIZE);
+        qToBigEndian<quint64>(it->lastUsed, entry + KEY_SIZE + 4);
+    }
+    
+    // Replace atomically, a torn index would forget the whole store
+    QSaveFile file(m_directory + '/' + INDEX_FILE_NAME);
+    if (!file.open(QIODevice::WriteOnly) || file.write(index) != index.size() || !file.commit()) {
+        qWarning() << "Failed to write chunk store index:" << file.errorString();
+        return false;
+    }
+    
+    m_unsavedChanges = 0;
+    return true;
+}
+
+void ChunkStore::evict()
+{
+    if (m_size <= m_maxSize) {
+        return;
+    }
+    
+    QList<QPair<quint64, QByteArray>> byAge;
+    byAge.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        byAge.append(qMakePair(it->lastUsed, it.key()));
+    }
+    std::sort(byAge.begin(), byAge.end());
+    
+    qint64 target = m_maxSize * EVICTION_TARGET_PERCENT / 100;
+    for (const auto &candidate : byAge) {
+        if (m_size <= target) {
+            break;
+        }
+        QFile::remove(pathFor(candidate.second));
+        removeEntry(candidate.second);
+    }
+}
+
+void ChunkStore::removeEntry(const QByteArray &key)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return;
+    }
+    
+    m_size -= it->size;
+    m_entries.erase(it);
+    m_unsavedChanges++;
+}
+
+QString ChunkStore::pathFor(const QByteArray &key) const
+{
+    // Fan out over 256 directories to keep them small
+    QString hex = QString::fromLatin1(key.toHex());
+    return m_directory + '/' + hex.left(2) + '/' + hex;
+}
@@ -0,0 +1,70 @@
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+
+// Content-addressed cache of chunk payloads shared by all transfers.
+//
+// Chunks are keyed by their BLAKE2s-256 digest and kept as one file each
+// under the store directory. The store is bounded: once it grows past its
+// size limit the least recently used chunks are evicted. A compact binary
+// index (key, size, last use) is read in one go at startup; chunk files the
+// index does not know about are ignored, chunks it lists that have gone
+// missing are dropped when they are looked up.
+//
+// The store is shared between transfer threads, every call locks; chunk
+// files are written with the lock released.
+class ChunkStore
+{
+public:
+    static const int KEY_SIZE = 32;
+    static const qint64 DEFAULT_MAX_SIZE = 1024LL * 1024 * 1024; // 1GB
+    
+    explicit ChunkStore(const QString &directory, qint64 maxSize = DEFAULT_MAX_SIZE);
+    ~ChunkStore();
+    
+    static QByteArray keyFor(const QByteArray &data);
+    static QString defaultDirectory();
+    
+    bool contains(const QByteArray &key) const;
+    // Fails if the chunk is unknown or no longer matches its key
+    bool get(const QByteArray &key, QByteArray &data);
+    bool put(const QByteArray &key, const QByteArray &data);
+    
+    // Size limit in bytes, shrinking it evicts right away
+    void setMaxSize(qint64 bytes);
+    qint64 getMaxSize() const;
+    qint64 getSize() const;
+    int getChunkCount() const;
+    
+    bool saveIndex();
+
+private:
+    struct Entry {
+        qint64 size;
+        quint64 lastUsed;
+    };
+    
+    // m_mutex must be held
+    void loadIndex();
+    bool writeIndex();
+    void evict();
+    void removeEntry(const QByteArray &key);
+    QString pathFor(const QByteArray &key) const;
+    
+    QString m_directory;
+    qint64 m_maxSize;
+    qint64 m_size;
+    
+    // LRU order is tracked with a use counter, persisted with the index
+    QHash<QByteArray, Entry> m_entries;
+    quint64 m_useClock;
+    int m_unsavedChanges;
+    
+    mutable QMutex m_mutex;
+};
+
+#endif // CHUNKSTORE_H
@@ -0,0 +1,160 @@
+#include "ControlCodec.h"
+#include <QHash>
+#include <QtEndian>
+#include <QDebug>
+#include <limits>
+
+static const quint32 MAX_WIRE_INDEX = std::numeric_limits<int>::max();
+static const int TRANSFER_ENTRY_SIZE = 10; // handle, cumulative, range count
+static const int RANGE_ENTRY_SIZE = 8;
+
+static const QHash<QString, ControlCodec::MessageType> &messageTypes()
+{
+    static const QHash<QString, ControlCodec::MessageType> types = {
+        {"file_transfer_response", ControlCodec::MessageType::FileTransferResponse},
+        {"transfer_status_update", ControlCodec::MessageType::TransferStatusUpdate},
+        {"chunk_ack", ControlCodec::MessageType::ChunkAck},
+        {"progress_response", ControlCodec::MessageType::ProgressResponse},
+        {"error", ControlCodec::MessageType::Error},
+        {"transfer_resume", ControlCodec::MessageType::TransferResume},
+        {"delta_ready", ControlCodec::MessageType::DeltaReady},
+        {"chunk_have", ControlCodec::MessageType::ChunkHave},
+        {"session_registered", ControlCodec::MessageType::SessionRegistered},
+        {"pong", ControlCodec::MessageType::Pong},
+        {"transfer_request", ControlCodec::MessageType::TransferRequest}
+    };
+    return types;
+}
+
+ControlCodec::MessageType ControlCodec::messageType(const QString &name)
+{
+    return messageTypes().value(name, MessageType::Unknown);
+}
+
+QString ControlCodec::messageTypeName(MessageType type)
+{
+    return messageTypes().key(type);
+}
+
+bool ControlCodec::isControlFrame(const QByteArray &frame)
+{
+    return frame.size() >= CONTROL_HEADER_SIZE &&
+           frame[0] == MAGIC_0 && frame[1] == MAGIC_1 &&
+           static_cast<unsigned char>(frame[2]) == CONTROL_FRAME_VERSION;
+}
+
+ControlCodec::MessageType ControlCodec::frameMessageType(const QByteArray &frame)
+{
+    if (!isControlFrame(frame)) {
+        return MessageType::Unknown;
+    }
+    return static_cast<MessageType>(static_cast<unsigned char>(frame[3]));
+}
+
+QByteArray ControlCodec::encodeChunkAcks(const QList<ChunkAcks> &acks)
+{
+    int transferCount = qMin(static_cast<int>(acks.size()), 0xFFFF);
+    qsizetype size = CONTROL_HEADER_SIZE + 2;
+    for (int i = 0; i < transferCount; ++i) {
+        size += TRANSFER_ENTRY_SIZE + qMin(static_cast<int>(acks[i].ranges.size()), 0xFFFF) * RANGE_ENTRY_SIZE;
+    }
+    
+    QByteArray frame(size, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(frame.data());
+    out[0] = MAGIC_0;
+    out[1] = MAGIC_1;
+    out[2] = CONTROL_FRAME_VERSION;
+    out[3] = static_cast<uchar>(MessageType::ChunkAck);
+    qToBigEndian<quint16>(static_cast<quint16>(transferCount), out + 4);
+    out += CONTROL_HEADER_SIZE + 2;
+    
+    for (int i = 0; i < transferCount; ++i) {
+        const ChunkAcks &entry = acks[i];
+        int rangeCount = qMin(static_cast<int>(entry.ranges.size()), 0xFFFF);
+        qToBigEndian<quint32>(entry.transferHandle, out);
+        qToBigEndian<quint32>(static_cast<quint32>(qMax(0, entry.cumulative)), out + 4);
+        qToBigEndian<quint16>(static_cast<quint16>(rangeCount), out + 8);
+        out += TRANSFER_ENTRY_SIZE;
+        
+        for (int range = 0; range < rangeCount; ++range) {
+            qToBigEndian<quint32>(static_cast<quint32>(qMax(0, entry.ranges[range].first)), out);
+            qToBigEndian<quint32>(static_cast<quint32>(qMax(0, entry.ranges[range].second)), out + 4);
+            out += RANGE_ENTRY_SIZE;
+        }
+    }
+    
+    return frame;
+}
+
+bool ControlCodec::decodeChunkAcks(const QByteArray &frame, QList<ChunkAcks> &acks)
+{
+    if (frameMessageType(frame) != MessageType::ChunkAck || frame.size() < CONTROL_HEADER_SIZE + 2) {
+        return false;
+    }
+    
+    const uchar *in = reinterpret_cast<const uchar *>(frame.constData());
+    const uchar *end = in + frame.size();
+    int transferCount = qFromBigEndian<quint16>(in + CONTROL_HEADER_SIZE);
+    in += CONTROL_HEADER_SIZE + 2;
+    
+    acks.clear();
+    acks.reserve(transferCount);
+    for (int i = 0; i < transferCount; ++i) {
+        if (end - in < TRANSFER_ENTRY_SIZE) {
+            qWarning() << "Chunk ack frame truncated";
+            return false;
+        }
+        
+        ChunkAcks entry;
+        entry.transferHandle = qFromBigEndian<quint32>(in);
+        entry.cumulative = static_cast<int>(qMin<quint32>(qFromBigEndian<quint32>(in + 4), MAX_WIRE_INDEX));
+        int rangeCount = qFromBigEndian<quint16>(in + 8);
+        in += TRANSFER_ENTRY_SIZE;
+        
+        if (end - in < static_cast<qsizetype>(rangeCount) * RANGE_ENTRY_SIZE) {
+            qWarning() << "Chunk ack frame truncated";
+            return false;
+        }
+        
+        entry.ranges.reserve(rangeCount);
+        for (int range = 0; range < rangeCount; ++range) {
+            int first = static_cast<int>(qMin<quint32>(qFromBigEndian<quint32>(in), MAX_WIRE_INDEX));
+            int count = static_cast<int>(qMin<quint32>(qFromBigEndian<quint32>(in + 4), MAX_WIRE_INDEX));
+            entry.ranges.append(qMakePair(first, count));
+            in += RANGE_ENTRY_SIZE;
+        }
+        acks.append(entry);
+    }
+    
+    return true;
+}
+
+ControlCodec::ChunkAcks ControlCodec::chunkAcksFromBitmap(quint32 transferHandle, const QBitArray &received, int from)
+{
+    ChunkAcks acks;
+    acks.transferHandle = transferHandle;
+    
+    // Chunks below from were all received when the previous frame was built
+    int size = static_cast<int>(received.size());
+    int index = qBound(0, from, size);
+    while (index < size && received.testBit(index)) {
+        ++index;
+    }
+    acks.cumulative = index;
+    
+    // Selective ranges, runs of received chunks above the first gap
+    while (index < size && acks.ranges.size() < MAX_ACK_RANGES) {
+        while (index < size && !received.testBit(index)) {
+            ++index;
+        }
+        int first = index;
+        while (index < size && received.testBit(index)) {
+            ++index;
+        }
+        if (index > first) {
+            acks.ranges.append(qMakePair(first, index - first));
+        }
+    }
+    
+    return acks;
+}
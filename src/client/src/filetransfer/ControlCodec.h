@@ -0,0 +1,77 @@
+#ifndef CONTROLCODEC_H
+#define CONTROLCODEC_H
+
+#include <QByteArray>
+#include <QBitArray>
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QtGlobal>
+
+// Control message types and binary control frames
+//
+// Text control messages are JSON objects naming their type in "type"; the
+// name is looked up once and handlers are dispatched on the MessageType.
+//
+// Binary control frames share the socket with chunk frames and carry the
+// type in their header, all integers big-endian:
+//   [magic(2) "OC"][version(1)][message_type(1)][payload]
+// JSON chunk frames start with a zero byte and binary ones with "OD", so
+// the three can be told apart from the first two bytes.
+//
+// ChunkAck payload, the acknowledgments of any number of transfers:
+//   [transfer_count(2)] then per transfer
+//   [transfer_handle(4)][cumulative(4)][range_count(2)] then per range
+//   [first_chunk(4)][chunk_count(4)]
+// Every chunk below cumulative is acknowledged, and each range above it.
+// A frame states everything its sender has received, not what changed, so
+// a peer can send one per interval and lost or repeated frames do no harm.
+class ControlCodec
+{
+public:
+    enum class MessageType : quint8 {
+        Unknown = 0,
+        FileTransferResponse,
+        TransferStatusUpdate,
+        ChunkAck,
+        ProgressResponse,
+        Error,
+        TransferResume,
+        DeltaReady,
+        ChunkHave,
+        SessionRegistered,
+        Pong,
+        TransferRequest
+    };
+    
+    static const int CONTROL_FRAME_VERSION = 1;
+    static const int CONTROL_HEADER_SIZE = 4;
+    static const int MAX_ACK_RANGES = 64; // Per transfer and frame, later ones wait for the next
+    static const int DEFAULT_ACK_INTERVAL = 20; // ms between ack frames a peer is asked for
+    
+    struct ChunkAcks {
+        quint32 transferHandle = 0;
+        int cumulative = 0;             // Every chunk below is acknowledged
+        QList<QPair<int, int>> ranges;  // First chunk and count, above cumulative
+    };
+    
+    // Text message types
+    static MessageType messageType(const QString &name);
+    static QString messageTypeName(MessageType type);
+    
+    // Binary control frames
+    static bool isControlFrame(const QByteArray &frame);
+    static MessageType frameMessageType(const QByteArray &frame);
+    static QByteArray encodeChunkAcks(const QList<ChunkAcks> &acks);
+    static bool decodeChunkAcks(const QByteArray &frame, QList<ChunkAcks> &acks);
+    
+    // Acknowledgments of the chunks set in received; scanning for the
+    // cumulative point starts at from, the one of the previous frame
+    static ChunkAcks chunkAcksFromBitmap(quint32 transferHandle, const QBitArray &received, int from = 0);
+
+private:
+    static const char MAGIC_0 = 'O';
+    static const char MAGIC_1 = 'C';
+};
+
+#endif // CONTROLCODEC_H
@@ -0,0 +1,344 @@
+#include "DeltaSync.h"
+#include "ChunkIntegrity.h"
+#include <QCryptographicHash>
+#include <QMultiHash>
+#include <QFile>
+#include <QtEndian>
+#include <QDebug>
+#include <cmath>
+#include <cstring>
+
+static const char SIGNATURE_MAGIC[4] = {'O', 'D', 'S', 'G'};
+static const char DELTA_MAGIC[4] = {'O', 'D', 'D', 'L'};
+static const int SIGNATURE_HEADER_SIZE = 12;
+static const int SIGNATURE_ENTRY_SIZE = 4 + DeltaSync::STRONG_DIGEST_SIZE;
+static const int DELTA_HEADER_SIZE = 16;
+static const qint64 MAX_LITERAL_OP = 1 << 30;
+static const char OP_COPY = 'C';
+static const char OP_LITERAL = 'L';
+static const char OP_END = 'E';
+
+namespace {
+
+QByteArray strongDigest(const char *data, int size)
+{
+    return ChunkIntegrity::digest(ChunkIntegrity::Algorithm::Blake2s, QByteArray::fromRawData(data, size))
+        .left(DeltaSync::STRONG_DIGEST_SIZE);
+}
+
+void appendUInt32(QByteArray &out, quint32 value)
+{
+    uchar bytes[4];
+    qToBigEndian<quint32>(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+}
+
+// Writes ops to the delta file, merging runs of consecutive blocks
+class DeltaWriter
+{
+public:
+    explicit DeltaWriter(QFile &file) : m_file(file), m_copyBlock(0), m_copyCount(0), m_ok(true) {}
+    
+    void copy(int block)
+    {
+        if (m_copyCount > 0 && block == m_copyBlock + m_copyCount) {
+            m_copyCount++;
+            return;
+        }
+        flushCopy();
+        m_copyBlock = block;
+        m_copyCount = 1;
+    }
+    
+    void literal(const char *data, qint64 size)
+    {
+        flushCopy();
+        while (size > 0 && m_ok) {
+            qint64 length = qMin(size, MAX_LITERAL_OP);
+            QByteArray op(1, OP_LITERAL);
+            appendUInt32(op, static_cast<quint32>(length));
+            write(op);
+            m_ok = m_ok && m_file.write(data, length) == length;
+            data += length;
+            size -= length;
+        }
+    }
+    
+    bool finish()
+    {
+        flushCopy();
+        write(QByteArray(1, OP_END));
+        return m_ok;
+    }
+
+private:
+    void flushCopy()
+    {
+        if (m_copyCount == 0) {
+            return;
+        }
+        QByteArray op(1, OP_COPY);
+        appendUInt32(op, static_cast<quint32>(m_copyBlock));
+        appendUInt32(op, static_cast<quint32>(m_copyCount));
+        write(op);
+        m_copyCount = 0;
+    }
+    
+    void write(const QByteArray &bytes)
+    {
+        m_ok = m_ok && m_file.write(bytes) == bytes.size();
+    }
+    
+    QFile &m_file;
+    int m_copyBlock;
+    int m_copyCount;
+    bool m_ok;
+};
+
+} // namespace
+
+int DeltaSync::blockSizeFor(qint64 fileSize)
+{
+    qint64 blockSize = static_cast<qint64>(std::ceil(std::sqrt(static_cast<double>(qMax<qint64>(0, fileSize)))));
+    blockSize = (blockSize + 1023) / 1024 * 1024;
+    return static_cast<int>(qBound<qint64>(MIN_BLOCK_SIZE, blockSize, MAX_BLOCK_SIZE));
+}
+
+quint32 DeltaSync::weakChecksum(const uchar *data, int size)
+{
+    quint32 a = 0;
+    quint32 b = 0;
+    for (int i = 0; i < size; ++i) {
+        a += data[i];
+        b += static_cast<quint32>(size - i) * data[i];
+    }
+    return (a & 0xffff) | ((b & 0xffff) << 16);
+}
+
+QByteArray DeltaSync::computeSignature(const QString &basisPath)
+{
+    QFile basis(basisPath);
+    if (!basis.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot read delta basis" << basisPath << ":" << basis.errorString();
+        return QByteArray();
+    }
+    
+    // Only full blocks are signed, the tail of the file is always sent
+    int blockSize = blockSizeFor(basis.size());
+    qint64 blockCount = basis.size() / blockSize;
+    
+    QByteArray signature;
+    signature.reserve(SIGNATURE_HEADER_SIZE + blockCount * SIGNATURE_ENTRY_SIZE);
+    signature.append(SIGNATURE_MAGIC, sizeof(SIGNATURE_MAGIC));
+    appendUInt32(signature, static_cast<quint32>(blockSize));
+    appendUInt32(signature, static_cast<quint32>(blockCount));
+    
+    QByteArray block;
+    for (qint64 i = 0; i < blockCount; ++i) {
+        block = basis.read(blockSize);
+        if (block.size() != blockSize) {
+            qWarning() << "Short read while signing" << basisPath;
+            return QByteArray();
+        }
+        appendUInt32(signature, weakChecksum(reinterpret_cast<const uchar *>(block.constData()), blockSize));
+        signature.append(strongDigest(block.constData(), blockSize));
+    }
+    
+    return signature;
+}
+
+bool DeltaSync::encode(const QString &sourcePath, const QByteArray &signature, const QString &deltaPath,
+                       qint64 *literalBytes, QByteArray *sourceDigest)
+{
+    if (signature.size() < SIGNATURE_HEADER_SIZE || memcmp(signature.constData(), SIGNATURE_MAGIC, 4) != 0) {
+        qWarning() << "Invalid delta signature";
+        return false;
+    }
+    
+    const uchar *header = reinterpret_cast<const uchar *>(signature.constData());
+    int blockSize = static_cast<int>(qFromBigEndian<quint32>(header + 4));
+    qint64 blockCount = qFromBigEndian<quint32>(header + 8);
+    if (blockSize < MIN_BLOCK_SIZE || blockSize > MAX_BLOCK_SIZE ||
+        signature.size() != SIGNATURE_HEADER_SIZE + blockCount * SIGNATURE_ENTRY_SIZE) {
+        qWarning() << "Malformed delta signature";
+        return false;
+    }
+    
+    QMultiHash<quint32, int> blocks;
+    blocks.reserve(blockCount);
+    for (int i = 0; i < blockCount; ++i) {
+        blocks.insert(qFromBigEndian<quint32>(header + SIGNATURE_HEADER_SIZE + i * SIGNATURE_ENTRY_SIZE), i);
+    }
+    
+    QFile source(sourcePath);
+    QFile delta(deltaPath);
+    if (!source.open(QIODevice::ReadOnly) || !delta.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot open files for delta encoding:" << source.errorString() << delta.errorString();
+        return false;
+    }
+    
+    // The whole source is scanned byte by byte, map it when possible
+    const qint64 size = source.size();
+    QByteArray buffered;
+    const uchar *data = size > 0 ? source.map(0, size) : nullptr;
+    if (!data && size > 0) {
+        buffered = source.readAll();
+        if (buffered.size() != size) {
+            return false;
+        }
+        data = reinterpret_cast<const uchar *>(buffered.constData());
+    }
+    
+    if (sourceDigest) {
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(QByteArrayView(data, size));
+        *sourceDigest = hash.result();
+    }
+    
+    QByteArray deltaHeader(DELTA_MAGIC, sizeof(DELTA_MAGIC));
+    appendUInt32(deltaHeader, static_cast<quint32>(blockSize));
+    uchar targetSize[8];
+    qToBigEndian<quint64>(static_cast<quint64>(size), targetSize);
+    deltaHeader.append(reinterpret_cast<const char *>(targetSize), sizeof(targetSize));
+    delta.write(deltaHeader);
+    
+    DeltaWriter writer(delta);
+    qint64 literal = 0;
+    qint64 literalStart = 0;
+    qint64 pos = 0;
+    quint32 a = 0;
+    quint32 b = 0;
+    
+    auto resetWindow = [&]() {
+        quint32 weak = weakChecksum(data + pos, blockSize);
+        a = weak & 0xffff;
+        b = weak >> 16;
+    };
+    
+    if (size >= blockSize && blockCount > 0) {
+        resetWindow();
+    }
+    
+    while (blockCount > 0 && pos + blockSize <= size) {
+        int match = -1;
+        auto it = blocks.constFind(a | (b << 16));
+        if (it != blocks.constEnd()) {
+            QByteArray strong = strongDigest(reinterpret_cast<const char *>(data + pos), blockSize);
+            for (; it != blocks.constEnd() && it.key() == (a | (b << 16)); ++it) {
+                const char *expected = signature.constData() + SIGNATURE_HEADER_SIZE + it.value() * SIGNATURE_ENTRY_SIZE + 4;
+                if (memcmp(expected, strong.constData(), STRONG_DIGEST_SIZE) == 0) {
+                    match = it.value();
+                    break;
+                }
+            }
+        }
+        
+        if (match >= 0) {
+            writer.literal(reinterpret_cast<const char *>(data + literalStart), pos - literalStart);
+            literal += pos - literalStart;
+            writer.copy(match);
+            
+            pos += blockSize;
+            literalStart = pos;
+            if (pos + blockSize <= size) {
+                resetWindow();
+            }
+            continue;
+        }
+        
+        // Slide the window by one byte
+        if (pos + blockSize < size) {
+            quint32 out = data[pos];
+            quint32 in = data[pos + blockSize];
+            a = (a - out + in) & 0xffff;
+            b = (b - static_cast<quint32>(blockSize) * out + a) & 0xffff;
+        }
+        pos++;
+    }
+    
+    writer.literal(reinterpret_cast<const char *>(data + literalStart), size - literalStart);
+    literal += size - literalStart;
+    
+    if (literalBytes) {
+        *literalBytes = literal;
+    }
+    
+    return writer.finish() && delta.flush();
+}
+
+bool DeltaSync::apply(const QString &basisPath, const QString &deltaPath, QIODevice *target,
+                      QByteArray *targetDigest)
+{
+    QFile basis(basisPath);
+    QFile delta(deltaPath);
+    if (!basis.open(QIODevice::ReadOnly) || !delta.open(QIODevice::ReadOnly) || !target->isWritable()) {
+        qWarning() << "Cannot open files to apply delta:" << basis.errorString() << delta.errorString()
+                   << target->errorString();
+        return false;
+    }
+    
+    QByteArray header = delta.read(DELTA_HEADER_SIZE);
+    if (header.size() != DELTA_HEADER_SIZE || memcmp(header.constData(), DELTA_MAGIC, 4) != 0) {
+        qWarning() << "Invalid delta stream" << deltaPath;
+        return false;
+    }
+    
+    const uchar *fields = reinterpret_cast<const uchar *>(header.constData());
+    qint64 blockSize = qFromBigEndian<quint32>(fields + 4);
+    qint64 targetSize = static_cast<qint64>(qFromBigEndian<quint64>(fields + 8));
+    
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    qint64 written = 0;
+    
+    auto emitData = [&](const QByteArray &data) {
+        hash.addData(data);
+        written += data.size();
+        return target->write(data) == data.size();
+    };
+    
+    char op = 0;
+    while (delta.getChar(&op) && op != OP_END) {
+        QByteArray args = delta.read(op == OP_COPY ? 8 : 4);
+        const uchar *arg = reinterpret_cast<const uchar *>(args.constData());
+        
+        if (op == OP_COPY && args.size() == 8) {
+            qint64 firstBlock = qFromBigEndian<quint32>(arg);
+            qint64 length = qFromBigEndian<quint32>(arg + 4) * blockSize;
+            if (!basis.seek(firstBlock * blockSize)) {
+                return false;
+            }
+            
+            for (qint64 remaining = length; remaining > 0;) {
+                QByteArray data = basis.read(qMin<qint64>(remaining, 1024 * 1024));
+                if (data.isEmpty() || !emitData(data)) {
+                    qWarning() << "Delta references data missing from" << basisPath;
+                    return false;
+                }
+                remaining -= data.size();
+            }
+        } else if (op == OP_LITERAL && args.size() == 4) {
+            for (qint64 remaining = qFromBigEndian<quint32>(arg); remaining > 0;) {
+                QByteArray data = delta.read(qMin<qint64>(remaining, 1024 * 1024));
+                if (data.isEmpty() || !emitData(data)) {
+                    qWarning() << "Truncated delta stream" << deltaPath;
+                    return false;
+                }
+                remaining -= data.size();
+            }
+        } else {
+            qWarning() << "Corrupt delta stream" << deltaPath;
+            return false;
+        }
+    }
+    
+    if (op != OP_END || written != targetSize) {
+        qWarning() << "Delta rebuilt" << written << "of" << targetSize << "bytes";
+        return false;
+    }
+    
+    if (targetDigest) {
+        *targetDigest = hash.result();
+    }
+    
+    return true;
+}
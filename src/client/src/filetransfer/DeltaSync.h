@@ -0,0 +1,52 @@
+#ifndef DELTASYNC_H
+#define DELTASYNC_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+class QIODevice;
+
+// rsync-style delta encoding for files the receiver already has a
+// version of.
+//
+// The receiver publishes a signature of its copy: one weak rolling
+// checksum and one truncated BLAKE2s digest per block. The sender slides
+// a block-sized window over its file, looks the rolling checksum up in
+// the signature and confirms hits with the strong digest. Matches become
+// block references and everything else is sent as literal bytes. The
+// resulting delta stream is what travels in the chunks, the receiver
+// rebuilds the file from its copy and the delta.
+//
+// Signature: [magic(4) "ODSG"][block_size(4)][block_count(4)]
+//            block_count x [weak(4)][strong(16)]
+// Delta:     [magic(4) "ODDL"][block_size(4)][target_size(8)] then ops
+//            'C' [first_block(4)][block_count(4)]  copy from the basis
+//            'L' [length(4)][bytes]                literal data
+//            'E'                                   end of stream
+// All integers are big-endian.
+class DeltaSync
+{
+public:
+    static const int MIN_BLOCK_SIZE = 2 * 1024;
+    static const int MAX_BLOCK_SIZE = 64 * 1024;
+    static const int STRONG_DIGEST_SIZE = 16;
+    
+    // Block size growing with the square root of the file size
+    static int blockSizeFor(qint64 fileSize);
+    
+    // Receiver side
+    static QByteArray computeSignature(const QString &basisPath);
+    // The rebuilt file is written to target, opened for writing by the caller
+    static bool apply(const QString &basisPath, const QString &deltaPath, QIODevice *target,
+                      QByteArray *targetDigest = nullptr);
+    
+    // Sender side; literalBytes reports how much of the file had no match
+    static bool encode(const QString &sourcePath, const QByteArray &signature, const QString &deltaPath,
+                       qint64 *literalBytes = nullptr, QByteArray *sourceDigest = nullptr);
+    
+    // Rolling checksum of a block (rsync's Adler-32 variant)
+    static quint32 weakChecksum(const uchar *data, int size);
+};
+
+#endif // DELTASYNC_H
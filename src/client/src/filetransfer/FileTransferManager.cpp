@@ -1,5 +1,20 @@
 #include "FileTransferManager.h"
+#include "FileTransferSession.h"
+#include "FileTransferWorker.h"
+#include "ChunkCodec.h"
+#include "TransferThreadPool.h"
+#include "ChunkCompressor.h"
+#include "TransferCheckpoint.h"
+#include "ChunkStore.h"
+#include "TransferBundle.h"
+#include "TransferStreamPool.h"
+#include "TransferProgressBus.h"
+#include "ChunkBufferPool.h"
+#include "TransferTelemetry.h"
+#include "FileValidationCache.h"
 #include "ApprovalDialog.h"
+#include "BatchApprovalDialog.h"
+#include "ControlCodec.h"
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -12,43 +27,155 @@
 #include <QApplication>
 #include <QMessageBox>
 #include <QProgressDialog>
-#include <QMimeDatabase>
-#include <QMimeType>
 #include <QSettings>
 #include <QMutexLocker>
+#include <QThreadPool>
+#include <algorithm>
+#include <limits>
 
 // Constants
-static const int DEFAULT_CHUNK_SIZE = 64 * 1024; // 64KB
+static const int DEFAULT_PIPELINE_WINDOW = 8; // chunks in flight per transfer
+static const int DEFAULT_PREFETCH_DEPTH = 8; // outstanding chunk requests per download
+static const int MAX_PIPELINE_WINDOW = 64;
 static const int DEFAULT_MAX_CONCURRENT = 3;
 static const int PING_INTERVAL = 30000; // 30 seconds
 static const int RECONNECT_INTERVAL = 5000; // 5 seconds
 static const qint64 MAX_FILE_SIZE = 100 * 1024 * 1024; // 100MB
+static const int THROUGHPUT_SAMPLE_INTERVAL = 2000; // 2 seconds
+static const double THROUGHPUT_CHANGE_THRESHOLD = 0.05; // 5%
+static const qint64 DEFAULT_SEND_LOW_WATERMARK = 2 * 1024 * 1024; // 2MB
+static const qint64 DEFAULT_SEND_HIGH_WATERMARK = 8 * 1024 * 1024; // 8MB
+static const qint64 MIN_SEND_HIGH_WATERMARK = 64 * 1024;
+static const int DEFAULT_TELEMETRY_INTERVAL = 10000; // 10 seconds
+static const int MIN_TELEMETRY_INTERVAL = 1000;
+static const int VALIDATION_THREADS = 2; // Hashing is bound by the disk
+static const int APPROVAL_BATCH_WINDOW = 250; // ms, requests arriving within share a dialog
+
+// Bytes a message takes in the socket's buffer: a header per frame of at
+// most outgoingFrameSize() bytes, with the mask every client frame carries
+static qint64 webSocketWireSize(const QWebSocket *socket, qint64 payloadSize)
+{
+    auto headerSize = [](qint64 length) -> qint64 {
+        return 2 + 4 + (length > 0xFFFF ? 8 : length > 125 ? 2 : 0);
+    };
+    qint64 frameSize = qMax<qint64>(1, static_cast<qint64>(socket->outgoingFrameSize()));
+    qint64 fullFrames = payloadSize / frameSize;
+    qint64 rest = payloadSize % frameSize;
+    
+    qint64 size = payloadSize + fullFrames * headerSize(frameSize);
+    if (rest > 0 || fullFrames == 0) {
+        size += headerSize(rest);
+    }
+    return size;
+}
 
 FileTransferManager::FileTransferManager(QObject *parent)
     : QObject(parent)
     , m_webSocket(std::make_unique<QWebSocket>())
+    , m_streamPool(std::make_unique<TransferStreamPool>())
     , m_isConnected(false)
     , m_pingTimer(std::make_unique<QTimer>(this))
     , m_reconnectTimer(std::make_unique<QTimer>(this))
     , m_reconnectAttempts(0)
-    , m_chunkSize(DEFAULT_CHUNK_SIZE)
+    , m_chunkHeaderVersion(ChunkCodec::JSON_HEADER_VERSION)
+    , m_nextTransferHandle(1)
+    , m_chunkIntegrity(ChunkIntegrity::Algorithm::Sha256)
+    , m_chunkCompressionAvailable(false)
+    , m_chunkEncryptionAvailable(false)
+    , m_transferResumeAvailable(false)
+    , m_deltaSyncAvailable(false)
+    , m_chunkDedupAvailable(false)
+    , m_bundleTransferAvailable(false)
+    , m_sparseFilesAvailable(false)
+    , m_bufferPool(std::make_unique<ChunkBufferPool>())
+    , m_telemetry(std::make_unique<TransferTelemetry>())
+    , m_telemetryTimer(std::make_unique<QTimer>(this))
+    , m_validationCache(std::make_unique<FileValidationCache>())
+    , m_validationPool(std::make_unique<QThreadPool>())
+    , m_threadPool(std::make_unique<TransferThreadPool>())
+    , m_progressBus(std::make_unique<TransferProgressBus>())
+    , m_admissionSequence(0)
+    , m_adaptiveConcurrency(true)
+    , m_concurrencyLimit(DEFAULT_MAX_CONCURRENT)
+    , m_concurrencyStep(-1)
+    , m_aggregateBytes(0)
+    , m_lastSampleBytes(0)
+    , m_lastThroughput(0)
+    , m_throughputTimer(std::make_unique<QTimer>(this))
+    , m_sendBacklog(0)
+    , m_sendLowWatermark(DEFAULT_SEND_LOW_WATERMARK)
+    , m_sendHighWatermark(DEFAULT_SEND_HIGH_WATERMARK)
+    , m_sendBlocked(false)
+    , m_rateTimer(std::make_unique<QTimer>(this))
+    , m_chunkSizeTuner(ChunkSizeTuner::DEFAULT_CHUNK_SIZE)
+    , m_config(std::make_shared<const TransferConfig>(TransferConfig{
+          true,                                  // adaptiveChunkSize
+          ChunkSizeTuner::DEFAULT_CHUNK_SIZE,    // chunkSize
+          DEFAULT_PIPELINE_WINDOW,               // pipelineWindow
+          DEFAULT_PREFETCH_DEPTH,                // prefetchDepth
+          WriteDurability::Checkpoint,           // writeDurability
+          true,                                  // encryptionEnabled
+          false,                                 // compressionEnabled
+          true,                                  // chunkDedupEnabled
+          ChunkStore::DEFAULT_MAX_SIZE,          // chunkCacheSize
+          false,                                 // parallelStreamsEnabled
+          MAX_FILE_SIZE,                         // maxFileSize
+          false,                                 // largeFileModeEnabled
+          QSet<QString>{".txt", ".pdf", ".doc", ".docx", ".xls", ".xlsx",
+                      ".zip", ".rar", ".jpg", ".png", ".gif", ".bmp",
+                      ".ppt", ".pptx", ".csv", ".rtf", ".odt", ".ods"},
+          false,                                 // autoApprovalEnabled
+          30,                                    // approvalTimeout
+          true                                   // rememberDecisionEnabled
+      }))
     , m_maxConcurrentTransfers(DEFAULT_MAX_CONCURRENT)
-    , m_encryptionEnabled(true)
-    , m_compressionEnabled(false)
-    , m_maxFileSize(MAX_FILE_SIZE)
-    , m_autoApprovalEnabled(false)
-    , m_approvalTimeout(30)
-    , m_rememberDecisionEnabled(true)
     , m_settings(new QSettings("OnliDesk", "FileTransfer", this))
+    , m_approvalBatchTimer(std::make_unique<QTimer>(this))
+    , m_openApprovalDialogs(0)
     , m_networkManager(std::make_unique<QNetworkAccessManager>(this))
 {
+    // Chunks and progress cross into worker threads through queued calls
+    qRegisterMetaType<FileChunk>("FileChunk");
+    qRegisterMetaType<FileTransferProgress>("FileTransferProgress");
+    qRegisterMetaType<QList<FileTransferProgress>>("QList<FileTransferProgress>");
+    qRegisterMetaType<QList<int>>("QList<int>");
+    
     setupWebSocket();
     
+    // Progress of all running transfers arrives in one batch per tick
+    connect(m_progressBus.get(), &TransferProgressBus::progressBatch, this, &FileTransferManager::onProgressBatch);
+    
     // Setup ping timer
     m_pingTimer->setInterval(PING_INTERVAL);
     m_pingTimer->setSingleShot(false);
     connect(m_pingTimer.get(), &QTimer::timeout, this, &FileTransferManager::onPingTimer);
     
+    // Setup throughput sampling for adaptive concurrency
+    m_throughputTimer->setInterval(THROUGHPUT_SAMPLE_INTERVAL);
+    m_throughputTimer->setSingleShot(false);
+    connect(m_throughputTimer.get(), &QTimer::timeout, this, &FileTransferManager::onThroughputSample);
+    
+    // Setup telemetry reports, the timer only runs while telemetry is enabled
+    m_telemetryTimer->setInterval(DEFAULT_TELEMETRY_INTERVAL);
+    m_telemetryTimer->setSingleShot(false);
+    connect(m_telemetryTimer.get(), &QTimer::timeout, this, &FileTransferManager::onTelemetryReport);
+    
+    // Background validation reads a few files at a time
+    m_validationPool->setMaxThreadCount(VALIDATION_THREADS);
+    
+    // Setup approval batching, the window opens with the first request
+    m_approvalBatchTimer->setInterval(APPROVAL_BATCH_WINDOW);
+    m_approvalBatchTimer->setSingleShot(true);
+    connect(m_approvalBatchTimer.get(), &QTimer::timeout, this, &FileTransferManager::onApprovalBatchTimeout);
+    
+    // Setup rate timer, it releases chunks held back by the rate limits
+    m_rateTimer->setSingleShot(true);
+    connect(m_rateTimer.get(), &QTimer::timeout, this, [this]() {
+        flushSendQueues();
+        flushChunkRequests();
+    });
+    m_rateClock.start();
+    
     // Setup reconnect timer
     m_reconnectTimer->setInterval(RECONNECT_INTERVAL);
     m_reconnectTimer->setSingleShot(true);
@@ -63,18 +190,26 @@ FileTransferManager::FileTransferManager(QObject *parent)
         }
     });
     
-    // Setup default allowed file extensions
-    m_allowedExtensions << ".txt" << ".pdf" << ".doc" << ".docx" << ".xls" << ".xlsx"
-                       << ".zip" << ".rar" << ".jpg" << ".png" << ".gif" << ".bmp"
-                       << ".ppt" << ".pptx" << ".csv" << ".rtf" << ".odt" << ".ods";
-    
     // Load settings from registry/config
     loadSettings();
 }
 
 FileTransferManager::~FileTransferManager()
 {
+    // Validation jobs still queued are dropped, running ones finished
+    m_validationPool->clear();
+    m_validationPool->waitForDone();
+    
     disconnectFromServer();
+    
+    // Stream sockets report their destruction, let them go while we are whole
+    m_streamPool.reset();
+    
+    // Workers are deleted on their pool threads, which finish them off on shutdown
+    for (const QString &transferId : m_transferWorkers.keys()) {
+        retireWorker(transferId);
+    }
+    m_threadPool->shutdown();
 }
 
 void FileTransferManager::setupWebSocket()
@@ -86,6 +221,10 @@ void FileTransferManager::setupWebSocket()
             this, &FileTransferManager::onWebSocketError);
     connect(m_webSocket.get(), &QWebSocket::textMessageReceived, this, &FileTransferManager::onWebSocketTextMessageReceived);
     connect(m_webSocket.get(), &QWebSocket::binaryMessageReceived, this, &FileTransferManager::onWebSocketBinaryMessageReceived);
+    
+    // Data streams deliver chunks (and the odd control message) like the main socket
+    connect(m_streamPool.get(), &TransferStreamPool::textMessageReceived, this, &FileTransferManager::onWebSocketTextMessageReceived);
+    connect(m_streamPool.get(), &TransferStreamPool::binaryMessageReceived, this, &FileTransferManager::onWebSocketBinaryMessageReceived);
 }
 
 void FileTransferManager::connectToServer(const QString &serverUrl)
@@ -143,10 +282,85 @@ QString FileTransferManager::requestFileUpload(const QString &filePath, const QS
         return QString();
     }
     
+    return submitUpload(request, sessionId, technician);
+}
+
+bool FileTransferManager::isBundleTransferAvailable() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_isConnected && m_bundleTransferAvailable;
+}
+
+QString FileTransferManager::requestBundleUpload(const QString &rootPath, const QStringList &filePaths,
+                                                 const QString &sessionId, const QString &technician)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (!m_isConnected || !m_bundleTransferAvailable) {
+        qWarning() << "Cannot request bundle upload: server does not accept bundles";
+        return QString();
+    }
+    
+    // Same checks as single uploads, applied to every file
+    TransferBundle bundle;
+    bundle.setRootPath(rootPath);
+    for (const QString &filePath : filePaths) {
+        QString errorMessage;
+        if (!validateFile(filePath, errorMessage)) {
+            emit fileValidationFailed(filePath, errorMessage);
+            continue;
+        }
+        if (!bundle.addFile(filePath)) {
+            emit fileValidationFailed(filePath, "File is outside the bundle folder");
+        }
+    }
+    
+    // A stream without bytes has no chunks to carry the manifest
+    if (bundle.getTotalSize() == 0) {
+        qWarning() << "Nothing to bundle below" << rootPath;
+        return QString();
+    }
+    
+    // The receiver checks every file it splits off and the stream as a whole
+    FileTransferRequest request;
+    if (!bundle.computeChecksums(request.checksum)) {
+        qWarning() << "Cannot hash the bundle below" << rootPath;
+        return QString();
+    }
+    request.filename = QFileInfo(bundle.getRootPath()).fileName();
+    request.fileSize = bundle.getTotalSize();
+    request.localPath = bundle.getRootPath();
+    request.metadata["bundle"] = bundle.toJson();
+    
+    return submitUpload(request, sessionId, technician);
+}
+
+QStringList FileTransferManager::getBundleFiles(const QString &transferId) const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto session = m_transferSessions.find(transferId);
+    if (session == m_transferSessions.end()) {
+        return QStringList();
+    }
+    
+    const TransferBundle &bundle = session.value()->getBundle();
+    QStringList files;
+    files.reserve(bundle.getFileCount());
+    for (int i = 0; i < bundle.getFileCount(); ++i) {
+        files.append(bundle.localPathAt(i));
+    }
+    return files;
+}
+
+QString FileTransferManager::submitUpload(FileTransferRequest &request, const QString &sessionId, const QString &technician)
+{
+    // m_mutex must be held
     request.id = generateTransferId();
     request.sessionId = sessionId;
     request.technician = technician;
     request.type = TransferType::Upload;
+    quint32 transferHandle = assignTransferHandle(request.id);
     
     // Create transfer session
     auto session = std::make_unique<FileTransferSession>(request, this);
@@ -156,6 +370,14 @@ QString FileTransferManager::requestFileUpload(const QString &filePath, const QS
         }
     });
     
+    int chunkSize = proposeChunkSize(request);
+    session->setChunkSize(chunkSize);
+    
+    // Holes at the proposed chunk size; a server answering with another size drops them
+    QBitArray holeChunks;
+    if (m_sparseFilesAvailable) {
+        holeChunks = session->findHoleChunks();
+    }
     m_transferSessions[request.id] = std::move(session);
     
     // Send request to server
@@ -167,6 +389,18 @@ QString FileTransferManager::requestFileUpload(const QString &filePath, const QS
     message["checksum"] = request.checksum;
     message["type"] = "upload";
     message["technician"] = request.technician;
+    message["transfer_handle"] = static_cast<qint64>(transferHandle);
+    message["chunk_size"] = chunkSize;
+    if (!holeChunks.isEmpty()) {
+        message["sparse_chunks"] = TransferCheckpoint::encodeBitmap(holeChunks);
+    }
+    
+    // One approval covers every file of a bundle
+    if (request.metadata.contains("bundle")) {
+        QJsonArray manifest = request.metadata["bundle"].toArray();
+        message["bundle"] = manifest;
+        message["file_count"] = manifest.size();
+    }
     
     sendControlMessage(message);
     
@@ -176,6 +410,35 @@ QString FileTransferManager::requestFileUpload(const QString &filePath, const QS
     return request.id;
 }
 
+int FileTransferManager::proposeChunkSize(const FileTransferRequest &request) const
+{
+    // m_mutex must be held; a checkpointed transfer keeps the size it started with
+    TransferCheckpoint checkpoint;
+    if (TransferCheckpoint::load(request, checkpoint) && checkpoint.chunkSize == ChunkSizeTuner::clamp(checkpoint.chunkSize)) {
+        return checkpoint.chunkSize;
+    }
+    
+    std::shared_ptr<const TransferConfig> settings = config();
+    if (!settings->adaptiveChunkSize) {
+        return settings->chunkSize;
+    }
+    
+    int window = request.type == TransferType::Upload ? settings->pipelineWindow : settings->prefetchDepth;
+    int chunkSize = m_chunkSizeTuner.recommendedChunkSize(window);
+    
+    // Keeps bitmaps, digests and checkpoints of very large files small
+    if (request.fileSize >= LARGE_FILE_THRESHOLD) {
+        chunkSize = ChunkSizeTuner::clamp(qMax(chunkSize, static_cast<int>(LARGE_FILE_CHUNK_SIZE)));
+    }
+    return chunkSize;
+}
+
+bool FileTransferManager::isStripedTransfer(const QString &transferId) const
+{
+    auto it = m_transferSessions.find(transferId);
+    return it != m_transferSessions.end() && it.value()->getRequest().fileSize >= TransferStreamPool::STRIPE_MIN_SIZE;
+}
+
 QString FileTransferManager::requestFileDownload(const QString &filename, const QString &sessionId, const QString &technician, const QString &savePath)
 {
     QMutexLocker locker(&m_mutex);
@@ -196,6 +459,7 @@ QString FileTransferManager::requestFileDownload(const QString &filename, const
     request.sessionId = sessionId;
     request.technician = technician;
     request.type = TransferType::Download;
+    quint32 transferHandle = assignTransferHandle(request.id);
     
     // Create transfer session
     auto session = std::make_unique<FileTransferSession>(request, this);
@@ -205,6 +469,8 @@ QString FileTransferManager::requestFileDownload(const QString &filename, const
         }
     });
     
+    int chunkSize = proposeChunkSize(request);
+    session->setChunkSize(chunkSize);
     m_transferSessions[request.id] = std::move(session);
     
     // Send request to server
@@ -215,6 +481,14 @@ QString FileTransferManager::requestFileDownload(const QString &filename, const
     message["file_size"] = request.fileSize;
     message["type"] = "download";
     message["technician"] = request.technician;
+    message["transfer_handle"] = static_cast<qint64>(transferHandle);
+    message["chunk_size"] = chunkSize;
+    
+    // An existing copy lets the sender reply with a delta instead of the file
+    QFileInfo basisInfo(request.localPath);
+    if (m_deltaSyncAvailable && basisInfo.isFile() && basisInfo.size() > 0) {
+        message["delta_basis"] = true;
+    }
     
     sendControlMessage(message);
     
@@ -229,7 +503,7 @@ void FileTransferManager::pauseTransfer(const QString &transferId)
     QMutexLocker locker(&m_mutex);
     
     if (auto worker = m_transferWorkers.value(transferId)) {
-        worker->pauseTransfer();
+        QMetaObject::invokeMethod(worker.get(), "pauseTransfer", Qt::QueuedConnection);
     }
     
     QJsonObject message = createControlMessage("transfer_control");
@@ -245,7 +519,7 @@ void FileTransferManager::resumeTransfer(const QString &transferId)
     QMutexLocker locker(&m_mutex);
     
     if (auto worker = m_transferWorkers.value(transferId)) {
-        worker->resumeTransfer();
+        QMetaObject::invokeMethod(worker.get(), "resumeTransfer", Qt::QueuedConnection);
     }
     
     QJsonObject message = createControlMessage("transfer_control");
@@ -260,15 +534,21 @@ void FileTransferManager::cancelTransfer(const QString &transferId)
 {
     QMutexLocker locker(&m_mutex);
     
-    // Cancel worker
-    if (auto worker = m_transferWorkers.value(transferId)) {
-        worker->cancelTransfer();
+    // Drop it from the admission queue if it never started
+    for (int i = 0; i < m_admissionQueue.size(); ++i) {
+        if (m_admissionQueue.at(i).transferId == transferId) {
+            m_admissionQueue.removeAt(i);
+            break;
+        }
     }
+    m_pinnedTransfers.remove(transferId);
+    
+    // Nor may the approval dialogs answer it if it was never decided
+    withdrawPendingRequest(transferId);
     
-    // Stop thread
-    if (auto thread = m_transferThreads.value(transferId)) {
-        thread->quit();
-        thread->wait(5000); // Wait up to 5 seconds
+    // Cancel worker, it runs before the queued deletion in retireWorker()
+    if (auto worker = m_transferWorkers.value(transferId)) {
+        QMetaObject::invokeMethod(worker.get(), "cancelTransfer", Qt::QueuedConnection);
     }
     
     // Update session status
@@ -276,9 +556,9 @@ void FileTransferManager::cancelTransfer(const QString &transferId)
         session->setStatus(TransferStatus::Cancelled);
     }
     
-    // Clean up
-    m_transferWorkers.remove(transferId);
-    m_transferThreads.remove(transferId);
+    // Clean up and hand the slot to the next queued transfer
+    retireWorker(transferId);
+    dispatchPendingTransfers();
     
     // Notify server
     QJsonObject message = createControlMessage("transfer_control");
@@ -296,7 +576,14 @@ FileTransferProgress FileTransferManager::getTransferProgress(const QString &tra
     QMutexLocker locker(&m_mutex);
     
     if (auto session = m_transferSessions.value(transferId)) {
-        return session->getProgress();
+        // Speed and ETA are only known to the progress bus
+        FileTransferProgress progress = session->getProgress();
+        if (m_progressBus->isAttached(transferId)) {
+            FileTransferProgress live = m_progressBus->getProgress(transferId);
+            progress.speed = live.speed;
+            progress.remainingTime = live.remainingTime;
+        }
+        return progress;
     }
     
     return FileTransferProgress{};
@@ -320,481 +607,1641 @@ QStringList FileTransferManager::getActiveTransfers() const
 
 void FileTransferManager::setChunkSize(int size)
 {
-    m_chunkSize = qMax(1024, qMin(size, 1024 * 1024)); // Between 1KB and 1MB
+    int chunkSize = ChunkSizeTuner::clamp(size);
+    updateConfig([chunkSize](TransferConfig &config) {
+        config.chunkSize = chunkSize;
+    });
+    
+    QMutexLocker locker(&m_mutex);
+    m_chunkSizeTuner.setBaseChunkSize(chunkSize);
 }
 
-void FileTransferManager::setMaxConcurrentTransfers(int max)
+int FileTransferManager::getChunkSize() const
 {
-    m_maxConcurrentTransfers = qMax(1, qMin(max, 10)); // Between 1 and 10
+    return config()->chunkSize;
 }
 
-void FileTransferManager::setEncryptionEnabled(bool enabled)
+void FileTransferManager::setAdaptiveChunkSizeEnabled(bool enabled)
 {
-    m_encryptionEnabled = enabled;
+    updateConfig([enabled](TransferConfig &config) {
+        config.adaptiveChunkSize = enabled;
+    });
 }
 
-void FileTransferManager::setCompressionEnabled(bool enabled)
+bool FileTransferManager::isAdaptiveChunkSizeEnabled() const
 {
-    m_compressionEnabled = enabled;
+    return config()->adaptiveChunkSize;
 }
 
-bool FileTransferManager::validateFile(const QString &filePath, QString &errorMessage)
+void FileTransferManager::setPipelineWindow(int chunks)
 {
-    QFileInfo fileInfo(filePath);
-    
-    // Check if file exists
-    if (!fileInfo.exists()) {
-        errorMessage = "File does not exist";
-        return false;
-    }
-    
-    // Check if it's a file (not directory)
-    if (!fileInfo.isFile()) {
-        errorMessage = "Path is not a file";
-        return false;
-    }
-    
-    // Check file size
-    if (fileInfo.size() > m_maxFileSize) {
-        errorMessage = QString("File size (%1 MB) exceeds maximum allowed size (%2 MB)")
-                      .arg(fileInfo.size() / (1024 * 1024))
-                      .arg(m_maxFileSize / (1024 * 1024));
-        return false;
-    }
-    
-    // Check file extension
-    QString extension = fileInfo.suffix().toLower();
-    if (!extension.isEmpty() && !m_allowedExtensions.contains("." + extension)) {
-        errorMessage = QString("File extension '.%1' is not allowed").arg(extension);
-        return false;
-    }
-    
-    // Check MIME type
-    QMimeDatabase mimeDb;
-    QMimeType mimeType = mimeDb.mimeTypeForFile(filePath);
-    if (mimeType.name().startsWith("application/x-executable")) {
-        errorMessage = "Executable files are not allowed";
-        return false;
-    }
-    
-    return true;
+    // 1 restores stop-and-wait behaviour
+    int window = qMax(1, qMin(chunks, MAX_PIPELINE_WINDOW));
+    updateConfig([window](TransferConfig &config) {
+        config.pipelineWindow = window;
+    });
 }
 
-QString FileTransferManager::calculateFileChecksum(const QString &filePath)
+int FileTransferManager::getPipelineWindow() const
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed to open file for checksum calculation:" << filePath;
-        return QString();
-    }
-    
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    
-    const int bufferSize = 64 * 1024; // 64KB buffer
-    QByteArray buffer;
-    
-    while (!file.atEnd()) {
-        buffer = file.read(bufferSize);
-        hash.addData(buffer);
-    }
-    
-    return hash.result().toHex();
+    return config()->pipelineWindow;
 }
 
-void FileTransferManager::onSessionRegistered(const QString &sessionId)
+void FileTransferManager::setPrefetchDepth(int chunks)
 {
-    m_sessionId = sessionId;
-    registerSession();
+    // 1 requests download chunks one at a time
+    int depth = qMax(1, qMin(chunks, MAX_PIPELINE_WINDOW));
+    updateConfig([depth](TransferConfig &config) {
+        config.prefetchDepth = depth;
+    });
 }
 
-void FileTransferManager::onTransferApprovalReceived(const QString &transferId, bool approved, const QString &message)
+int FileTransferManager::getPrefetchDepth() const
+{
+    return config()->prefetchDepth;
+}
+
+void FileTransferManager::setSendBufferWatermarks(qint64 lowBytes, qint64 highBytes)
 {
     QMutexLocker locker(&m_mutex);
     
-    if (auto session = m_transferSessions.value(transferId)) {
-        if (approved) {
-            session->setStatus(TransferStatus::Approved);
-            emit transferApproved(transferId);
-        } else {
-            session->setStatus(TransferStatus::Rejected);
-            session->setError(message);
-            emit transferRejected(transferId, message);
-        }
-    }
+    // Below the high watermark a whole chunk goes out, it need not exceed the chunk size
+    m_sendHighWatermark = qMax(MIN_SEND_HIGH_WATERMARK, highBytes);
+    m_sendLowWatermark = qBound<qint64>(0, lowBytes, m_sendHighWatermark);
+    updateSendBackpressure();
 }
 
-// WebSocket event handlers
-void FileTransferManager::onWebSocketConnected()
+qint64 FileTransferManager::getSendLowWatermark() const
 {
-    qDebug() << "Connected to file transfer server";
-    
-    m_isConnected = true;
-    m_reconnectAttempts = 0;
-    m_reconnectTimer->stop();
-    
-    // Start ping timer
-    m_pingTimer->start();
-    
-    // Register session if we have one
-    if (!m_sessionId.isEmpty()) {
-        registerSession();
-    }
-    
-    emit connected();
+    QMutexLocker locker(&m_mutex);
+    return m_sendLowWatermark;
 }
 
-void FileTransferManager::onWebSocketDisconnected()
+qint64 FileTransferManager::getSendHighWatermark() const
 {
-    qDebug() << "Disconnected from file transfer server";
-    
-    m_isConnected = false;
-    m_pingTimer->stop();
-    
-    // Start reconnection attempts
-    if (m_reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
-        m_reconnectTimer->start();
-    }
-    
-    emit disconnected();
+    QMutexLocker locker(&m_mutex);
+    return m_sendHighWatermark;
 }
 
-void FileTransferManager::onWebSocketError(QAbstractSocket::SocketError error)
+qint64 FileTransferManager::getSendBacklog() const
 {
-    QString errorString = m_webSocket->errorString();
-    qWarning() << "WebSocket error:" << error << errorString;
-    
-    emit connectionError(errorString);
+    QMutexLocker locker(&m_mutex);
+    return m_sendBacklog;
 }
 
-void FileTransferManager::onWebSocketTextMessageReceived(const QString &message)
+quint64 FileTransferManager::getBufferPoolHitCount() const
 {
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8(), &parseError);
-    
-    if (parseError.error != QJsonParseError::NoError) {
-        qWarning() << "Failed to parse JSON message:" << parseError.errorString();
-        return;
-    }
-    
-    QJsonObject obj = doc.object();
-    handleControlMessage(obj);
+    return m_bufferPool->getHitCount();
 }
 
-void FileTransferManager::onWebSocketBinaryMessageReceived(const QByteArray &data)
+quint64 FileTransferManager::getBufferPoolMissCount() const
 {
-    // Handle binary file chunks
-    if (data.size() < 4) {
-        qWarning() << "Binary message too short";
-        return;
-    }
-    
-    // Extract header length (first 4 bytes)
-    int headerLength = (static_cast<unsigned char>(data[0]) << 24) |
-                      (static_cast<unsigned char>(data[1]) << 16) |
-                      (static_cast<unsigned char>(data[2]) << 8) |
-                      static_cast<unsigned char>(data[3]);
-    
-    if (headerLength > data.size() - 4) {
-        qWarning() << "Invalid header length in binary message";
-        return;
-    }
-    
-    // Parse header
-    QByteArray headerData = data.mid(4, headerLength);
-    QByteArray chunkData = data.mid(4 + headerLength);
-    
-    QJsonParseError parseError;
-    QJsonDocument headerDoc = QJsonDocument::fromJson(headerData, &parseError);
-    
-    if (parseError.error != QJsonParseError::NoError) {
-        qWarning() << "Failed to parse chunk header:" << parseError.errorString();
-        return;
+    return m_bufferPool->getMissCount();
+}
+
+void FileTransferManager::setTelemetryEnabled(bool enabled)
+{
+    // Stats of an earlier run are not reported as this one's
+    if (enabled && !m_telemetry->isEnabled()) {
+        m_telemetry->reset();
     }
+    m_telemetry->setEnabled(enabled);
     
-    QJsonObject header = headerDoc.object();
-    
-    FileChunk chunk;
-    chunk.transferId = header["transfer_id"].toString();
-    chunk.chunkIndex = header["chunk_index"].toInt();
-    chunk.data = chunkData;
-    chunk.checksum = header["checksum"].toString();
-    chunk.isLast = header["is_last"].toBool();
-    
-    // Process chunk with appropriate worker
-    if (auto worker = m_transferWorkers.value(chunk.transferId)) {
-        // This would be handled by the worker's chunk processing logic
-        emit chunkReceived(chunk.transferId, chunk.chunkIndex);
+    if (enabled) {
+        m_telemetryTimer->start();
+    } else {
+        m_telemetryTimer->stop();
     }
 }
 
-void FileTransferManager::onPingTimer()
+bool FileTransferManager::isTelemetryEnabled() const
 {
-    sendPing();
+    return m_telemetry->isEnabled();
 }
 
-void FileTransferManager::onTransferWorkerFinished()
+void FileTransferManager::setTelemetryReportInterval(int ms)
 {
-    // Clean up finished worker
-    FileTransferWorker *worker = qobject_cast<FileTransferWorker*>(sender());
-    if (worker) {
-        // Find and remove the worker
-        for (auto it = m_transferWorkers.begin(); it != m_transferWorkers.end(); ++it) {
-            if (it.value().get() == worker) {
-                QString transferId = it.key();
-                
-                // Stop and clean up thread
-                if (auto thread = m_transferThreads.value(transferId)) {
-                    thread->quit();
-                    thread->wait(5000);
-                }
-                
-                m_transferWorkers.remove(transferId);
-                m_transferThreads.remove(transferId);
-                break;
-            }
-        }
-    }
+    m_telemetryTimer->setInterval(qMax(ms, MIN_TELEMETRY_INTERVAL));
 }
 
-// Private helper methods
-void FileTransferManager::registerSession()
+int FileTransferManager::getTelemetryReportInterval() const
 {
-    if (!m_isConnected || m_sessionId.isEmpty()) {
-        return;
-    }
-    
-    QJsonObject message = createControlMessage("session_register");
-    message["session_id"] = m_sessionId;
-    message["role"] = "client";
-    
-    sendControlMessage(message);
-    
-    qDebug() << "Session registered:" << m_sessionId;
+    return m_telemetryTimer->interval();
 }
 
-void FileTransferManager::sendPing()
+QJsonObject FileTransferManager::getTelemetryStats() const
 {
-    if (m_isConnected) {
-        QJsonObject message = createControlMessage("ping");
-        sendControlMessage(message);
+    return m_telemetry->getStats();
+}
+
+void FileTransferManager::setTelemetryTracingEnabled(bool enabled)
+{
+    if (enabled && !m_telemetry->isTracingEnabled()) {
+        m_telemetry->clearTrace();
     }
+    m_telemetry->setTracingEnabled(enabled);
 }
 
-void FileTransferManager::handleControlMessage(const QJsonObject &message)
+bool FileTransferManager::isTelemetryTracingEnabled() const
 {
-    QString type = message["type"].toString();
-    
-    if (type == "file_transfer_response") {
-        handleTransferResponse(message);
-    } else if (type == "transfer_status_update") {
-        handleTransferStatusUpdate(message);
-    } else if (type == "chunk_ack") {
-        handleChunkAcknowledgment(message);
-    } else if (type == "progress_response") {
-        handleProgressResponse(message);
-    } else if (type == "error") {
-        handleErrorMessage(message);
-    } else if (type == "pong") {
-        // Pong received, connection is alive
-    } else if (type == "transfer_request") {
-        // Handle incoming transfer request from technician
-        onTransferRequestReceived(message);
+    return m_telemetry->isTracingEnabled();
+}
+
+bool FileTransferManager::writeTelemetryTrace(const QString &filePath) const
+{
+    return m_telemetry->writeTrace(filePath);
+}
+
+void FileTransferManager::setWriteDurability(WriteDurability durability)
+{
+    updateConfig([durability](TransferConfig &config) {
+        config.writeDurability = durability;
+    });
+}
+
+WriteDurability FileTransferManager::getWriteDurability() const
+{
+    return config()->writeDurability;
+}
+
+void FileTransferManager::setMaxConcurrentTransfers(int max)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    m_maxConcurrentTransfers = qMax(1, qMin(max, 10)); // Between 1 and 10
+    m_concurrencyLimit = m_maxConcurrentTransfers;
+    dispatchPendingTransfers();
+}
+
+void FileTransferManager::setAdaptiveConcurrencyEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    m_adaptiveConcurrency = enabled;
+    if (!enabled) {
+        m_concurrencyLimit = m_maxConcurrentTransfers;
+        dispatchPendingTransfers();
+    }
+}
+
+bool FileTransferManager::isAdaptiveConcurrencyEnabled() const
+{
+    return m_adaptiveConcurrency;
+}
+
+int FileTransferManager::getConcurrencyLimit() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_concurrencyLimit;
+}
+
+void FileTransferManager::setTransferPinned(const QString &transferId, bool pinned)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (pinned) {
+        m_pinnedTransfers.insert(transferId);
     } else {
-        qDebug() << "Unknown message type:" << type;
+        m_pinnedTransfers.remove(transferId);
+    }
+    
+    // Reposition the transfer if it is already waiting
+    for (int i = 0; i < m_admissionQueue.size(); ++i) {
+        if (m_admissionQueue.at(i).transferId == transferId) {
+            PendingTransfer pending = m_admissionQueue.takeAt(i);
+            pending.pinned = pinned;
+            enqueueTransfer(pending);
+            break;
+        }
     }
 }
 
-void FileTransferManager::handleTransferResponse(const QJsonObject &message)
+int FileTransferManager::getQueuedTransferCount() const
 {
-    QString transferId = message["transfer_id"].toString();
-    QString status = message["status"].toString();
-    QString responseMessage = message["message"].toString();
+    QMutexLocker locker(&m_mutex);
+    return m_admissionQueue.size();
+}
+
+void FileTransferManager::setEncryptionEnabled(bool enabled)
+{
+    updateConfig([enabled](TransferConfig &config) {
+        config.encryptionEnabled = enabled;
+    });
+}
+
+void FileTransferManager::setCompressionEnabled(bool enabled)
+{
+    updateConfig([enabled](TransferConfig &config) {
+        config.compressionEnabled = enabled;
+    });
+}
+
+void FileTransferManager::setChunkDedupEnabled(bool enabled)
+{
+    updateConfig([enabled](TransferConfig &config) {
+        config.chunkDedupEnabled = enabled;
+    });
+}
+
+bool FileTransferManager::isChunkDedupEnabled() const
+{
+    return config()->chunkDedupEnabled;
+}
+
+void FileTransferManager::setChunkCacheSize(qint64 bytes)
+{
+    qint64 cacheSize = qMax<qint64>(0, bytes);
+    updateConfig([cacheSize](TransferConfig &config) {
+        config.chunkCacheSize = cacheSize;
+    });
     
-    qDebug() << "Transfer response:" << transferId << status << responseMessage;
+    QMutexLocker locker(&m_mutex);
+    if (m_chunkStore) {
+        m_chunkStore->setMaxSize(cacheSize);
+    }
+}
+
+qint64 FileTransferManager::getChunkCacheSize() const
+{
+    return config()->chunkCacheSize;
+}
+
+void FileTransferManager::setParallelStreamsEnabled(bool enabled)
+{
+    updateConfig([enabled](TransferConfig &config) {
+        config.parallelStreamsEnabled = enabled;
+    });
+    
+    QMutexLocker locker(&m_mutex);
+    if (!enabled) {
+        m_streamPool->close();
+    }
+}
+
+bool FileTransferManager::isParallelStreamsEnabled() const
+{
+    return config()->parallelStreamsEnabled;
+}
+
+void FileTransferManager::setMaxDataStreams(int streams)
+{
+    QMutexLocker locker(&m_mutex);
+    m_streamPool->setMaxStreams(streams);
+}
+
+int FileTransferManager::getMaxDataStreams() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streamPool->getMaxStreams();
+}
+
+int FileTransferManager::getDataStreamCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streamPool->getStreamCount();
+}
+
+void FileTransferManager::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&m_mutex);
+    m_sendLimiter.setRateLimit(bytesPerSecond);
+    m_receiveLimiter.setRateLimit(bytesPerSecond);
+    
+    // Chunks held back under the old limit are rescheduled
+    flushSendQueues();
+    flushChunkRequests();
+}
+
+qint64 FileTransferManager::getBandwidthLimit() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sendLimiter.getRateLimit();
+}
+
+void FileTransferManager::setTransferBandwidthLimit(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&m_mutex);
+    m_sendLimiter.setTransferRateLimit(bytesPerSecond);
+    m_receiveLimiter.setTransferRateLimit(bytesPerSecond);
+    
+    // Chunks held back under the old limit are rescheduled
+    flushSendQueues();
+    flushChunkRequests();
+}
+
+qint64 FileTransferManager::getTransferBandwidthLimit() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sendLimiter.getTransferRateLimit();
+}
+
+void FileTransferManager::setYieldToInteractiveEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_sendLimiter.setYieldEnabled(enabled);
+    m_receiveLimiter.setYieldEnabled(enabled);
+    if (!enabled) {
+        m_chunkTimestamps.clear();
+    }
+}
+
+bool FileTransferManager::isYieldToInteractiveEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sendLimiter.isYieldEnabled();
+}
+
+bool FileTransferManager::validateFile(const QString &filePath, QString &errorMessage)
+{
+    QFileInfo fileInfo(filePath);
+    
+    // Check if file exists
+    if (!fileInfo.exists()) {
+        errorMessage = "File does not exist";
+        return false;
+    }
+    
+    // Check if it's a file (not directory)
+    if (!fileInfo.isFile()) {
+        errorMessage = "Path is not a file";
+        return false;
+    }
+    
+    // Check file size
+    std::shared_ptr<const TransferConfig> settings = config();
+    qint64 maxFileSize = getEffectiveMaxFileSize();
+    if (fileInfo.size() > maxFileSize) {
+        errorMessage = QString("File size (%1 MB) exceeds maximum allowed size (%2 MB)")
+                      .arg(fileInfo.size() / (1024 * 1024))
+                      .arg(maxFileSize / (1024 * 1024));
+        return false;
+    }
+    
+    // Check file extension
+    QString extension = fileInfo.suffix().toLower();
+    if (!extension.isEmpty() && !settings->allowedExtensions.contains("." + extension)) {
+        errorMessage = QString("File extension '.%1' is not allowed").arg(extension);
+        return false;
+    }
+    
+    // Check MIME type; the sniff reads the file, so its verdict is cached
+    FileValidationCache::Entry entry;
+    if (!m_validationCache->find(fileInfo, entry) && FileValidationCache::inspect(fileInfo, false, entry)) {
+        m_validationCache->insert(fileInfo, entry);
+    }
+    if (entry.executable) {
+        errorMessage = "Executable files are not allowed";
+        return false;
+    }
+    
+    return true;
+}
+
+void FileTransferManager::prevalidateFiles(const QStringList &filePaths)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    for (const QString &filePath : filePaths) {
+        if (m_pendingValidations.contains(filePath)) {
+            continue;
+        }
+        m_pendingValidations.insert(filePath);
+        
+        m_validationPool->start([this, filePath]() {
+            // Cheap checks first, files that fail them are not hashed
+            QString errorMessage;
+            bool valid = validateFile(filePath, errorMessage);
+            QString checksum;
+            if (valid) {
+                checksum = calculateFileChecksum(filePath);
+            }
+            
+            // Results are reported on the manager's thread
+            QMetaObject::invokeMethod(this, [this, filePath, valid, errorMessage, checksum]() {
+                {
+                    QMutexLocker locker(&m_mutex);
+                    m_pendingValidations.remove(filePath);
+                }
+                
+                if (valid) {
+                    emit fileValidated(filePath, checksum);
+                } else {
+                    emit fileValidationFailed(filePath, errorMessage);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+QString FileTransferManager::getCachedChecksum(const QString &filePath) const
+{
+    FileValidationCache::Entry entry;
+    return m_validationCache->find(QFileInfo(filePath), entry) ? entry.checksum : QString();
+}
+
+void FileTransferManager::clearValidationCache()
+{
+    m_validationCache->clear();
+}
+
+QString FileTransferManager::calculateFileChecksum(const QString &filePath)
+{
+    // An unchanged file is not read again
+    QFileInfo fileInfo(filePath);
+    FileValidationCache::Entry entry;
+    if (m_validationCache->find(fileInfo, entry) && !entry.checksum.isEmpty()) {
+        return entry.checksum;
+    }
+    
+    // A file that changed while it was read is hashed again next time
+    if (FileValidationCache::inspect(fileInfo, true, entry)) {
+        m_validationCache->insert(fileInfo, entry);
+    }
+    return entry.checksum;
+}
+
+void FileTransferManager::onSessionRegistered(const QString &sessionId)
+{
+    m_sessionId = sessionId;
+    registerSession();
+}
+
+void FileTransferManager::onTransferApprovalReceived(const QString &transferId, bool approved, const QString &message)
+{
+    QMutexLocker locker(&m_mutex);
     
     if (auto session = m_transferSessions.value(transferId)) {
-        if (status == "pending") {
-            session->setStatus(TransferStatus::Pending);
-        } else if (status == "approved") {
+        if (approved) {
             session->setStatus(TransferStatus::Approved);
-        } else if (status == "rejected") {
+            emit transferApproved(transferId);
+        } else {
             session->setStatus(TransferStatus::Rejected);
-            session->setError(responseMessage);
+            session->setError(message);
+            emit transferRejected(transferId, message);
+        }
+    }
+}
+
+// WebSocket event handlers
+void FileTransferManager::onWebSocketConnected()
+{
+    qDebug() << "Connected to file transfer server";
+    
+    m_isConnected = true;
+    m_reconnectAttempts = 0;
+    m_reconnectTimer->stop();
+    
+    // Start ping timer
+    m_pingTimer->start();
+    
+    // Register session if we have one, suspended transfers resume once it is
+    if (!m_sessionId.isEmpty()) {
+        registerSession();
+    } else {
+        resumeSuspendedTransfers();
+    }
+    
+    emit connected();
+}
+
+void FileTransferManager::onWebSocketDisconnected()
+{
+    qDebug() << "Disconnected from file transfer server";
+    
+    m_isConnected = false;
+    m_pingTimer->stop();
+    
+    // Chunk framing is renegotiated with whichever server we reconnect to
+    m_chunkHeaderVersion = ChunkCodec::JSON_HEADER_VERSION;
+    m_chunkIntegrity = ChunkIntegrity::Algorithm::Sha256;
+    m_chunkCompressionAvailable = false;
+    m_chunkEncryptionAvailable = false;
+    m_transferResumeAvailable = false;
+    m_deltaSyncAvailable = false;
+    m_chunkDedupAvailable = false;
+    m_bundleTransferAvailable = false;
+    m_sparseFilesAvailable = false;
+    
+    // Data streams belong to the session that is gone, as do the chunks
+    // waiting for a socket or still in its buffer
+    m_streamPool->close();
+    m_sendQueues.clear();
+    m_sendOrder.clear();
+    m_chunkRequests.clear();
+    m_chunkTimestamps.clear();
+    m_sendLimiter.reset();
+    m_receiveLimiter.reset();
+    auto backlog = m_socketBacklog.find(m_webSocket.get());
+    if (backlog != m_socketBacklog.end()) {
+        m_sendBacklog -= backlog.value();
+        backlog.value() = 0;
+    }
+    updateSendBackpressure();
+    
+    // Keep running transfers from burning their retries on a dead socket
+    suspendActiveTransfers();
+    
+    // Start reconnection attempts
+    if (m_reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
+        m_reconnectTimer->start();
+    }
+    
+    emit disconnected();
+}
+
+void FileTransferManager::onWebSocketError(QAbstractSocket::SocketError error)
+{
+    QString errorString = m_webSocket->errorString();
+    qWarning() << "WebSocket error:" << error << errorString;
+    
+    emit connectionError(errorString);
+}
+
+void FileTransferManager::onWebSocketTextMessageReceived(const QString &message)
+{
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(message.toUtf8(), &parseError);
+    
+    if (parseError.error != QJsonParseError::NoError) {
+        qWarning() << "Failed to parse JSON message:" << parseError.errorString();
+        return;
+    }
+    
+    QJsonObject obj = doc.object();
+    handleControlMessage(obj);
+}
+
+void FileTransferManager::onWebSocketBinaryMessageReceived(const QByteArray &data)
+{
+    // Binary control frames share the socket with the chunks
+    if (ControlCodec::isControlFrame(data)) {
+        handleControlFrame(data);
+        return;
+    }
+    
+    // Handle binary file chunks
+    FileChunk chunk;
+    qint64 stageStart = m_telemetry->now();
+    
+    if (ChunkCodec::isBinaryFrame(data)) {
+        quint32 transferHandle = 0;
+        if (!ChunkCodec::decodeBinaryFrame(data, transferHandle, chunk)) {
+            qWarning() << "Failed to decode binary chunk header";
+            return;
+        }
+        
+        chunk.transferId = m_handleTransfers.value(transferHandle);
+        if (chunk.transferId.isEmpty()) {
+            qWarning() << "Chunk for unknown transfer handle:" << transferHandle;
+            return;
+        }
+    } else if (!ChunkCodec::decodeJsonFrame(data, chunk)) {
+        return;
+    }
+    m_telemetry->recordStage(TransferTelemetry::Stage::Frame, stageStart, chunk.transferId, chunk.chunkIndex);
+    
+    recordChunkRoundTrip(m_receiveLimiter, chunk.transferId, chunk.chunkIndex);
+    
+    // Process chunk with appropriate worker
+    if (auto worker = m_transferWorkers.value(chunk.transferId)) {
+        QMetaObject::invokeMethod(worker.get(), "processReceivedChunk",
+                                 Qt::QueuedConnection, Q_ARG(FileChunk, chunk));
+        emit chunkReceived(chunk.transferId, chunk.chunkIndex);
+    }
+}
+
+void FileTransferManager::onPingTimer()
+{
+    sendPing();
+}
+
+void FileTransferManager::onTransferWorkerFinished()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // Clean up finished worker
+    FileTransferWorker *worker = qobject_cast<FileTransferWorker*>(sender());
+    if (worker) {
+        // Find and remove the worker
+        for (auto it = m_transferWorkers.begin(); it != m_transferWorkers.end(); ++it) {
+            if (it.value().get() == worker) {
+                QString transferId = it.key();
+                retireWorker(transferId);
+                break;
+            }
+        }
+    }
+    
+    // Admit the next queued transfer into the freed slot
+    dispatchPendingTransfers();
+}
+
+void FileTransferManager::onThroughputSample()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    qint64 throughput = (m_aggregateBytes - m_lastSampleBytes) * 1000 / THROUGHPUT_SAMPLE_INTERVAL;
+    m_lastSampleBytes = m_aggregateBytes;
+    qint64 previousThroughput = m_lastThroughput;
+    m_lastThroughput = throughput;
+    
+    // Data streams are tuned on the same samples, against striped transfers only
+    bool striping = false;
+    for (auto it = m_transferWorkers.cbegin(); it != m_transferWorkers.cend() && !striping; ++it) {
+        striping = isStripedTransfer(it.key());
+    }
+    m_streamPool->sampleThroughput(throughput, striping);
+    
+    // Only tune while the limit is what keeps transfers waiting
+    if (!m_adaptiveConcurrency || m_admissionQueue.isEmpty() || previousThroughput <= 0) {
+        return;
+    }
+    
+    // Keep moving while throughput improves, turn around when it drops, and
+    // prefer fewer transfers when extra concurrency buys nothing
+    double change = static_cast<double>(throughput - previousThroughput) / previousThroughput;
+    if (change < -THROUGHPUT_CHANGE_THRESHOLD) {
+        m_concurrencyStep = -m_concurrencyStep;
+    } else if (change <= THROUGHPUT_CHANGE_THRESHOLD) {
+        m_concurrencyStep = -1;
+    }
+    
+    int limit = qBound(1, m_concurrencyLimit + m_concurrencyStep, m_maxConcurrentTransfers);
+    if (limit != m_concurrencyLimit) {
+        qDebug() << "Concurrency limit" << m_concurrencyLimit << "->" << limit
+                 << "at" << throughput << "bytes/s";
+        m_concurrencyLimit = limit;
+        dispatchPendingTransfers();
+    }
+}
+
+void FileTransferManager::onProgressBatch(const QList<FileTransferProgress> &updates)
+{
+    for (const FileTransferProgress &progress : updates) {
+        // Aggregate throughput drives the adaptive concurrency limit
+        m_aggregateBytes += qMax<qint64>(0, progress.bytesTransferred - m_reportedBytes.value(progress.transferId));
+        m_reportedBytes[progress.transferId] = progress.bytesTransferred;
+        
+        emit transferProgress(progress.transferId, progress);
+    }
+    
+    emit transferProgressBatch(updates);
+}
+
+void FileTransferManager::onTelemetryReport()
+{
+    if (!m_isConnected || m_sessionId.isEmpty()) {
+        return;
+    }
+    
+    // Nothing is sent for idle periods
+    QJsonObject stats = m_telemetry->takeStats();
+    if (stats.isEmpty()) {
+        return;
+    }
+    
+    QJsonObject message = createControlMessage("transfer_stats", stats);
+    message["session_id"] = m_sessionId;
+    sendControlMessage(message);
+}
+
+// Private helper methods
+void FileTransferManager::registerSession()
+{
+    if (!m_isConnected || m_sessionId.isEmpty()) {
+        return;
+    }
+    
+    QJsonObject message = createControlMessage("session_register");
+    message["session_id"] = m_sessionId;
+    message["role"] = "client";
+    message["chunk_header_version"] = ChunkCodec::LATEST_HEADER_VERSION;
+    message["chunk_integrity"] = QJsonArray::fromStringList(ChunkIntegrity::supportedAlgorithms());
+    message["chunk_compression"] = QJsonArray{ChunkCompressor::algorithmName()};
+    message["chunk_encryption"] = QJsonArray{ChunkCipher::algorithmName()};
+    message["transfer_resume"] = true;
+    message["delta_sync"] = true;
+    std::shared_ptr<const TransferConfig> settings = config();
+    message["chunk_dedup"] = settings->chunkDedupEnabled;
+    message["bundle_transfer"] = true;
+    message["sparse_files"] = true;
+    message["control_frames"] = ControlCodec::CONTROL_FRAME_VERSION;
+    message["ack_interval"] = ControlCodec::DEFAULT_ACK_INTERVAL;
+    if (settings->parallelStreamsEnabled) {
+        message["data_streams"] = m_streamPool->getMaxStreams();
+        message["stripe_chunks"] = TransferStreamPool::STRIPE_CHUNKS;
+    }
+    
+    sendControlMessage(message);
+    
+    qDebug() << "Session registered:" << m_sessionId;
+}
+
+void FileTransferManager::sendPing()
+{
+    if (m_isConnected) {
+        QJsonObject message = createControlMessage("ping");
+        sendControlMessage(message);
+    }
+}
+
+void FileTransferManager::handleControlMessage(const QJsonObject &message)
+{
+    QString type = message["type"].toString();
+    
+    switch (ControlCodec::messageType(type)) {
+    case ControlCodec::MessageType::FileTransferResponse:
+        handleTransferResponse(message);
+        break;
+    case ControlCodec::MessageType::TransferStatusUpdate:
+        handleTransferStatusUpdate(message);
+        break;
+    case ControlCodec::MessageType::ChunkAck:
+        handleChunkAcknowledgment(message);
+        break;
+    case ControlCodec::MessageType::ProgressResponse:
+        handleProgressResponse(message);
+        break;
+    case ControlCodec::MessageType::Error:
+        handleErrorMessage(message);
+        break;
+    case ControlCodec::MessageType::TransferResume:
+        handleTransferResume(message);
+        break;
+    case ControlCodec::MessageType::DeltaReady:
+        handleDeltaReady(message);
+        break;
+    case ControlCodec::MessageType::ChunkHave:
+        handleChunkHave(message);
+        break;
+    case ControlCodec::MessageType::SessionRegistered:
+        handleSessionRegistered(message);
+        break;
+    case ControlCodec::MessageType::Pong:
+        // Pong received, connection is alive
+        break;
+    case ControlCodec::MessageType::TransferRequest:
+        // Handle incoming transfer request from technician
+        onTransferRequestReceived(message);
+        break;
+    default:
+        qDebug() << "Unknown message type:" << type;
+        break;
+    }
+}
+
+void FileTransferManager::handleControlFrame(const QByteArray &frame)
+{
+    ControlCodec::MessageType type = ControlCodec::frameMessageType(frame);
+    
+    switch (type) {
+    case ControlCodec::MessageType::ChunkAck:
+        handleChunkAckFrame(frame);
+        break;
+    default:
+        qDebug() << "Unknown control frame type:" << static_cast<int>(type);
+        break;
+    }
+}
+
+void FileTransferManager::handleSessionRegistered(const QJsonObject &message)
+{
+    // Servers that do not announce a version only understand JSON chunk headers
+    int serverVersion = message["chunk_header_version"].toInt(ChunkCodec::JSON_HEADER_VERSION);
+    m_chunkHeaderVersion = qBound(static_cast<int>(ChunkCodec::JSON_HEADER_VERSION), serverVersion,
+                                  static_cast<int>(ChunkCodec::LATEST_HEADER_VERSION));
+    
+    // Servers that do not pick an integrity algorithm keep SHA-256
+    bool ok = false;
+    m_chunkIntegrity = ChunkIntegrity::stringToAlgorithm(message["chunk_integrity"].toString(), &ok);
+    if (!ok) {
+        m_chunkIntegrity = ChunkIntegrity::Algorithm::Sha256;
+    }
+    
+    // Compressed chunks are only sent to servers that accept them
+    m_chunkCompressionAvailable = message["chunk_compression"].toString() == ChunkCompressor::algorithmName();
+    
+    // Sealed chunks need a peer that can open them; otherwise only TLS protects the data
+    m_chunkEncryptionAvailable = message["chunk_encryption"].toString() == ChunkCipher::algorithmName();
+    
+    qDebug() << "Chunk header version negotiated:" << m_chunkHeaderVersion
+             << "integrity:" << ChunkIntegrity::algorithmToString(m_chunkIntegrity)
+             << "compression:" << m_chunkCompressionAvailable
+             << "encryption:" << m_chunkEncryptionAvailable;
+    
+    // Servers that reconcile checkpoints answer transfer_resume with their own bitmap
+    m_transferResumeAvailable = message["transfer_resume"].toBool();
+    m_deltaSyncAvailable = message["delta_sync"].toBool();
+    std::shared_ptr<const TransferConfig> settings = config();
+    m_chunkDedupAvailable = settings->chunkDedupEnabled && message["chunk_dedup"].toBool();
+    m_bundleTransferAvailable = message["bundle_transfer"].toBool();
+    m_sparseFilesAvailable = message["sparse_files"].toBool();
+    
+    // Data streams attach with the token the server issued for this session
+    int dataStreams = message["data_streams"].toInt();
+    QString streamToken = message["stream_token"].toString();
+    if (settings->parallelStreamsEnabled && dataStreams > 0 && !streamToken.isEmpty()) {
+        m_streamPool->open(QUrl(m_serverUrl), m_sessionId, streamToken, dataStreams);
+    } else {
+        m_streamPool->close();
+    }
+    
+    resumeSuspendedTransfers();
+}
+
+void FileTransferManager::handleTransferResponse(const QJsonObject &message)
+{
+    QString transferId = message["transfer_id"].toString();
+    QString status = message["status"].toString();
+    QString responseMessage = message["message"].toString();
+    
+    qDebug() << "Transfer response:" << transferId << status << responseMessage;
+    
+    if (auto session = m_transferSessions.value(transferId)) {
+        // Server reports the size of files we download
+        qint64 fileSize = message["file_size"].toVariant().toLongLong();
+        if (session->getRequest().type == TransferType::Download && fileSize > 0) {
+            session->setFileSize(fileSize);
+        }
+        
+        // Chunk size the server accepted; servers that predate negotiation
+        // do not answer and chunk at the default size
+        if (!session->setChunkSize(message["chunk_size"].toInt(ChunkSizeTuner::DEFAULT_CHUNK_SIZE))) {
+            session->setChunkSize(ChunkSizeTuner::DEFAULT_CHUNK_SIZE);
+        }
+        
+        // Delta sync: the receiver's signature for uploads, acceptance of our basis for downloads
+        if (session->getRequest().type == TransferType::Upload) {
+            QByteArray signature = QByteArray::fromBase64(message["delta_signature"].toString().toLatin1());
+            if (!signature.isEmpty()) {
+                session->setDeltaSignature(signature);
+            }
+        } else if (message["delta"].toBool()) {
+            session->setDeltaOffered(true);
+        }
+        
+        // Holes the server will not send, at the chunk size just accepted
+        if (session->getRequest().type == TransferType::Download && m_sparseFilesAvailable && message.contains("sparse_chunks")) {
+            session->setHoleChunks(TransferCheckpoint::decodeBitmap(message["sparse_chunks"].toString(), session->getTotalChunks()));
+        }
+        
+        // Digests of the chunks a download will receive, cached ones are not requested
+        if (session->getRequest().type == TransferType::Download && message.contains("chunk_manifest")) {
+            session->setChunkManifest(QByteArray::fromBase64(message["chunk_manifest"].toString().toLatin1()));
+        }
+        
+        if (status == "pending") {
+            session->setStatus(TransferStatus::Pending);
+        } else if (status == "approved") {
+            session->setStatus(TransferStatus::Approved);
+        } else if (status == "rejected") {
+            session->setStatus(TransferStatus::Rejected);
+            session->setError(responseMessage);
+        }
+    }
+}
+
+void FileTransferManager::handleTransferStatusUpdate(const QJsonObject &message)
+{
+    QString transferId = message["transfer_id"].toString();
+    QString status = message["status"].toString();
+    QString statusMessage = message["message"].toString();
+    
+    // A request still waiting for the user's decision was withdrawn
+    if (status == "cancelled" || status == "failed") {
+        withdrawPendingRequest(transferId);
+    }
+    
+    if (auto session = m_transferSessions.value(transferId)) {
+        if (status == "approved") {
+            session->setStatus(TransferStatus::Approved);
+            emit transferApproved(transferId);
+        } else if (status == "rejected") {
+            session->setStatus(TransferStatus::Rejected);
+            session->setError(statusMessage);
+            emit transferRejected(transferId, statusMessage);
+        }
+    }
+}
+
+void FileTransferManager::handleChunkAcknowledgment(const QJsonObject &message)
+{
+    acknowledgeChunks(message["transfer_id"].toString(), QList<int>{message["chunk_index"].toInt()});
+}
+
+void FileTransferManager::handleChunkAckFrame(const QByteArray &frame)
+{
+    QList<ControlCodec::ChunkAcks> acks;
+    if (!ControlCodec::decodeChunkAcks(frame, acks)) {
+        qWarning() << "Failed to decode chunk ack frame";
+        return;
+    }
+    
+    for (const ControlCodec::ChunkAcks &entry : std::as_const(acks)) {
+        // Frames keep coming for a while after a transfer ended
+        QString transferId = m_handleTransfers.value(entry.transferHandle);
+        auto session = m_transferSessions.find(transferId);
+        if (transferId.isEmpty() || session == m_transferSessions.end()) {
+            continue;
+        }
+        
+        int totalChunks = session.value()->getTotalChunks();
+        AckScoreboard &board = m_ackScoreboards[transferId];
+        if (board.selective.size() != totalChunks) {
+            board.selective.resize(totalChunks);
+        }
+        
+        // Only chunks no earlier frame acknowledged go to the worker
+        QList<int> acked;
+        int cumulative = qBound(0, entry.cumulative, totalChunks);
+        for (int chunkIndex = board.cumulative; chunkIndex < cumulative; ++chunkIndex) {
+            if (!board.selective.testBit(chunkIndex)) {
+                acked.append(chunkIndex);
+            }
+        }
+        board.cumulative = qMax(board.cumulative, cumulative);
+        
+        for (const QPair<int, int> &range : entry.ranges) {
+            int first = qMax(range.first, board.cumulative);
+            int end = static_cast<int>(qMin<qint64>(static_cast<qint64>(range.first) + range.second, totalChunks));
+            for (int chunkIndex = first; chunkIndex < end; ++chunkIndex) {
+                if (!board.selective.testBit(chunkIndex)) {
+                    board.selective.setBit(chunkIndex);
+                    acked.append(chunkIndex);
+                }
+            }
+        }
+        
+        acknowledgeChunks(transferId, acked);
+    }
+}
+
+void FileTransferManager::acknowledgeChunks(const QString &transferId, const QList<int> &chunkIndices)
+{
+    if (chunkIndices.isEmpty()) {
+        return;
+    }
+    
+    for (int chunkIndex : chunkIndices) {
+        recordChunkRoundTrip(m_sendLimiter, transferId, chunkIndex);
+        emit chunkSent(transferId, chunkIndex);
+    }
+    
+    // Notify worker about acknowledgments, one queued call per message or frame
+    auto worker = m_transferWorkers.find(transferId);
+    if (worker != m_transferWorkers.end()) {
+        QMetaObject::invokeMethod(worker.value().get(), "onChunksAcknowledged",
+                                 Qt::QueuedConnection, Q_ARG(QList<int>, chunkIndices));
+    }
+}
+
+void FileTransferManager::handleProgressResponse(const QJsonObject &message)
+{
+    // Handle progress updates from server
+    QJsonObject progressObj = message["progress"].toObject();
+    
+    FileTransferProgress progress;
+    progress.transferId = progressObj["transfer_id"].toString();
+    progress.bytesTransferred = progressObj["bytes_transferred"].toVariant().toLongLong();
+    progress.totalBytes = progressObj["total_bytes"].toVariant().toLongLong();
+    progress.percentage = progressObj["percentage"].toDouble();
+    progress.speed = progressObj["speed"].toVariant().toLongLong();
+    progress.remainingTime = progressObj["remaining_time"].toVariant().toLongLong();
+    progress.compressionRatio = progressObj["compression_ratio"].toDouble(1.0);
+    progress.completedFiles = progressObj["completed_files"].toInt();
+    progress.totalFiles = progressObj["total_files"].toInt();
+    
+    emit transferProgress(progress.transferId, progress);
+}
+
+void FileTransferManager::handleErrorMessage(const QJsonObject &message)
+{
+    QString error = message["error"].toString();
+    QString errorMessage = message["message"].toString();
+    
+    qWarning() << "Server error:" << error << errorMessage;
+    emit connectionError(errorMessage);
+}
+
+void FileTransferManager::handleTransferResume(const QJsonObject &message)
+{
+    QString transferId = message["transfer_id"].toString();
+    
+    QMutexLocker locker(&m_mutex);
+    
+    auto worker = m_transferWorkers.find(transferId);
+    auto session = m_transferSessions.find(transferId);
+    if (worker == m_transferWorkers.end() || session == m_transferSessions.end()) {
+        return;
+    }
+    
+    // Chunks the server no longer holds are sent again, and acknowledged again
+    m_ackScoreboards.remove(transferId);
+    QBitArray serverChunks = TransferCheckpoint::decodeBitmap(message["completed_chunks"].toString(),
+                                                              session.value()->getTotalChunks());
+    QMetaObject::invokeMethod(worker.value().get(), "reconcileChunks", Qt::QueuedConnection,
+                              Q_ARG(QBitArray, serverChunks));
+}
+
+void FileTransferManager::handleDeltaReady(const QJsonObject &message)
+{
+    QString transferId = message["transfer_id"].toString();
+    qint64 deltaSize = message["delta_size"].toVariant().toLongLong();
+    QString checksum = message["checksum"].toString();
+    
+    QMutexLocker locker(&m_mutex);
+    
+    auto worker = m_transferWorkers.find(transferId);
+    if (worker == m_transferWorkers.end()) {
+        return;
+    }
+    
+    QMetaObject::invokeMethod(worker.value().get(), "startDeltaDownload", Qt::QueuedConnection,
+                              Q_ARG(qint64, deltaSize), Q_ARG(QString, checksum));
+}
+
+void FileTransferManager::handleChunkHave(const QJsonObject &message)
+{
+    QString transferId = message["transfer_id"].toString();
+    
+    QMutexLocker locker(&m_mutex);
+    
+    auto worker = m_transferWorkers.find(transferId);
+    auto session = m_transferSessions.find(transferId);
+    if (worker == m_transferWorkers.end() || session == m_transferSessions.end()) {
+        return;
+    }
+    
+    // Reply to our chunk_manifest; an unreadable bitmap just means every chunk is sent
+    QBitArray peerChunks = TransferCheckpoint::decodeBitmap(message["have_chunks"].toString(),
+                                                            session.value()->getTotalChunks());
+    QMetaObject::invokeMethod(worker.value().get(), "startDedupUpload", Qt::QueuedConnection,
+                              Q_ARG(QBitArray, peerChunks));
+}
+
+void FileTransferManager::startTransfer(const QString &transferId)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto session = m_transferSessions.value(transferId);
+    if (!session) {
+        qWarning() << "Cannot start transfer: session not found" << transferId;
+        return;
+    }
+    
+    if (m_transferWorkers.contains(transferId)) {
+        return;
+    }
+    for (const PendingTransfer &queued : m_admissionQueue) {
+        if (queued.transferId == transferId) {
+            return;
+        }
+    }
+    
+    // Downloads of unknown size queue behind everything of known size
+    PendingTransfer pending;
+    pending.transferId = transferId;
+    pending.pinned = m_pinnedTransfers.contains(transferId);
+    pending.fileSize = session->getRequest().fileSize > 0 ? session->getRequest().fileSize
+                                                          : std::numeric_limits<qint64>::max();
+    pending.sequence = m_admissionSequence++;
+    enqueueTransfer(pending);
+    
+    dispatchPendingTransfers();
+    
+    for (int i = 0; i < m_admissionQueue.size(); ++i) {
+        if (m_admissionQueue.at(i).transferId == transferId) {
+            qDebug() << "Transfer queued:" << transferId << "position" << i;
+            emit transferQueued(transferId, i);
+            break;
+        }
+    }
+}
+
+void FileTransferManager::enqueueTransfer(const PendingTransfer &pending)
+{
+    // Pinned transfers first, then smaller files, then arrival order
+    auto before = [](const PendingTransfer &a, const PendingTransfer &b) {
+        if (a.pinned != b.pinned) {
+            return a.pinned;
+        }
+        if (a.fileSize != b.fileSize) {
+            return a.fileSize < b.fileSize;
+        }
+        return a.sequence < b.sequence;
+    };
+    
+    auto it = std::upper_bound(m_admissionQueue.begin(), m_admissionQueue.end(), pending, before);
+    m_admissionQueue.insert(it, pending);
+}
+
+void FileTransferManager::dispatchPendingTransfers()
+{
+    // m_mutex must be held
+    while (!m_admissionQueue.isEmpty() && m_transferWorkers.size() < m_concurrencyLimit) {
+        launchTransfer(m_admissionQueue.takeFirst().transferId);
+    }
+    
+    if (m_transferWorkers.isEmpty()) {
+        m_throughputTimer->stop();
+    } else if (!m_throughputTimer->isActive()) {
+        m_throughputTimer->start();
+    }
+}
+
+void FileTransferManager::launchTransfer(const QString &transferId)
+{
+    // m_mutex must be held
+    auto session = m_transferSessions.value(transferId);
+    if (!session) {
+        qWarning() << "Cannot start transfer: session not found" << transferId;
+        return;
+    }
+    
+    // Create worker on a shared pool thread
+    std::shared_ptr<const TransferConfig> settings = config();
+    auto worker = std::make_unique<FileTransferWorker>(session.get(), this);
+    worker->setWindowSize(session->getRequest().type == TransferType::Upload ? settings->pipelineWindow : settings->prefetchDepth);
+    worker->setChunkIntegrity(m_chunkIntegrity);
+    worker->setCompressionEnabled(settings->compressionEnabled && m_chunkCompressionAvailable &&
+                                  ChunkCompressor::isCompressibleFile(session->getRequest().filename));
+    if (settings->encryptionEnabled && m_chunkEncryptionAvailable && !m_encryptionSecret.isEmpty()) {
+        worker->setEncryptionKey(ChunkCipher::deriveTransferKey(m_encryptionSecret, transferId));
+    } else if (settings->encryptionEnabled) {
+        qWarning() << "Chunk encryption unavailable, transfer" << transferId << "relies on TLS only";
+    }
+    if (m_chunkDedupAvailable) {
+        worker->setChunkStore(chunkStore());
+    }
+    if (session->getRequest().type == TransferType::Upload) {
+        worker->setBufferPool(m_bufferPool.get());
+        if (m_chunkHeaderVersion >= ChunkCodec::BINARY_HEADER_VERSION) {
+            worker->setTransferHandle(m_transferHandles.value(transferId));
+        }
+    }
+    worker->setSendBlocked(m_sendBlocked);
+    worker->setTelemetry(m_telemetry.get());
+    session->setProgressCounters(m_progressBus->attach(transferId));
+    session->setTelemetry(m_telemetry.get());
+    session->setWriteDurability(settings->writeDurability);
+    worker->moveToThread(m_threadPool->acquireThread());
+    
+    // Connect signals
+    connect(worker.get(), &FileTransferWorker::transferCompleted, this, [this, transferId]() {
+        FileTransferSession *session = m_transferSessions[transferId].get();
+        if (session->getRequest().type == TransferType::Upload) {
+            QJsonObject message = createControlMessage("transfer_checksum");
+            message["transfer_id"] = transferId;
+            message["checksum"] = session->getFileDigest();
+            sendControlMessage(message);
+        }
+        
+        emit transferCompleted(transferId, session->getRequest().localPath);
+    });
+    connect(worker.get(), &FileTransferWorker::transferFailed, this, [this, transferId](const QString &error) {
+        emit transferFailed(transferId, error);
+    });
+    connect(worker.get(), &FileTransferWorker::linkSampled, this,
+            [this](qint64 rttMs, qint64 bytes, qint64 elapsedMs, int chunksSent, int chunksRetransmitted) {
+        QMutexLocker locker(&m_mutex);
+        m_chunkSizeTuner.recordSample(rttMs, bytes, elapsedMs, chunksSent, chunksRetransmitted);
+    });
+    connect(worker.get(), &FileTransferWorker::checkpointRestored, this,
+            [this, transferId](const QString &previousTransferId, const QBitArray &completedChunks) {
+        // Lets the server continue the partial file of the earlier attempt;
+        // a server that cannot is sent the whole file again
+        QMutexLocker locker(&m_mutex);
+        auto it = m_transferWorkers.find(transferId);
+        if (m_transferResumeAvailable) {
+            sendTransferResume(transferId, completedChunks, previousTransferId);
+        } else if (it != m_transferWorkers.end()) {
+            QMetaObject::invokeMethod(it.value().get(), "discardCheckpoint", Qt::QueuedConnection);
+        }
+    });
+    connect(worker.get(), &FileTransferWorker::deltaSignatureReady, this, [this, transferId](const QByteArray &signature) {
+        QJsonObject message = createControlMessage("delta_signature");
+        message["transfer_id"] = transferId;
+        message["signature"] = QString::fromLatin1(signature.toBase64());
+        sendControlMessage(message);
+    });
+    connect(worker.get(), &FileTransferWorker::deltaPrepared, this, [this, transferId](qint64 deltaSize) {
+        // Sent ahead of the first chunk; a zero size means the file follows in full
+        QJsonObject message = createControlMessage("delta_ready");
+        message["transfer_id"] = transferId;
+        message["delta_size"] = deltaSize;
+        if (deltaSize > 0) {
+            message["checksum"] = m_transferSessions[transferId]->getFileDigest();
+        }
+        sendControlMessage(message);
+    });
+    connect(worker.get(), &FileTransferWorker::chunkManifestReady, this, [this, transferId](const QByteArray &manifest) {
+        // Answered with chunk_have before any chunk is sent
+        QJsonObject message = createControlMessage("chunk_manifest");
+        message["transfer_id"] = transferId;
+        message["chunks"] = QString::fromLatin1(manifest.toBase64());
+        sendControlMessage(message);
+    });
+    connect(worker.get(), &FileTransferWorker::chunkReady, this, [this](const FileChunk &chunk) {
+        sendBinaryChunk(chunk);
+    });
+    connect(worker.get(), &FileTransferWorker::chunkRequested, this, [this](const QString &id, int chunkIndex) {
+        m_chunkRequests.append(ChunkRequest{id, chunkIndex});
+        flushChunkRequests();
+    });
+    
+    // Workers are released once they complete, fail or are cancelled
+    connect(worker.get(), &FileTransferWorker::transferCompleted, this, &FileTransferManager::onTransferWorkerFinished);
+    connect(worker.get(), &FileTransferWorker::transferFailed, this, &FileTransferManager::onTransferWorkerFinished);
+    connect(worker.get(), &FileTransferWorker::transferCancelled, this, &FileTransferManager::onTransferWorkerFinished);
+    
+    // Store worker and start it on its thread
+    QMetaObject::invokeMethod(worker.get(), "startTransfer", Qt::QueuedConnection);
+    m_transferWorkers[transferId] = std::move(worker);
+    
+    session->setStatus(TransferStatus::InProgress);
+    emit transferStarted(transferId);
+    
+    qDebug() << "Transfer started:" << transferId;
+}
+
+void FileTransferManager::retireWorker(const QString &transferId)
+{
+    std::unique_ptr<FileTransferWorker> worker = m_transferWorkers.take(transferId);
+    if (worker) {
+        m_threadPool->releaseThread(worker->thread());
+        
+        // The worker lives on a pool thread, delete it there
+        worker->disconnect(this);
+        worker.release()->deleteLater();
+    }
+    
+    m_reportedBytes.remove(transferId);
+    m_progressBus->detach(transferId);
+    clearSendQueue(transferId);
+    m_chunkRequests.removeIf([&transferId](const ChunkRequest &request) {
+        return request.transferId == transferId;
+    });
+    m_chunkTimestamps.remove(transferId);
+    m_sendLimiter.removeTransfer(transferId);
+    m_receiveLimiter.removeTransfer(transferId);
+    releaseTransferHandle(transferId);
+}
+
+ChunkStore *FileTransferManager::chunkStore()
+{
+    // m_mutex must be held; the index is only read once dedup is first used
+    if (!m_chunkStore) {
+        m_chunkStore = std::make_unique<ChunkStore>(ChunkStore::defaultDirectory(), config()->chunkCacheSize);
+    }
+    return m_chunkStore.get();
+}
+
+void FileTransferManager::suspendActiveTransfers()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    for (auto it = m_transferWorkers.begin(); it != m_transferWorkers.end(); ++it) {
+        FileTransferWorker *worker = it.value().get();
+        if (!worker->isRunning() || worker->isPaused()) {
+            continue;
+        }
+        
+        // Paused transfers stop their chunk timers; the checkpoint covers a restart
+        m_suspendedTransfers.insert(it.key());
+        QMetaObject::invokeMethod(worker, "pauseTransfer", Qt::QueuedConnection);
+    }
+    
+    if (!m_suspendedTransfers.isEmpty()) {
+        qDebug() << "Suspended" << m_suspendedTransfers.size() << "transfers until reconnected";
+    }
+}
+
+void FileTransferManager::resumeSuspendedTransfers()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    for (const QString &transferId : std::as_const(m_suspendedTransfers)) {
+        auto it = m_transferWorkers.find(transferId);
+        if (it == m_transferWorkers.end()) {
+            continue;
+        }
+        
+        FileTransferWorker *worker = it.value().get();
+        if (m_transferResumeAvailable) {
+            sendTransferResume(transferId, worker->getCompletedChunkBitmap());
+        }
+        QMetaObject::invokeMethod(worker, "resumeAfterReconnect", Qt::QueuedConnection);
+    }
+    
+    m_suspendedTransfers.clear();
+}
+
+void FileTransferManager::sendTransferResume(const QString &transferId, const QBitArray &completedChunks,
+                                             const QString &previousTransferId)
+{
+    QJsonObject message = createControlMessage("transfer_resume");
+    message["transfer_id"] = transferId;
+    message["total_chunks"] = static_cast<int>(completedChunks.size());
+    message["completed_chunks"] = TransferCheckpoint::encodeBitmap(completedChunks);
+    if (!previousTransferId.isEmpty() && previousTransferId != transferId) {
+        message["previous_transfer_id"] = previousTransferId;
+    }
+    sendControlMessage(message);
+}
+
+QJsonObject FileTransferManager::createControlMessage(const QString &type, const QJsonObject &data)
+{
+    // Built on the data, which is shared until written to; UTC skips the
+    // time zone lookup and gives the offset RFC 3339 parsers expect
+    QJsonObject message = data;
+    message["type"] = type;
+    message["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    
+    return message;
+}
+
+void FileTransferManager::sendControlMessage(const QJsonObject &message)
+{
+    if (!m_isConnected) {
+        qWarning() << "Cannot send message: not connected";
+        return;
+    }
+    
+    QByteArray text = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    queueSocketBytes(m_webSocket.get(), text.size());
+    m_webSocket->sendTextMessage(QString::fromUtf8(text));
+}
+
+void FileTransferManager::sendBinaryChunk(const FileChunk &chunk)
+{
+    if (!m_isConnected) {
+        qWarning() << "Cannot send chunk: not connected";
+        return;
+    }
+    
+    // Fixed-layout header when the server supports it, JSON otherwise; the
+    // worker's frame is sent as is unless the framing changed since, e.g. on
+    // a reconnect to an older server
+    QByteArray message;
+    qint64 stageStart = m_telemetry->now();
+    quint32 transferHandle = m_transferHandles.value(chunk.transferId);
+    bool framed = m_chunkHeaderVersion >= ChunkCodec::BINARY_HEADER_VERSION && transferHandle != 0 &&
+                  transferHandle == ChunkCodec::frameTransferHandle(chunk.frame);
+    if (framed) {
+        message = chunk.frame;
+        stageStart = -1; // Framed by the worker, timed there
+    } else if (m_chunkHeaderVersion >= ChunkCodec::BINARY_HEADER_VERSION && transferHandle != 0) {
+        message = ChunkCodec::encodeBinaryFrame(transferHandle, chunk);
+    } else {
+        message = ChunkCodec::encodeJsonFrame(chunk);
+    }
+    m_telemetry->recordStage(TransferTelemetry::Stage::Frame, stageStart, chunk.transferId, chunk.chunkIndex);
+    
+    // The payload was copied into the encoded frame, the worker's buffer goes back now
+    if (!framed) {
+        m_bufferPool->release(chunk.frame);
+    }
+    
+    // Behind the transfer's earlier chunks, transfers take turns
+    QQueue<OutgoingChunk> &queue = m_sendQueues[chunk.transferId];
+    if (queue.isEmpty()) {
+        m_sendOrder.append(chunk.transferId);
+    }
+    queue.enqueue(OutgoingChunk{chunk.chunkIndex, message, framed});
+    
+    flushSendQueues();
+}
+
+void FileTransferManager::flushSendQueues()
+{
+    // One chunk per transfer and turn while the sockets take more; transfers
+    // over a rate limit sit out until every remaining one is held
+    qint64 now = m_rateClock.elapsed();
+    qint64 wait = 0;
+    int held = 0;
+    QHash<QString, QList<int>> writtenChunks;
+    while (m_sendBacklog < m_sendHighWatermark && held < m_sendOrder.size()) {
+        QString transferId = m_sendOrder.takeFirst();
+        auto it = m_sendQueues.find(transferId);
+        if (it == m_sendQueues.end() || it->isEmpty()) {
+            continue;
+        }
+        
+        qint64 delay = m_sendLimiter.reserve(transferId, it->head().frame.size(), now);
+        if (delay > 0) {
+            m_sendOrder.append(transferId);
+            wait = wait > 0 ? qMin(wait, delay) : delay;
+            ++held;
+            continue;
+        }
+        held = 0;
+        
+        OutgoingChunk next = it->dequeue();
+        if (it->isEmpty()) {
+            m_sendQueues.erase(it);
+        } else {
+            m_sendOrder.append(transferId);
+        }
+        
+        writeChunkFrame(transferId, next.chunkIndex, next.frame);
+        if (next.pooled) {
+            m_bufferPool->release(std::move(next.frame));
+        }
+        writtenChunks[transferId].append(next.chunkIndex);
+    }
+    
+    reportChunksWritten(writtenChunks);
+    if (wait > 0) {
+        scheduleRateTimer(wait);
+    }
+    updateSendBackpressure();
+    
+    if (m_telemetry->isEnabled()) {
+        qint64 queued = 0;
+        for (auto queue = m_sendQueues.cbegin(); queue != m_sendQueues.cend(); ++queue) {
+            queued += queue->size();
         }
+        m_telemetry->recordQueueDepth(TransferTelemetry::Queue::SendQueue, queued);
     }
 }
 
-void FileTransferManager::handleTransferStatusUpdate(const QJsonObject &message)
+void FileTransferManager::writeChunkFrame(const QString &transferId, int chunkIndex, const QByteArray &frame)
 {
-    QString transferId = message["transfer_id"].toString();
-    QString status = message["status"].toString();
-    QString statusMessage = message["message"].toString();
+    // Off the control socket whenever a data stream is open
+    QWebSocket *socket = m_streamPool->streamFor(chunkIndex, isStripedTransfer(transferId));
+    if (!socket) {
+        socket = m_webSocket.get();
+    }
     
-    if (auto session = m_transferSessions.value(transferId)) {
-        if (status == "approved") {
-            session->setStatus(TransferStatus::Approved);
-            emit transferApproved(transferId);
-        } else if (status == "rejected") {
-            session->setStatus(TransferStatus::Rejected);
-            session->setError(statusMessage);
-            emit transferRejected(transferId, statusMessage);
+    queueSocketBytes(socket, frame.size());
+    stampChunk(transferId, chunkIndex);
+    
+    qint64 stageStart = m_telemetry->now();
+    socket->sendBinaryMessage(frame);
+    m_telemetry->recordStage(TransferTelemetry::Stage::Send, stageStart, transferId, chunkIndex);
+    m_telemetry->recordQueueDepth(TransferTelemetry::Queue::SendBacklog, m_sendBacklog);
+}
+
+void FileTransferManager::queueSocketBytes(QWebSocket *socket, qint64 payloadSize)
+{
+    // The control socket is accounted from its first message on, data
+    // streams from their first chunk until they go away; a stream's attach
+    // message is written before chunks are routed to it
+    if (!m_socketBacklog.contains(socket)) {
+        connect(socket, &QWebSocket::bytesWritten, this, [this, socket](qint64 bytes) {
+            onSocketBytesWritten(socket, bytes);
+        });
+        if (socket != m_webSocket.get()) {
+            connect(socket, &QObject::destroyed, this, [this, socket]() {
+                m_sendBacklog -= m_socketBacklog.take(socket);
+                flushSendQueues();
+            });
         }
     }
+    
+    qint64 size = webSocketWireSize(socket, payloadSize);
+    m_socketBacklog[socket] += size;
+    m_sendBacklog += size;
 }
 
-void FileTransferManager::handleChunkAcknowledgment(const QJsonObject &message)
+void FileTransferManager::onSocketBytesWritten(QWebSocket *socket, qint64 bytes)
 {
-    QString transferId = message["transfer_id"].toString();
-    int chunkIndex = message["chunk_index"].toInt();
+    // Every message the manager queued is counted, framing included; only
+    // pongs the socket answers pings with on its own are not, a few bytes each
+    auto it = m_socketBacklog.find(socket);
+    if (it == m_socketBacklog.end() || it.value() == 0) {
+        return;
+    }
     
-    emit chunkSent(transferId, chunkIndex);
+    qint64 written = qMin(bytes, it.value());
+    it.value() -= written;
+    m_sendBacklog -= written;
     
-    // Notify worker about acknowledgment
-    if (auto worker = m_transferWorkers.value(transferId)) {
-        QMetaObject::invokeMethod(worker.get(), "onChunkAcknowledged", 
-                                 Qt::QueuedConnection, Q_ARG(int, chunkIndex));
-    }
+    flushSendQueues();
 }
 
-void FileTransferManager::handleProgressResponse(const QJsonObject &message)
+void FileTransferManager::updateSendBackpressure()
 {
-    // Handle progress updates from server
-    QJsonObject progressObj = message["progress"].toObject();
+    // Hysteresis keeps workers from flapping around a single threshold
+    bool blocked = m_sendBlocked ? m_sendBacklog > m_sendLowWatermark : m_sendBacklog >= m_sendHighWatermark;
+    if (blocked == m_sendBlocked) {
+        return;
+    }
     
-    FileTransferProgress progress;
-    progress.transferId = progressObj["transfer_id"].toString();
-    progress.bytesTransferred = progressObj["bytes_transferred"].toVariant().toLongLong();
-    progress.totalBytes = progressObj["total_bytes"].toVariant().toLongLong();
-    progress.percentage = progressObj["percentage"].toDouble();
-    progress.speed = progressObj["speed"].toVariant().toLongLong();
-    progress.remainingTime = progressObj["remaining_time"].toVariant().toLongLong();
+    m_sendBlocked = blocked;
+    qDebug() << (blocked ? "Send buffers full," : "Send buffers drained,") << m_sendBacklog << "bytes unwritten";
     
-    emit transferProgress(progress.transferId, progress);
+    for (auto it = m_transferWorkers.cbegin(); it != m_transferWorkers.cend(); ++it) {
+        QMetaObject::invokeMethod(it.value().get(), "setSendBlocked", Qt::QueuedConnection, Q_ARG(bool, blocked));
+    }
 }
 
-void FileTransferManager::handleErrorMessage(const QJsonObject &message)
+void FileTransferManager::clearSendQueue(const QString &transferId)
 {
-    QString error = message["error"].toString();
-    QString errorMessage = message["message"].toString();
-    
-    qWarning() << "Server error:" << error << errorMessage;
-    emit connectionError(errorMessage);
+    m_sendQueues.remove(transferId);
+    m_sendOrder.removeAll(transferId);
 }
 
-void FileTransferManager::startTransfer(const QString &transferId)
+void FileTransferManager::flushChunkRequests()
 {
-    QMutexLocker locker(&m_mutex);
-    
-    auto session = m_transferSessions.value(transferId);
-    if (!session) {
-        qWarning() << "Cannot start transfer: session not found" << transferId;
-        return;
+    // In request order; a transfer over its own limit does not hold up the others
+    qint64 now = m_rateClock.elapsed();
+    qint64 wait = 0;
+    QHash<QString, QList<int>> writtenChunks;
+    for (auto it = m_chunkRequests.begin(); it != m_chunkRequests.end();) {
+        auto session = m_transferSessions.find(it->transferId);
+        if (session == m_transferSessions.end()) {
+            it = m_chunkRequests.erase(it);
+            continue;
+        }
+        
+        qint64 delay = m_receiveLimiter.reserve(it->transferId, session.value()->getChunkSize(), now);
+        if (delay > 0) {
+            wait = wait > 0 ? qMin(wait, delay) : delay;
+            ++it;
+            continue;
+        }
+        
+        QJsonObject message = createControlMessage("chunk_request");
+        message["transfer_id"] = it->transferId;
+        message["chunk_index"] = it->chunkIndex;
+        stampChunk(it->transferId, it->chunkIndex);
+        sendControlMessage(message);
+        writtenChunks[it->transferId].append(it->chunkIndex);
+        it = m_chunkRequests.erase(it);
     }
+    reportChunksWritten(writtenChunks);
+    m_telemetry->recordQueueDepth(TransferTelemetry::Queue::ChunkRequests, m_chunkRequests.size());
     
-    // Check if we've reached max concurrent transfers
-    int activeCount = 0;
-    for (const auto &worker : m_transferWorkers) {
-        Q_UNUSED(worker)
-        activeCount++;
+    if (wait > 0) {
+        scheduleRateTimer(wait);
     }
-    
-    if (activeCount >= m_maxConcurrentTransfers) {
-        qWarning() << "Cannot start transfer: max concurrent transfers reached";
-        return;
+}
+
+void FileTransferManager::reportChunksWritten(const QHash<QString, QList<int>> &writtenChunks)
+{
+    // One queued call per transfer and flush, chunks held by a rate limit
+    // do not time out while they wait
+    for (auto it = writtenChunks.cbegin(); it != writtenChunks.cend(); ++it) {
+        auto worker = m_transferWorkers.find(it.key());
+        if (worker != m_transferWorkers.end()) {
+            QMetaObject::invokeMethod(worker.value().get(), "onChunksWritten",
+                                     Qt::QueuedConnection, Q_ARG(QList<int>, it.value()));
+        }
     }
-    
-    // Create worker and thread
-    auto worker = std::make_unique<FileTransferWorker>(session.get(), this);
-    auto thread = std::make_unique<QThread>();
-    
-    // Move worker to thread
-    worker->moveToThread(thread.get());
-    
-    // Connect signals
-    connect(thread.get(), &QThread::started, worker.get(), &FileTransferWorker::startTransfer);
-    connect(worker.get(), &FileTransferWorker::transferCompleted, this, [this, transferId]() {
-        emit transferCompleted(transferId, m_transferSessions[transferId]->getRequest().localPath);
-    });
-    connect(worker.get(), &FileTransferWorker::transferFailed, this, [this, transferId](const QString &error) {
-        emit transferFailed(transferId, error);
-    });
-    connect(worker.get(), &FileTransferWorker::progressUpdated, this, [this, transferId](const FileTransferProgress &progress) {
-        emit transferProgress(transferId, progress);
-    });
-    connect(worker.get(), &FileTransferWorker::chunkReady, this, [this](const FileChunk &chunk) {
-        sendBinaryChunk(chunk);
-    });
-    
-    // Store worker and thread
-    m_transferWorkers[transferId] = std::move(worker);
-    m_transferThreads[transferId] = std::move(thread);
-    
-    // Start thread
-    m_transferThreads[transferId]->start();
-    
-    session->setStatus(TransferStatus::InProgress);
-    emit transferStarted(transferId);
-    
-    qDebug() << "Transfer started:" << transferId;
 }
 
-QJsonObject FileTransferManager::createControlMessage(const QString &type, const QJsonObject &data)
+void FileTransferManager::scheduleRateTimer(qint64 waitMs)
 {
-    QJsonObject message;
-    message["type"] = type;
-    message["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    
-    // Merge additional data
-    for (auto it = data.begin(); it != data.end(); ++it) {
-        message[it.key()] = it.value();
+    // Whichever held chunk is due first wakes both directions
+    if (!m_rateTimer->isActive() || m_rateTimer->remainingTime() > waitMs) {
+        m_rateTimer->start(static_cast<int>(waitMs));
     }
-    
-    return message;
 }
 
-void FileTransferManager::sendControlMessage(const QJsonObject &message)
+void FileTransferManager::stampChunk(const QString &transferId, int chunkIndex)
 {
-    if (!m_isConnected) {
-        qWarning() << "Cannot send message: not connected";
+    if (!m_sendLimiter.isYieldEnabled()) {
         return;
     }
     
-    QJsonDocument doc(message);
-    m_webSocket->sendTextMessage(doc.toJson(QJsonDocument::Compact));
+    // A chunk sent or requested again cannot be timed (Karn's rule)
+    QHash<int, qint64> &timestamps = m_chunkTimestamps[transferId];
+    timestamps.insert(chunkIndex, timestamps.contains(chunkIndex) ? -1 : m_rateClock.elapsed());
 }
 
-void FileTransferManager::sendBinaryChunk(const FileChunk &chunk)
+void FileTransferManager::recordChunkRoundTrip(TransferRateLimiter &limiter, const QString &transferId, int chunkIndex)
 {
-    if (!m_isConnected) {
-        qWarning() << "Cannot send chunk: not connected";
+    auto it = m_chunkTimestamps.find(transferId);
+    if (it == m_chunkTimestamps.end()) {
         return;
     }
     
-    // Create chunk header
-    QJsonObject header;
-    header["transfer_id"] = chunk.transferId;
-    header["chunk_index"] = chunk.chunkIndex;
-    header["checksum"] = chunk.checksum;
-    header["is_last"] = chunk.isLast;
-    
-    QJsonDocument headerDoc(header);
-    QByteArray headerData = headerDoc.toJson(QJsonDocument::Compact);
-    
-    // Create binary message: [header_length(4 bytes)][header][chunk_data]
-    QByteArray message;
-    
-    // Header length (4 bytes, big-endian)
-    int headerLength = headerData.size();
-    message.append(static_cast<char>((headerLength >> 24) & 0xFF));
-    message.append(static_cast<char>((headerLength >> 16) & 0xFF));
-    message.append(static_cast<char>((headerLength >> 8) & 0xFF));
-    message.append(static_cast<char>(headerLength & 0xFF));
-    
-    // Header and chunk data
-    message.append(headerData);
-    message.append(chunk.data);
-    
-    m_webSocket->sendBinaryMessage(message);
+    qint64 stamp = it->take(chunkIndex);
+    if (stamp > 0) {
+        qint64 now = m_rateClock.elapsed();
+        limiter.recordLatency(now - stamp, now);
+    }
+}
+
+QByteArray FileTransferManager::compressData(const QByteArray &data)
+{
+    ChunkCompressor compressor;
+    QByteArray compressed;
+    if (!compressor.compress(data, compressed)) {
+        return QByteArray();
+    }
+    return compressed;
+}
+
+QByteArray FileTransferManager::decompressData(const QByteArray &compressedData)
+{
+    ChunkCompressor compressor;
+    QByteArray data;
+    if (!compressor.decompress(compressedData, data, config()->maxFileSize)) {
+        return QByteArray();
+    }
+    return data;
 }
 
 QString FileTransferManager::generateTransferId()
@@ -802,6 +2249,29 @@ QString FileTransferManager::generateTransferId()
     return QUuid::createUuid().toString(QUuid::WithoutBraces);
 }
 
+quint32 FileTransferManager::assignTransferHandle(const QString &transferId, quint32 handle)
+{
+    // Numeric handles identify transfers in binary chunk headers
+    if (handle == 0) {
+        do {
+            handle = m_nextTransferHandle++;
+        } while (handle == 0 || m_handleTransfers.contains(handle));
+    }
+    
+    m_transferHandles.insert(transferId, handle);
+    m_handleTransfers.insert(handle, transferId);
+    return handle;
+}
+
+void FileTransferManager::releaseTransferHandle(const QString &transferId)
+{
+    quint32 handle = m_transferHandles.take(transferId);
+    if (handle != 0) {
+        m_handleTransfers.remove(handle);
+    }
+    m_ackScoreboards.remove(transferId);
+}
+
 bool FileTransferManager::prepareFileForUpload(const QString &filePath, FileTransferRequest &request)
 {
     QFileInfo fileInfo(filePath);
@@ -809,12 +2279,11 @@ bool FileTransferManager::prepareFileForUpload(const QString &filePath, FileTran
     request.filename = fileInfo.fileName();
     request.fileSize = fileInfo.size();
     request.localPath = filePath;
-    request.checksum = calculateFileChecksum(filePath);
     
-    if (request.checksum.isEmpty()) {
-        qWarning() << "Failed to calculate file checksum";
-        return false;
-    }
+    // A checksum hashed ahead by prevalidateFiles() goes with the request;
+    // otherwise it is computed while the chunks are sent and reported once
+    // the upload completes, so the file is not scanned up front
+    request.checksum = getCachedChecksum(filePath);
     
     return true;
 }
@@ -841,113 +2310,229 @@ bool FileTransferManager::prepareFileForDownload(const QString &filename, const
 // Approval dialog settings
 void FileTransferManager::setAutoApprovalEnabled(bool enabled)
 {
-    QMutexLocker locker(&m_mutex);
-    m_autoApprovalEnabled = enabled;
+    updateConfig([enabled](TransferConfig &config) {
+        config.autoApprovalEnabled = enabled;
+    });
     saveSettings();
 }
 
 bool FileTransferManager::isAutoApprovalEnabled() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_autoApprovalEnabled;
+    return config()->autoApprovalEnabled;
 }
 
 void FileTransferManager::setApprovalTimeout(int seconds)
 {
-    QMutexLocker locker(&m_mutex);
-    m_approvalTimeout = qMax(5, seconds); // Minimum 5 seconds
+    int timeout = qMax(5, seconds); // Minimum 5 seconds
+    updateConfig([timeout](TransferConfig &config) {
+        config.approvalTimeout = timeout;
+    });
     saveSettings();
 }
 
 int FileTransferManager::getApprovalTimeout() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_approvalTimeout;
+    return config()->approvalTimeout;
 }
 
 void FileTransferManager::setRememberDecisionEnabled(bool enabled)
 {
-    QMutexLocker locker(&m_mutex);
-    m_rememberDecisionEnabled = enabled;
+    updateConfig([enabled](TransferConfig &config) {
+        config.rememberDecisionEnabled = enabled;
+    });
     saveSettings();
 }
 
 bool FileTransferManager::isRememberDecisionEnabled() const
+{
+    return config()->rememberDecisionEnabled;
+}
+
+void FileTransferManager::setApprovalPolicy(const QString &technician, const QString &extension, int sizeClass, bool approved)
+{
+    QMutexLocker locker(&m_mutex);
+    m_approvalPolicies.setPolicy(technician, extension, sizeClass, approved);
+    persistApprovalPolicies();
+}
+
+bool FileTransferManager::removeApprovalPolicy(const QString &technician, const QString &extension, int sizeClass)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_approvalPolicies.removePolicy(technician, extension, sizeClass)) {
+        return false;
+    }
+    persistApprovalPolicies();
+    return true;
+}
+
+void FileTransferManager::clearApprovalPolicies()
+{
+    QMutexLocker locker(&m_mutex);
+    m_approvalPolicies.clear();
+    persistApprovalPolicies();
+}
+
+int FileTransferManager::getApprovalPolicyCount() const
 {
     QMutexLocker locker(&m_mutex);
-    return m_rememberDecisionEnabled;
+    return m_approvalPolicies.getPolicyCount();
 }
 
 // Security settings
 void FileTransferManager::addAllowedFileExtension(const QString &extension)
 {
-    QMutexLocker locker(&m_mutex);
     QString ext = extension.toLower();
     if (!ext.startsWith(".")) {
         ext.prepend(".");
     }
-    if (!m_allowedExtensions.contains(ext)) {
-        m_allowedExtensions.append(ext);
+    
+    bool added = false;
+    updateConfig([&ext, &added](TransferConfig &config) {
+        if (!config.allowedExtensions.contains(ext)) {
+            config.allowedExtensions.insert(ext);
+            added = true;
+        }
+    });
+    if (added) {
         saveSettings();
     }
 }
 
 void FileTransferManager::removeAllowedFileExtension(const QString &extension)
 {
-    QMutexLocker locker(&m_mutex);
     QString ext = extension.toLower();
     if (!ext.startsWith(".")) {
         ext.prepend(".");
     }
-    if (m_allowedExtensions.removeAll(ext) > 0) {
+    
+    bool removed = false;
+    updateConfig([&ext, &removed](TransferConfig &config) {
+        removed = config.allowedExtensions.remove(ext);
+    });
+    if (removed) {
         saveSettings();
     }
 }
 
 QStringList FileTransferManager::getAllowedFileExtensions() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_allowedExtensions;
+    std::shared_ptr<const TransferConfig> settings = config();
+    QStringList extensions(settings->allowedExtensions.cbegin(), settings->allowedExtensions.cend());
+    extensions.sort();
+    return extensions;
 }
 
 void FileTransferManager::setMaxFileSize(qint64 maxSize)
 {
-    QMutexLocker locker(&m_mutex);
-    m_maxFileSize = qMax(1024LL, maxSize); // Minimum 1KB
+    qint64 size = qMax(1024LL, maxSize); // Minimum 1KB
+    updateConfig([size](TransferConfig &config) {
+        config.maxFileSize = size;
+    });
     saveSettings();
 }
 
 qint64 FileTransferManager::getMaxFileSize() const
+{
+    return config()->maxFileSize;
+}
+
+void FileTransferManager::setLargeFileModeEnabled(bool enabled)
+{
+    updateConfig([enabled](TransferConfig &config) {
+        config.largeFileModeEnabled = enabled;
+    });
+    saveSettings();
+}
+
+bool FileTransferManager::isLargeFileModeEnabled() const
+{
+    return config()->largeFileModeEnabled;
+}
+
+qint64 FileTransferManager::getEffectiveMaxFileSize() const
+{
+    // Never below the configured limit, which may already be higher
+    std::shared_ptr<const TransferConfig> settings = config();
+    return settings->largeFileModeEnabled ? qMax(settings->maxFileSize, static_cast<qint64>(LARGE_FILE_MAX_SIZE)) : settings->maxFileSize;
+}
+
+void FileTransferManager::setEncryptionSecret(const QByteArray &secret)
 {
     QMutexLocker locker(&m_mutex);
-    return m_maxFileSize;
+    m_encryptionSecret = secret;
 }
 
 // Approval and security methods
 void FileTransferManager::showApprovalDialog(const FileTransferRequest &request)
 {
-    // Check if we have a remembered decision
+    // Check if a remembered policy covers the request
+    std::shared_ptr<const TransferConfig> settings = config();
     bool approved = false;
-    if (m_rememberDecisionEnabled && checkRememberedDecision(request.id, approved)) {
+    if (settings->rememberDecisionEnabled && checkApprovalPolicy(request, approved)) {
         processApprovalDecision(request.id, approved, 
                               approved ? tr("Auto-approved (remembered)") : tr("Auto-rejected (remembered)"));
         return;
     }
     
+    // An open batch dialog takes the request
+    if (m_batchApprovalDialog) {
+        m_batchApprovalDialog->addRequest(request);
+        return;
+    }
+    
+    // Requests arriving together are shown together
+    m_approvalBatch.append(request);
+    if (!m_approvalBatchTimer->isActive()) {
+        m_approvalBatchTimer->start();
+    }
+}
+
+void FileTransferManager::openApprovalDialog(const FileTransferRequest &request)
+{
+    std::shared_ptr<const TransferConfig> settings = config();
+    
     // Show approval dialog
     ApprovalDialog *dialog = new ApprovalDialog(request, qobject_cast<QWidget*>(parent()));
     
     // Configure dialog
-    if (m_approvalTimeout > 0) {
-        dialog->setAutoTimeout(m_approvalTimeout);
+    if (settings->approvalTimeout > 0) {
+        dialog->setAutoTimeout(settings->approvalTimeout);
     }
-    dialog->setRememberOptionEnabled(m_rememberDecisionEnabled);
+    dialog->setRememberOptionEnabled(settings->rememberDecisionEnabled);
     
     // Connect dialog signals
     connect(dialog, QOverload<int>::of(&QDialog::finished), this, &FileTransferManager::onApprovalDialogFinished);
     
     // Store dialog reference
     dialog->setProperty("transferId", request.id);
+    ++m_openApprovalDialogs;
+    
+    // Show dialog
+    dialog->show();
+    dialog->raise();
+    dialog->activateWindow();
+}
+
+void FileTransferManager::openBatchApprovalDialog(const QList<FileTransferRequest> &requests)
+{
+    std::shared_ptr<const TransferConfig> settings = config();
+    
+    // Show one dialog for all of them
+    BatchApprovalDialog *dialog = new BatchApprovalDialog(qobject_cast<QWidget*>(parent()));
+    for (const FileTransferRequest &request : requests) {
+        dialog->addRequest(request);
+    }
+    
+    // Configure dialog
+    if (settings->approvalTimeout > 0) {
+        dialog->setAutoTimeout(settings->approvalTimeout);
+    }
+    dialog->setRememberOptionEnabled(settings->rememberDecisionEnabled);
+    
+    // Connect dialog signals
+    connect(dialog, &BatchApprovalDialog::requestsDecided, this, &FileTransferManager::onBatchApprovalDecided);
+    connect(dialog, QOverload<int>::of(&QDialog::finished), this, &FileTransferManager::onBatchApprovalDialogFinished);
+    m_batchApprovalDialog = dialog;
     
     // Show dialog
     dialog->show();
@@ -960,78 +2545,111 @@ bool FileTransferManager::isFileExtensionAllowed(const QString &filePath) const
     QFileInfo fileInfo(filePath);
     QString extension = "." + fileInfo.suffix().toLower();
     
-    QMutexLocker locker(&m_mutex);
-    return m_allowedExtensions.contains(extension);
+    return config()->allowedExtensions.contains(extension);
 }
 
 bool FileTransferManager::isFileSizeValid(qint64 fileSize) const
+{
+    return fileSize > 0 && fileSize <= getEffectiveMaxFileSize();
+}
+
+bool FileTransferManager::checkApprovalPolicy(const FileTransferRequest &request, bool &approved) const
 {
     QMutexLocker locker(&m_mutex);
-    return fileSize > 0 && fileSize <= m_maxFileSize;
+    return m_approvalPolicies.lookup(request, approved);
 }
 
-bool FileTransferManager::checkRememberedDecision(const QString &transferId, bool &approved) const
+void FileTransferManager::saveApprovalPolicies(const QList<FileTransferRequest> &requests, bool approved)
 {
+    if (requests.isEmpty()) {
+        return;
+    }
+    
+    // One write to persistent storage for the whole batch; a policy needs a
+    // technician to match on, and executables are never approved unseen
     QMutexLocker locker(&m_mutex);
-    if (m_rememberedDecisions.contains(transferId)) {
-        approved = m_rememberedDecisions.value(transferId);
-        return true;
+    int remembered = 0;
+    for (const FileTransferRequest &request : requests) {
+        bool dangerous = ApprovalDialog::DANGEROUS_EXTENSIONS.contains(QFileInfo(request.filename).suffix().toLower());
+        if (request.technician.isEmpty() || (approved && dangerous)) {
+            qDebug() << "Not remembering the decision on" << request.filename << "from" << request.technician;
+            continue;
+        }
+        m_approvalPolicies.remember(request, approved);
+        ++remembered;
+    }
+    if (remembered > 0) {
+        persistApprovalPolicies();
     }
-    return false;
 }
 
-void FileTransferManager::saveRememberedDecision(const QString &transferId, bool approved)
+void FileTransferManager::persistApprovalPolicies()
 {
-    QMutexLocker locker(&m_mutex);
-    m_rememberedDecisions.insert(transferId, approved);
-    
-    // Save to persistent storage
-    m_settings->beginGroup("RememberedDecisions");
-    m_settings->setValue(transferId, approved);
-    m_settings->endGroup();
+    m_approvalPolicies.save(m_settings);
     m_settings->sync();
 }
 
 void FileTransferManager::loadSettings()
 {
-    // Load approval settings
-    m_autoApprovalEnabled = m_settings->value("AutoApproval/Enabled", false).toBool();
-    m_approvalTimeout = m_settings->value("AutoApproval/Timeout", 30).toInt();
-    m_rememberDecisionEnabled = m_settings->value("AutoApproval/RememberDecision", true).toBool();
+    updateConfig([this](TransferConfig &config) {
+        // Load approval settings
+        config.autoApprovalEnabled = m_settings->value("AutoApproval/Enabled", false).toBool();
+        config.approvalTimeout = m_settings->value("AutoApproval/Timeout", 30).toInt();
+        config.rememberDecisionEnabled = m_settings->value("AutoApproval/RememberDecision", true).toBool();
     
-    // Load security settings
-    m_maxFileSize = m_settings->value("Security/MaxFileSize", MAX_FILE_SIZE).toLongLong();
+        // Load security settings
+        config.maxFileSize = m_settings->value("Security/MaxFileSize", MAX_FILE_SIZE).toLongLong();
+        config.largeFileModeEnabled = m_settings->value("Security/LargeFileMode", false).toBool();
     
-    // Load allowed extensions (if saved)
-    QStringList savedExtensions = m_settings->value("Security/AllowedExtensions").toStringList();
-    if (!savedExtensions.isEmpty()) {
-        m_allowedExtensions = savedExtensions;
-    }
+        // Load allowed extensions (if saved)
+        QStringList savedExtensions = m_settings->value("Security/AllowedExtensions").toStringList();
+        if (!savedExtensions.isEmpty()) {
+            config.allowedExtensions = QSet<QString>(savedExtensions.cbegin(), savedExtensions.cend());
+        }
+    });
     
-    // Load remembered decisions
-    m_settings->beginGroup("RememberedDecisions");
-    QStringList keys = m_settings->childKeys();
-    for (const QString &key : keys) {
-        bool approved = m_settings->value(key).toBool();
-        m_rememberedDecisions.insert(key, approved);
-    }
-    m_settings->endGroup();
+    // Load approval policies; decisions kept by transfer ID never matched
+    // a later request and are dropped
+    QMutexLocker locker(&m_mutex);
+    m_approvalPolicies.load(m_settings);
+    m_settings->remove("RememberedDecisions");
 }
 
 void FileTransferManager::saveSettings()
 {
+    // The settings store is shared with the approval policies
+    std::shared_ptr<const TransferConfig> settings = config();
+    QMutexLocker locker(&m_mutex);
+    
     // Save approval settings
-    m_settings->setValue("AutoApproval/Enabled", m_autoApprovalEnabled);
-    m_settings->setValue("AutoApproval/Timeout", m_approvalTimeout);
-    m_settings->setValue("AutoApproval/RememberDecision", m_rememberDecisionEnabled);
+    m_settings->setValue("AutoApproval/Enabled", settings->autoApprovalEnabled);
+    m_settings->setValue("AutoApproval/Timeout", settings->approvalTimeout);
+    m_settings->setValue("AutoApproval/RememberDecision", settings->rememberDecisionEnabled);
     
     // Save security settings
-    m_settings->setValue("Security/MaxFileSize", m_maxFileSize);
-    m_settings->setValue("Security/AllowedExtensions", m_allowedExtensions);
+    m_settings->setValue("Security/MaxFileSize", settings->maxFileSize);
+    m_settings->setValue("Security/LargeFileMode", settings->largeFileModeEnabled);
+    QStringList extensions(settings->allowedExtensions.cbegin(), settings->allowedExtensions.cend());
+    extensions.sort();
+    m_settings->setValue("Security/AllowedExtensions", extensions);
     
     m_settings->sync();
 }
 
+std::shared_ptr<const FileTransferManager::TransferConfig> FileTransferManager::config() const
+{
+    return std::atomic_load(&m_config);
+}
+
+void FileTransferManager::updateConfig(const std::function<void(TransferConfig &)> &update)
+{
+    // Snapshots already handed out keep the values they were taken with
+    QMutexLocker locker(&m_configMutex);
+    auto copy = std::make_shared<TransferConfig>(*m_config);
+    update(*copy);
+    std::atomic_store(&m_config, std::shared_ptr<const TransferConfig>(std::move(copy)));
+}
+
 // Approval and security slots
 void FileTransferManager::onApprovalDialogFinished(int result)
 {
@@ -1044,13 +2662,89 @@ void FileTransferManager::onApprovalDialogFinished(int result)
     bool approved = dialog->isApproved();
     QString message = dialog->getMessage();
     
-    // Save decision if requested
-    if (dialog->shouldRememberDecision()) {
-        saveRememberedDecision(transferId, approved);
+    // A request withdrawn while the dialog was open gets no answer
+    auto it = m_pendingRequests.constFind(transferId);
+    if (it != m_pendingRequests.cend()) {
+        if (dialog->shouldRememberDecision()) {
+            saveApprovalPolicies({it.value()}, approved);
+        }
+        processApprovalDecision(transferId, approved, message);
+    }
+    
+    // Clean up
+    --m_openApprovalDialogs;
+    dialog->deleteLater();
+}
+
+void FileTransferManager::onApprovalBatchTimeout()
+{
+    QList<FileTransferRequest> batch;
+    batch.swap(m_approvalBatch);
+    
+    // A dialog closed during the window may have left a policy for these
+    std::shared_ptr<const TransferConfig> settings = config();
+    QList<FileTransferRequest> undecided;
+    for (const FileTransferRequest &request : batch) {
+        if (!m_pendingRequests.contains(request.id)) {
+            continue;
+        }
+        
+        bool approved = false;
+        if (settings->rememberDecisionEnabled && checkApprovalPolicy(request, approved)) {
+            processApprovalDecision(request.id, approved,
+                                  approved ? tr("Auto-approved (remembered)") : tr("Auto-rejected (remembered)"));
+            continue;
+        }
+        undecided.append(request);
+    }
+    
+    if (undecided.isEmpty()) {
+        return;
+    }
+    
+    // A lone request gets the detailed dialog, unless another is still open
+    if (m_batchApprovalDialog) {
+        for (const FileTransferRequest &request : undecided) {
+            m_batchApprovalDialog->addRequest(request);
+        }
+    } else if (undecided.size() == 1 && m_openApprovalDialogs == 0) {
+        openApprovalDialog(undecided.first());
+    } else {
+        openBatchApprovalDialog(undecided);
+    }
+}
+
+void FileTransferManager::onBatchApprovalDecided(const QStringList &transferIds, bool approved, const QString &message, bool remember)
+{
+    // Save decisions if requested
+    if (remember) {
+        QList<FileTransferRequest> requests;
+        for (const QString &transferId : transferIds) {
+            auto it = m_pendingRequests.constFind(transferId);
+            if (it != m_pendingRequests.cend()) {
+                requests.append(it.value());
+            }
+        }
+        saveApprovalPolicies(requests, approved);
     }
     
-    // Process the decision
-    processApprovalDecision(transferId, approved, message);
+    // Process the decisions
+    for (const QString &transferId : transferIds) {
+        processApprovalDecision(transferId, approved, message);
+    }
+}
+
+void FileTransferManager::onBatchApprovalDialogFinished(int result)
+{
+    BatchApprovalDialog *dialog = qobject_cast<BatchApprovalDialog*>(sender());
+    if (!dialog) {
+        return;
+    }
+    
+    // Later requests open a dialog of their own
+    if (m_batchApprovalDialog == dialog) {
+        m_batchApprovalDialog.clear();
+    }
     
     // Clean up
     dialog->deleteLater();
@@ -1067,6 +2761,12 @@ void FileTransferManager::onTransferRequestReceived(const QJsonObject &request)
     transferRequest.technician = request["technician"].toString();
     transferRequest.checksum = request["checksum"].toString();
     
+    // Server-initiated transfers carry the handle used in binary chunk headers
+    quint32 transferHandle = request["transfer_handle"].toVariant().toUInt();
+    if (transferHandle != 0) {
+        assignTransferHandle(transferRequest.id, transferHandle);
+    }
+    
     // Store pending request
     m_pendingRequests.insert(transferRequest.id, transferRequest);
     
@@ -1087,7 +2787,7 @@ void FileTransferManager::onTransferRequestReceived(const QJsonObject &request)
     }
     
     // Check for auto-approval
-    if (m_autoApprovalEnabled) {
+    if (config()->autoApprovalEnabled) {
         processApprovalDecision(transferRequest.id, true, tr("Auto-approved"));
         return;
     }
@@ -1097,10 +2797,22 @@ void FileTransferManager::onTransferRequestReceived(const QJsonObject &request)
     showApprovalDialog(transferRequest);
 }
 
+void FileTransferManager::withdrawPendingRequest(const QString &transferId)
+{
+    // The batch timeout skips requests no longer pending, a dialog listing
+    // it must not answer it either
+    if (m_pendingRequests.remove(transferId) && m_batchApprovalDialog) {
+        m_batchApprovalDialog->removeRequest(transferId);
+    }
+}
+
 void FileTransferManager::processApprovalDecision(const QString &transferId, bool approved, const QString &message)
 {
-    // Remove from pending requests
+    // Remove from pending requests, and from a batch dialog when decided elsewhere
     m_pendingRequests.remove(transferId);
+    if (m_batchApprovalDialog) {
+        m_batchApprovalDialog->removeRequest(transferId);
+    }
     
     // Send decision to server
     QJsonObject response = createControlMessage("transfer_approval");
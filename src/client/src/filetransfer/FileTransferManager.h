@@ -5,7 +5,10 @@
 #include <QWebSocket>
 #include <QFile>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QQueue>
+#include <QSet>
+#include <QBitArray>
 #include <QMutex>
 #include <QThread>
 #include <QJsonObject>
@@ -16,11 +19,27 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QSettings>
+#include <QPointer>
 #include <memory>
+#include <functional>
+#include "ChunkIntegrity.h"
+#include "ChunkCipher.h"
+#include "ChunkSizeTuner.h"
+#include "TransferRateLimiter.h"
+#include "ApprovalPolicyCache.h"
 
 class FileTransferSession;
 class FileTransferWorker;
+class TransferThreadPool;
+class ChunkStore;
+class TransferStreamPool;
+class TransferProgressBus;
+class ChunkBufferPool;
+class TransferTelemetry;
+class FileValidationCache;
+class QThreadPool;
 class ApprovalDialog;
+class BatchApprovalDialog;
 
 // Transfer types
 enum class TransferType {
@@ -40,6 +59,13 @@ enum class TransferStatus {
     Rejected
 };
 
+// Durability of downloaded data versus write throughput
+enum class WriteDurability {
+    Fast,       // Buffered writes, flushed on completion only
+    Checkpoint, // Synced to disk periodically and on completion
+    Safe        // Synced to disk after every chunk
+};
+
 // File transfer request structure
 struct FileTransferRequest {
     QString id;
@@ -62,6 +88,9 @@ struct FileTransferProgress {
     double percentage;
     qint64 speed; // bytes per second
     qint64 remainingTime; // seconds
+    double compressionRatio; // bytes on the wire / file bytes, 1.0 when uncompressed
+    int completedFiles; // bundles only, both 0 for single files
+    int totalFiles;
     TransferStatus status;
     QString errorMessage;
     QDateTime startTime;
@@ -73,10 +102,16 @@ struct FileChunk {
     QString transferId;
     int chunkIndex;
     QByteArray data;
-    QString checksum;
+    QByteArray checksum; // raw digest, algorithm negotiated per session
     bool isLast;
+    bool compressed; // data is deflate compressed, checksum covers the original
+    ChunkCipher::Cipher cipher; // data is sealed, checksum is unused
+    QByteArray frame; // frame that data and checksum view into, received or framed in place for sending
 };
 
+Q_DECLARE_METATYPE(FileChunk)
+Q_DECLARE_METATYPE(FileTransferProgress)
+
 class FileTransferManager : public QObject
 {
     Q_OBJECT
@@ -94,24 +129,103 @@ public:
     QString requestFileUpload(const QString &filePath, const QString &sessionId, const QString &technician);
     QString requestFileDownload(const QString &filename, const QString &sessionId, const QString &technician, const QString &savePath);
     
+    // Bundles: many small files below rootPath sent as one transfer (see
+    // TransferBundle). Files that fail validation are left out and reported
+    // through fileValidationFailed; servers without bundle support get none.
+    bool isBundleTransferAvailable() const;
+    QString requestBundleUpload(const QString &rootPath, const QStringList &filePaths,
+                                const QString &sessionId, const QString &technician);
+    QStringList getBundleFiles(const QString &transferId) const;
+    
     // Transfer control
     void pauseTransfer(const QString &transferId);
     void resumeTransfer(const QString &transferId);
     void cancelTransfer(const QString &transferId);
     
+    // Admission queue: approved transfers wait here for a free slot
+    void setTransferPinned(const QString &transferId, bool pinned);
+    int getQueuedTransferCount() const;
+    
     // Progress tracking
     FileTransferProgress getTransferProgress(const QString &transferId) const;
     QStringList getActiveTransfers() const;
     
     // Configuration
     void setChunkSize(int size);
+    int getChunkSize() const;
+    // Size each new transfer's chunks from the RTT, throughput and retransmit
+    // rate measured on earlier ones, starting from the configured chunk size
+    void setAdaptiveChunkSizeEnabled(bool enabled);
+    bool isAdaptiveChunkSizeEnabled() const;
+    void setPipelineWindow(int chunks);
+    int getPipelineWindow() const;
+    void setPrefetchDepth(int chunks);
+    int getPrefetchDepth() const;
+    // Send flow control: uploads stop producing chunks once more than the
+    // high watermark sits unwritten in the socket buffers and resume below
+    // the low one; queued chunks go out round-robin across transfers
+    void setSendBufferWatermarks(qint64 lowBytes, qint64 highBytes);
+    qint64 getSendLowWatermark() const;
+    qint64 getSendHighWatermark() const;
+    qint64 getSendBacklog() const;
+    // Upload frames come from a pool (see ChunkBufferPool) and go back once
+    // written; in a steady transfer every chunk is a hit
+    quint64 getBufferPoolHitCount() const;
+    quint64 getBufferPoolMissCount() const;
+    // Pipeline telemetry (see TransferTelemetry), off by default: stage
+    // latency histograms, retransmits, timeouts and queue depths, reported
+    // to the server as a transfer_stats message every report interval
+    void setTelemetryEnabled(bool enabled);
+    bool isTelemetryEnabled() const;
+    void setTelemetryReportInterval(int ms);
+    int getTelemetryReportInterval() const;
+    QJsonObject getTelemetryStats() const;
+    // Chrome trace events of the timed stages, for one slow transfer
+    void setTelemetryTracingEnabled(bool enabled);
+    bool isTelemetryTracingEnabled() const;
+    bool writeTelemetryTrace(const QString &filePath) const;
+    void setWriteDurability(WriteDurability durability);
+    WriteDurability getWriteDurability() const;
     void setMaxConcurrentTransfers(int max);
+    void setAdaptiveConcurrencyEnabled(bool enabled);
+    bool isAdaptiveConcurrencyEnabled() const;
+    int getConcurrencyLimit() const;
     void setEncryptionEnabled(bool enabled);
     void setCompressionEnabled(bool enabled);
-    
-    // Security and validation
+    // Chunks the peer already holds (or that are cached locally) are not sent
+    void setChunkDedupEnabled(bool enabled);
+    bool isChunkDedupEnabled() const;
+    void setChunkCacheSize(qint64 bytes);
+    qint64 getChunkCacheSize() const;
+    // Chunk data on extra connections next to the control socket, large
+    // transfers striped over them (see TransferStreamPool); enabling takes
+    // effect when the session next registers
+    void setParallelStreamsEnabled(bool enabled);
+    bool isParallelStreamsEnabled() const;
+    void setMaxDataStreams(int streams);
+    int getMaxDataStreams() const;
+    int getDataStreamCount() const;
+    // Rate shaping (see TransferRateLimiter), in bytes/s with 0 for no
+    // limit; sent chunks and requested chunks are shaped separately, and
+    // yielding backs both off while chunk round trips are inflated
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    qint64 getBandwidthLimit() const;
+    void setTransferBandwidthLimit(qint64 bytesPerSecond);
+    qint64 getTransferBandwidthLimit() const;
+    void setYieldToInteractiveEnabled(bool enabled);
+    bool isYieldToInteractiveEnabled() const;
+    
+    // Security and validation; safe from any thread. What reading the file
+    // found (MIME sniff, checksum) is cached while its size and mtime hold.
     bool validateFile(const QString &filePath, QString &errorMessage);
     QString calculateFileChecksum(const QString &filePath);
+    // Validates and hashes files about to be sent on background threads;
+    // each ends in fileValidated or fileValidationFailed, after which
+    // validateFile and the upload request cost a stat. The checksum of a
+    // pre-hashed file goes out with its upload request.
+    void prevalidateFiles(const QStringList &filePaths);
+    QString getCachedChecksum(const QString &filePath) const;
+    void clearValidationCache();
     
     // Approval dialog settings
     void setAutoApprovalEnabled(bool enabled);
@@ -121,12 +235,34 @@ public:
     void setRememberDecisionEnabled(bool enabled);
     bool isRememberDecisionEnabled() const;
     
+    // Remembered decisions apply to every later request of the same
+    // technician, file extension and size class (see ApprovalPolicyCache);
+    // requests arriving together are decided in one dialog
+    void setApprovalPolicy(const QString &technician, const QString &extension, int sizeClass, bool approved);
+    bool removeApprovalPolicy(const QString &technician, const QString &extension, int sizeClass);
+    void clearApprovalPolicies();
+    int getApprovalPolicyCount() const;
+    
     // Security settings
     void addAllowedFileExtension(const QString &extension);
     void removeAllowedFileExtension(const QString &extension);
     QStringList getAllowedFileExtensions() const;
     void setMaxFileSize(qint64 maxSize);
     qint64 getMaxFileSize() const;
+    
+    // Large-file mode lifts the size limit to LARGE_FILE_MAX_SIZE. Files
+    // from LARGE_FILE_THRESHOLD on get chunks of LARGE_FILE_CHUNK_SIZE or
+    // more, so the per-chunk state of a transfer stays small, and holes of
+    // sparse files are skipped where the server supports it.
+    static const qint64 LARGE_FILE_MAX_SIZE = 1024LL * 1024 * 1024 * 1024; // 1TB
+    static const qint64 LARGE_FILE_THRESHOLD = 1024LL * 1024 * 1024;       // 1GB
+    static const int LARGE_FILE_CHUNK_SIZE = 1024 * 1024;                  // 1MB
+    void setLargeFileModeEnabled(bool enabled);
+    bool isLargeFileModeEnabled() const;
+    // Limit uploads and offered downloads are checked against
+    qint64 getEffectiveMaxFileSize() const;
+    // Secret shared with the peer, chunk keys are derived from it per transfer
+    void setEncryptionSecret(const QByteArray &secret);
 
 public slots:
     void onSessionRegistered(const QString &sessionId);
@@ -142,8 +278,12 @@ signals:
     void transferRequested(const QString &transferId, const FileTransferRequest &request);
     void transferApproved(const QString &transferId);
     void transferRejected(const QString &transferId, const QString &reason);
+    void transferQueued(const QString &transferId, int position);
     void transferStarted(const QString &transferId);
     void transferProgress(const QString &transferId, const FileTransferProgress &progress);
+    // Every running transfer that changed since the last progress tick, for
+    // views that repaint once per tick; transferProgress is emitted for each
+    void transferProgressBatch(const QList<FileTransferProgress> &updates);
     void transferCompleted(const QString &transferId, const QString &filePath);
     void transferFailed(const QString &transferId, const QString &error);
     void transferCancelled(const QString &transferId);
@@ -158,6 +298,7 @@ signals:
     void transferApprovalDecision(const QString &transferId, bool approved, const QString &message);
     void securityWarning(const QString &message, const QString &details);
     void fileValidationFailed(const QString &filePath, const QString &reason);
+    void fileValidated(const QString &filePath, const QString &checksum);
     void unauthorizedTransferAttempt(const QString &transferId, const QString &reason);
 
 private slots:
@@ -168,9 +309,15 @@ private slots:
     void onWebSocketBinaryMessageReceived(const QByteArray &data);
     void onPingTimer();
     void onTransferWorkerFinished();
+    void onThroughputSample();
+    void onProgressBatch(const QList<FileTransferProgress> &updates);
+    void onTelemetryReport();
     
     // Approval and security slots
     void onApprovalDialogFinished(int result);
+    void onApprovalBatchTimeout();
+    void onBatchApprovalDecided(const QStringList &transferIds, bool approved, const QString &message, bool remember);
+    void onBatchApprovalDialogFinished(int result);
     void onTransferRequestReceived(const QJsonObject &request);
     void processApprovalDecision(const QString &transferId, bool approved, const QString &message);
 
@@ -182,14 +329,31 @@ private:
     
     // Message handling
     void handleControlMessage(const QJsonObject &message);
+    void handleSessionRegistered(const QJsonObject &message);
     void handleTransferResponse(const QJsonObject &message);
     void handleTransferStatusUpdate(const QJsonObject &message);
     void handleChunkAcknowledgment(const QJsonObject &message);
     void handleProgressResponse(const QJsonObject &message);
     void handleErrorMessage(const QJsonObject &message);
+    void handleTransferResume(const QJsonObject &message);
+    void handleDeltaReady(const QJsonObject &message);
+    void handleChunkHave(const QJsonObject &message);
+    void handleControlFrame(const QByteArray &frame);
+    void handleChunkAckFrame(const QByteArray &frame);
     
     // Transfer management
     void startTransfer(const QString &transferId);
+    void launchTransfer(const QString &transferId);
+    void dispatchPendingTransfers();
+    void retireWorker(const QString &transferId);
+    void acknowledgeChunks(const QString &transferId, const QList<int> &chunkIndices);
+    ChunkStore *chunkStore();
+    
+    // Reconnect handling: running transfers are parked while the socket is down
+    void suspendActiveTransfers();
+    void resumeSuspendedTransfers();
+    void sendTransferResume(const QString &transferId, const QBitArray &completedChunks,
+                            const QString &previousTransferId = QString());
     void updateTransferProgress(const QString &transferId, const FileTransferProgress &progress);
     FileTransferSession* getTransferSession(const QString &transferId) const;
     
@@ -198,6 +362,24 @@ private:
     void sendControlMessage(const QJsonObject &message);
     void sendBinaryChunk(const FileChunk &chunk);
     QString generateTransferId();
+    QString submitUpload(FileTransferRequest &request, const QString &sessionId, const QString &technician);
+    bool isStripedTransfer(const QString &transferId) const;
+    
+    // Send queues and socket backlog accounting
+    void flushSendQueues();
+    void writeChunkFrame(const QString &transferId, int chunkIndex, const QByteArray &frame);
+    void queueSocketBytes(QWebSocket *socket, qint64 payloadSize);
+    void onSocketBytesWritten(QWebSocket *socket, qint64 bytes);
+    void updateSendBackpressure();
+    void clearSendQueue(const QString &transferId);
+    void flushChunkRequests();
+    void reportChunksWritten(const QHash<QString, QList<int>> &writtenChunks);
+    void scheduleRateTimer(qint64 waitMs);
+    void stampChunk(const QString &transferId, int chunkIndex);
+    void recordChunkRoundTrip(TransferRateLimiter &limiter, const QString &transferId, int chunkIndex);
+    int proposeChunkSize(const FileTransferRequest &request) const;
+    quint32 assignTransferHandle(const QString &transferId, quint32 handle = 0);
+    void releaseTransferHandle(const QString &transferId);
     
     // File operations
     bool prepareFileForUpload(const QString &filePath, FileTransferRequest &request);
@@ -205,22 +387,26 @@ private:
     
     // Approval and security methods
     void showApprovalDialog(const FileTransferRequest &request);
+    void openApprovalDialog(const FileTransferRequest &request);
+    void openBatchApprovalDialog(const QList<FileTransferRequest> &requests);
+    void withdrawPendingRequest(const QString &transferId);
     bool isFileExtensionAllowed(const QString &filePath) const;
     bool isFileSizeValid(qint64 fileSize) const;
-    bool checkRememberedDecision(const QString &transferId, bool &approved) const;
-    void saveRememberedDecision(const QString &transferId, bool approved);
+    bool checkApprovalPolicy(const FileTransferRequest &request, bool &approved) const;
+    void saveApprovalPolicies(const QList<FileTransferRequest> &requests, bool approved);
+    // m_mutex must be held
+    void persistApprovalPolicies();
     void loadSettings();
     void saveSettings();
     
     // Security
-    QByteArray encryptData(const QByteArray &data);
-    QByteArray decryptData(const QByteArray &encryptedData);
     QByteArray compressData(const QByteArray &data);
     QByteArray decompressData(const QByteArray &compressedData);
 
 private:
-    // WebSocket connection
+    // WebSocket connection; chunks move to the data streams once they are open
     std::unique_ptr<QWebSocket> m_webSocket;
+    std::unique_ptr<TransferStreamPool> m_streamPool;
     QString m_serverUrl;
     QString m_sessionId;
     bool m_isConnected;
@@ -231,27 +417,147 @@ private:
     int m_reconnectAttempts;
     static const int MAX_RECONNECT_ATTEMPTS = 5;
     
+    // Chunk framing and integrity negotiated in the session handshake
+    int m_chunkHeaderVersion;
+    quint32 m_nextTransferHandle;
+    QHash<QString, quint32> m_transferHandles;
+    QHash<quint32, QString> m_handleTransfers;
+    ChunkIntegrity::Algorithm m_chunkIntegrity;
+    bool m_chunkCompressionAvailable;
+    bool m_chunkEncryptionAvailable;
+    bool m_transferResumeAvailable;
+    bool m_deltaSyncAvailable;
+    bool m_chunkDedupAvailable;
+    bool m_bundleTransferAvailable;
+    bool m_sparseFilesAvailable;
+    
+    // Chunks acknowledged by ack frames, per transfer: all below cumulative
+    // and the selective bits above it, so repeated ranges count once
+    struct AckScoreboard {
+        int cumulative = 0;
+        QBitArray selective;
+    };
+    QHash<QString, AckScoreboard> m_ackScoreboards;
+    
+    // Upload frame buffers, shared with the workers
+    std::unique_ptr<ChunkBufferPool> m_bufferPool;
+    
+    // Pipeline telemetry, shared with the sessions and workers
+    std::unique_ptr<TransferTelemetry> m_telemetry;
+    std::unique_ptr<QTimer> m_telemetryTimer;
+    
+    // Background validation; m_pendingValidations is guarded by m_mutex
+    std::unique_ptr<FileValidationCache> m_validationCache;
+    std::unique_ptr<QThreadPool> m_validationPool;
+    QSet<QString> m_pendingValidations;
+    
     // Transfer management
     QMap<QString, std::unique_ptr<FileTransferSession>> m_transferSessions;
     QMap<QString, std::unique_ptr<FileTransferWorker>> m_transferWorkers;
-    QMap<QString, std::unique_ptr<QThread>> m_transferThreads;
-    
-    // Configuration
-    int m_chunkSize;
+    std::unique_ptr<TransferThreadPool> m_threadPool;
+    std::unique_ptr<TransferProgressBus> m_progressBus;
+    
+    // Admission queue, kept in dispatch order
+    struct PendingTransfer {
+        QString transferId;
+        bool pinned;
+        qint64 fileSize;
+        quint64 sequence;
+    };
+    void enqueueTransfer(const PendingTransfer &pending);
+    QList<PendingTransfer> m_admissionQueue;
+    quint64 m_admissionSequence;
+    QSet<QString> m_pinnedTransfers;
+    QSet<QString> m_suspendedTransfers;
+    
+    // Bandwidth-aware concurrency below m_maxConcurrentTransfers
+    bool m_adaptiveConcurrency;
+    int m_concurrencyLimit;
+    int m_concurrencyStep;
+    qint64 m_aggregateBytes;
+    qint64 m_lastSampleBytes;
+    qint64 m_lastThroughput;
+    QHash<QString, qint64> m_reportedBytes;
+    std::unique_ptr<QTimer> m_throughputTimer;
+    
+    // Send flow control: frames waiting per transfer, the transfers with
+    // frames in round-robin order, and bytes handed to each socket that it
+    // has not written yet
+    struct OutgoingChunk {
+        int chunkIndex;
+        QByteArray frame;
+        bool pooled; // The worker's buffer, released once written
+    };
+    QHash<QString, QQueue<OutgoingChunk>> m_sendQueues;
+    QList<QString> m_sendOrder;
+    QHash<QWebSocket *, qint64> m_socketBacklog;
+    qint64 m_sendBacklog;
+    qint64 m_sendLowWatermark;
+    qint64 m_sendHighWatermark;
+    bool m_sendBlocked;
+    
+    // Rate shaping: chunk requests wait here for the receive limiter, which
+    // paces downloads from our side. Round trips for yielding are timed from
+    // the socket write or request on, time spent held back does not count
+    struct ChunkRequest {
+        QString transferId;
+        int chunkIndex;
+    };
+    TransferRateLimiter m_sendLimiter;
+    TransferRateLimiter m_receiveLimiter;
+    QList<ChunkRequest> m_chunkRequests;
+    QHash<QString, QHash<int, qint64>> m_chunkTimestamps;
+    QElapsedTimer m_rateClock;
+    std::unique_ptr<QTimer> m_rateTimer;
+    
+    // Chunk sizing from link measurements of finished and running transfers
+    ChunkSizeTuner m_chunkSizeTuner;
+    
+    // Settings that change rarely. Readers take the current snapshot
+    // without locking; setters copy it, change the copy and publish it, one
+    // at a time under m_configMutex, so neither waits on m_mutex
+    struct TransferConfig {
+        bool adaptiveChunkSize;
+        int chunkSize;
+        int pipelineWindow;
+        int prefetchDepth;
+        WriteDurability writeDurability;
+        bool encryptionEnabled;
+        bool compressionEnabled;
+        bool chunkDedupEnabled;
+        qint64 chunkCacheSize;
+        bool parallelStreamsEnabled;
+        qint64 maxFileSize;
+        bool largeFileModeEnabled;
+        QSet<QString> allowedExtensions; // Lower case, with the dot
+        
+        // Approval
+        bool autoApprovalEnabled;
+        int approvalTimeout;
+        bool rememberDecisionEnabled;
+    };
+    std::shared_ptr<const TransferConfig> config() const;
+    void updateConfig(const std::function<void(TransferConfig &)> &update);
+    std::shared_ptr<const TransferConfig> m_config;
+    QMutex m_configMutex;
+    
+    // Configuration tied to state under m_mutex
     int m_maxConcurrentTransfers;
-    bool m_encryptionEnabled;
-    bool m_compressionEnabled;
-    qint64 m_maxFileSize;
-    QStringList m_allowedExtensions;
-    
-    // Approval and security settings
-    bool m_autoApprovalEnabled;
-    int m_approvalTimeout;
-    bool m_rememberDecisionEnabled;
+    QByteArray m_encryptionSecret;
+    std::unique_ptr<ChunkStore> m_chunkStore;
+    
+    // Approval and security state
     QSettings *m_settings;
-    QHash<QString, bool> m_rememberedDecisions;
+    ApprovalPolicyCache m_approvalPolicies; // Guarded by m_mutex
     QHash<QString, FileTransferRequest> m_pendingRequests;
     
+    // Requests waiting for the batch window to close, and the dialogs the
+    // user has open; a batch dialog takes further requests while open
+    QList<FileTransferRequest> m_approvalBatch;
+    std::unique_ptr<QTimer> m_approvalBatchTimer;
+    QPointer<BatchApprovalDialog> m_batchApprovalDialog;
+    int m_openApprovalDialogs;
+    
     // Thread safety
     mutable QMutex m_mutex;
     
@@ -259,103 +565,4 @@ private:
     std::unique_ptr<QNetworkAccessManager> m_networkManager;
 };
 
-// File transfer session class
-class FileTransferSession : public QObject
-{
-    Q_OBJECT
-    
-public:
-    explicit FileTransferSession(const FileTransferRequest &request, QObject *parent = nullptr);
-    ~FileTransferSession();
-    
-    // Getters
-    const FileTransferRequest& getRequest() const { return m_request; }
-    TransferStatus getStatus() const { return m_status; }
-    const FileTransferProgress& getProgress() const { return m_progress; }
-    QString getErrorMessage() const { return m_errorMessage; }
-    
-    // Status management
-    void setStatus(TransferStatus status);
-    void setError(const QString &error);
-    void updateProgress(qint64 bytesTransferred, qint64 speed = 0);
-    
-    // File operations
-    bool openFile();
-    void closeFile();
-    QByteArray readChunk(int chunkIndex, int chunkSize);
-    bool writeChunk(int chunkIndex, const QByteArray &data);
-    
-    // Validation
-    bool validateChecksum();
-    QString calculateCurrentChecksum();
-    
-signals:
-    void statusChanged(TransferStatus status);
-    void progressUpdated(const FileTransferProgress &progress);
-    void errorOccurred(const QString &error);
-    
-private:
-    void calculateProgress();
-    void updateSpeed();
-    
-private:
-    FileTransferRequest m_request;
-    TransferStatus m_status;
-    FileTransferProgress m_progress;
-    QString m_errorMessage;
-    
-    std::unique_ptr<QFile> m_file;
-    QDateTime m_startTime;
-    QDateTime m_lastProgressUpdate;
-    qint64 m_lastBytesTransferred;
-    
-    mutable QMutex m_mutex;
-};
-
-// File transfer worker for background operations
-class FileTransferWorker : public QObject
-{
-    Q_OBJECT
-    
-public:
-    explicit FileTransferWorker(FileTransferSession *session, FileTransferManager *manager, QObject *parent = nullptr);
-    
-public slots:
-    void startTransfer();
-    void pauseTransfer();
-    void resumeTransfer();
-    void cancelTransfer();
-    
-signals:
-    void chunkReady(const FileChunk &chunk);
-    void transferCompleted();
-    void transferFailed(const QString &error);
-    void progressUpdated(const FileTransferProgress &progress);
-    
-private slots:
-    void processNextChunk();
-    void onChunkAcknowledged(int chunkIndex);
-    
-private:
-    void uploadFile();
-    void downloadFile();
-    void sendNextChunk();
-    void handleReceivedChunk(const FileChunk &chunk);
-    
-private:
-    FileTransferSession *m_session;
-    FileTransferManager *m_manager;
-    
-    bool m_isPaused;
-    bool m_isCancelled;
-    int m_currentChunkIndex;
-    int m_totalChunks;
-    QQueue<int> m_pendingChunks;
-    QSet<int> m_acknowledgedChunks;
-    
-    std::unique_ptr<QTimer> m_chunkTimer;
-    
-    mutable QMutex m_mutex;
-};
-
 #endif // FILETRANSFERMANAGER_H
\ No newline at end of file
@@ -1,10 +1,45 @@
 #include "FileTransferSession.h"
+#include "TransferCheckpoint.h"
+#include "DeltaSync.h"
+#include "ChunkStore.h"
+#include "TransferTelemetry.h"
 #include <QDebug>
 #include <QDateTime>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QDir>
 #include <QCryptographicHash>
-#include <QTimer>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#elif defined(Q_OS_WIN)
+#include <io.h>
+#endif
+
+// Address space budget for upload reads
+static const qint64 MAP_WINDOW_SIZE = 64 * 1024 * 1024; // 64MB
+static const int MAX_MAPPED_WINDOWS = 3;
+
+// Download write-behind
+static const int WRITE_BUFFER_SIZE = 1024 * 1024; // 1MB coalesced writes
+static const qint64 CHECKPOINT_SYNC_BYTES = 16 * 1024 * 1024; // Sync every 16MB
+
+// Copies of out-of-order chunks kept for the file digest, the rest is read back
+static const qint64 MAX_PENDING_DIGEST_BYTES = 64 * 1024 * 1024; // 64MB
+
+// Deltas that do not save at least 10% are not worth the receiver's rebuild
+static const double DELTA_MAX_RATIO = 0.9;
+static const char *DELTA_SPOOL_SUFFIX = ".oddelta";
+
+// What hole chunks are hashed as, shared by every session
+static const QByteArray &zeroChunk()
+{
+    static const QByteArray zeros(ChunkSizeTuner::MAX_CHUNK_SIZE, '\0');
+    return zeros;
+}
 
 FileTransferSession::FileTransferSession(const FileTransferRequest &request, QObject *parent)
     : QObject(parent)
@@ -19,11 +54,25 @@ FileTransferSession::FileTransferSession(const FileTransferRequest &request, QOb
     , m_isPaused(false)
     , m_isCancelled(false)
     , m_file(nullptr)
+    , m_chunkSize(CHUNK_SIZE)
     , m_totalChunks(0)
     , m_completedChunks(0)
+    , m_completionPercentage(0.0)
+    , m_mappingEnabled(false)
+    , m_writeDurability(WriteDurability::Checkpoint)
+    , m_writeBufferOffset(0)
+    , m_bytesSinceSync(0)
+    , m_fileHash(QCryptographicHash::Sha256)
+    , m_nextDigestChunk(0)
+    , m_pendingDigestBytes(0)
+    , m_deltaOffered(false)
+    , m_deltaMode(false)
+    , m_deltaSize(0)
     , m_lastProgressUpdate(QDateTime::currentDateTime())
-    , m_speedCalculationTimer(new QTimer(this))
-    , m_lastBytesTransferred(0)
+    , m_skippedBytes(0)
+    , m_telemetry(nullptr)
+    , m_compressionFileBytes(0)
+    , m_compressionWireBytes(0)
 {
     // Initialize progress
     m_progress.transferId = m_request.id;
@@ -32,15 +81,21 @@ FileTransferSession::FileTransferSession(const FileTransferRequest &request, QOb
     m_progress.percentage = 0.0;
     m_progress.speed = 0;
     m_progress.remainingTime = 0;
+    m_progress.compressionRatio = 1.0;
+    m_progress.completedFiles = 0;
+    m_progress.totalFiles = 0;
     
-    // Setup speed calculation timer
-    m_speedCalculationTimer->setInterval(1000); // Update every second
-    connect(m_speedCalculationTimer, &QTimer::timeout, this, &FileTransferSession::updateSpeed);
+    // Bundles carry their manifest in the request, the local path is the root folder
+    if (m_request.type == TransferType::Upload && m_request.metadata.contains("bundle")) {
+        if (TransferBundle::fromJson(m_request.metadata["bundle"].toArray(), m_request.localPath, m_bundle)) {
+            m_progress.totalFiles = m_bundle.getFileCount();
+        } else {
+            qWarning() << "Invalid bundle manifest for" << m_request.id;
+        }
+    }
     
     // Calculate total chunks
-    if (m_request.fileSize > 0) {
-        m_totalChunks = (m_request.fileSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
-    }
+    m_totalChunks = chunkCount(m_request.fileSize);
     
     qDebug() << "FileTransferSession created:" << m_request.id << m_request.filename;
 }
@@ -57,33 +112,28 @@ const FileTransferRequest& FileTransferSession::getRequest() const
 
 TransferStatus FileTransferSession::getStatus() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_status;
+    return m_status.load();
 }
 
 void FileTransferSession::setStatus(TransferStatus status)
 {
     {
         QMutexLocker locker(&m_mutex);
-        if (m_status == status) {
+        TransferStatus oldStatus = m_status.exchange(status);
+        if (oldStatus == status) {
             return;
         }
         
-        TransferStatus oldStatus = m_status;
-        m_status = status;
-        
         // Update timestamps
         if (status == TransferStatus::InProgress && oldStatus == TransferStatus::Approved) {
             m_startTime = QDateTime::currentDateTime();
-            m_speedCalculationTimer->start();
         } else if (status == TransferStatus::Completed || status == TransferStatus::Failed || 
                   status == TransferStatus::Cancelled) {
             m_endTime = QDateTime::currentDateTime();
-            m_speedCalculationTimer->stop();
-        } else if (status == TransferStatus::Paused) {
-            m_speedCalculationTimer->stop();
-        } else if (status == TransferStatus::InProgress && oldStatus == TransferStatus::Paused) {
-            m_speedCalculationTimer->start();
+        }
+        
+        if (m_progressCounters) {
+            m_progressCounters->status.store(status, std::memory_order_relaxed);
         }
     }
     
@@ -92,6 +142,55 @@ void FileTransferSession::setStatus(TransferStatus status)
     qDebug() << "Transfer status changed:" << m_request.id << statusToString(status);
 }
 
+void FileTransferSession::recordCompression(qint64 fileBytes, qint64 wireBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    m_compressionFileBytes += fileBytes;
+    m_compressionWireBytes += wireBytes;
+    if (m_compressionFileBytes > 0) {
+        m_progress.compressionRatio = static_cast<double>(m_compressionWireBytes) / m_compressionFileBytes;
+    }
+    publishProgress();
+}
+
+void FileTransferSession::setProgressCounters(const std::shared_ptr<ProgressCounters> &counters)
+{
+    QMutexLocker locker(&m_mutex);
+    m_progressCounters = counters;
+    publishProgress();
+}
+
+void FileTransferSession::addSkippedBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_skippedBytes += qMax<qint64>(0, bytes);
+    publishProgress();
+}
+
+void FileTransferSession::setTelemetry(TransferTelemetry *telemetry)
+{
+    QMutexLocker locker(&m_mutex);
+    m_telemetry = telemetry;
+}
+
+void FileTransferSession::publishProgress()
+{
+    // m_mutex must be held; the bus reads these without it
+    m_completionPercentage.store(m_progress.percentage, std::memory_order_relaxed);
+    if (!m_progressCounters) {
+        return;
+    }
+    
+    m_progressCounters->bytesTransferred.store(m_progress.bytesTransferred, std::memory_order_relaxed);
+    m_progressCounters->skippedBytes.store(m_skippedBytes, std::memory_order_relaxed);
+    m_progressCounters->totalBytes.store(m_progress.totalBytes, std::memory_order_relaxed);
+    m_progressCounters->completedFiles.store(m_progress.completedFiles, std::memory_order_relaxed);
+    m_progressCounters->totalFiles.store(m_progress.totalFiles, std::memory_order_relaxed);
+    m_progressCounters->compressionRatio.store(m_progress.compressionRatio, std::memory_order_relaxed);
+    m_progressCounters->status.store(m_status.load(), std::memory_order_relaxed);
+}
+
 FileTransferProgress FileTransferSession::getProgress() const
 {
     QMutexLocker locker(&m_mutex);
@@ -100,44 +199,43 @@ FileTransferProgress FileTransferSession::getProgress() const
 
 void FileTransferSession::updateProgress(qint64 bytesTransferred)
 {
-    {
-        QMutexLocker locker(&m_mutex);
-        
-        m_progress.bytesTransferred = bytesTransferred;
-        
-        if (m_progress.totalBytes > 0) {
-            m_progress.percentage = (static_cast<double>(bytesTransferred) / m_progress.totalBytes) * 100.0;
-        }
-        
-        m_lastProgressUpdate = QDateTime::currentDateTime();
+    QMutexLocker locker(&m_mutex);
+    
+    m_progress.bytesTransferred = bytesTransferred;
+    
+    if (m_progress.totalBytes > 0) {
+        m_progress.percentage = (static_cast<double>(bytesTransferred) / m_progress.totalBytes) * 100.0;
     }
     
-    emit progressUpdated(m_progress);
+    m_lastProgressUpdate = QDateTime::currentDateTime();
+    publishProgress();
 }
 
 void FileTransferSession::updateChunkProgress(int completedChunks)
 {
-    {
-        QMutexLocker locker(&m_mutex);
-        m_completedChunks = completedChunks;
+    QMutexLocker locker(&m_mutex);
+    m_completedChunks = completedChunks;
+    
+    if (m_totalChunks > 0) {
+        qint64 bytesTransferred = static_cast<qint64>(completedChunks) * m_chunkSize;
+        if (completedChunks == m_totalChunks && wireSize() > 0) {
+            bytesTransferred = wireSize(); // Last chunk might be smaller
+        }
         
-        if (m_totalChunks > 0) {
-            qint64 bytesTransferred = static_cast<qint64>(completedChunks) * CHUNK_SIZE;
-            if (completedChunks == m_totalChunks && m_request.fileSize > 0) {
-                bytesTransferred = m_request.fileSize; // Last chunk might be smaller
-            }
-            
-            m_progress.bytesTransferred = qMin(bytesTransferred, m_request.fileSize);
-            
-            if (m_progress.totalBytes > 0) {
-                m_progress.percentage = (static_cast<double>(m_progress.bytesTransferred) / m_progress.totalBytes) * 100.0;
-            }
+        m_progress.bytesTransferred = qMin(bytesTransferred, wireSize());
+        
+        // Chunks complete roughly in stream order, so this lags by at most a window
+        if (!m_bundle.isEmpty()) {
+            m_progress.completedFiles = m_bundle.completedFiles(m_progress.bytesTransferred);
         }
         
-        m_lastProgressUpdate = QDateTime::currentDateTime();
+        if (m_progress.totalBytes > 0) {
+            m_progress.percentage = (static_cast<double>(m_progress.bytesTransferred) / m_progress.totalBytes) * 100.0;
+        }
     }
     
-    emit progressUpdated(m_progress);
+    m_lastProgressUpdate = QDateTime::currentDateTime();
+    publishProgress();
 }
 
 QString FileTransferSession::getError() const
@@ -173,7 +271,11 @@ QDateTime FileTransferSession::getEndTime() const
 qint64 FileTransferSession::getDuration() const
 {
     QMutexLocker locker(&m_mutex);
+    return durationMs();
+}
     
+qint64 FileTransferSession::durationMs() const
+{
     if (m_startTime.isValid()) {
         QDateTime endTime = m_endTime.isValid() ? m_endTime : QDateTime::currentDateTime();
         return m_startTime.msecsTo(endTime);
@@ -186,7 +288,7 @@ qint64 FileTransferSession::getAverageSpeed() const
 {
     QMutexLocker locker(&m_mutex);
     
-    qint64 duration = getDuration();
+    qint64 duration = durationMs();
     if (duration > 0 && m_progress.bytesTransferred > 0) {
         return (m_progress.bytesTransferred * 1000) / duration; // bytes per second
     }
@@ -196,16 +298,12 @@ qint64 FileTransferSession::getAverageSpeed() const
 
 bool FileTransferSession::isPaused() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_isPaused;
+    return m_isPaused.load();
 }
 
 void FileTransferSession::setPaused(bool paused)
 {
-    {
-        QMutexLocker locker(&m_mutex);
-        m_isPaused = paused;
-    }
+    m_isPaused.store(paused);
     
     if (paused) {
         setStatus(TransferStatus::Paused);
@@ -216,16 +314,12 @@ void FileTransferSession::setPaused(bool paused)
 
 bool FileTransferSession::isCancelled() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_isCancelled;
+    return m_isCancelled.load();
 }
 
 void FileTransferSession::setCancelled(bool cancelled)
 {
-    {
-        QMutexLocker locker(&m_mutex);
-        m_isCancelled = cancelled;
-    }
+    m_isCancelled.store(cancelled);
     
     if (cancelled) {
         setStatus(TransferStatus::Cancelled);
@@ -264,16 +358,25 @@ bool FileTransferSession::openFile()
         return true; // Already open
     }
     
-    m_file = std::make_unique<QFile>(m_request.localPath);
+    // Bundled files are opened one at a time as the stream reaches them
+    if (!m_bundle.isEmpty()) {
+        return true;
+    }
+    
+    m_file = std::make_unique<QFile>(wirePath());
     
     QIODevice::OpenMode mode;
     if (m_request.type == TransferType::Upload) {
         mode = QIODevice::ReadOnly;
     } else {
-        mode = QIODevice::WriteOnly | QIODevice::Truncate;
+        // Writes go through writeAt(), the QFile buffer would only add a copy;
+        // a resumed download keeps the chunks already in the partial file.
+        // Chunks parked for the file digest may be read back.
+        mode = m_restoredChunks.isEmpty() ? QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Unbuffered
+                                          : QIODevice::ReadWrite | QIODevice::Unbuffered;
         
         // Ensure directory exists for downloads
-        QFileInfo fileInfo(m_request.localPath);
+        QFileInfo fileInfo(wirePath());
         QDir dir = fileInfo.absoluteDir();
         if (!dir.exists()) {
             if (!dir.mkpath(".")) {
@@ -284,11 +387,25 @@ bool FileTransferSession::openFile()
     }
     
     if (!m_file->open(mode)) {
-        m_error = QString("Failed to open file: %1 - %2").arg(m_request.localPath, m_file->errorString());
+        m_error = QString("Failed to open file: %1 - %2").arg(wirePath(), m_file->errorString());
         m_file.reset();
         return false;
     }
     
+    // Uploads read through memory mapped windows when possible
+    m_mappingEnabled = (m_request.type == TransferType::Upload && wireSize() > 0);
+    
+    if (m_request.type == TransferType::Download) {
+        m_writeBuffer.reserve(WRITE_BUFFER_SIZE);
+        m_writeBufferOffset = 0;
+        m_bytesSinceSync = 0;
+        preallocateFile();
+    }
+    
+    if (!m_restoredChunks.isEmpty()) {
+        verifyRestoredChunks();
+    }
+    
     return true;
 }
 
@@ -297,40 +414,114 @@ void FileTransferSession::closeFile()
     QMutexLocker locker(&m_mutex);
     
     if (m_file) {
+        if (!flushWriteBuffer()) {
+            qWarning() << "Failed to write buffered chunks before closing" << m_request.localPath;
+        }
+        
+        // Closing the file releases its mappings
+        m_mappedWindows.clear();
         m_file->close();
         m_file.reset();
     }
+    
+    m_bundle.close();
 }
 
 QByteArray FileTransferSession::readChunk(int chunkIndex)
 {
     QMutexLocker locker(&m_mutex);
     
-    if (!m_file || !m_file->isOpen()) {
+    if ((!m_file || !m_file->isOpen()) && m_bundle.isEmpty()) {
         qWarning() << "File not open for reading";
         return QByteArray();
     }
     
-    qint64 offset = static_cast<qint64>(chunkIndex) * CHUNK_SIZE;
-    qint64 remainingBytes = m_request.fileSize - offset;
-    int chunkSize = static_cast<int>(qMin(static_cast<qint64>(CHUNK_SIZE), remainingBytes));
+    qint64 offset = chunkOffset(chunkIndex);
+    int chunkSize = chunkLength(chunkIndex);
     
     if (chunkSize <= 0) {
         return QByteArray();
     }
     
-    if (!m_file->seek(offset)) {
+    QByteArray data;
+    if (!m_bundle.isEmpty()) {
+        data = QByteArray(chunkSize, Qt::Uninitialized);
+        if (!m_bundle.read(offset, data.data(), chunkSize)) {
+            return QByteArray();
+        }
+    } else if (const uchar *mapped = mapFileRange(offset, chunkSize)) {
+        data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), chunkSize);
+    } else {
+        if (!m_file->seek(offset)) {
+            qWarning() << "Failed to seek to position" << offset;
+            return QByteArray();
+        }
+        
+        data = m_file->read(chunkSize);
+        if (data.size() != chunkSize) {
+            qWarning() << "Failed to read expected chunk size. Expected:" << chunkSize << "Got:" << data.size();
+            return QByteArray();
+        }
+    }
+    
+    updateFileDigest(chunkIndex, data);
+    recordChunkDigest(chunkIndex, data);
+    return data;
+}
+
+bool FileTransferSession::readChunk(int chunkIndex, QByteArray &buffer)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if ((!m_file || !m_file->isOpen()) && m_bundle.isEmpty()) {
+        qWarning() << "File not open for reading";
+        return false;
+    }
+    
+    qint64 offset = chunkOffset(chunkIndex);
+    int chunkSize = chunkLength(chunkIndex);
+    
+    if (chunkSize <= 0) {
+        return false;
+    }
+    
+    qsizetype start = buffer.size();
+    buffer.resize(start + chunkSize);
+    char *target = buffer.data() + start;
+    
+    qint64 stageStart = m_telemetry ? m_telemetry->now() : -1;
+    bool read = false;
+    if (!m_bundle.isEmpty()) {
+        read = m_bundle.read(offset, target, chunkSize);
+    } else if (const uchar *mapped = mapFileRange(offset, chunkSize)) {
+        memcpy(target, mapped, chunkSize);
+        read = true;
+    } else if (!m_file->seek(offset)) {
         qWarning() << "Failed to seek to position" << offset;
-        return QByteArray();
+    } else {
+        qint64 bytesRead = m_file->read(target, chunkSize);
+        read = bytesRead == chunkSize;
+        if (!read) {
+            qWarning() << "Failed to read expected chunk size. Expected:" << chunkSize << "Got:" << bytesRead;
+        }
     }
     
-    QByteArray data = m_file->read(chunkSize);
-    if (data.size() != chunkSize) {
-        qWarning() << "Failed to read expected chunk size. Expected:" << chunkSize << "Got:" << data.size();
-        return QByteArray();
+    if (!read) {
+        buffer.resize(start);
+        return false;
     }
     
-    return data;
+    QByteArray data = QByteArray::fromRawData(buffer.constData() + start, chunkSize);
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Read, stageStart, m_request.id, chunkIndex);
+        stageStart = m_telemetry->now();
+    }
+    updateFileDigest(chunkIndex, data);
+    recordChunkDigest(chunkIndex, data);
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Hash, stageStart, m_request.id, chunkIndex);
+    }
+    return true;
 }
 
 bool FileTransferSession::writeChunk(int chunkIndex, const QByteArray &data)
@@ -342,23 +533,61 @@ bool FileTransferSession::writeChunk(int chunkIndex, const QByteArray &data)
         return false;
     }
     
-    qint64 offset = static_cast<qint64>(chunkIndex) * CHUNK_SIZE;
+    qint64 offset = chunkOffset(chunkIndex);
+    qint64 stageStart = m_telemetry ? m_telemetry->now() : -1;
     
-    if (!m_file->seek(offset)) {
-        qWarning() << "Failed to seek to position" << offset;
+    // Coalesce contiguous chunks, anything else starts a new buffer
+    bool contiguous = !m_writeBuffer.isEmpty() && offset == m_writeBufferOffset + m_writeBuffer.size();
+    if (!contiguous || m_writeBuffer.size() + data.size() > WRITE_BUFFER_SIZE) {
+        if (!flushWriteBuffer()) {
+            return false;
+        }
+        m_writeBufferOffset = offset;
+    }
+    
+    m_writeBuffer.append(data);
+    
+    bool syncDue = m_writeDurability == WriteDurability::Safe ||
+                   (m_writeDurability == WriteDurability::Checkpoint &&
+                    m_bytesSinceSync + m_writeBuffer.size() >= CHECKPOINT_SYNC_BYTES);
+    if (syncDue && (!flushWriteBuffer() || !syncFile())) {
         return false;
     }
     
-    qint64 bytesWritten = m_file->write(data);
-    if (bytesWritten != data.size()) {
-        qWarning() << "Failed to write complete chunk. Expected:" << data.size() << "Written:" << bytesWritten;
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Write, stageStart, m_request.id, chunkIndex);
+        stageStart = m_telemetry->now();
+    }
+    updateFileDigest(chunkIndex, data);
+    recordChunkDigest(chunkIndex, data);
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Hash, stageStart, m_request.id, chunkIndex);
+    }
+    return true;
+}
+
+bool FileTransferSession::flushWrites()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (!m_file || !m_file->isOpen() || m_request.type != TransferType::Download) {
+        return true;
+    }
+    
+    if (!flushWriteBuffer() || (m_writeDurability != WriteDurability::Fast && !syncFile())) {
+        m_error = QString("Failed to write %1 to disk").arg(m_request.localPath);
         return false;
     }
     
-    m_file->flush();
     return true;
 }
 
+void FileTransferSession::setWriteDurability(WriteDurability durability)
+{
+    QMutexLocker locker(&m_mutex);
+    m_writeDurability = durability;
+}
+
 QString FileTransferSession::calculateFileChecksum()
 {
     QMutexLocker locker(&m_mutex);
@@ -368,6 +597,10 @@ QString FileTransferSession::calculateFileChecksum()
         return QString();
     }
     
+    if (!flushWriteBuffer()) {
+        return QString();
+    }
+    
     qint64 originalPos = m_file->pos();
     m_file->seek(0);
     
@@ -388,7 +621,11 @@ QString FileTransferSession::calculateFileChecksum()
 
 bool FileTransferSession::verifyChecksum(const QString &expectedChecksum)
 {
-    QString actualChecksum = calculateFileChecksum();
+    // Prefer the digest built while streaming, rescan only if it is incomplete
+    QString actualChecksum = getFileDigest();
+    if (actualChecksum.isEmpty()) {
+        actualChecksum = calculateFileChecksum();
+    }
     
     if (actualChecksum.isEmpty()) {
         m_error = "Failed to calculate file checksum";
@@ -404,22 +641,697 @@ bool FileTransferSession::verifyChecksum(const QString &expectedChecksum)
     return true;
 }
 
-int FileTransferSession::getTotalChunks() const
+QString FileTransferSession::getFileDigest() const
 {
     QMutexLocker locker(&m_mutex);
-    return m_totalChunks;
+    
+    // The chunks only carried the delta stream
+    if (m_deltaMode) {
+        return m_deltaFileDigest;
+    }
+    
+    if (m_totalChunks <= 0 || m_nextDigestChunk < m_totalChunks) {
+        return QString();
+    }
+    
+    return m_fileHash.result().toHex();
 }
 
-int FileTransferSession::getCompletedChunks() const
+void FileTransferSession::updateFileDigest(int chunkIndex, const QByteArray &data)
+{
+    // m_mutex must be held; retransmitted chunks were already hashed
+    if (chunkIndex < m_nextDigestChunk || m_pendingDigestChunks.contains(chunkIndex)) {
+        return;
+    }
+    
+    // Parked chunks are copied, data may be a view into a frame or mapping;
+    // over budget only a marker is kept and the chunk is read back later
+    if (chunkIndex > m_nextDigestChunk) {
+        if (!data.isNull() && m_pendingDigestBytes + data.size() <= MAX_PENDING_DIGEST_BYTES) {
+            m_pendingDigestChunks.insert(chunkIndex, QByteArray(data.constData(), data.size()));
+            m_pendingDigestBytes += data.size();
+        } else {
+            m_pendingDigestChunks.insert(chunkIndex, QByteArray());
+        }
+        return;
+    }
+    
+    m_fileHash.addData(data);
+    m_nextDigestChunk++;
+    
+    // Drain chunks that were waiting for this one
+    auto it = m_pendingDigestChunks.begin();
+    while (it != m_pendingDigestChunks.end() && it.key() == m_nextDigestChunk) {
+        QByteArray parked = it.value();
+        if (!parked.isNull()) {
+            m_pendingDigestBytes -= parked.size();
+        } else if (it.key() < m_holeChunks.size() && m_holeChunks.testBit(it.key())) {
+            parked = QByteArray::fromRawData(zeroChunk().constData(), chunkLength(it.key()));
+        } else if (!readBackChunk(it.key(), parked)) {
+            // The digest stays incomplete, verification rescans the file
+            qWarning() << "Failed to read back chunk" << it.key() << "for the digest of" << m_request.id;
+            return;
+        }
+        
+        m_fileHash.addData(parked);
+        m_nextDigestChunk++;
+        it = m_pendingDigestChunks.erase(it);
+    }
+}
+
+bool FileTransferSession::readBackChunk(int chunkIndex, QByteArray &data)
+{
+    // m_mutex must be held; downloads may still hold the chunk in the write
+    // buffer. No mapping is used, new windows would evict views handed out.
+    qint64 offset = chunkOffset(chunkIndex);
+    int chunkSize = chunkLength(chunkIndex);
+    data = QByteArray(chunkSize, Qt::Uninitialized);
+    
+    if (!m_bundle.isEmpty()) {
+        return m_bundle.read(offset, data.data(), chunkSize);
+    }
+    if (!m_file || (m_request.type == TransferType::Download && !flushWriteBuffer())) {
+        return false;
+    }
+    return m_file->seek(offset) && m_file->read(data.data(), chunkSize) == chunkSize;
+}
+
+bool FileTransferSession::loadCheckpoint()
 {
     QMutexLocker locker(&m_mutex);
-    return m_completedChunks;
+    
+    // Delta streams depend on the receiver's copy and are not resumed, nor are
+    // bundles whose files cannot be checked against a single mtime
+    TransferCheckpoint checkpoint;
+    if (m_file || m_deltaMode || m_deltaOffered || !m_bundle.isEmpty() || !TransferCheckpoint::load(m_request, checkpoint) || checkpoint.chunkSize != m_chunkSize) {
+        return false;
+    }
+    
+    m_restoredChunks = checkpoint.completedChunks;
+    m_chunkDigests = checkpoint.chunkDigests;
+    m_checkpointTransferId = checkpoint.transferId;
+    
+    qDebug() << "Resuming" << m_request.localPath << "from checkpoint of" << checkpoint.transferId << ":"
+             << m_restoredChunks.count(true) << "of" << m_restoredChunks.size() << "chunks";
+    return true;
 }
 
-double FileTransferSession::getCompletionPercentage() const
+QBitArray FileTransferSession::getRestoredChunks() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_restoredChunks;
+}
+
+QString FileTransferSession::getCheckpointTransferId() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_checkpointTransferId;
+}
+
+bool FileTransferSession::saveCheckpoint(const QBitArray &completedChunks)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (!m_file || m_totalChunks <= 0 || m_deltaMode) {
+        return false;
+    }
+    
+    // Chunks claimed by the checkpoint must have reached the file; chunks
+    // lost before they were synced fail verification on resume
+    if (m_request.type == TransferType::Download && !flushWriteBuffer()) {
+        return false;
+    }
+    
+    TransferCheckpoint checkpoint;
+    checkpoint.transferId = m_request.id;
+    checkpoint.fileSize = m_request.fileSize;
+    checkpoint.chunkSize = m_chunkSize;
+    if (m_request.type == TransferType::Upload) {
+        checkpoint.sourceModified = QFileInfo(m_request.localPath).lastModified().toMSecsSinceEpoch();
+    }
+    checkpoint.completedChunks = completedChunks;
+    checkpoint.completedChunks.resize(m_totalChunks);
+    checkpoint.chunkDigests = m_chunkDigests;
+    checkpoint.chunkDigests.resize(static_cast<qsizetype>(m_totalChunks) * TransferCheckpoint::CHUNK_DIGEST_SIZE);
+    
+    return checkpoint.save(m_request);
+}
+
+void FileTransferSession::removeCheckpoint()
+{
+    QMutexLocker locker(&m_mutex);
+    TransferCheckpoint::remove(m_request);
+    m_restoredChunks.clear();
+}
+
+void FileTransferSession::recordChunkDigest(int chunkIndex, const QByteArray &data)
+{
+    // m_mutex must be held
+    qsizetype offset = static_cast<qsizetype>(chunkIndex) * TransferCheckpoint::CHUNK_DIGEST_SIZE;
+    if (m_chunkDigests.size() < offset + TransferCheckpoint::CHUNK_DIGEST_SIZE) {
+        m_chunkDigests.resize(offset + TransferCheckpoint::CHUNK_DIGEST_SIZE, '\0');
+    }
+    
+    QByteArray digest = ChunkIntegrity::digest(ChunkIntegrity::Algorithm::Crc32c, data);
+    m_chunkDigests.replace(offset, TransferCheckpoint::CHUNK_DIGEST_SIZE, digest);
+}
+
+void FileTransferSession::verifyRestoredChunks()
+{
+    // m_mutex must be held; chunks that no longer match are sent again
+    for (int chunkIndex = 0; chunkIndex < m_restoredChunks.size(); ++chunkIndex) {
+        if (!m_restoredChunks.testBit(chunkIndex)) {
+            continue;
+        }
+        
+        qint64 offset = chunkOffset(chunkIndex);
+        int chunkSize = chunkLength(chunkIndex);
+        
+        QByteArray data;
+        if (m_file->seek(offset)) {
+            data = m_file->read(chunkSize);
+        }
+        
+        QByteArray expected = m_chunkDigests.mid(static_cast<qsizetype>(chunkIndex) * TransferCheckpoint::CHUNK_DIGEST_SIZE,
+                                                 TransferCheckpoint::CHUNK_DIGEST_SIZE);
+        if (data.size() != chunkSize ||
+            ChunkIntegrity::digest(ChunkIntegrity::Algorithm::Crc32c, data) != expected) {
+            qWarning() << "Checkpointed chunk" << chunkIndex << "does not match, transferring it again";
+            m_restoredChunks.clearBit(chunkIndex);
+            continue;
+        }
+        
+        updateFileDigest(chunkIndex, data);
+    }
+}
+
+void FileTransferSession::setDeltaSignature(const QByteArray &signature)
+{
+    QMutexLocker locker(&m_mutex);
+    m_deltaSignature = signature;
+}
+
+bool FileTransferSession::hasDeltaSignature() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_deltaSignature.isEmpty();
+}
+
+bool FileTransferSession::prepareDeltaUpload()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_deltaSignature.isEmpty() || m_file || m_request.type != TransferType::Upload || !m_bundle.isEmpty()) {
+        return false;
+    }
+    
+    // Encoding reads the whole file, progress and status stay readable meanwhile
+    QString spoolPath = QDir::temp().filePath(m_request.id + DELTA_SPOOL_SUFFIX);
+    QString sourcePath = m_request.localPath;
+    QByteArray signature = m_deltaSignature;
+    locker.unlock();
+    
+    qint64 literalBytes = 0;
+    QByteArray fileDigest;
+    bool encoded = DeltaSync::encode(sourcePath, signature, spoolPath, &literalBytes, &fileDigest);
+    
+    // The transfer may have started reading the file in full meanwhile
+    locker.relock();
+    if (!encoded || m_file) {
+        qWarning() << "Delta encoding failed, sending" << m_request.filename << "in full";
+        QFile::remove(spoolPath);
+        return false;
+    }
+    
+    qint64 deltaSize = QFileInfo(spoolPath).size();
+    if (deltaSize >= m_request.fileSize * DELTA_MAX_RATIO) {
+        qDebug() << "Delta of" << m_request.filename << "saves too little, sending it in full";
+        QFile::remove(spoolPath);
+        return false;
+    }
+    
+    qDebug() << "Sending" << m_request.filename << "as a" << deltaSize << "byte delta ("
+             << literalBytes << "literal bytes of" << m_request.fileSize << ")";
+    
+    // The receiver checks the rebuilt file against the source digest
+    m_deltaFileDigest = QString::fromLatin1(fileDigest.toHex());
+    m_request.checksum = m_deltaFileDigest;
+    enterDeltaMode(spoolPath, deltaSize);
+    return true;
+}
+
+void FileTransferSession::setDeltaOffered(bool offered)
 {
     QMutexLocker locker(&m_mutex);
-    return m_progress.percentage;
+    m_deltaOffered = offered;
+}
+
+bool FileTransferSession::isDeltaOffered() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_deltaOffered;
+}
+
+QByteArray FileTransferSession::computeDeltaSignature() const
+{
+    // Reads the whole local copy, called from the worker thread
+    return DeltaSync::computeSignature(m_request.localPath);
+}
+
+void FileTransferSession::beginDeltaDownload(qint64 deltaSize, const QString &checksum)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_file || m_request.type != TransferType::Download) {
+        return;
+    }
+    
+    if (!checksum.isEmpty()) {
+        m_request.checksum = checksum;
+    }
+    enterDeltaMode(m_request.localPath + DELTA_SPOOL_SUFFIX, deltaSize);
+}
+
+bool FileTransferSession::applyDelta()
+{
+    // Releases the spool file before it is read back
+    closeFile();
+    
+    QMutexLocker locker(&m_mutex);
+    
+    if (!m_deltaMode || m_request.type != TransferType::Download) {
+        return true;
+    }
+    
+    // Rebuilt next to the old copy, which is replaced in one rename once the
+    // new one is complete and matches the source digest
+    QSaveFile rebuilt(m_request.localPath);
+    QByteArray fileDigest;
+    if (!rebuilt.open(QIODevice::WriteOnly) ||
+        !DeltaSync::apply(m_request.localPath, m_deltaSpoolPath, &rebuilt, &fileDigest)) {
+        m_error = QString("Failed to rebuild %1 from its delta").arg(m_request.localPath);
+        rebuilt.cancelWriting();
+        return false;
+    }
+    
+    QString actualChecksum = QString::fromLatin1(fileDigest.toHex());
+    if (!m_request.checksum.isEmpty() && actualChecksum.compare(m_request.checksum, Qt::CaseInsensitive) != 0) {
+        m_error = QString("Checksum mismatch. Expected: %1, Actual: %2").arg(m_request.checksum, actualChecksum);
+        rebuilt.cancelWriting();
+        return false;
+    }
+    
+    if (!rebuilt.commit()) {
+        m_error = QString("Failed to replace %1 with the rebuilt file").arg(m_request.localPath);
+        return false;
+    }
+    
+    QFile::remove(m_deltaSpoolPath);
+    m_deltaFileDigest = actualChecksum;
+    return true;
+}
+
+bool FileTransferSession::isDeltaMode() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_deltaMode;
+}
+
+qint64 FileTransferSession::getDeltaSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_deltaSize;
+}
+
+bool FileTransferSession::isBundle() const
+{
+    return !m_bundle.isEmpty();
+}
+
+const TransferBundle &FileTransferSession::getBundle() const
+{
+    return m_bundle;
+}
+
+void FileTransferSession::setChunkManifest(const QByteArray &manifest)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (manifest.size() != static_cast<qsizetype>(m_totalChunks) * ChunkStore::KEY_SIZE) {
+        qWarning() << "Ignoring chunk manifest that does not match" << m_request.id;
+        m_chunkManifest.clear();
+        return;
+    }
+    m_chunkManifest = manifest;
+}
+
+QByteArray FileTransferSession::getChunkKey(int chunkIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // The manifest describes the file, not a delta stream
+    if (m_deltaMode || chunkIndex < 0 || chunkIndex >= m_chunkManifest.size() / ChunkStore::KEY_SIZE) {
+        return QByteArray();
+    }
+    return m_chunkManifest.mid(static_cast<qsizetype>(chunkIndex) * ChunkStore::KEY_SIZE, ChunkStore::KEY_SIZE);
+}
+
+QBitArray FileTransferSession::findHoleChunks()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    m_holeChunks.clear();
+    if (m_file || m_deltaMode || !m_bundle.isEmpty() || m_request.type != TransferType::Upload || m_totalChunks <= 0) {
+        return QBitArray();
+    }
+    
+#if defined(Q_OS_UNIX) && defined(SEEK_HOLE)
+    QFile file(m_request.localPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QBitArray();
+    }
+    
+    int fd = file.handle();
+    qint64 size = m_request.fileSize;
+    QBitArray holes(m_totalChunks);
+    int found = 0;
+    qint64 offset = 0;
+    while (offset < size) {
+        // Every file ends in an implicit hole at its size
+        off_t holeStart = lseek(fd, offset, SEEK_HOLE);
+        if (holeStart < 0 || holeStart >= size) {
+            break;
+        }
+        
+        // ENXIO: the hole runs to the end of the file
+        off_t dataStart = lseek(fd, holeStart, SEEK_DATA);
+        if (dataStart < 0 && errno != ENXIO) {
+            break;
+        }
+        qint64 holeEnd = dataStart < 0 ? size : qMin<qint64>(dataStart, size);
+        if (holeEnd <= holeStart) {
+            break;
+        }
+        
+        // Only chunks lying wholly inside the hole
+        int chunkIndex = static_cast<int>((holeStart + m_chunkSize - 1) / m_chunkSize);
+        for (; chunkIndex < m_totalChunks && chunkOffset(chunkIndex) + chunkLength(chunkIndex) <= holeEnd; ++chunkIndex) {
+            holes.setBit(chunkIndex);
+            found++;
+        }
+        offset = holeEnd;
+    }
+    
+    if (found == 0) {
+        return QBitArray();
+    }
+    
+    qDebug() << found << "of" << m_totalChunks << "chunks of" << m_request.filename << "lie in holes";
+    m_holeChunks = holes;
+    return holes;
+#else
+    return QBitArray();
+#endif
+}
+
+void FileTransferSession::setHoleChunks(const QBitArray &holeChunks)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // The file is sized and allocated when it opens
+    if (m_file || m_deltaMode || m_request.type != TransferType::Download) {
+        return;
+    }
+    m_holeChunks = holeChunks;
+    m_holeChunks.resize(m_totalChunks);
+}
+
+QBitArray FileTransferSession::getHoleChunks() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_holeChunks;
+}
+
+bool FileTransferSession::skipHoleChunk(int chunkIndex)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    int chunkSize = chunkLength(chunkIndex);
+    if (chunkIndex >= m_holeChunks.size() || !m_holeChunks.testBit(chunkIndex) || chunkSize <= 0) {
+        return false;
+    }
+    
+    // Parked holes cost nothing, they are hashed as zeros when drained
+    QByteArray zeros = QByteArray::fromRawData(zeroChunk().constData(), chunkSize);
+    if (chunkIndex > m_nextDigestChunk) {
+        if (!m_pendingDigestChunks.contains(chunkIndex)) {
+            m_pendingDigestChunks.insert(chunkIndex, QByteArray());
+        }
+    } else {
+        updateFileDigest(chunkIndex, zeros);
+    }
+    recordChunkDigest(chunkIndex, zeros);
+    return true;
+}
+
+QString FileTransferSession::wirePath() const
+{
+    return m_deltaMode ? m_deltaSpoolPath : m_request.localPath;
+}
+
+qint64 FileTransferSession::wireSize() const
+{
+    return m_deltaMode ? m_deltaSize : m_request.fileSize;
+}
+
+int FileTransferSession::chunkCount(qint64 size) const
+{
+    return size > 0 ? static_cast<int>((size + m_chunkSize - 1) / m_chunkSize) : 0;
+}
+
+qint64 FileTransferSession::chunkOffset(int chunkIndex) const
+{
+    return static_cast<qint64>(chunkIndex) * m_chunkSize;
+}
+
+int FileTransferSession::chunkLength(int chunkIndex) const
+{
+    // 0 past the end, the last chunk may be short
+    qint64 remaining = wireSize() - chunkOffset(chunkIndex);
+    return chunkIndex < 0 ? 0 : static_cast<int>(qBound<qint64>(0, remaining, m_chunkSize));
+}
+
+void FileTransferSession::enterDeltaMode(const QString &spoolPath, qint64 deltaSize)
+{
+    // m_mutex must be held; chunks and progress now count delta bytes
+    m_deltaMode = true;
+    m_deltaSpoolPath = spoolPath;
+    m_deltaSize = deltaSize;
+    m_totalChunks = chunkCount(deltaSize);
+    m_progress.totalBytes = deltaSize;
+    m_chunkDigests.clear();
+    m_holeChunks.clear();
+    publishProgress();
+}
+
+void FileTransferSession::preallocateFile()
+{
+    if (!m_file || m_request.type != TransferType::Download || wireSize() <= 0) {
+        return;
+    }
+    
+#ifdef Q_OS_LINUX
+    // Reserve the blocks up front so the file does not fragment as it grows;
+    // sparse files are only sized, their holes stay unallocated
+    if (m_holeChunks.count(true) == 0 && posix_fallocate(m_file->handle(), 0, wireSize()) == 0) {
+        return;
+    }
+#endif
+    
+    if (!m_file->resize(wireSize())) {
+        qWarning() << "Failed to preallocate" << m_request.localPath << ":" << m_file->errorString();
+    }
+}
+
+bool FileTransferSession::flushWriteBuffer()
+{
+    if (m_writeBuffer.isEmpty()) {
+        return true;
+    }
+    
+    if (!writeAt(m_writeBufferOffset, m_writeBuffer.constData(), m_writeBuffer.size())) {
+        return false;
+    }
+    
+    m_bytesSinceSync += m_writeBuffer.size();
+    m_writeBufferOffset += m_writeBuffer.size();
+    m_writeBuffer.resize(0); // Keeps the reserved capacity
+    return true;
+}
+
+bool FileTransferSession::writeAt(qint64 offset, const char *data, qint64 size)
+{
+#ifdef Q_OS_UNIX
+    // Positional writes leave the shared file offset alone
+    int fd = m_file->handle();
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd, data, static_cast<size_t>(size), static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qWarning() << "Failed to write at position" << offset << ":" << strerror(errno);
+            return false;
+        }
+        
+        data += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+#else
+    if (!m_file->seek(offset)) {
+        qWarning() << "Failed to seek to position" << offset;
+        return false;
+    }
+    
+    qint64 bytesWritten = m_file->write(data, size);
+    if (bytesWritten != size) {
+        qWarning() << "Failed to write complete chunk. Expected:" << size << "Written:" << bytesWritten;
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool FileTransferSession::syncFile()
+{
+    m_file->flush();
+    
+#ifdef Q_OS_UNIX
+    if (::fsync(m_file->handle()) != 0) {
+        qWarning() << "Failed to sync" << m_request.localPath << ":" << strerror(errno);
+        return false;
+    }
+#elif defined(Q_OS_WIN)
+    if (_commit(m_file->handle()) != 0) {
+        qWarning() << "Failed to sync" << m_request.localPath;
+        return false;
+    }
+#endif
+    
+    m_bytesSinceSync = 0;
+    return true;
+}
+
+const uchar *FileTransferSession::mapFileRange(qint64 offset, qint64 size)
+{
+    // m_mutex must be held
+    if (!m_mappingEnabled) {
+        return nullptr;
+    }
+    
+    for (int i = 0; i < m_mappedWindows.size(); ++i) {
+        const MappedWindow window = m_mappedWindows.at(i);
+        if (offset >= window.offset && offset + size <= window.offset + window.size) {
+            m_mappedWindows.move(i, 0);
+            return window.data + (offset - window.offset);
+        }
+    }
+    
+    // Windows are aligned to their size unless the range would straddle one
+    qint64 windowOffset = (offset / MAP_WINDOW_SIZE) * MAP_WINDOW_SIZE;
+    if (offset + size > windowOffset + MAP_WINDOW_SIZE) {
+        windowOffset = offset;
+    }
+    qint64 windowSize = qMin(qMax(MAP_WINDOW_SIZE, size), wireSize() - windowOffset);
+    
+    uchar *data = m_file->map(windowOffset, windowSize);
+    if (!data) {
+        qWarning() << "Memory mapping unavailable, using buffered reads:" << m_file->errorString();
+        m_mappingEnabled = false;
+        return nullptr;
+    }
+    
+    if (m_mappedWindows.size() >= MAX_MAPPED_WINDOWS) {
+        m_file->unmap(m_mappedWindows.takeLast().data);
+    }
+    
+    m_mappedWindows.prepend({windowOffset, windowSize, data});
+    return data + (offset - windowOffset);
+}
+
+void FileTransferSession::setFileSize(qint64 fileSize)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // Downloads learn their size from the server response
+    m_request.fileSize = fileSize;
+    if (m_deltaMode) {
+        return;
+    }
+    m_progress.totalBytes = fileSize;
+    m_totalChunks = chunkCount(fileSize);
+    publishProgress();
+    
+    if (m_file && m_file->isOpen()) {
+        preallocateFile();
+    }
+}
+
+bool FileTransferSession::setChunkSize(int chunkSize)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // Chunks already read or written would move
+    if (m_file || m_deltaMode) {
+        return chunkSize == m_chunkSize;
+    }
+    if (chunkSize < ChunkSizeTuner::MIN_CHUNK_SIZE || chunkSize > ChunkSizeTuner::MAX_CHUNK_SIZE) {
+        qWarning() << "Ignoring chunk size" << chunkSize << "for" << m_request.id;
+        return false;
+    }
+    
+    // Holes were found for the old chunk boundaries
+    if (chunkSize != m_chunkSize) {
+        m_holeChunks.clear();
+    }
+    m_chunkSize = chunkSize;
+    m_totalChunks = chunkCount(m_request.fileSize);
+    return true;
+}
+
+int FileTransferSession::getChunkSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_chunkSize;
+}
+
+qint64 FileTransferSession::getChunkOffset(int chunkIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    return chunkOffset(chunkIndex);
+}
+
+int FileTransferSession::getChunkLength(int chunkIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    return chunkLength(chunkIndex);
+}
+
+int FileTransferSession::getTotalChunks() const
+{
+    return m_totalChunks.load();
+}
+
+int FileTransferSession::getCompletedChunks() const
+{
+    return m_completedChunks.load();
+}
+
+double FileTransferSession::getCompletionPercentage() const
+{
+    return m_completionPercentage.load(std::memory_order_relaxed);
 }
 
 QJsonObject FileTransferSession::toJson() const
@@ -435,20 +1347,21 @@ QJsonObject FileTransferSession::toJson() const
     obj["checksum"] = m_request.checksum;
     obj["type"] = (m_request.type == TransferType::Upload) ? "upload" : "download";
     obj["technician"] = m_request.technician;
-    obj["status"] = statusToString(m_status);
+    obj["status"] = statusToString(m_status.load());
     obj["progress"] = m_progress.percentage;
     obj["bytes_transferred"] = m_progress.bytesTransferred;
     obj["speed"] = m_progress.speed;
     obj["remaining_time"] = m_progress.remainingTime;
     obj["start_time"] = m_startTime.toString(Qt::ISODate);
     obj["end_time"] = m_endTime.toString(Qt::ISODate);
-    obj["duration"] = getDuration();
+    obj["duration"] = durationMs();
     obj["error"] = m_error;
     obj["retry_count"] = m_retryCount;
-    obj["is_paused"] = m_isPaused;
-    obj["is_cancelled"] = m_isCancelled;
-    obj["total_chunks"] = m_totalChunks;
-    obj["completed_chunks"] = m_completedChunks;
+    obj["is_paused"] = m_isPaused.load();
+    obj["is_cancelled"] = m_isCancelled.load();
+    obj["chunk_size"] = m_chunkSize;
+    obj["total_chunks"] = m_totalChunks.load();
+    obj["completed_chunks"] = m_completedChunks.load();
     
     return obj;
 }
@@ -480,17 +1393,18 @@ void FileTransferSession::fromJson(const QJsonObject &obj)
     if (!endTimeStr.isEmpty()) {
         m_endTime = QDateTime::fromString(endTimeStr, Qt::ISODate);
     }
+    publishProgress();
     
-    // Update status (this will emit signals)
-    QString statusStr = obj["status"].toString();
-    TransferStatus status = stringToStatus(statusStr);
-    if (status != m_status) {
-        setStatus(status);
-    }
+    // Update status (this will emit signals); setStatus() takes the lock itself
+    locker.unlock();
+    setStatus(stringToStatus(obj["status"].toString()));
 }
 
 void FileTransferSession::reset()
 {
+    // Close file first, closeFile() takes the lock itself
+    closeFile();
+    
     QMutexLocker locker(&m_mutex);
     
     // Reset progress
@@ -507,27 +1421,40 @@ void FileTransferSession::reset()
     m_isCancelled = false;
     m_completedChunks = 0;
     
+    // Reset digest
+    m_fileHash.reset();
+    m_nextDigestChunk = 0;
+    m_pendingDigestChunks.clear();
+    m_pendingDigestBytes = 0;
+    m_restoredChunks.clear();
+    m_skippedBytes = 0;
+    
     // Reset timestamps
     m_startTime = QDateTime();
     m_endTime = QDateTime();
     
-    // Close file
-    closeFile();
-    
-    m_speedCalculationTimer->stop();
+    publishProgress();
 }
 
 void FileTransferSession::cleanup()
 {
     closeFile();
     
-    if (m_speedCalculationTimer) {
-        m_speedCalculationTimer->stop();
+    // Failed downloads keep their partial file while a checkpoint can resume them
+    if (m_status == TransferStatus::Cancelled) {
+        TransferCheckpoint::remove(m_request);
+    }
+    
+    // The delta spool is never resumed; for downloads the target still holds the old copy
+    if (!m_deltaSpoolPath.isEmpty()) {
+        QFile::remove(m_deltaSpoolPath);
     }
     
     // Clean up temporary files if transfer was cancelled or failed
-    if ((m_status == TransferStatus::Cancelled || m_status == TransferStatus::Failed) &&
-        m_request.type == TransferType::Download) {
+    bool resumable = QFile::exists(TransferCheckpoint::pathFor(m_request));
+    bool keepsBasis = m_deltaMode || m_deltaOffered;
+    if ((m_status == TransferStatus::Cancelled || (m_status == TransferStatus::Failed && !resumable)) &&
+        m_request.type == TransferType::Download && !keepsBasis) {
         
         QFile tempFile(m_request.localPath);
         if (tempFile.exists()) {
@@ -538,29 +1465,6 @@ void FileTransferSession::cleanup()
     }
 }
 
-void FileTransferSession::updateSpeed()
-{
-    QMutexLocker locker(&m_mutex);
-    
-    qint64 currentBytes = m_progress.bytesTransferred;
-    qint64 bytesDiff = currentBytes - m_lastBytesTransferred;
-    
-    // Calculate speed (bytes per second)
-    m_progress.speed = bytesDiff; // Timer fires every second
-    
-    // Calculate remaining time
-    if (m_progress.speed > 0 && m_progress.totalBytes > 0) {
-        qint64 remainingBytes = m_progress.totalBytes - currentBytes;
-        m_progress.remainingTime = remainingBytes / m_progress.speed;
-    } else {
-        m_progress.remainingTime = 0;
-    }
-    
-    m_lastBytesTransferred = currentBytes;
-    
-    emit progressUpdated(m_progress);
-}
-
 QString FileTransferSession::statusToString(TransferStatus status)
 {
     switch (status) {
@@ -0,0 +1,283 @@
+#ifndef FILETRANSFERSESSION_H
+#define FILETRANSFERSESSION_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QMutex>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include <QMap>
+#include <QList>
+#include <QBitArray>
+#include <memory>
+#include <atomic>
+#include "FileTransferManager.h"
+#include "TransferBundle.h"
+#include "TransferProgressBus.h"
+
+class TransferTelemetry;
+
+// Chunk size of transfers that did not negotiate another
+static const int CHUNK_SIZE = ChunkSizeTuner::DEFAULT_CHUNK_SIZE; // 64KB
+
+// File transfer session class
+class FileTransferSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileTransferSession(const FileTransferRequest &request, QObject *parent = nullptr);
+    ~FileTransferSession();
+
+    // Request and status
+    const FileTransferRequest& getRequest() const;
+    TransferStatus getStatus() const;
+    void setStatus(TransferStatus status);
+
+    // Progress tracking
+    FileTransferProgress getProgress() const;
+    void updateProgress(qint64 bytesTransferred);
+    void updateChunkProgress(int completedChunks);
+    void recordCompression(qint64 fileBytes, qint64 wireBytes);
+    // Progress is published here for the progress bus; speed and ETA are
+    // left to the bus, getProgress() reports neither
+    void setProgressCounters(const std::shared_ptr<ProgressCounters> &counters);
+    // Bytes counted as transferred that never crossed the wire (holes,
+    // deduplicated or resumed chunks), left out of the bus's rates
+    void addSkippedBytes(qint64 bytes);
+    // Chunk reads, writes and file digests are timed here, owned by the manager
+    void setTelemetry(TransferTelemetry *telemetry);
+
+    // Error handling
+    QString getError() const;
+    void setError(const QString &error);
+
+    // Timing
+    QDateTime getStartTime() const;
+    QDateTime getEndTime() const;
+    qint64 getDuration() const;
+    qint64 getAverageSpeed() const;
+
+    // Pause and cancellation
+    bool isPaused() const;
+    void setPaused(bool paused);
+    bool isCancelled() const;
+    void setCancelled(bool cancelled);
+
+    // Retry management
+    int getRetryCount() const;
+    void incrementRetryCount();
+    bool canRetry() const;
+    void setMaxRetries(int maxRetries);
+
+    // File operations
+    bool openFile();
+    void closeFile();
+    // Uploads read through a windowed memory mapping when the file system
+    // allows it; the returned chunk is then a view that stays valid while
+    // its window is mapped (the last MAX_MAPPED_WINDOWS windows touched).
+    // Use it before the next read or closeFile(), never across threads;
+    // chunks that are sent are read with the overload below
+    QByteArray readChunk(int chunkIndex);
+    // Appends the chunk to buffer instead, copied out of the mapping; into
+    // reserved capacity this reads without allocating
+    bool readChunk(int chunkIndex, QByteArray &buffer);
+    // Downloads are written behind: contiguous chunks are coalesced into
+    // large positional writes and synced according to the durability setting
+    bool writeChunk(int chunkIndex, const QByteArray &data);
+    bool flushWrites();
+    void setWriteDurability(WriteDurability durability);
+
+    // Validation
+    QString calculateFileChecksum();
+    bool verifyChecksum(const QString &expectedChecksum);
+
+    // File digest accumulated from the chunks read or written, empty until
+    // every chunk has passed through the session
+    QString getFileDigest() const;
+    
+    // Resume checkpoints: a matching checkpoint loaded before openFile()
+    // makes the file open without truncation, its chunks are checked against
+    // their recorded digests and folded into the file digest
+    bool loadCheckpoint();
+    QBitArray getRestoredChunks() const;
+    QString getCheckpointTransferId() const;
+    bool saveCheckpoint(const QBitArray &completedChunks);
+    void removeCheckpoint();
+    
+    // Delta sync (see DeltaSync): the chunks carry a delta stream against the
+    // receiver's existing copy instead of the whole file. Uploads encode the
+    // stream from the receiver's signature before the first chunk is read;
+    // downloads sign their local copy, receive the stream into a spool file
+    // and rebuild the target when it is complete.
+    void setDeltaSignature(const QByteArray &signature);
+    bool hasDeltaSignature() const;
+    bool prepareDeltaUpload();
+    void setDeltaOffered(bool offered);
+    bool isDeltaOffered() const;
+    QByteArray computeDeltaSignature() const;
+    void beginDeltaDownload(qint64 deltaSize, const QString &checksum);
+    bool applyDelta();
+    bool isDeltaMode() const;
+    qint64 getDeltaSize() const;
+    
+    // Chunk dedup: ChunkStore keys of a download's chunks as announced by
+    // the sender; empty keys when it sent no manifest
+    void setChunkManifest(const QByteArray &manifest);
+    QByteArray getChunkKey(int chunkIndex) const;
+    
+    // Sparse files: chunks that lie entirely in a hole are never sent. An
+    // upload finds them in its source file (Unix, SEEK_HOLE) once the chunk
+    // size is proposed; a download takes them from the server response
+    // before the file is opened and leaves them unwritten in a file sized
+    // up front. Either way they are folded into the digests as zeros. The
+    // bitmap is dropped if the chunk size changes or a delta is sent.
+    QBitArray findHoleChunks();
+    void setHoleChunks(const QBitArray &holeChunks);
+    QBitArray getHoleChunks() const;
+    bool skipHoleChunk(int chunkIndex);
+    
+    // Bundle uploads read their chunks from the files of the manifest in
+    // the request metadata; the manifest itself is fixed once constructed
+    bool isBundle() const;
+    const TransferBundle &getBundle() const;
+    
+    // Chunk information
+    void setFileSize(qint64 fileSize);
+    // Negotiated per transfer and fixed once the file is open, so chunk
+    // indices, bitmaps and checkpoints keep meaning the same byte ranges
+    bool setChunkSize(int chunkSize);
+    int getChunkSize() const;
+    qint64 getChunkOffset(int chunkIndex) const;
+    int getChunkLength(int chunkIndex) const;
+    int getTotalChunks() const;
+    int getCompletedChunks() const;
+    double getCompletionPercentage() const;
+
+    // Serialization
+    QJsonObject toJson() const;
+    void fromJson(const QJsonObject &obj);
+
+    // Lifecycle
+    void reset();
+
+    static QString statusToString(TransferStatus status);
+    static TransferStatus stringToStatus(const QString &statusStr);
+
+signals:
+    void statusChanged(TransferStatus status);
+    void errorOccurred(const QString &error);
+
+private:
+    void cleanup();
+    void publishProgress();
+    void updateFileDigest(int chunkIndex, const QByteArray &data);
+    void recordChunkDigest(int chunkIndex, const QByteArray &data);
+    void verifyRestoredChunks();
+    bool readBackChunk(int chunkIndex, QByteArray &data);
+    
+    // File the chunks are read from or written to, m_mutex must be held
+    QString wirePath() const;
+    qint64 wireSize() const;
+    int chunkCount(qint64 size) const;
+    qint64 chunkOffset(int chunkIndex) const;
+    int chunkLength(int chunkIndex) const;
+    void enterDeltaMode(const QString &spoolPath, qint64 deltaSize);
+    const uchar *mapFileRange(qint64 offset, qint64 size);
+
+    // Write-behind helpers, m_mutex must be held
+    void preallocateFile();
+    bool flushWriteBuffer();
+    bool writeAt(qint64 offset, const char *data, qint64 size);
+    bool syncFile();
+
+    // Elapsed time, m_mutex must be held
+    qint64 durationMs() const;
+
+private:
+    FileTransferRequest m_request;
+    
+    // Polled by the worker and the UI on every chunk, so read without m_mutex
+    std::atomic<TransferStatus> m_status;
+    FileTransferProgress m_progress;
+    QDateTime m_startTime;
+    QDateTime m_endTime;
+    QString m_error;
+
+    // Retry state
+    int m_retryCount;
+    int m_maxRetries;
+
+    // Control flags, read without m_mutex
+    std::atomic<bool> m_isPaused;
+    std::atomic<bool> m_isCancelled;
+
+    // File and chunk state
+    std::unique_ptr<QFile> m_file;
+    int m_chunkSize;
+    std::atomic<int> m_totalChunks;
+    std::atomic<int> m_completedChunks;
+    std::atomic<double> m_completionPercentage; // Mirrors m_progress.percentage
+
+    // Memory mapped read windows, most recently used first
+    struct MappedWindow {
+        qint64 offset;
+        qint64 size;
+        uchar *data;
+    };
+    QList<MappedWindow> m_mappedWindows;
+    bool m_mappingEnabled;
+    
+    // Write-behind buffer of contiguous chunks starting at m_writeBufferOffset
+    WriteDurability m_writeDurability;
+    QByteArray m_writeBuffer;
+    qint64 m_writeBufferOffset;
+    qint64 m_bytesSinceSync;
+    
+    // Running file digest: chunks are hashed in index order, chunks that
+    // arrive early wait in m_pendingDigestChunks. Past MAX_PENDING_DIGEST_BYTES
+    // only a null marker is parked and the chunk is read back from the file
+    // when its turn comes, so memory stays bounded whatever the file size.
+    QCryptographicHash m_fileHash;
+    int m_nextDigestChunk;
+    QMap<int, QByteArray> m_pendingDigestChunks;
+    qint64 m_pendingDigestBytes;
+    
+    // Chunks lying in holes of a sparse file
+    QBitArray m_holeChunks;
+    
+    // Resume state: CRC32C of every chunk moved, chunks restored from a checkpoint
+    QByteArray m_chunkDigests;
+    QBitArray m_restoredChunks;
+    QString m_checkpointTransferId;
+    
+    // Delta sync state; the file digest is that of the full file
+    QByteArray m_deltaSignature;
+    bool m_deltaOffered;
+    bool m_deltaMode;
+    QString m_deltaSpoolPath;
+    qint64 m_deltaSize;
+    QString m_deltaFileDigest;
+    
+    // Chunk dedup manifest, ChunkStore::KEY_SIZE bytes per chunk
+    QByteArray m_chunkManifest;
+    
+    // Files behind a bundle upload, empty for single files
+    TransferBundle m_bundle;
+    
+    // Progress as seen by the progress bus
+    QDateTime m_lastProgressUpdate;
+    std::shared_ptr<ProgressCounters> m_progressCounters;
+    qint64 m_skippedBytes;
+    TransferTelemetry *m_telemetry;
+
+    // Compression accounting
+    qint64 m_compressionFileBytes;
+    qint64 m_compressionWireBytes;
+    
+    mutable QMutex m_mutex;
+};
+
+#endif // FILETRANSFERSESSION_H
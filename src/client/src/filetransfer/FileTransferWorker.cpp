@@ -1,18 +1,29 @@
 #include "FileTransferWorker.h"
 #include "FileTransferSession.h"
 #include "FileTransferManager.h"
+#include "ChunkStore.h"
+#include "ChunkBufferPool.h"
+#include "ChunkCodec.h"
+#include "TransferTelemetry.h"
 #include <QDebug>
 #include <QThread>
 #include <QCryptographicHash>
 #include <QTimer>
 #include <QEventLoop>
 #include <QRandomGenerator>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
 
 // Constants
-static const int CHUNK_TIMEOUT = 30000; // 30 seconds
+static const int CHUNK_TIMEOUT = 30000; // 30 seconds after the chunk was written
+static const qint64 NOT_WRITTEN = std::numeric_limits<qint64>::max();
+static const int CHUNK_TIMEOUT_CHECK_INTERVAL = 1000; // Scan in-flight chunks every second
 static const int MAX_CHUNK_RETRIES = 3;
 static const int RETRY_DELAY_BASE = 1000; // 1 second base delay
-static const int PROGRESS_UPDATE_INTERVAL = 500; // 500ms
+static const int LINK_SAMPLE_INTERVAL = 500; // 500ms
+static const int CHECKPOINT_INTERVAL_CHUNKS = 256; // Persist resume state every 16MB at 64KB chunks
+static const int PEER_ANSWER_TIMEOUT = 30000; // Wait for delta_ready, transfer_resume or chunk_have, then send in full
 
 FileTransferWorker::FileTransferWorker(FileTransferSession *session, FileTransferManager *manager, QObject *parent)
     : QObject(parent)
@@ -26,34 +37,56 @@ FileTransferWorker::FileTransferWorker(FileTransferSession *session, FileTransfe
     , m_completedChunks(0)
     , m_failedChunks()
     , m_chunkRetries()
-    , m_progressTimer(new QTimer(this))
+    , m_windowSize(1)
+    , m_nextChunkIndex(0)
+    , m_sampleStart(0)
+    , m_sampleRttTotal(0)
+    , m_sampleRttCount(0)
+    , m_sampleBytes(0)
+    , m_sampleChunksSent(0)
+    , m_sampleRetransmits(0)
+    , m_chunkIntegrity(ChunkIntegrity::Algorithm::Sha256)
+    , m_compressionEnabled(false)
+    , m_outgoingCipher(ChunkCipher::Cipher::None)
+    , m_chunkStore(nullptr)
+    , m_awaitingChunkHave(false)
+    , m_awaitingResume(false)
+    , m_bufferPool(nullptr)
+    , m_transferHandle(0)
+    , m_telemetry(nullptr)
+    , m_sendBlocked(false)
+    , m_transferBegun(false)
+    , m_sampleTimer(new QTimer(this))
     , m_chunkTimeoutTimer(new QTimer(this))
     , m_retryTimer(new QTimer(this))
-    , m_pauseCondition()
+    , m_peerAnswerTimer(new QTimer(this))
     , m_mutex()
 {
-    // Setup progress timer
-    m_progressTimer->setInterval(PROGRESS_UPDATE_INTERVAL);
-    m_progressTimer->setSingleShot(false);
-    connect(m_progressTimer, &QTimer::timeout, this, &FileTransferWorker::updateProgress);
-    
-    // Setup chunk timeout timer
-    m_chunkTimeoutTimer->setInterval(CHUNK_TIMEOUT);
-    m_chunkTimeoutTimer->setSingleShot(true);
+    // Setup link sampling timer, progress itself goes through the progress bus
+    m_sampleTimer->setInterval(LINK_SAMPLE_INTERVAL);
+    m_sampleTimer->setSingleShot(false);
+    connect(m_sampleTimer, &QTimer::timeout, this, &FileTransferWorker::sampleLink);
+    
+    // Setup chunk timeout timer (checks the deadline of every in-flight chunk)
+    m_chunkTimeoutTimer->setInterval(CHUNK_TIMEOUT_CHECK_INTERVAL);
+    m_chunkTimeoutTimer->setSingleShot(false);
     connect(m_chunkTimeoutTimer, &QTimer::timeout, this, &FileTransferWorker::onChunkTimeout);
     
     // Setup retry timer
     m_retryTimer->setSingleShot(true);
-    connect(m_retryTimer, &QTimer::timeout, this, &FileTransferWorker::retryCurrentChunk);
+    connect(m_retryTimer, &QTimer::timeout, this, &FileTransferWorker::retryFailedChunks);
+    
+    // Setup the timer for answers the peer owes before chunks flow
+    m_peerAnswerTimer->setInterval(PEER_ANSWER_TIMEOUT);
+    m_peerAnswerTimer->setSingleShot(true);
+    connect(m_peerAnswerTimer, &QTimer::timeout, this, &FileTransferWorker::onPeerAnswerTimeout);
     
     // Connect to session signals
     if (m_session) {
         connect(m_session, &FileTransferSession::statusChanged, this, &FileTransferWorker::onSessionStatusChanged);
         
         // Calculate total chunks
-        if (m_session->getRequest().fileSize > 0) {
-            m_totalChunks = (m_session->getRequest().fileSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
-        }
+        m_totalChunks = m_session->getTotalChunks();
     }
     
     qDebug() << "FileTransferWorker created for transfer:" << (m_session ? m_session->getRequest().id : "unknown");
@@ -64,6 +97,67 @@ FileTransferWorker::~FileTransferWorker()
     stopTransfer();
 }
 
+void FileTransferWorker::setWindowSize(int chunks)
+{
+    QMutexLocker locker(&m_mutex);
+    m_windowSize = qMax(1, chunks);
+}
+
+int FileTransferWorker::getWindowSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_windowSize;
+}
+
+void FileTransferWorker::setChunkIntegrity(ChunkIntegrity::Algorithm algorithm)
+{
+    QMutexLocker locker(&m_mutex);
+    m_chunkIntegrity = algorithm;
+}
+
+ChunkIntegrity::Algorithm FileTransferWorker::getChunkIntegrity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_chunkIntegrity;
+}
+
+void FileTransferWorker::setCompressionEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_compressionEnabled = enabled;
+}
+
+void FileTransferWorker::setEncryptionKey(const QByteArray &key)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cipher.setKey(key);
+    m_outgoingCipher = m_cipher.hasKey() ? ChunkCipher::preferredCipher() : ChunkCipher::Cipher::None;
+}
+
+void FileTransferWorker::setChunkStore(ChunkStore *store)
+{
+    QMutexLocker locker(&m_mutex);
+    m_chunkStore = store;
+}
+
+void FileTransferWorker::setBufferPool(ChunkBufferPool *pool)
+{
+    QMutexLocker locker(&m_mutex);
+    m_bufferPool = pool;
+}
+
+void FileTransferWorker::setTransferHandle(quint32 handle)
+{
+    QMutexLocker locker(&m_mutex);
+    m_transferHandle = handle;
+}
+
+void FileTransferWorker::setTelemetry(TransferTelemetry *telemetry)
+{
+    QMutexLocker locker(&m_mutex);
+    m_telemetry = telemetry;
+}
+
 void FileTransferWorker::startTransfer()
 {
     QMutexLocker locker(&m_mutex);
@@ -77,12 +171,76 @@ void FileTransferWorker::startTransfer()
     m_isRunning = true;
     m_isPaused = false;
     m_isCancelled = false;
+    m_transferBegun = false;
+    m_awaitingResume = false;
+    m_pendingRestoredChunks.clear();
     m_currentChunkIndex = 0;
+    m_nextChunkIndex = 0;
     m_completedChunks = 0;
     m_failedChunks.clear();
     m_chunkRetries.clear();
+    m_inFlightChunks.clear();
+    m_clock.start();
+    m_sampleStart = 0;
+    m_sampleRttTotal = 0;
+    m_sampleRttCount = 0;
+    m_sampleBytes = 0;
+    m_sampleChunksSent = 0;
+    m_sampleRetransmits = 0;
+    
+    locker.unlock();
+    
+    // Delta downloads publish a signature of the local copy and wait for the
+    // server to announce the delta stream, see startDeltaDownload()
+    bool isUpload = m_session->getRequest().type == TransferType::Upload;
+    if (!isUpload && m_session->isDeltaOffered()) {
+        emit deltaSignatureReady(m_session->computeDeltaSignature());
+        m_peerAnswerTimer->start();
+        return;
+    }
+    
+    // Delta uploads encode the whole stream before the first chunk is read
+    if (isUpload && m_session->hasDeltaSignature()) {
+        bool delta = m_session->prepareDeltaUpload();
+        emit deltaPrepared(delta ? m_session->getDeltaSize() : 0);
+    }
+    
+    beginTransfer();
+}
+
+void FileTransferWorker::startDeltaDownload(qint64 deltaSize, const QString &checksum)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_isRunning || m_isCancelled || !m_session || m_transferBegun) {
+            return;
+        }
+        m_peerAnswerTimer->stop();
+    }
+    
+    // A server that declines sends the whole file over the old copy
+    if (deltaSize > 0) {
+        m_session->beginDeltaDownload(deltaSize, checksum);
+    } else {
+        m_session->setDeltaOffered(false);
+    }
+    
+    beginTransfer();
+}
+
+void FileTransferWorker::beginTransfer()
+{
+    QMutexLocker locker(&m_mutex);
+    m_transferBegun = true;
+    
+    // Size may only be known after the server answered the request
+    m_totalChunks = m_session->getTotalChunks();
+    m_completedChunkBitmap.fill(false, m_totalChunks);
+    m_compressionDecided.fill(false, m_totalChunks);
+    m_compressedChunks.fill(false, m_totalChunks);
     
-    // Open file
+    // Open file, resuming from a checkpoint left by an earlier attempt
+    bool resumed = m_session->loadCheckpoint();
     if (!m_session->openFile()) {
         QString error = m_session->getError();
         qWarning() << "Failed to open file:" << error;
@@ -90,19 +248,122 @@ void FileTransferWorker::startTransfer()
         return;
     }
     
-    // Start progress timer
-    m_progressTimer->start();
+    // A download's checkpoint is what is on disk; an upload's chunks are
+    // only skipped once the server answered transfer_resume, and only those
+    // it still holds
+    bool isUpload = m_session->getRequest().type == TransferType::Upload;
+    QBitArray restoredChunks;
+    if (resumed) {
+        restoredChunks = m_session->getRestoredChunks();
+        restoredChunks.resize(m_totalChunks);
+        if (isUpload) {
+            m_pendingRestoredChunks = restoredChunks;
+            m_awaitingResume = true;
+        } else {
+            restoreChunks(restoredChunks);
+        }
+    }
+    qint64 skippedBytes = skipHoleChunks();
+    
+    // Start link sampling
+    m_sampleTimer->start();
     
     // Start the actual transfer process
     locker.unlock();
     
-    if (m_session->getRequest().type == TransferType::Upload) {
+    if (skippedBytes > 0) {
+        m_session->addSkippedBytes(skippedBytes);
+        m_session->updateChunkProgress(m_completedChunks);
+    }
+    if (resumed) {
+        emit checkpointRestored(m_session->getCheckpointTransferId(), restoredChunks);
+    }
+    if (resumed && isUpload) {
+        m_peerAnswerTimer->start();
+        return;
+    }
+    
+    openWindow();
+}
+
+void FileTransferWorker::openWindow()
+{
+    // Dedup: uploads hold back their chunks until the peer said which it has,
+    // downloads take what they can from the cache before requesting anything
+    bool isUpload = m_session->getRequest().type == TransferType::Upload;
+    if (m_chunkStore && !m_session->isDeltaMode()) {
+        if (isUpload) {
+            QByteArray manifest = buildChunkManifest();
+            if (!manifest.isEmpty()) {
+                m_session->setChunkManifest(manifest);
+                {
+                    QMutexLocker locker(&m_mutex);
+                    m_awaitingChunkHave = true;
+                }
+                emit chunkManifestReady(manifest);
+                m_peerAnswerTimer->start();
+                return;
+            }
+        } else {
+            fillFromChunkStore();
+        }
+    }
+    
+    if (isUpload) {
         processUpload();
     } else {
         processDownload();
     }
 }
 
+void FileTransferWorker::startDedupUpload(const QBitArray &peerChunks)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_isRunning || !m_awaitingChunkHave) {
+            return;
+        }
+        m_awaitingChunkHave = false;
+        m_peerAnswerTimer->stop();
+        
+        int skipped = 0;
+        qint64 skippedBytes = 0;
+        for (int chunkIndex = 0; chunkIndex < qMin(m_totalChunks, static_cast<int>(peerChunks.size())); ++chunkIndex) {
+            if (peerChunks.testBit(chunkIndex) && markChunkCompleted(chunkIndex)) {
+                skipped++;
+                skippedBytes += m_session->getChunkLength(chunkIndex);
+            }
+        }
+        
+        if (skipped > 0) {
+            qDebug() << "Peer already holds" << skipped << "of" << m_totalChunks << "chunks of" << m_session->getRequest().id;
+            m_session->addSkippedBytes(skippedBytes);
+            m_session->updateChunkProgress(m_completedChunks);
+        }
+    }
+    
+    processUpload();
+}
+
+void FileTransferWorker::setSendBlocked(bool blocked)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_sendBlocked == blocked) {
+            return;
+        }
+        m_sendBlocked = blocked;
+        
+        // Only uploads send, and dedup or resumed uploads wait for the peer first
+        if (blocked || !m_isRunning || m_awaitingChunkHave || m_awaitingResume || !m_session ||
+            m_session->getRequest().type != TransferType::Upload) {
+            return;
+        }
+    }
+    
+    processNextChunk();
+}
+
 void FileTransferWorker::pauseTransfer()
 {
     QMutexLocker locker(&m_mutex);
@@ -114,12 +375,16 @@ void FileTransferWorker::pauseTransfer()
     qDebug() << "Pausing transfer:" << (m_session ? m_session->getRequest().id : "unknown");
     
     m_isPaused = true;
-    m_progressTimer->stop();
+    m_sampleTimer->stop();
     m_chunkTimeoutTimer->stop();
     m_retryTimer->stop();
+    QBitArray completedChunks = m_completedChunkBitmap;
     
+    // The session reports the new status back through onSessionStatusChanged()
+    locker.unlock();
     if (m_session) {
         m_session->setPaused(true);
+        m_session->saveCheckpoint(completedChunks);
     }
 }
 
@@ -134,14 +399,32 @@ void FileTransferWorker::resumeTransfer()
     qDebug() << "Resuming transfer:" << (m_session ? m_session->getRequest().id : "unknown");
     
     m_isPaused = false;
-    m_progressTimer->start();
+    m_sampleTimer->start();
+    
+    // Give in-flight chunks a fresh deadline, the peer was paused as well
+    const qint64 deadline = m_clock.elapsed() + CHUNK_TIMEOUT;
+    for (auto it = m_inFlightChunks.begin(); it != m_inFlightChunks.end(); ++it) {
+        if (it->deadline != NOT_WRITTEN) {
+            it->deadline = deadline;
+        }
+        it->sentAt = -1;
+        it->tracedAt = -1;
+    }
+    if (!m_inFlightChunks.isEmpty()) {
+        m_chunkTimeoutTimer->start();
+    }
+    
+    // Nothing was sent or requested while paused; a transfer still waiting
+    // for delta_ready, transfer_resume or chunk_have starts when the answer comes
+    bool refill = m_transferBegun && !m_awaitingChunkHave && !m_awaitingResume;
+    locker.unlock();
     
     if (m_session) {
         m_session->setPaused(false);
     }
-    
-    // Wake up any waiting operations
-    m_pauseCondition.wakeAll();
+    if (refill) {
+        processNextChunk();
+    }
 }
 
 void FileTransferWorker::cancelTransfer()
@@ -158,18 +441,18 @@ void FileTransferWorker::cancelTransfer()
     m_isRunning = false;
     
     // Stop all timers
-    m_progressTimer->stop();
+    m_sampleTimer->stop();
     m_chunkTimeoutTimer->stop();
     m_retryTimer->stop();
+    m_peerAnswerTimer->stop();
     
+    locker.unlock();
     if (m_session) {
         m_session->setCancelled(true);
+        m_session->removeCheckpoint();
         m_session->closeFile();
     }
     
-    // Wake up any waiting operations
-    m_pauseCondition.wakeAll();
-    
     emit transferCancelled();
 }
 
@@ -178,7 +461,148 @@ void FileTransferWorker::stopTransfer()
     cancelTransfer();
 }
 
+void FileTransferWorker::saveCheckpoint()
+{
+    QBitArray completedChunks;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_isRunning || !m_session || m_session->isDeltaMode() || m_session->isBundle()) {
+            return;
+        }
+        completedChunks = m_completedChunkBitmap;
+    }
+    
+    if (!m_session->saveCheckpoint(completedChunks)) {
+        qWarning() << "Failed to save checkpoint for" << m_session->getRequest().id;
+    }
+}
+
+void FileTransferWorker::resumeAfterReconnect()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_isRunning) {
+            return;
+        }
+        
+        // Whatever was in flight went down with the old connection, as did
+        // a pending chunk manifest or resume: fall back to sending every chunk
+        m_awaitingChunkHave = false;
+        m_awaitingResume = false;
+        m_pendingRestoredChunks.clear();
+        m_peerAnswerTimer->stop();
+        for (auto it = m_inFlightChunks.constBegin(); it != m_inFlightChunks.constEnd(); ++it) {
+            m_failedChunks.insert(it.key());
+        }
+        m_inFlightChunks.clear();
+        m_chunkTimeoutTimer->stop();
+    }
+    
+    resumeTransfer();
+    processNextChunk();
+}
+
+void FileTransferWorker::reconcileChunks(const QBitArray &peerCompletedChunks)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        // Only uploads trust the peer, a download's bitmap is what is on disk
+        if (!m_isRunning || !m_session || m_session->getRequest().type != TransferType::Upload) {
+            return;
+        }
+        
+        // The answer to a restored checkpoint: skip what both sides have
+        if (m_awaitingResume) {
+            QBitArray peerChunks = peerCompletedChunks;
+            peerChunks.resize(m_totalChunks);
+            QBitArray restoredChunks = m_pendingRestoredChunks & peerChunks;
+            m_awaitingResume = false;
+            m_pendingRestoredChunks.clear();
+            m_peerAnswerTimer->stop();
+            
+            qDebug() << "Server holds" << restoredChunks.count(true) << "checkpointed chunks of" << m_session->getRequest().id;
+            restoreChunks(restoredChunks);
+            locker.unlock();
+            
+            openWindow();
+            return;
+        }
+        
+        // Holes were never sent, the peer need not list them
+        QBitArray holeChunks = m_session->getHoleChunks();
+        int missing = 0;
+        for (int chunkIndex = 0; chunkIndex < m_completedChunkBitmap.size(); ++chunkIndex) {
+            bool peerHasChunk = (chunkIndex < peerCompletedChunks.size() && peerCompletedChunks.testBit(chunkIndex)) ||
+                                (chunkIndex < holeChunks.size() && holeChunks.testBit(chunkIndex));
+            if (m_completedChunkBitmap.testBit(chunkIndex) && !peerHasChunk) {
+                m_completedChunkBitmap.clearBit(chunkIndex);
+                m_completedChunks--;
+                m_failedChunks.insert(chunkIndex);
+                missing++;
+            }
+        }
+        
+        if (missing == 0) {
+            return;
+        }
+        
+        qDebug() << "Peer is missing" << missing << "checkpointed chunks of" << m_session->getRequest().id;
+        m_session->updateChunkProgress(m_completedChunks);
+    }
+    
+    processNextChunk();
+}
+
+void FileTransferWorker::discardCheckpoint()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_isRunning || !m_awaitingResume) {
+            return;
+        }
+        
+        qDebug() << "Server cannot resume, sending every chunk of" << m_session->getRequest().id;
+        m_awaitingResume = false;
+        m_pendingRestoredChunks.clear();
+        m_peerAnswerTimer->stop();
+    }
+    
+    openWindow();
+}
+
+void FileTransferWorker::onPeerAnswerTimeout()
+{
+    bool awaitingDelta = false;
+    bool awaitingChunkHave = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_isRunning || !m_session) {
+            return;
+        }
+        awaitingDelta = !m_transferBegun;
+        awaitingChunkHave = m_awaitingChunkHave;
+    }
+    
+    // The whole file is transferred instead of what the server never answered
+    if (awaitingDelta) {
+        qWarning() << "No delta_ready for" << m_session->getRequest().id << ", downloading it in full";
+        startDeltaDownload(0, QString());
+    } else if (awaitingChunkHave) {
+        qWarning() << "No chunk_have for" << m_session->getRequest().id << ", sending every chunk";
+        startDedupUpload(QBitArray());
+    } else {
+        qWarning() << "No answer to transfer_resume for" << m_session->getRequest().id;
+        discardCheckpoint();
+    }
+}
+
 void FileTransferWorker::onChunkAcknowledged(int chunkIndex)
+{
+    onChunksAcknowledged(QList<int>{chunkIndex});
+}
+
+void FileTransferWorker::onChunksAcknowledged(const QList<int> &chunkIndices)
 {
     QMutexLocker locker(&m_mutex);
     
@@ -186,41 +610,53 @@ void FileTransferWorker::onChunkAcknowledged(int chunkIndex)
         return;
     }
     
-    // Stop timeout timer for this chunk
-    if (chunkIndex == m_currentChunkIndex) {
+    int completedBefore = m_completedChunks;
+    for (int chunkIndex : chunkIndices) {
+        // Chunk is no longer in flight
+        recordRoundTrip(chunkIndex, m_session ? m_session->getChunkLength(chunkIndex) : 0);
+        m_inFlightChunks.remove(chunkIndex);
+        
+        // Mark chunk as completed
+        if (markChunkCompleted(chunkIndex) && TransferTelemetry::isLogSampled(chunkIndex, m_totalChunks)) {
+            qDebug() << "Chunk acknowledged:" << chunkIndex << "(" << m_completedChunks << "/" << m_totalChunks << ")";
+        }
+        
+        // Remove from failed chunks if it was there
+        m_failedChunks.remove(chunkIndex);
+        m_chunkRetries.remove(chunkIndex);
+    }
+    
+    if (m_inFlightChunks.isEmpty()) {
         m_chunkTimeoutTimer->stop();
     }
     
-    // Mark chunk as completed
-    if (!m_completedChunkIndices.contains(chunkIndex)) {
-        m_completedChunkIndices.insert(chunkIndex);
-        m_completedChunks++;
-        
+    bool checkpointDue = false;
+    if (m_completedChunks > completedBefore) {
         // Update session progress
         if (m_session) {
             m_session->updateChunkProgress(m_completedChunks);
         }
         
-        qDebug() << "Chunk acknowledged:" << chunkIndex << "(" << m_completedChunks << "/" << m_totalChunks << ")";
-        
         // Check if transfer is complete
         if (m_completedChunks >= m_totalChunks) {
             locker.unlock();
             completeTransfer();
             return;
         }
+        
+        // A batch may cross the checkpoint interval without landing on it
+        checkpointDue = m_completedChunks / CHECKPOINT_INTERVAL_CHUNKS != completedBefore / CHECKPOINT_INTERVAL_CHUNKS;
     }
     
-    // Remove from failed chunks if it was there
-    m_failedChunks.remove(chunkIndex);
-    m_chunkRetries.remove(chunkIndex);
-    
-    // Continue with next chunk
+    // Refill the window
     locker.unlock();
+    if (checkpointDue) {
+        saveCheckpoint();
+    }
     processNextChunk();
 }
 
-void FileTransferWorker::onChunkTimeout()
+void FileTransferWorker::onChunksWritten(const QList<int> &chunkIndices)
 {
     QMutexLocker locker(&m_mutex);
     
@@ -228,33 +664,78 @@ void FileTransferWorker::onChunkTimeout()
         return;
     }
     
-    qWarning() << "Chunk timeout:" << m_currentChunkIndex;
+    // A chunk sent again since keeps the deadline of its latest send
+    const qint64 deadline = m_clock.elapsed() + CHUNK_TIMEOUT;
+    for (int chunkIndex : chunkIndices) {
+        auto it = m_inFlightChunks.find(chunkIndex);
+        if (it != m_inFlightChunks.end() && it->deadline == NOT_WRITTEN) {
+            it->deadline = deadline;
+        }
+    }
+}
+
+void FileTransferWorker::onChunkTimeout()
+{
+    QMutexLocker locker(&m_mutex);
     
-    // Add to failed chunks
-    m_failedChunks.insert(m_currentChunkIndex);
+    if (!m_isRunning || m_isCancelled) {
+        return;
+    }
     
-    // Increment retry count
-    int retryCount = m_chunkRetries.value(m_currentChunkIndex, 0) + 1;
-    m_chunkRetries[m_currentChunkIndex] = retryCount;
+    const qint64 now = m_clock.elapsed();
+    int maxRetryCount = 0;
     
-    if (retryCount >= MAX_CHUNK_RETRIES) {
-        QString error = QString("Chunk %1 failed after %2 retries").arg(m_currentChunkIndex).arg(MAX_CHUNK_RETRIES);
-        qWarning() << error;
+    for (auto it = m_inFlightChunks.begin(); it != m_inFlightChunks.end();) {
+        if (it->deadline > now) {
+            ++it;
+            continue;
+        }
         
-        locker.unlock();
-        emit transferFailed(error);
+        int chunkIndex = it.key();
+        it = m_inFlightChunks.erase(it);
+        
+        qWarning() << "Chunk timeout:" << chunkIndex;
+        if (m_telemetry) {
+            m_telemetry->increment(TransferTelemetry::Counter::Timeouts);
+        }
+        
+        // Queue for selective retransmission
+        m_failedChunks.insert(chunkIndex);
+        
+        // Increment retry count
+        int retryCount = m_chunkRetries.value(chunkIndex, 0) + 1;
+        m_chunkRetries[chunkIndex] = retryCount;
+        
+        if (retryCount >= MAX_CHUNK_RETRIES) {
+            QString error = QString("Chunk %1 failed after %2 retries").arg(chunkIndex).arg(MAX_CHUNK_RETRIES);
+            qWarning() << error;
+            
+            m_chunkTimeoutTimer->stop();
+            locker.unlock();
+            emit transferFailed(error);
+            return;
+        }
+        
+        maxRetryCount = qMax(maxRetryCount, retryCount);
+    }
+    
+    if (m_inFlightChunks.isEmpty()) {
+        m_chunkTimeoutTimer->stop();
+    }
+    
+    if (maxRetryCount == 0 || m_retryTimer->isActive()) {
         return;
     }
     
     // Schedule retry
-    int delay = RETRY_DELAY_BASE * (1 << (retryCount - 1)); // Exponential backoff
+    int delay = RETRY_DELAY_BASE * (1 << (maxRetryCount - 1)); // Exponential backoff
     m_retryTimer->setInterval(delay);
     m_retryTimer->start();
     
-    qDebug() << "Scheduling chunk retry in" << delay << "ms (attempt" << retryCount << ")";
+    qDebug() << "Scheduling chunk retry in" << delay << "ms (attempt" << maxRetryCount << ")";
 }
 
-void FileTransferWorker::retryCurrentChunk()
+void FileTransferWorker::retryFailedChunks()
 {
     QMutexLocker locker(&m_mutex);
     
@@ -262,19 +743,12 @@ void FileTransferWorker::retryCurrentChunk()
         return;
     }
     
-    qDebug() << "Retrying chunk:" << m_currentChunkIndex;
-    
-    // Remove from failed chunks
-    m_failedChunks.remove(m_currentChunkIndex);
+    qDebug() << "Retrying" << m_failedChunks.size() << "failed chunks";
     
     locker.unlock();
     
-    // Retry the current chunk
-    if (m_session && m_session->getRequest().type == TransferType::Upload) {
-        sendChunk(m_currentChunkIndex);
-    } else {
-        requestChunk(m_currentChunkIndex);
-    }
+    // Failed chunks are picked before new ones when the window is refilled
+    processNextChunk();
 }
 
 void FileTransferWorker::onSessionStatusChanged(TransferStatus status)
@@ -297,9 +771,8 @@ void FileTransferWorker::processUpload()
     
     qDebug() << "Processing upload:" << m_totalChunks << "chunks";
     
-    // Start with first chunk
-    m_currentChunkIndex = 0;
-    sendChunk(m_currentChunkIndex);
+    // Fill the send window
+    processNextChunk();
 }
 
 void FileTransferWorker::processDownload()
@@ -315,92 +788,226 @@ void FileTransferWorker::processDownload()
     // The total chunks will be determined by the server
     // We just need to be ready to receive them
     
-    // Start with requesting the first chunk
-    m_currentChunkIndex = 0;
-    requestChunk(m_currentChunkIndex);
+    // Keep the prefetch window full, chunks may arrive in any order
+    processNextChunk();
 }
 
 void FileTransferWorker::sendChunk(int chunkIndex)
 {
     if (!m_session || !checkCanContinue()) {
+        requeueChunk(chunkIndex);
         return;
     }
     
-    // Read chunk data
-    QByteArray chunkData = m_session->readChunk(chunkIndex);
-    if (chunkData.isEmpty() && chunkIndex < m_totalChunks - 1) {
+    // Read behind the header room of a frame buffer, pooled when the manager shares one
+    const int headroom = ChunkBufferPool::HEADROOM;
+    int chunkLength = m_session->getChunkLength(chunkIndex);
+    QByteArray frame;
+    if (m_bufferPool) {
+        frame = m_bufferPool->acquire(chunkLength);
+    } else {
+        frame.reserve(headroom + chunkLength + ChunkBufferPool::TAILROOM);
+        frame.resize(headroom);
+    }
+    
+    if (!m_session->readChunk(chunkIndex, frame) && chunkIndex < m_totalChunks - 1) {
         QString error = QString("Failed to read chunk %1").arg(chunkIndex);
         qWarning() << error;
         emit transferFailed(error);
         return;
     }
+    QByteArray chunkData = QByteArray::fromRawData(frame.constData() + headroom, frame.size() - headroom);
+    qsizetype chunkSize = chunkData.size();
+    
+    QString transferId = m_session->getRequest().id;
+    qint64 stageStart = m_telemetry ? m_telemetry->now() : -1;
+    
+    // The AEAD tag authenticates sealed chunks, no separate digest needed;
+    // a dedup manifest already holds the BLAKE2s digest of every chunk
+    QByteArray checksum;
+    if (m_outgoingCipher == ChunkCipher::Cipher::None) {
+        if (getChunkIntegrity() == ChunkIntegrity::Algorithm::Blake2s) {
+            checksum = m_session->getChunkKey(chunkIndex);
+        }
+        if (checksum.isEmpty()) {
+            checksum = ChunkIntegrity::digest(getChunkIntegrity(), chunkData);
+        }
+    }
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Hash, stageStart, transferId, chunkIndex);
+        stageStart = m_telemetry->now();
+    }
     
-    // Calculate chunk checksum
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    hash.addData(chunkData);
-    QString checksum = hash.result().toHex();
+    // Compress unless sampling showed the file does not shrink; the smaller
+    // payload replaces the original in the frame, chunkData is stale after.
+    // A chunk keeps the decision of its first send: the nonce of a sealed
+    // chunk comes from its index, so a retransmit must seal the same bytes
+    bool decided = chunkIndex < m_compressionDecided.size() && m_compressionDecided.testBit(chunkIndex);
+    bool firstDecision = decided && m_compressedChunks.testBit(chunkIndex);
+    bool compressed = false;
+    if (decided ? firstDecision : m_compressionEnabled && m_compressor.shouldCompress()) {
+        if (m_compressor.compress(chunkData, m_compressBuffer)) {
+            if (!decided) {
+                m_compressor.recordSample(chunkSize, m_compressBuffer.size());
+            }
+            if (m_compressBuffer.size() < chunkSize) {
+                frame.resize(headroom);
+                frame.append(m_compressBuffer);
+                compressed = true;
+            }
+        }
+    }
+    if (decided && compressed != firstDecision) {
+        QString error = QString("Chunk %1 cannot be resent as it was first sent").arg(chunkIndex);
+        qWarning() << error;
+        emit transferFailed(error);
+        return;
+    }
+    if (!decided && chunkIndex < m_compressionDecided.size()) {
+        m_compressionDecided.setBit(chunkIndex);
+        m_compressedChunks.setBit(chunkIndex, compressed);
+    }
+    m_session->recordCompression(chunkSize, frame.size() - headroom);
     
     // Create chunk object
     FileChunk chunk;
-    chunk.transferId = m_session->getRequest().id;
+    chunk.transferId = transferId;
     chunk.chunkIndex = chunkIndex;
-    chunk.data = chunkData;
     chunk.checksum = checksum;
     chunk.isLast = (chunkIndex == m_totalChunks - 1);
+    chunk.compressed = compressed;
+    chunk.cipher = m_outgoingCipher;
     
-    // Update current chunk index
+    // Seal in place after compression, ciphertext does not compress
+    if (chunk.cipher != ChunkCipher::Cipher::None &&
+        !m_cipher.encrypt(chunk.cipher, chunkIndex, chunkAssociatedData(chunk), frame, headroom)) {
+        QString error = QString("Failed to encrypt chunk %1").arg(chunkIndex);
+        qWarning() << error;
+        emit transferFailed(error);
+        return;
+    }
+    
+    // Frame in place; a zeroed header tells the manager to encode the chunk itself
+    if (m_transferHandle != 0) {
+        ChunkCodec::writeBinaryHeader(reinterpret_cast<uchar *>(frame.data()), m_transferHandle, chunk);
+    } else {
+        memset(frame.data(), 0, headroom);
+    }
+    chunk.data = QByteArray::fromRawData(frame.constData() + headroom, frame.size() - headroom);
+    chunk.frame = frame;
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Frame, stageStart, transferId, chunkIndex);
+        m_telemetry->increment(TransferTelemetry::Counter::ChunksSent);
+    }
+    
+    // Track chunk in the send window
     {
         QMutexLocker locker(&m_mutex);
         m_currentChunkIndex = chunkIndex;
+        trackInFlight(chunkIndex);
     }
     
     // Start timeout timer
-    m_chunkTimeoutTimer->start();
+    if (!m_chunkTimeoutTimer->isActive()) {
+        m_chunkTimeoutTimer->start();
+    }
     
     // Send chunk
     emit chunkReady(chunk);
     
-    qDebug() << "Sent chunk:" << chunkIndex << "(" << chunkData.size() << "bytes)";
+    if (TransferTelemetry::isLogSampled(chunkIndex, m_totalChunks)) {
+        qDebug() << "Sent chunk:" << chunkIndex << "(" << chunkSize << "bytes)";
+    }
 }
 
 void FileTransferWorker::requestChunk(int chunkIndex)
 {
     if (!m_session || !checkCanContinue()) {
+        requeueChunk(chunkIndex);
         return;
     }
     
-    // Update current chunk index
+    // Track chunk as outstanding
     {
         QMutexLocker locker(&m_mutex);
         m_currentChunkIndex = chunkIndex;
+        trackInFlight(chunkIndex);
     }
     
     // Start timeout timer
-    m_chunkTimeoutTimer->start();
+    if (!m_chunkTimeoutTimer->isActive()) {
+        m_chunkTimeoutTimer->start();
+    }
     
     // Request chunk from server (this would be handled by the manager)
     // For now, we'll emit a signal that the manager can handle
     emit chunkRequested(m_session->getRequest().id, chunkIndex);
     
-    qDebug() << "Requested chunk:" << chunkIndex;
+    if (TransferTelemetry::isLogSampled(chunkIndex, m_totalChunks)) {
+        qDebug() << "Requested chunk:" << chunkIndex;
+    }
 }
 
 void FileTransferWorker::processReceivedChunk(const FileChunk &chunk)
 {
-    if (!m_session || !checkCanContinue()) {
+    // Chunks requested before a pause are still written
+    if (!m_session || !m_isRunning || m_isCancelled) {
         return;
     }
     
-    // Verify chunk checksum
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    hash.addData(chunk.data);
-    QString actualChecksum = hash.result().toHex();
+    // Drop duplicates of chunks we already wrote (e.g. late retransmissions)
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        // Indices past the file, or of a download of unknown size past the
+        // chunks requested, are a protocol error and never retried
+        int chunkLimit = m_totalChunks > 0 ? m_totalChunks : m_nextChunkIndex;
+        if (chunk.chunkIndex < 0 || chunk.chunkIndex >= chunkLimit) {
+            locker.unlock();
+            QString error = QString("Chunk index %1 out of range (%2 chunks)").arg(chunk.chunkIndex).arg(chunkLimit);
+            qWarning() << error;
+            emit transferFailed(error);
+            return;
+        }
+        
+        if (isChunkCompleted(chunk.chunkIndex)) {
+            m_inFlightChunks.remove(chunk.chunkIndex);
+            return;
+        }
+    }
+    
+    // Open sealed chunks, decompress, then verify the checksum of the original data
+    qint64 stageStart = m_telemetry ? m_telemetry->now() : -1;
+    QByteArray payload;
+    bool decoded = true;
+    if (chunk.cipher == ChunkCipher::Cipher::None) {
+        payload = chunk.data;
+    } else {
+        decoded = m_cipher.decrypt(chunk.cipher, chunk.chunkIndex, chunkAssociatedData(chunk), chunk.data, payload);
+    }
     
-    if (actualChecksum.compare(chunk.checksum, Qt::CaseInsensitive) != 0) {
+    QByteArray data = payload;
+    decoded = decoded && (!chunk.compressed || m_compressor.decompress(payload, data, m_session->getChunkSize()));
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Frame, stageStart, chunk.transferId, chunk.chunkIndex);
+        stageStart = m_telemetry->now();
+    }
+    
+    bool verified = decoded && (chunk.cipher != ChunkCipher::Cipher::None ||
+                                ChunkIntegrity::verify(getChunkIntegrity(), data, chunk.checksum));
+    if (m_telemetry) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::Hash, stageStart, chunk.transferId, chunk.chunkIndex);
+    }
+    
+    if (!verified) {
         qWarning() << "Chunk checksum mismatch for chunk" << chunk.chunkIndex;
+        if (m_telemetry) {
+            m_telemetry->increment(TransferTelemetry::Counter::ChecksumFailures);
+        }
         
         // Add to failed chunks for retry
         QMutexLocker locker(&m_mutex);
+        m_inFlightChunks.remove(chunk.chunkIndex);
         m_failedChunks.insert(chunk.chunkIndex);
         
         int retryCount = m_chunkRetries.value(chunk.chunkIndex, 0) + 1;
@@ -413,55 +1020,76 @@ void FileTransferWorker::processReceivedChunk(const FileChunk &chunk)
         }
         
         // Schedule retry
-        int delay = RETRY_DELAY_BASE * (1 << (retryCount - 1));
-        m_retryTimer->setInterval(delay);
-        m_retryTimer->start();
+        if (!m_retryTimer->isActive()) {
+            int delay = RETRY_DELAY_BASE * (1 << (retryCount - 1));
+            m_retryTimer->setInterval(delay);
+            m_retryTimer->start();
+        }
         return;
     }
     
+    m_session->recordCompression(data.size(), payload.size());
+    if (m_telemetry) {
+        m_telemetry->increment(TransferTelemetry::Counter::ChunksReceived);
+    }
+    
     // Write chunk to file
-    if (!m_session->writeChunk(chunk.chunkIndex, chunk.data)) {
+    if (!m_session->writeChunk(chunk.chunkIndex, data)) {
         QString error = QString("Failed to write chunk %1 to file").arg(chunk.chunkIndex);
         qWarning() << error;
         emit transferFailed(error);
         return;
     }
     
-    // Stop timeout timer
-    m_chunkTimeoutTimer->stop();
+    // Keep file content for later transfers, delta streams are not worth it
+    if (m_chunkStore && !m_session->isDeltaMode()) {
+        QByteArray key = m_session->getChunkKey(chunk.chunkIndex);
+        m_chunkStore->put(key.isEmpty() ? ChunkStore::keyFor(data) : key, data);
+    }
     
     // Mark chunk as completed
+    bool isComplete = false;
+    bool checkpointDue = false;
     {
         QMutexLocker locker(&m_mutex);
-        if (!m_completedChunkIndices.contains(chunk.chunkIndex)) {
-            m_completedChunkIndices.insert(chunk.chunkIndex);
-            m_completedChunks++;
-            
+        recordRoundTrip(chunk.chunkIndex, data.size());
+        m_inFlightChunks.remove(chunk.chunkIndex);
+        if (m_inFlightChunks.isEmpty()) {
+            m_chunkTimeoutTimer->stop();
+        }
+        
+        if (markChunkCompleted(chunk.chunkIndex)) {
             // Update session progress
             m_session->updateChunkProgress(m_completedChunks);
+            checkpointDue = m_completedChunks % CHECKPOINT_INTERVAL_CHUNKS == 0;
         }
         
         // Remove from failed chunks
         m_failedChunks.remove(chunk.chunkIndex);
         m_chunkRetries.remove(chunk.chunkIndex);
-    }
-    
-    qDebug() << "Processed chunk:" << chunk.chunkIndex << "(" << m_completedChunks << "/" << m_totalChunks << ")";
-    
-    // Check if this was the last chunk
-    if (chunk.isLast) {
+        
         // Update total chunks if not set
-        if (m_totalChunks == 0) {
+        if (chunk.isLast && m_totalChunks == 0) {
             m_totalChunks = chunk.chunkIndex + 1;
         }
         
-        // Check if transfer is complete
-        if (m_completedChunks >= m_totalChunks) {
-            completeTransfer();
-            return;
+        isComplete = m_totalChunks > 0 && m_completedChunks >= m_totalChunks;
+        
+        if (TransferTelemetry::isLogSampled(chunk.chunkIndex, m_totalChunks)) {
+            qDebug() << "Processed chunk:" << chunk.chunkIndex << "(" << m_completedChunks << "/" << m_totalChunks << ")";
         }
     }
     
+    // Check if transfer is complete
+    if (isComplete) {
+        completeTransfer();
+        return;
+    }
+    
+    if (checkpointDue) {
+        saveCheckpoint();
+    }
+    
     // Continue with next chunk
     processNextChunk();
 }
@@ -475,43 +1103,58 @@ void FileTransferWorker::processNextChunk()
     QMutexLocker locker(&m_mutex);
     
     // Check if we have completed all chunks
-    if (m_completedChunks >= m_totalChunks) {
+    if (m_totalChunks > 0 && m_completedChunks >= m_totalChunks) {
         locker.unlock();
         completeTransfer();
         return;
     }
     
-    // Find next chunk to process
-    int nextChunk = -1;
+    // Nothing more is read while the socket buffers are full
+    bool isUpload = m_session->getRequest().type == TransferType::Upload;
+    if (isUpload && m_sendBlocked) {
+        return;
+    }
+    
+    // Downloads of unknown size are fetched one chunk at a time
+    bool sizeKnown = m_totalChunks > 0;
+    int windowSize = sizeKnown ? m_windowSize : 1;
     
-    // First, retry any failed chunks
-    if (!m_failedChunks.isEmpty()) {
-        nextChunk = *m_failedChunks.begin();
-    } else {
-        // Find next unprocessed chunk
-        for (int i = 0; i < m_totalChunks; ++i) {
-            if (!m_completedChunkIndices.contains(i)) {
-                nextChunk = i;
-                break;
+    // Pick chunks until the window is full
+    QList<int> nextChunks;
+    while (m_inFlightChunks.size() + nextChunks.size() < windowSize) {
+        int nextChunk = -1;
+        
+        if (!m_failedChunks.isEmpty()) {
+            // Selective retransmit of timed out / corrupted chunks first
+            auto it = m_failedChunks.begin();
+            nextChunk = *it;
+            m_failedChunks.erase(it);
+        } else {
+            // Next chunk that was never sent
+            while (m_nextChunkIndex < m_totalChunks && isChunkCompleted(m_nextChunkIndex)) {
+                m_nextChunkIndex++;
+            }
+            if (m_nextChunkIndex < m_totalChunks || !sizeKnown) {
+                nextChunk = m_nextChunkIndex++;
             }
         }
+        
+        if (nextChunk == -1) {
+            break;
+        }
+        
+        nextChunks.append(nextChunk);
     }
     
-    if (nextChunk == -1) {
-        // All chunks processed
-        locker.unlock();
-        completeTransfer();
-        return;
-    }
-    
-    m_currentChunkIndex = nextChunk;
     locker.unlock();
     
-    // Process the next chunk
-    if (m_session->getRequest().type == TransferType::Upload) {
-        sendChunk(nextChunk);
-    } else {
-        requestChunk(nextChunk);
+    // Process the selected chunks
+    for (int chunkIndex : nextChunks) {
+        if (isUpload) {
+            sendChunk(chunkIndex);
+        } else {
+            requestChunk(chunkIndex);
+        }
     }
 }
 
@@ -526,17 +1169,40 @@ void FileTransferWorker::completeTransfer()
     qDebug() << "Completing transfer:" << (m_session ? m_session->getRequest().id : "unknown");
     
     m_isRunning = false;
+    m_inFlightChunks.clear();
     
     // Stop all timers
-    m_progressTimer->stop();
+    m_sampleTimer->stop();
     m_chunkTimeoutTimer->stop();
     m_retryTimer->stop();
+    m_peerAnswerTimer->stop();
     
     if (!m_session) {
         emit transferFailed("Session is null");
         return;
     }
     
+    // Write out buffered chunks before declaring the download complete
+    if (!m_session->flushWrites()) {
+        QString error = m_session->getError();
+        qWarning() << "Failed to flush downloaded file:" << error;
+        
+        locker.unlock();
+        emit transferFailed(error);
+        return;
+    }
+    
+    // Delta downloads rebuild the target from the old copy and the stream
+    if (m_session->getRequest().type == TransferType::Download && m_session->isDeltaMode() &&
+        !m_session->applyDelta()) {
+        QString error = m_session->getError();
+        qWarning() << "Failed to apply delta:" << error;
+        
+        locker.unlock();
+        emit transferFailed(error);
+        return;
+    }
+    
     // Verify file checksum for downloads
     if (m_session->getRequest().type == TransferType::Download && !m_session->getRequest().checksum.isEmpty()) {
         if (!m_session->verifyChecksum(m_session->getRequest().checksum)) {
@@ -549,7 +1215,8 @@ void FileTransferWorker::completeTransfer()
         }
     }
     
-    // Close file
+    // Close file, nothing is left to resume
+    m_session->removeCheckpoint();
     m_session->closeFile();
     
     // Update session status
@@ -562,49 +1229,241 @@ void FileTransferWorker::completeTransfer()
     qDebug() << "Transfer completed successfully:" << m_session->getRequest().id;
 }
 
-void FileTransferWorker::updateProgress()
+void FileTransferWorker::sampleLink()
 {
     if (!m_session || !m_isRunning || m_isCancelled) {
         return;
     }
     
-    FileTransferProgress progress = m_session->getProgress();
-    emit progressUpdated(progress);
+    qint64 rtt = 0;
+    qint64 bytes = 0;
+    qint64 elapsed = 0;
+    int chunksSent = 0;
+    int retransmits = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        const qint64 now = m_clock.elapsed();
+        rtt = m_sampleRttCount > 0 ? m_sampleRttTotal / m_sampleRttCount : 0;
+        bytes = m_sampleBytes;
+        elapsed = now - m_sampleStart;
+        chunksSent = m_sampleChunksSent;
+        retransmits = m_sampleRetransmits;
+        
+        m_sampleStart = now;
+        m_sampleRttTotal = 0;
+        m_sampleRttCount = 0;
+        m_sampleBytes = 0;
+        m_sampleChunksSent = 0;
+        m_sampleRetransmits = 0;
+    }
+    
+    if (chunksSent > 0 || bytes > 0) {
+        emit linkSampled(rtt, bytes, elapsed, chunksSent, retransmits);
+    }
+}
+
+void FileTransferWorker::trackInFlight(int chunkIndex)
+{
+    // m_mutex must be held; Karn's rule: a retransmitted chunk's answer may
+    // belong to either send, so only first sends are timed
+    const qint64 now = m_clock.elapsed();
+    bool retransmit = m_chunkRetries.contains(chunkIndex);
+    qint64 tracedAt = m_telemetry && !retransmit ? m_telemetry->now() : -1;
+    m_inFlightChunks.insert(chunkIndex, InFlightChunk{NOT_WRITTEN, retransmit ? -1 : now, tracedAt});
+    
+    m_sampleChunksSent++;
+    if (retransmit) {
+        m_sampleRetransmits++;
+    }
+    if (m_telemetry) {
+        if (retransmit) {
+            m_telemetry->increment(TransferTelemetry::Counter::Retransmits);
+        }
+        m_telemetry->recordQueueDepth(TransferTelemetry::Queue::InFlight, m_inFlightChunks.size());
+    }
+}
+
+void FileTransferWorker::recordRoundTrip(int chunkIndex, qint64 bytes)
+{
+    // m_mutex must be held
+    auto it = m_inFlightChunks.constFind(chunkIndex);
+    if (it == m_inFlightChunks.constEnd()) {
+        return;
+    }
+    
+    if (it->sentAt >= 0) {
+        m_sampleRttTotal += m_clock.elapsed() - it->sentAt;
+        m_sampleRttCount++;
+    }
+    if (m_telemetry && m_session && it->tracedAt >= 0) {
+        m_telemetry->recordStage(TransferTelemetry::Stage::AckRtt, it->tracedAt, m_session->getRequest().id, chunkIndex);
+    }
+    m_sampleBytes += bytes;
+}
+
+bool FileTransferWorker::isChunkCompleted(int chunkIndex) const
+{
+    return chunkIndex >= 0 && chunkIndex < m_completedChunkBitmap.size() &&
+           m_completedChunkBitmap.testBit(chunkIndex);
+}
+
+bool FileTransferWorker::markChunkCompleted(int chunkIndex)
+{
+    if (chunkIndex < 0 || isChunkCompleted(chunkIndex)) {
+        return false;
+    }
+    
+    // Grow the bitmap for downloads whose size was not announced, only up
+    // to the chunks requested so far
+    if (chunkIndex >= m_completedChunkBitmap.size()) {
+        if (m_totalChunks > 0 || chunkIndex >= m_nextChunkIndex) {
+            return false;
+        }
+        m_completedChunkBitmap.resize(chunkIndex + 1);
+    }
+    
+    m_completedChunkBitmap.setBit(chunkIndex);
+    m_completedChunks++;
+    return true;
+}
+
+void FileTransferWorker::restoreChunks(const QBitArray &restoredChunks)
+{
+    // m_mutex must be held
+    qint64 restoredBytes = 0;
+    for (int chunkIndex = 0; chunkIndex < qMin(m_totalChunks, static_cast<int>(restoredChunks.size())); ++chunkIndex) {
+        if (restoredChunks.testBit(chunkIndex) && markChunkCompleted(chunkIndex)) {
+            restoredBytes += m_session->getChunkLength(chunkIndex);
+        }
+    }
+    
+    if (restoredBytes > 0) {
+        m_session->addSkippedBytes(restoredBytes);
+        m_session->updateChunkProgress(m_completedChunks);
+    }
+}
+
+qint64 FileTransferWorker::skipHoleChunks()
+{
+    // m_mutex must be held; holes of a sparse file complete without being sent
+    QBitArray holeChunks = m_session->getHoleChunks();
+    int skipped = 0;
+    qint64 skippedBytes = 0;
+    for (int chunkIndex = 0; chunkIndex < qMin(m_totalChunks, static_cast<int>(holeChunks.size())); ++chunkIndex) {
+        if (holeChunks.testBit(chunkIndex) && !isChunkCompleted(chunkIndex) &&
+            m_session->skipHoleChunk(chunkIndex) && markChunkCompleted(chunkIndex)) {
+            skipped++;
+            skippedBytes += m_session->getChunkLength(chunkIndex);
+        }
+    }
+    
+    if (skipped > 0) {
+        qDebug() << "Skipping" << skipped << "hole chunks of" << m_session->getRequest().id;
+    }
+    return skippedBytes;
 }
 
 bool FileTransferWorker::checkCanContinue()
 {
+    // Called for every chunk; never blocks, the pool thread is shared with
+    // other workers and resumeTransfer() refills the window
+    return m_isRunning && !m_isPaused && !m_isCancelled;
+}
+
+void FileTransferWorker::requeueChunk(int chunkIndex)
+{
+    // A chunk picked just before a pause goes out first after the resume
     QMutexLocker locker(&m_mutex);
+    if (m_isRunning && !m_isCancelled && !isChunkCompleted(chunkIndex)) {
+        m_failedChunks.insert(chunkIndex);
+    }
+}
+
+QByteArray FileTransferWorker::buildChunkManifest()
+{
+    // One pass over the file; it also completes the file digest early
+    QByteArray manifest;
+    manifest.reserve(static_cast<qsizetype>(m_totalChunks) * ChunkStore::KEY_SIZE);
+    
+    for (int chunkIndex = 0; chunkIndex < m_totalChunks; ++chunkIndex) {
+        // A view into the mapped window, hashed before the next read can evict it
+        QByteArray data = m_session->readChunk(chunkIndex);
+        if (data.isEmpty()) {
+            qWarning() << "Chunk manifest unavailable, sending every chunk of" << m_session->getRequest().id;
+            return QByteArray();
+        }
+        manifest.append(ChunkStore::keyFor(data));
+    }
     
-    // Check if cancelled
-    if (m_isCancelled || !m_isRunning) {
-        return false;
+    return manifest;
+}
+
+void FileTransferWorker::fillFromChunkStore()
+{
+    if (m_session->getChunkKey(0).isEmpty()) {
+        return;
     }
     
-    // Wait if paused
-    while (m_isPaused && !m_isCancelled) {
-        m_pauseCondition.wait(&m_mutex);
+    int filled = 0;
+    qint64 filledBytes = 0;
+    for (int chunkIndex = 0; chunkIndex < m_totalChunks; ++chunkIndex) {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (isChunkCompleted(chunkIndex)) {
+                continue;
+            }
+        }
+        
+        QByteArray data;
+        if (!m_chunkStore->get(m_session->getChunkKey(chunkIndex), data)) {
+            continue;
+        }
+        
+        // Whatever could not be written is simply requested
+        if (!m_session->writeChunk(chunkIndex, data)) {
+            qWarning() << "Failed to write cached chunk" << chunkIndex;
+            break;
+        }
+        
+        QMutexLocker locker(&m_mutex);
+        if (markChunkCompleted(chunkIndex)) {
+            filled++;
+            filledBytes += data.size();
+        }
     }
     
-    return !m_isCancelled && m_isRunning;
+    if (filled > 0) {
+        QMutexLocker locker(&m_mutex);
+        qDebug() << "Filled" << filled << "of" << m_totalChunks << "chunks of" << m_session->getRequest().id << "from the chunk cache";
+        m_session->addSkippedBytes(filledBytes);
+        m_session->updateChunkProgress(m_completedChunks);
+    }
+}
+
+QByteArray FileTransferWorker::chunkAssociatedData(const FileChunk &chunk)
+{
+    // Binds the ciphertext to its transfer, position and header flags
+    QByteArray associatedData = chunk.transferId.toUtf8();
+    uchar index[4];
+    qToBigEndian<quint32>(static_cast<quint32>(chunk.chunkIndex), index);
+    associatedData.append(reinterpret_cast<const char *>(index), sizeof(index));
+    associatedData.append(static_cast<char>((chunk.isLast ? 0x1 : 0) | (chunk.compressed ? 0x2 : 0)));
+    return associatedData;
 }
 
 bool FileTransferWorker::isRunning() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_isRunning;
+    return m_isRunning.load();
 }
 
 bool FileTransferWorker::isPaused() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_isPaused;
+    return m_isPaused.load();
 }
 
 bool FileTransferWorker::isCancelled() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_isCancelled;
+    return m_isCancelled.load();
 }
 
 int FileTransferWorker::getCurrentChunkIndex() const
@@ -631,4 +1490,10 @@ QSet<int> FileTransferWorker::getFailedChunks() const
     return m_failedChunks;
 }
 
+QBitArray FileTransferWorker::getCompletedChunkBitmap() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_completedChunkBitmap;
+}
+
 #include "FileTransferWorker.moc"
\ No newline at end of file
@@ -0,0 +1,223 @@
+#ifndef FILETRANSFERWORKER_H
+#define FILETRANSFERWORKER_H
+
+#include <QObject>
+#include <QSet>
+#include <QHash>
+#include <QBitArray>
+#include <QTimer>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <atomic>
+#include "FileTransferManager.h"
+#include "ChunkCompressor.h"
+
+class FileTransferSession;
+class ChunkStore;
+class ChunkBufferPool;
+class TransferTelemetry;
+
+// File transfer worker for background operations
+class FileTransferWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileTransferWorker(FileTransferSession *session, FileTransferManager *manager, QObject *parent = nullptr);
+    ~FileTransferWorker();
+
+    // Pipelining: number of chunks allowed in flight without acknowledgment
+    // (upload send window or download prefetch depth)
+    void setWindowSize(int chunks);
+    int getWindowSize() const;
+    
+    // Per-chunk digest algorithm negotiated for the session
+    void setChunkIntegrity(ChunkIntegrity::Algorithm algorithm);
+    ChunkIntegrity::Algorithm getChunkIntegrity() const;
+    
+    // Compress outgoing chunks; incoming compressed chunks are always accepted
+    void setCompressionEnabled(bool enabled);
+    
+    // Per-transfer chunk key; outgoing chunks are sealed when one is set
+    void setEncryptionKey(const QByteArray &key);
+    
+    // Shared chunk cache; when set, uploads negotiate which chunks the peer
+    // still needs and downloads take announced chunks from the cache
+    void setChunkStore(ChunkStore *store);
+    
+    // Upload chunks are read into pooled buffers and framed in place with
+    // the transfer's binary header handle; without a handle (JSON frames)
+    // the manager encodes them
+    void setBufferPool(ChunkBufferPool *pool);
+    void setTransferHandle(quint32 handle);
+    
+    // Stage timings, retransmits and timeouts go here, owned by the manager
+    void setTelemetry(TransferTelemetry *telemetry);
+
+    // State
+    bool isRunning() const;
+    bool isPaused() const;
+    bool isCancelled() const;
+    int getCurrentChunkIndex() const;
+    int getCompletedChunks() const;
+    int getTotalChunks() const;
+    QSet<int> getFailedChunks() const;
+    QBitArray getCompletedChunkBitmap() const;
+
+public slots:
+    void startTransfer();
+    void pauseTransfer();
+    void resumeTransfer();
+    void cancelTransfer();
+    void stopTransfer();
+
+    void onChunkAcknowledged(int chunkIndex);
+    // Acks arriving together, one refill of the window for all of them
+    void onChunksAcknowledged(const QList<int> &chunkIndices);
+    // The manager wrote these chunks, or their requests, to a socket; their
+    // timeout runs from here, not from the time they were queued
+    void onChunksWritten(const QList<int> &chunkIndices);
+    void processReceivedChunk(const FileChunk &chunk);
+
+    // Resume support
+    void saveCheckpoint();
+    void resumeAfterReconnect();
+    // The server's answer to transfer_resume; the first one decides which
+    // chunks of a restored upload checkpoint are skipped
+    void reconcileChunks(const QBitArray &peerCompletedChunks);
+    // The server cannot resume, a restored upload is sent in full
+    void discardCheckpoint();
+
+    // Delta downloads: size of the announced delta stream, 0 if declined
+    void startDeltaDownload(qint64 deltaSize, const QString &checksum);
+
+    // Dedup uploads: the peer's answer to the chunk manifest
+    void startDedupUpload(const QBitArray &peerChunks);
+    
+    // Send path backpressure: uploads stop reading chunks while the
+    // manager's socket buffers are full and refill their window after
+    void setSendBlocked(bool blocked);
+
+signals:
+    void chunkReady(const FileChunk &chunk);
+    void chunkRequested(const QString &transferId, int chunkIndex);
+    void transferCompleted();
+    void transferFailed(const QString &error);
+    void transferCancelled();
+    void checkpointRestored(const QString &previousTransferId, const QBitArray &completedChunks);
+    void deltaSignatureReady(const QByteArray &signature);
+    void deltaPrepared(qint64 deltaSize);
+    void chunkManifestReady(const QByteArray &manifest);
+    // Link measurements of one sampling period, for chunk size tuning;
+    // rttMs is the mean round trip of the chunks timed, 0 if none was
+    void linkSampled(qint64 rttMs, qint64 bytes, qint64 elapsedMs, int chunksSent, int chunksRetransmitted);
+
+private slots:
+    void processNextChunk();
+    void onChunkTimeout();
+    void retryFailedChunks();
+    void onSessionStatusChanged(TransferStatus status);
+    void sampleLink();
+    void onPeerAnswerTimeout();
+
+private:
+    void beginTransfer();
+    void openWindow();
+    void processUpload();
+    void processDownload();
+    void sendChunk(int chunkIndex);
+    void requestChunk(int chunkIndex);
+    void completeTransfer();
+    bool checkCanContinue();
+    void requeueChunk(int chunkIndex);
+    void trackInFlight(int chunkIndex);
+    void recordRoundTrip(int chunkIndex, qint64 bytes);
+    QByteArray buildChunkManifest();
+    void fillFromChunkStore();
+    static QByteArray chunkAssociatedData(const FileChunk &chunk);
+    
+    // Completion bitmap helpers, m_mutex must be held
+    bool isChunkCompleted(int chunkIndex) const;
+    bool markChunkCompleted(int chunkIndex);
+    void restoreChunks(const QBitArray &restoredChunks);
+    qint64 skipHoleChunks();
+
+private:
+    FileTransferSession *m_session;
+    FileTransferManager *m_manager;
+
+    // Control flags; written under m_mutex, read without it
+    std::atomic<bool> m_isRunning;
+    std::atomic<bool> m_isPaused;
+    std::atomic<bool> m_isCancelled;
+
+    // Chunk bookkeeping
+    int m_currentChunkIndex;
+    int m_totalChunks;
+    int m_completedChunks;
+    QSet<int> m_failedChunks;
+    QHash<int, int> m_chunkRetries;
+    QBitArray m_completedChunkBitmap;
+
+    // Sliding window, times in ms on m_clock; chunks sent again or held
+    // over a pause have no send time, their round trip is not measured
+    struct InFlightChunk {
+        qint64 deadline; // NOT_WRITTEN while queued in the manager
+        qint64 sentAt;
+        qint64 tracedAt; // us on the telemetry clock, -1 if not timed
+    };
+    int m_windowSize;
+    int m_nextChunkIndex;
+    QHash<int, InFlightChunk> m_inFlightChunks;
+    QElapsedTimer m_clock;
+    
+    // Link measurements since the last linkSampled()
+    qint64 m_sampleStart;
+    qint64 m_sampleRttTotal;
+    int m_sampleRttCount;
+    qint64 m_sampleBytes;
+    int m_sampleChunksSent;
+    int m_sampleRetransmits;
+
+    ChunkIntegrity::Algorithm m_chunkIntegrity;
+    
+    // Compression context for this transfer, only used on the worker thread
+    bool m_compressionEnabled;
+    ChunkCompressor m_compressor;
+    QByteArray m_compressBuffer; // Reused, copied into the frame
+    QBitArray m_compressionDecided; // Chunks sent at least once
+    QBitArray m_compressedChunks;   // Their first send was compressed
+    
+    // Cipher context for this transfer, only used on the worker thread
+    ChunkCipher m_cipher;
+    ChunkCipher::Cipher m_outgoingCipher;
+    
+    // Content-addressed chunk cache, owned by the manager
+    ChunkStore *m_chunkStore;
+    bool m_awaitingChunkHave;
+    
+    // Restored upload checkpoint, held until the server answered transfer_resume
+    bool m_awaitingResume;
+    QBitArray m_pendingRestoredChunks;
+    
+    // Frame buffers, owned by the manager
+    ChunkBufferPool *m_bufferPool;
+    quint32 m_transferHandle;
+    
+    // Pipeline telemetry, owned by the manager
+    TransferTelemetry *m_telemetry;
+    
+    bool m_sendBlocked;
+    bool m_transferBegun; // beginTransfer() ran, the window may be refilled
+    
+    // Timers
+    QTimer *m_sampleTimer;
+    QTimer *m_chunkTimeoutTimer;
+    QTimer *m_retryTimer;
+    QTimer *m_peerAnswerTimer;
+
+    // Thread synchronization
+    mutable QMutex m_mutex;
+};
+
+#endif // FILETRANSFERWORKER_H
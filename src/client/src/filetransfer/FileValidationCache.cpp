@@ -0,0 +1,119 @@
+#include "FileValidationCache.h"
+#include <QFile>
+#include <QDateTime>
+#include <QMimeDatabase>
+#include <QMimeType>
+#include <QCryptographicHash>
+#include <QDebug>
+
+static qint64 modifiedTime(const QFileInfo &fileInfo)
+{
+    return fileInfo.lastModified().toMSecsSinceEpoch();
+}
+
+FileValidationCache::FileValidationCache(int maxEntries)
+    : m_maxEntries(qMax(1, maxEntries))
+{
+}
+
+bool FileValidationCache::find(const QFileInfo &fileInfo, Entry &entry) const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto it = m_entries.constFind(fileInfo.absoluteFilePath());
+    if (it == m_entries.cend() || it->size != fileInfo.size() || it->modified != modifiedTime(fileInfo)) {
+        return false;
+    }
+    
+    entry = it.value();
+    return true;
+}
+
+void FileValidationCache::insert(const QFileInfo &fileInfo, const Entry &entry)
+{
+    QString key = fileInfo.absoluteFilePath();
+    Entry stored = entry;
+    stored.size = fileInfo.size();
+    stored.modified = modifiedTime(fileInfo);
+    
+    QMutexLocker locker(&m_mutex);
+    if (!m_entries.contains(key)) {
+        m_order.enqueue(key);
+    }
+    m_entries.insert(key, stored);
+    trim();
+}
+
+void FileValidationCache::remove(const QString &filePath)
+{
+    QString key = QFileInfo(filePath).absoluteFilePath();
+    
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.remove(key)) {
+        m_order.removeOne(key);
+    }
+}
+
+void FileValidationCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_order.clear();
+}
+
+int FileValidationCache::getEntryCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+void FileValidationCache::setMaxEntries(int maxEntries)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxEntries = qMax(1, maxEntries);
+    trim();
+}
+
+int FileValidationCache::getMaxEntries() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxEntries;
+}
+
+bool FileValidationCache::inspect(const QFileInfo &fileInfo, bool withChecksum, Entry &entry)
+{
+    QString filePath = fileInfo.absoluteFilePath();
+    
+    if (!entry.sniffed) {
+        // QMimeDatabase is thread-safe, the sniff reads the start of the file
+        QMimeDatabase mimeDb;
+        entry.executable = mimeDb.mimeTypeForFile(filePath).name().startsWith("application/x-executable");
+        entry.sniffed = true;
+    }
+    
+    if (withChecksum && entry.checksum.isEmpty()) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed to open file for checksum calculation:" << filePath;
+            return false;
+        }
+        
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        if (!hash.addData(&file)) {
+            qWarning() << "Failed to read file for checksum calculation:" << filePath;
+            return false;
+        }
+        entry.checksum = QString::fromLatin1(hash.result().toHex());
+    }
+    
+    // A file written to meanwhile would be cached under its old size and time
+    QFileInfo after(filePath);
+    return after.size() == fileInfo.size() && modifiedTime(after) == modifiedTime(fileInfo);
+}
+
+void FileValidationCache::trim()
+{
+    while (m_entries.size() > m_maxEntries && !m_order.isEmpty()) {
+        m_entries.remove(m_order.dequeue());
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef FILEVALIDATIONCACHE_H
+#define FILEVALIDATIONCACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QQueue>
+#include <QMutex>
+#include <QFileInfo>
+
+// What validation and hashing learned about a file, for as long as the
+// file stays the same.
+//
+// Entries are keyed on the absolute path and only match while the size
+// and modification time on disk are those recorded, so an edited file is
+// inspected afresh and resending an unchanged one neither sniffs nor
+// hashes it again. The oldest entries make room past the entry limit.
+// Safe to use from any thread.
+class FileValidationCache
+{
+public:
+    static const int DEFAULT_MAX_ENTRIES = 4096;
+    
+    struct Entry {
+        qint64 size = -1;
+        qint64 modified = 0;     // ms since the epoch
+        bool sniffed = false;    // MIME type looked at
+        bool executable = false;
+        QString checksum;        // Hex SHA-256, empty until hashed
+    };
+    
+    explicit FileValidationCache(int maxEntries = DEFAULT_MAX_ENTRIES);
+    
+    // Entry of the file as it is on disk now
+    bool find(const QFileInfo &fileInfo, Entry &entry) const;
+    // Recorded against the size and time of fileInfo
+    void insert(const QFileInfo &fileInfo, const Entry &entry);
+    void remove(const QString &filePath);
+    void clear();
+    int getEntryCount() const;
+    
+    void setMaxEntries(int maxEntries);
+    int getMaxEntries() const;
+    
+    // Completes entry from the file: the MIME sniff if not done, the
+    // checksum if asked for and missing. Blocking; false if the file could
+    // not be read or changed while it was.
+    static bool inspect(const QFileInfo &fileInfo, bool withChecksum, Entry &entry);
+
+private:
+    // m_mutex must be held
+    void trim();
+    
+    QHash<QString, Entry> m_entries;
+    QQueue<QString> m_order; // Keys, oldest first
+    int m_maxEntries;
+    
+    mutable QMutex m_mutex;
+};
+
+#endif // FILEVALIDATIONCACHE_H
@@ -0,0 +1,230 @@
+#include "TransferBundle.h"
+#include <QJsonObject>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QCryptographicHash>
+#include <algorithm>
+#include <QDebug>
+
+TransferBundle::TransferBundle()
+    : m_totalSize(0)
+    , m_openIndex(-1)
+{
+}
+
+void TransferBundle::setRootPath(const QString &rootPath)
+{
+    close();
+    m_rootPath = QDir::cleanPath(QFileInfo(rootPath).absoluteFilePath());
+}
+
+QString TransferBundle::getRootPath() const
+{
+    return m_rootPath;
+}
+
+bool TransferBundle::addFile(const QString &filePath)
+{
+    QFileInfo fileInfo(filePath);
+    QString relativePath = QDir(m_rootPath).relativeFilePath(fileInfo.absoluteFilePath());
+    
+    if (!fileInfo.isFile() || !isSafeRelativePath(relativePath)) {
+        qWarning() << "Cannot bundle" << filePath << "below" << m_rootPath;
+        return false;
+    }
+    
+    Entry entry;
+    entry.relativePath = relativePath;
+    entry.size = fileInfo.size();
+    entry.offset = m_totalSize;
+    entry.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    
+    m_entries.append(entry);
+    m_totalSize += entry.size;
+    return true;
+}
+
+bool TransferBundle::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+int TransferBundle::getFileCount() const
+{
+    return m_entries.size();
+}
+
+qint64 TransferBundle::getTotalSize() const
+{
+    return m_totalSize;
+}
+
+const TransferBundle::Entry &TransferBundle::entryAt(int index) const
+{
+    return m_entries.at(index);
+}
+
+QString TransferBundle::localPathAt(int index) const
+{
+    return m_rootPath + '/' + m_entries.at(index).relativePath;
+}
+
+bool TransferBundle::computeChecksums(QString &streamChecksum)
+{
+    close();
+    
+    QCryptographicHash streamHash(QCryptographicHash::Sha256);
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    for (int index = 0; index < m_entries.size(); ++index) {
+        Entry &entry = m_entries[index];
+        QFile file(localPathAt(index));
+        if (!file.open(QIODevice::ReadOnly) || file.size() != entry.size) {
+            qWarning() << "Cannot hash bundled file" << file.fileName() << ":" << file.errorString();
+            return false;
+        }
+        
+        fileHash.reset();
+        qint64 hashed = 0;
+        while (hashed < entry.size) {
+            QByteArray data = file.read(qMin<qint64>(entry.size - hashed, 1024 * 1024));
+            if (data.isEmpty()) {
+                qWarning() << "Bundled file changed while hashing:" << file.fileName();
+                return false;
+            }
+            fileHash.addData(data);
+            streamHash.addData(data);
+            hashed += data.size();
+        }
+        entry.checksum = QString::fromLatin1(fileHash.result().toHex());
+    }
+    
+    streamChecksum = QString::fromLatin1(streamHash.result().toHex());
+    return true;
+}
+
+int TransferBundle::completedFiles(qint64 bytes) const
+{
+    // File ends never decrease along the stream
+    auto it = std::partition_point(m_entries.cbegin(), m_entries.cend(), [bytes](const Entry &entry) {
+        return entry.offset + entry.size <= bytes;
+    });
+    return static_cast<int>(it - m_entries.cbegin());
+}
+
+bool TransferBundle::read(qint64 offset, char *buffer, qint64 size)
+{
+    if (offset < 0 || size < 0 || offset + size > m_totalSize) {
+        return false;
+    }
+    
+    for (int index = findEntry(offset); size > 0 && index < m_entries.size(); ++index) {
+        const Entry &entry = m_entries.at(index);
+        qint64 position = offset - entry.offset;
+        qint64 count = qMin(size, entry.size - position);
+        if (count <= 0) {
+            continue; // Empty file
+        }
+        
+        if (m_openIndex != index) {
+            close();
+            m_openFile = std::make_unique<QFile>(localPathAt(index));
+            if (!m_openFile->open(QIODevice::ReadOnly)) {
+                qWarning() << "Failed to open bundled file" << m_openFile->fileName() << ":" << m_openFile->errorString();
+                m_openFile.reset();
+                return false;
+            }
+            m_openIndex = index;
+        }
+        
+        // A file that changed size since it was bundled would shift every later file
+        if (m_openFile->size() != entry.size || !m_openFile->seek(position) ||
+            m_openFile->read(buffer, count) != count) {
+            qWarning() << "Bundled file changed during the transfer:" << m_openFile->fileName();
+            return false;
+        }
+        
+        buffer += count;
+        offset += count;
+        size -= count;
+    }
+    
+    return size == 0;
+}
+
+void TransferBundle::close()
+{
+    m_openFile.reset();
+    m_openIndex = -1;
+}
+
+QJsonArray TransferBundle::toJson() const
+{
+    QJsonArray manifest;
+    for (const Entry &entry : m_entries) {
+        QJsonObject file;
+        file["path"] = entry.relativePath;
+        file["size"] = entry.size;
+        file["modified"] = entry.modified;
+        if (!entry.checksum.isEmpty()) {
+            file["checksum"] = entry.checksum;
+        }
+        manifest.append(file);
+    }
+    return manifest;
+}
+
+bool TransferBundle::fromJson(const QJsonArray &manifest, const QString &rootPath, TransferBundle &bundle)
+{
+    bundle.setRootPath(rootPath);
+    bundle.m_entries.clear();
+    bundle.m_entries.reserve(manifest.size());
+    bundle.m_totalSize = 0;
+    
+    for (const QJsonValue &value : manifest) {
+        QJsonObject file = value.toObject();
+        
+        Entry entry;
+        entry.relativePath = file["path"].toString();
+        entry.size = file["size"].toVariant().toLongLong();
+        entry.offset = bundle.m_totalSize;
+        entry.modified = file["modified"].toVariant().toLongLong();
+        entry.checksum = file["checksum"].toString();
+        
+        if (!isSafeRelativePath(entry.relativePath) || entry.size < 0) {
+            qWarning() << "Rejecting bundle manifest entry" << entry.relativePath;
+            bundle.m_entries.clear();
+            bundle.m_totalSize = 0;
+            return false;
+        }
+        
+        bundle.m_entries.append(entry);
+        bundle.m_totalSize += entry.size;
+    }
+    
+    return !bundle.m_entries.isEmpty();
+}
+
+bool TransferBundle::isSafeRelativePath(const QString &path)
+{
+    if (path.isEmpty() || path.contains('\\') || path.contains(':') || QDir::isAbsolutePath(path)) {
+        return false;
+    }
+    
+    const QStringList segments = path.split('/');
+    for (const QString &segment : segments) {
+        if (segment.isEmpty() || segment == "." || segment == "..") {
+            return false;
+        }
+    }
+    return true;
+}
+
+int TransferBundle::findEntry(qint64 offset) const
+{
+    // Last file starting at or before the offset
+    auto it = std::upper_bound(m_entries.cbegin(), m_entries.cend(), offset, [](qint64 value, const Entry &entry) {
+        return value < entry.offset;
+    });
+    return qMax(0, static_cast<int>(it - m_entries.cbegin()) - 1);
+}
@@ -0,0 +1,69 @@
+#ifndef TRANSFERBUNDLE_H
+#define TRANSFERBUNDLE_H
+
+#include <QFile>
+#include <QJsonArray>
+#include <QList>
+#include <QString>
+#include <memory>
+
+// Many small files sent as a single transfer.
+//
+// The files are concatenated in manifest order into one virtual stream that
+// is chunked like any other file, so a bundle costs one request, one
+// approval and one worker however many files it holds. Chunks straddle file
+// boundaries freely; the manifest (relative path, size, mtime and SHA-256
+// of every file) travels with the request and lets the receiver split and
+// verify the stream.
+class TransferBundle
+{
+public:
+    struct Entry {
+        QString relativePath;
+        qint64 size;
+        qint64 offset;   // Position of the file in the stream
+        qint64 modified; // ms since epoch
+        QString checksum; // SHA-256 hex, empty until computeChecksums()
+    };
+    
+    TransferBundle();
+    
+    // Files are added below the root, in stream order
+    void setRootPath(const QString &rootPath);
+    QString getRootPath() const;
+    bool addFile(const QString &filePath);
+    
+    bool isEmpty() const;
+    int getFileCount() const;
+    qint64 getTotalSize() const;
+    const Entry &entryAt(int index) const;
+    QString localPathAt(int index) const;
+    
+    // Hashes every file and the stream they form in one pass
+    bool computeChecksums(QString &streamChecksum);
+    
+    // Number of files that lie entirely within the first bytes of the stream
+    int completedFiles(qint64 bytes) const;
+    
+    // Reads across file boundaries; the last file touched stays open until close()
+    bool read(qint64 offset, char *buffer, qint64 size);
+    void close();
+    
+    QJsonArray toJson() const;
+    static bool fromJson(const QJsonArray &manifest, const QString &rootPath, TransferBundle &bundle);
+    
+    // Manifest paths must stay below the root on every platform
+    static bool isSafeRelativePath(const QString &path);
+
+private:
+    int findEntry(qint64 offset) const;
+    
+    QString m_rootPath;
+    QList<Entry> m_entries;
+    qint64 m_totalSize;
+    
+    std::unique_ptr<QFile> m_openFile;
+    int m_openIndex;
+};
+
+#endif // TRANSFERBUNDLE_H
@@ -0,0 +1,123 @@
+#include "TransferCheckpoint.h"
+#include <QCryptographicHash>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+static const char *CHECKPOINT_SUFFIX = ".odresume";
+
+TransferCheckpoint::TransferCheckpoint()
+    : fileSize(0)
+    , chunkSize(0)
+    , sourceModified(0)
+{
+}
+
+bool TransferCheckpoint::load(const FileTransferRequest &request, TransferCheckpoint &checkpoint)
+{
+    QFile file(pathFor(request));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        qWarning() << "Ignoring unreadable checkpoint" << file.fileName();
+        return false;
+    }
+    
+    QJsonObject obj = doc.object();
+    if (obj["version"].toInt() != VERSION) {
+        return false;
+    }
+    
+    checkpoint.transferId = obj["transfer_id"].toString();
+    checkpoint.fileSize = obj["file_size"].toVariant().toLongLong();
+    checkpoint.chunkSize = obj["chunk_size"].toInt();
+    checkpoint.sourceModified = obj["source_modified"].toVariant().toLongLong();
+    
+    // The file must still be the one the checkpoint was written for
+    if (checkpoint.fileSize <= 0 || checkpoint.fileSize != request.fileSize) {
+        return false;
+    }
+    
+    QFileInfo fileInfo(request.localPath);
+    if (request.type == TransferType::Upload) {
+        if (fileInfo.lastModified().toMSecsSinceEpoch() != checkpoint.sourceModified) {
+            return false;
+        }
+    } else if (!fileInfo.exists()) {
+        return false;
+    }
+    
+    int totalChunks = static_cast<int>((checkpoint.fileSize + checkpoint.chunkSize - 1) / qMax(1, checkpoint.chunkSize));
+    checkpoint.completedChunks = decodeBitmap(obj["completed_chunks"].toString(), totalChunks);
+    checkpoint.chunkDigests = QByteArray::fromBase64(obj["chunk_digests"].toString().toLatin1());
+    
+    return checkpoint.chunkDigests.size() == static_cast<qsizetype>(totalChunks) * CHUNK_DIGEST_SIZE;
+}
+
+bool TransferCheckpoint::save(const FileTransferRequest &request) const
+{
+    QString path = pathFor(request);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    
+    QJsonObject obj;
+    obj["version"] = VERSION;
+    obj["transfer_id"] = transferId;
+    obj["file_size"] = fileSize;
+    obj["chunk_size"] = chunkSize;
+    obj["source_modified"] = sourceModified;
+    obj["completed_chunks"] = encodeBitmap(completedChunks);
+    obj["chunk_digests"] = QString::fromLatin1(chunkDigests.toBase64());
+    
+    // Replace atomically, a torn checkpoint would be worse than an old one
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write checkpoint" << path << ":" << file.errorString();
+        return false;
+    }
+    
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void TransferCheckpoint::remove(const FileTransferRequest &request)
+{
+    QFile::remove(pathFor(request));
+}
+
+QString TransferCheckpoint::pathFor(const FileTransferRequest &request)
+{
+    if (request.type == TransferType::Download) {
+        return request.localPath + CHECKPOINT_SUFFIX;
+    }
+    
+    // Upload sources may sit in read-only directories
+    QByteArray key = QCryptographicHash::hash(QFileInfo(request.localPath).absoluteFilePath().toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+           "/checkpoints/" + QString::fromLatin1(key) + CHECKPOINT_SUFFIX;
+}
+
+QString TransferCheckpoint::encodeBitmap(const QBitArray &bitmap)
+{
+    return QString::fromLatin1(QByteArray::fromRawData(bitmap.bits(), (bitmap.size() + 7) / 8).toBase64());
+}
+
+QBitArray TransferCheckpoint::decodeBitmap(const QString &encoded, int size)
+{
+    QByteArray bits = QByteArray::fromBase64(encoded.toLatin1());
+    if (size <= 0 || bits.size() < (size + 7) / 8) {
+        return QBitArray(qMax(0, size));
+    }
+    
+    return QBitArray::fromBits(bits.constData(), size);
+}
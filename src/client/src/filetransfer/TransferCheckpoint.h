@@ -0,0 +1,46 @@
+#ifndef TRANSFERCHECKPOINT_H
+#define TRANSFERCHECKPOINT_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QString>
+#include "FileTransferManager.h"
+
+// Persisted resume state of a transfer.
+//
+// Download checkpoints live next to the partial file, upload checkpoints in
+// the application data directory. Both are keyed by the local path rather
+// than the transfer id so that a transfer requested again after a client
+// restart picks up where the previous one stopped.
+//
+// Every completed chunk keeps its CRC32C so the partial file can be checked
+// before it is trusted: chunks that were lost in a crash (or changed on disk)
+// fail the check and are transferred again.
+class TransferCheckpoint
+{
+public:
+    static const int VERSION = 1;
+    static const int CHUNK_DIGEST_SIZE = 4;
+    
+    TransferCheckpoint();
+    
+    QString transferId;      // Transfer that wrote the checkpoint
+    qint64 fileSize;
+    int chunkSize;
+    qint64 sourceModified;   // Upload source mtime (ms since epoch)
+    QBitArray completedChunks;
+    QByteArray chunkDigests; // CHUNK_DIGEST_SIZE bytes per chunk
+    
+    // Loads the checkpoint for the request, false if there is none or it no
+    // longer matches the file
+    static bool load(const FileTransferRequest &request, TransferCheckpoint &checkpoint);
+    bool save(const FileTransferRequest &request) const;
+    static void remove(const FileTransferRequest &request);
+    static QString pathFor(const FileTransferRequest &request);
+    
+    // Compact bitmap encoding shared with the transfer_resume message
+    static QString encodeBitmap(const QBitArray &bitmap);
+    static QBitArray decodeBitmap(const QString &encoded, int size);
+};
+
+#endif // TRANSFERCHECKPOINT_H
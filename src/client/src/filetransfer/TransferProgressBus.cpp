@@ -0,0 +1,154 @@
+#include "TransferProgressBus.h"
+#include <QDateTime>
+#include <cmath>
+
+// Weight of the newest window rate in the displayed speed
+static const double SPEED_WEIGHT = 0.3;
+
+TransferProgressBus::TransferProgressBus(QObject *parent)
+    : QObject(parent)
+{
+    m_tickTimer.setInterval(DEFAULT_TICK_INTERVAL);
+    connect(&m_tickTimer, &QTimer::timeout, this, [this]() {
+        sample(m_clock.elapsed());
+    });
+    m_clock.start();
+}
+
+std::shared_ptr<ProgressCounters> TransferProgressBus::attach(const QString &transferId)
+{
+    auto it = m_entries.find(transferId);
+    if (it != m_entries.end()) {
+        return it->counters;
+    }
+    
+    Entry entry;
+    entry.counters = std::make_shared<ProgressCounters>();
+    entry.newestSample = 0;
+    entry.sampleCount = 0;
+    entry.speed = 0;
+    entry.etaRate = 0;
+    entry.progress = FileTransferProgress{};
+    entry.progress.transferId = transferId;
+    entry.progress.compressionRatio = 1.0;
+    entry.progress.status = TransferStatus::Pending;
+    entry.progress.startTime = QDateTime::currentDateTime();
+    m_entries.insert(transferId, entry);
+    
+    if (!m_tickTimer.isActive()) {
+        m_tickTimer.start();
+    }
+    return entry.counters;
+}
+
+void TransferProgressBus::detach(const QString &transferId)
+{
+    m_entries.remove(transferId);
+    if (m_entries.isEmpty()) {
+        m_tickTimer.stop();
+    }
+}
+
+bool TransferProgressBus::isAttached(const QString &transferId) const
+{
+    return m_entries.contains(transferId);
+}
+
+int TransferProgressBus::getTransferCount() const
+{
+    return m_entries.size();
+}
+
+void TransferProgressBus::setTickInterval(int ms)
+{
+    m_tickTimer.setInterval(qMax(10, ms));
+}
+
+int TransferProgressBus::getTickInterval() const
+{
+    return m_tickTimer.interval();
+}
+
+FileTransferProgress TransferProgressBus::getProgress(const QString &transferId) const
+{
+    auto it = m_entries.constFind(transferId);
+    return it != m_entries.cend() ? it->progress : FileTransferProgress{};
+}
+
+void TransferProgressBus::sample(qint64 nowMs)
+{
+    QList<FileTransferProgress> updates;
+    QDateTime tickTime;
+    
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        Entry &entry = it.value();
+        const ProgressCounters &counters = *entry.counters;
+        qint64 bytes = counters.bytesTransferred.load(std::memory_order_relaxed);
+        qint64 sentBytes = qMax<qint64>(0, bytes - counters.skippedBytes.load(std::memory_order_relaxed));
+        qint64 totalBytes = counters.totalBytes.load(std::memory_order_relaxed);
+        TransferStatus status = counters.status.load(std::memory_order_relaxed);
+        
+        // A transfer that is not moving, or restarted from zero, starts a new window
+        if (status != TransferStatus::InProgress ||
+            (entry.sampleCount > 0 && sentBytes < entry.samples[entry.newestSample].bytes)) {
+            entry.sampleCount = 0;
+            entry.speed = 0;
+            entry.etaRate = 0;
+        }
+        
+        if (status == TransferStatus::InProgress) {
+            // The oldest sample is overwritten once the window is full
+            entry.newestSample = (entry.newestSample + 1) % SPEED_WINDOW;
+            entry.samples[entry.newestSample] = Sample{nowMs, sentBytes};
+            entry.sampleCount = qMin(entry.sampleCount + 1, static_cast<int>(SPEED_WINDOW));
+            
+            const Sample &oldest = entry.samples[(entry.newestSample + SPEED_WINDOW - entry.sampleCount + 1) % SPEED_WINDOW];
+            if (nowMs > oldest.time) {
+                double rate = (sentBytes - oldest.bytes) * 1000.0 / (nowMs - oldest.time);
+                if (rate <= 0 || entry.sampleCount == 2) {
+                    entry.speed = rate; // Nothing moved for a whole window, or the first rate
+                } else {
+                    entry.speed += SPEED_WEIGHT * (rate - entry.speed);
+                }
+                
+                // Weighted by the time since the previous tick, stalls included
+                const Sample &previous = entry.samples[(entry.newestSample + SPEED_WINDOW - 1) % SPEED_WINDOW];
+                if (entry.sampleCount == 2) {
+                    entry.etaRate = rate;
+                } else if (entry.sampleCount > 2 && nowMs > previous.time) {
+                    double tickRate = (sentBytes - previous.bytes) * 1000.0 / (nowMs - previous.time);
+                    double weight = 1.0 - std::exp(-static_cast<double>(nowMs - previous.time) / ETA_TIME_CONSTANT_MS);
+                    entry.etaRate += weight * (tickRate - entry.etaRate);
+                }
+            }
+        }
+        
+        qint64 speed = static_cast<qint64>(entry.speed);
+        int completedFiles = counters.completedFiles.load(std::memory_order_relaxed);
+        FileTransferProgress &progress = entry.progress;
+        if (bytes == progress.bytesTransferred && totalBytes == progress.totalBytes && speed == progress.speed &&
+            status == progress.status && completedFiles == progress.completedFiles) {
+            continue;
+        }
+        
+        if (!tickTime.isValid()) {
+            tickTime = QDateTime::currentDateTime();
+        }
+        progress.bytesTransferred = bytes;
+        progress.totalBytes = totalBytes;
+        progress.percentage = totalBytes > 0 ? bytes * 100.0 / totalBytes : 0.0;
+        progress.speed = speed;
+        qint64 etaRate = static_cast<qint64>(entry.etaRate);
+        progress.remainingTime = etaRate > 0 ? qMax<qint64>(0, totalBytes - bytes) / etaRate : 0;
+        progress.compressionRatio = counters.compressionRatio.load(std::memory_order_relaxed);
+        progress.completedFiles = completedFiles;
+        progress.totalFiles = counters.totalFiles.load(std::memory_order_relaxed);
+        progress.status = status;
+        progress.lastUpdateTime = tickTime;
+        updates.append(progress);
+    }
+    
+    if (!updates.isEmpty()) {
+        emit progressBatch(updates);
+    }
+}
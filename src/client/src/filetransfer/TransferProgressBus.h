@@ -0,0 +1,90 @@
+#ifndef TRANSFERPROGRESSBUS_H
+#define TRANSFERPROGRESSBUS_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <atomic>
+#include <array>
+#include <memory>
+#include "FileTransferManager.h"
+
+// Progress of one transfer, written by whichever thread moves its chunks
+// and read by the bus tick without taking a lock
+struct ProgressCounters {
+    std::atomic<qint64> bytesTransferred{0};
+    std::atomic<qint64> skippedBytes{0}; // Part of bytesTransferred never sent
+    std::atomic<qint64> totalBytes{0};
+    std::atomic<int> completedFiles{0};
+    std::atomic<int> totalFiles{0};
+    std::atomic<double> compressionRatio{1.0};
+    std::atomic<TransferStatus> status{TransferStatus::Pending};
+};
+
+// Collects the progress of every attached transfer on one GUI-side tick.
+//
+// Sessions publish into their ProgressCounters as chunks complete. Each
+// tick reads all counters once, works out speed and ETA and emits a single
+// progressBatch() carrying the transfers that changed, so the number of
+// timers and signals no longer grows with the number of transfers.
+//
+// Speed is the rate over the last SPEED_WINDOW ticks, kept in a ring
+// buffer per transfer, smoothed by an exponentially weighted average.
+// The ETA uses a separate average with a time constant of
+// ETA_TIME_CONSTANT_MS, so it holds steady over multi-hour transfers
+// that the displayed speed follows closely. Skipped bytes (holes,
+// deduplicated or resumed chunks) count towards progress but not rates.
+// The tick only runs while transfers are attached.
+class TransferProgressBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_TICK_INTERVAL = 250; // ms
+    static const int SPEED_WINDOW = 8;            // ticks
+    static const int ETA_TIME_CONSTANT_MS = 60000;
+    
+    explicit TransferProgressBus(QObject *parent = nullptr);
+    
+    // The counters outlive detach() for writers that still hold them
+    std::shared_ptr<ProgressCounters> attach(const QString &transferId);
+    void detach(const QString &transferId);
+    bool isAttached(const QString &transferId) const;
+    int getTransferCount() const;
+    
+    void setTickInterval(int ms);
+    int getTickInterval() const;
+    
+    // As of the last tick, with speed and ETA
+    FileTransferProgress getProgress(const QString &transferId) const;
+    
+    // One tick; normally driven by the timer
+    void sample(qint64 nowMs);
+
+signals:
+    void progressBatch(const QList<FileTransferProgress> &updates);
+
+private:
+    struct Sample {
+        qint64 time;
+        qint64 bytes;
+    };
+    
+    struct Entry {
+        std::shared_ptr<ProgressCounters> counters;
+        std::array<Sample, SPEED_WINDOW> samples;
+        int newestSample;
+        int sampleCount;
+        double speed;
+        double etaRate;
+        FileTransferProgress progress;
+    };
+    
+    QHash<QString, Entry> m_entries;
+    QTimer m_tickTimer;
+    QElapsedTimer m_clock;
+};
+
+#endif // TRANSFERPROGRESSBUS_H
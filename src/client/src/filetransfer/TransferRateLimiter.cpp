@@ -0,0 +1,201 @@
+#include "TransferRateLimiter.h"
+
+// Tokens a full bucket holds, in milliseconds of its rate
+static const int BURST_MS = 100;
+
+// Weight of the newest round trip
+static const double RTT_WEIGHT = 0.25;
+
+// The lowest round trip is taken over this and the previous window, so a
+// route change that raises it is picked up within two windows
+static const qint64 BASE_RTT_WINDOW_MS = 60000; // 1 minute
+
+// Back off by 30% at most once a second, recover by 10% a sample
+static const double YIELD_DECREASE = 0.7;
+static const double YIELD_INCREASE = 1.1;
+static const qint64 YIELD_DECREASE_INTERVAL_MS = 1000;
+
+TransferRateLimiter::TransferRateLimiter()
+    : m_rateLimit(0)
+    , m_transferRateLimit(0)
+    , m_yieldEnabled(false)
+    , m_globalBucket{0, -1}
+    , m_rtt(0)
+    , m_windowMinRtt(0)
+    , m_previousMinRtt(0)
+    , m_windowStart(-1)
+    , m_lastSampleTime(-1)
+    , m_grantedBytes(0)
+    , m_yieldRate(0)
+    , m_lastDecrease(-1)
+{
+}
+
+void TransferRateLimiter::setRateLimit(qint64 bytesPerSecond)
+{
+    m_rateLimit = qMax<qint64>(0, bytesPerSecond);
+}
+
+qint64 TransferRateLimiter::getRateLimit() const
+{
+    return m_rateLimit;
+}
+
+void TransferRateLimiter::setTransferRateLimit(qint64 bytesPerSecond)
+{
+    m_transferRateLimit = qMax<qint64>(0, bytesPerSecond);
+}
+
+qint64 TransferRateLimiter::getTransferRateLimit() const
+{
+    return m_transferRateLimit;
+}
+
+void TransferRateLimiter::setYieldEnabled(bool enabled)
+{
+    m_yieldEnabled = enabled;
+    if (!enabled) {
+        m_yieldRate = 0;
+    }
+}
+
+bool TransferRateLimiter::isYieldEnabled() const
+{
+    return m_yieldEnabled;
+}
+
+qint64 TransferRateLimiter::getEffectiveRate() const
+{
+    return isYielding() ? m_yieldRate : m_rateLimit;
+}
+
+bool TransferRateLimiter::isYielding() const
+{
+    return m_yieldRate > 0 && (m_rateLimit == 0 || m_yieldRate < m_rateLimit);
+}
+
+qint64 TransferRateLimiter::reserve(const QString &transferId, qint64 bytes, qint64 nowMs)
+{
+    qint64 globalRate = getEffectiveRate();
+    refill(m_globalBucket, globalRate, nowMs);
+    
+    Bucket *transferBucket = nullptr;
+    if (m_transferRateLimit > 0) {
+        auto it = m_transferBuckets.find(transferId);
+        if (it == m_transferBuckets.end()) {
+            it = m_transferBuckets.insert(transferId, Bucket{0, -1});
+        }
+        transferBucket = &it.value();
+        refill(*transferBucket, m_transferRateLimit, nowMs);
+    }
+    
+    qint64 wait = waitTime(m_globalBucket, globalRate);
+    if (transferBucket) {
+        wait = qMax(wait, waitTime(*transferBucket, m_transferRateLimit));
+    }
+    if (wait > 0) {
+        return wait;
+    }
+    
+    if (globalRate > 0) {
+        m_globalBucket.tokens -= bytes * 1000;
+    }
+    if (transferBucket) {
+        transferBucket->tokens -= bytes * 1000;
+    }
+    m_grantedBytes += bytes;
+    return 0;
+}
+
+void TransferRateLimiter::recordLatency(qint64 rttMs, qint64 nowMs)
+{
+    if (rttMs <= 0) {
+        return;
+    }
+    
+    m_rtt = m_rtt > 0 ? m_rtt + RTT_WEIGHT * (rttMs - m_rtt) : rttMs;
+    if (m_windowStart < 0 || nowMs - m_windowStart >= BASE_RTT_WINDOW_MS) {
+        m_previousMinRtt = m_windowMinRtt;
+        m_windowMinRtt = rttMs;
+        m_windowStart = nowMs;
+    } else {
+        m_windowMinRtt = qMin(m_windowMinRtt, rttMs);
+    }
+    
+    if (m_yieldEnabled) {
+        updateYieldRate(nowMs);
+    }
+    
+    m_lastSampleTime = nowMs;
+    m_grantedBytes = 0;
+}
+
+void TransferRateLimiter::removeTransfer(const QString &transferId)
+{
+    m_transferBuckets.remove(transferId);
+}
+
+void TransferRateLimiter::reset()
+{
+    m_globalBucket = Bucket{0, -1};
+    m_transferBuckets.clear();
+    m_rtt = 0;
+    m_windowMinRtt = 0;
+    m_previousMinRtt = 0;
+    m_windowStart = -1;
+    m_lastSampleTime = -1;
+    m_grantedBytes = 0;
+    m_yieldRate = 0;
+    m_lastDecrease = -1;
+}
+
+void TransferRateLimiter::refill(Bucket &bucket, qint64 rate, qint64 nowMs)
+{
+    if (rate <= 0) {
+        return;
+    }
+    
+    // New buckets start full
+    qint64 burst = rate * BURST_MS;
+    if (bucket.lastRefill < 0) {
+        bucket.tokens = burst;
+    } else if (nowMs > bucket.lastRefill) {
+        bucket.tokens = qMin(burst, bucket.tokens + rate * (nowMs - bucket.lastRefill));
+    }
+    bucket.lastRefill = qMax(bucket.lastRefill, nowMs);
+}
+
+qint64 TransferRateLimiter::waitTime(const Bucket &bucket, qint64 rate)
+{
+    if (rate <= 0 || bucket.tokens >= 0) {
+        return 0;
+    }
+    return (-bucket.tokens + rate - 1) / rate;
+}
+
+void TransferRateLimiter::updateYieldRate(qint64 nowMs)
+{
+    qint64 elapsed = nowMs - m_lastSampleTime;
+    if (m_lastSampleTime < 0 || elapsed <= 0) {
+        return;
+    }
+    qint64 rate = m_grantedBytes * 1000 / elapsed;
+    qint64 baseRtt = m_previousMinRtt > 0 ? qMin(m_previousMinRtt, m_windowMinRtt) : m_windowMinRtt;
+    
+    if (m_rtt - baseRtt > QUEUE_DELAY_TARGET_MS) {
+        // Only traffic we passed can have queued, and the queue needs time to drain
+        if (m_grantedBytes == 0 || (m_lastDecrease >= 0 && nowMs - m_lastDecrease < YIELD_DECREASE_INTERVAL_MS)) {
+            return;
+        }
+        qint64 current = m_yieldRate > 0 ? qMin(m_yieldRate, rate) : rate;
+        m_yieldRate = qMax(static_cast<qint64>(MIN_YIELD_RATE), static_cast<qint64>(current * YIELD_DECREASE));
+        m_lastDecrease = nowMs;
+    } else if (m_yieldRate > 0) {
+        m_yieldRate = static_cast<qint64>(m_yieldRate * YIELD_INCREASE) + 1;
+        
+        // Lifted once it no longer holds traffic back
+        if (m_yieldRate > 2 * rate) {
+            m_yieldRate = 0;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef TRANSFERRATELIMITER_H
+#define TRANSFERRATELIMITER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+
+// Token buckets that shape chunk data in one direction.
+//
+// A global bucket caps all transfers together and a bucket per transfer
+// caps each one; a chunk goes out once both hold tokens and then takes its
+// full size from them, so a bucket may run into debt by up to one chunk
+// and stays empty until that is repaid. This keeps the shaping exact for
+// chunks larger than a bucket's burst.
+//
+// With yielding enabled the global rate also backs off when round trips
+// rise above the lowest seen recently, the queueing delay that would
+// otherwise slow the interactive session sharing the link, and creeps back
+// up once they fall again.
+//
+// Rates are bytes per second, 0 for no limit. Time is passed in by the
+// caller in milliseconds. Not thread safe.
+class TransferRateLimiter
+{
+public:
+    static const qint64 MIN_YIELD_RATE = 32 * 1024; // 32KB/s
+    static const int QUEUE_DELAY_TARGET_MS = 50;
+    
+    TransferRateLimiter();
+    
+    void setRateLimit(qint64 bytesPerSecond);
+    qint64 getRateLimit() const;
+    void setTransferRateLimit(qint64 bytesPerSecond);
+    qint64 getTransferRateLimit() const;
+    void setYieldEnabled(bool enabled);
+    bool isYieldEnabled() const;
+    
+    // Global rate in force, the configured one lowered while yielding
+    qint64 getEffectiveRate() const;
+    bool isYielding() const;
+    
+    // Takes the tokens and returns 0 when the chunk may go now, otherwise
+    // leaves the buckets alone and returns the milliseconds to wait
+    qint64 reserve(const QString &transferId, qint64 bytes, qint64 nowMs);
+    
+    // Round trip of a chunk in this direction
+    void recordLatency(qint64 rttMs, qint64 nowMs);
+    
+    void removeTransfer(const QString &transferId);
+    void reset();
+
+private:
+    struct Bucket {
+        qint64 tokens; // thousandths of a byte, exact at any rate
+        qint64 lastRefill;
+    };
+    
+    static void refill(Bucket &bucket, qint64 rate, qint64 nowMs);
+    static qint64 waitTime(const Bucket &bucket, qint64 rate);
+    void updateYieldRate(qint64 nowMs);
+    
+    qint64 m_rateLimit;
+    qint64 m_transferRateLimit;
+    bool m_yieldEnabled;
+    
+    Bucket m_globalBucket;
+    QHash<QString, Bucket> m_transferBuckets;
+    
+    // Yielding: smoothed RTT against the minimum of this and the last
+    // window, and the bytes granted since the previous sample
+    double m_rtt;
+    qint64 m_windowMinRtt;
+    qint64 m_previousMinRtt;
+    qint64 m_windowStart;
+    qint64 m_lastSampleTime;
+    qint64 m_grantedBytes;
+    qint64 m_yieldRate;
+    qint64 m_lastDecrease;
+};
+
+#endif // TRANSFERRATELIMITER_H
@@ -0,0 +1,269 @@
+#include "TransferStreamPool.h"
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QTimer>
+#include <algorithm>
+#include <QDebug>
+
+// Dropped streams stay open a little so chunks already queued on them get out
+static const int STREAM_DRAIN_DELAY = 2000; // 2 seconds
+
+// Throughput changes smaller than this count as no change
+static const double THROUGHPUT_CHANGE_THRESHOLD = 0.05; // 5%
+
+// Steady state samples before probing with another stream again
+static const int PROBE_INTERVAL_SAMPLES = 15;
+
+TransferStreamPool::TransferStreamPool(QObject *parent)
+    : QObject(parent)
+    , m_isOpen(false)
+    , m_grantedStreams(0)
+    , m_maxStreams(DEFAULT_MAX_STREAMS)
+    , m_targetStreams(0)
+    , m_nextStreamId(1)
+    , m_lastThroughput(0)
+    , m_step(0)
+    , m_heldSamples(0)
+{
+}
+
+TransferStreamPool::~TransferStreamPool()
+{
+    close();
+}
+
+void TransferStreamPool::open(const QUrl &url, const QString &sessionId, const QString &token, int maxStreams)
+{
+    close();
+    
+    m_url = url;
+    m_sessionId = sessionId;
+    m_token = token;
+    m_grantedStreams = qBound(0, maxStreams, static_cast<int>(MAX_STREAMS));
+    if (m_grantedStreams == 0) {
+        return;
+    }
+    
+    // Start with one data stream, striping earns the others
+    m_isOpen = true;
+    m_targetStreams = 1;
+    m_lastThroughput = 0;
+    m_step = 0;
+    m_heldSamples = PROBE_INTERVAL_SAMPLES;
+    rebalance();
+}
+
+void TransferStreamPool::close()
+{
+    bool hadStreams = !m_attached.isEmpty();
+    
+    m_isOpen = false;
+    m_targetStreams = 0;
+    m_attached.clear();
+    for (const auto &stream : m_streams) {
+        stream->socket->disconnect(this);
+        stream->socket->close();
+    }
+    m_streams.clear();
+    
+    if (hadStreams) {
+        emit streamCountChanged(0);
+    }
+}
+
+bool TransferStreamPool::isOpen() const
+{
+    return m_isOpen;
+}
+
+void TransferStreamPool::setMaxStreams(int streams)
+{
+    m_maxStreams = qBound(1, streams, static_cast<int>(MAX_STREAMS));
+    if (m_isOpen && m_targetStreams > qMin(m_maxStreams, m_grantedStreams)) {
+        m_targetStreams = qMin(m_maxStreams, m_grantedStreams);
+        rebalance();
+    }
+}
+
+int TransferStreamPool::getMaxStreams() const
+{
+    return m_maxStreams;
+}
+
+int TransferStreamPool::getStreamCount() const
+{
+    return m_attached.size();
+}
+
+int TransferStreamPool::getTargetStreamCount() const
+{
+    return m_targetStreams;
+}
+
+QWebSocket *TransferStreamPool::streamFor(int chunkIndex, bool striped) const
+{
+    if (m_attached.isEmpty()) {
+        return nullptr;
+    }
+    
+    // Chunks carry their index, so the receiver does not care which stream
+    // a stripe arrived on or that the mapping moves when streams come and go
+    int stream = striped ? (chunkIndex / STRIPE_CHUNKS) % m_attached.size() : 0;
+    return m_attached.at(stream)->socket.get();
+}
+
+void TransferStreamPool::sampleThroughput(qint64 bytesPerSecond, bool striping)
+{
+    qint64 previous = m_lastThroughput;
+    m_lastThroughput = bytesPerSecond;
+    
+    if (!m_isOpen) {
+        return;
+    }
+    
+    // Without striping only lost streams are replaced
+    if (!striping) {
+        rebalance();
+        return;
+    }
+    
+    // Keep a stream that raised throughput, give back one that did not, and
+    // step back the other way when throughput drops; once steady, probe
+    // with one more stream every PROBE_INTERVAL_SAMPLES
+    if (previous > 0) {
+        double change = static_cast<double>(bytesPerSecond - previous) / previous;
+        if (change < -THROUGHPUT_CHANGE_THRESHOLD) {
+            m_step = m_step > 0 ? -1 : 1;
+        } else if (change <= THROUGHPUT_CHANGE_THRESHOLD) {
+            m_step = m_step > 0 ? -1 : 0;
+        }
+    }
+    
+    if (m_step == 0 && ++m_heldSamples >= PROBE_INTERVAL_SAMPLES) {
+        m_step = 1;
+    }
+    if (m_step != 0) {
+        m_heldSamples = 0;
+    }
+    
+    int limit = qMin(m_maxStreams, m_grantedStreams);
+    int target = qBound(1, m_targetStreams + m_step, limit);
+    if (target == m_targetStreams) {
+        m_step = 0;
+    } else {
+        qDebug() << "Data streams" << m_targetStreams << "->" << target << "at" << bytesPerSecond << "bytes/s";
+        m_targetStreams = target;
+    }
+    
+    // Also replaces streams that were lost
+    rebalance();
+}
+
+void TransferStreamPool::rebalance()
+{
+    while (static_cast<int>(m_streams.size()) < m_targetStreams) {
+        addStream();
+    }
+    while (static_cast<int>(m_streams.size()) > m_targetStreams) {
+        dropStream();
+    }
+}
+
+void TransferStreamPool::addStream()
+{
+    auto stream = std::make_unique<Stream>();
+    stream->socket = std::make_unique<QWebSocket>();
+    stream->id = m_nextStreamId++;
+    stream->attached = false;
+    
+    Stream *raw = stream.get();
+    QWebSocket *socket = stream->socket.get();
+    connect(socket, &QWebSocket::connected, this, [this, raw]() {
+        onStreamConnected(raw);
+    });
+    connect(socket, &QWebSocket::disconnected, this, [this, raw]() {
+        onStreamDisconnected(raw);
+    });
+    connect(socket, &QWebSocket::textMessageReceived, this, [this, raw](const QString &message) {
+        onStreamTextMessage(raw, message);
+    });
+    connect(socket, &QWebSocket::binaryMessageReceived, this, &TransferStreamPool::binaryMessageReceived);
+    
+    m_streams.push_back(std::move(stream));
+    socket->open(m_url);
+}
+
+void TransferStreamPool::dropStream()
+{
+    // Newest first, the oldest streams have the widest TCP windows
+    std::unique_ptr<Stream> stream = std::move(m_streams.back());
+    m_streams.pop_back();
+    
+    if (m_attached.removeOne(stream.get())) {
+        emit streamCountChanged(m_attached.size());
+    }
+    
+    // No new chunks are sent on it, late arrivals are still delivered
+    QWebSocket *socket = stream->socket.release();
+    socket->disconnect(this);
+    socket->setParent(this);
+    connect(socket, &QWebSocket::binaryMessageReceived, this, &TransferStreamPool::binaryMessageReceived);
+    connect(socket, &QWebSocket::textMessageReceived, this, &TransferStreamPool::textMessageReceived);
+    QTimer::singleShot(STREAM_DRAIN_DELAY, socket, [socket]() {
+        socket->close();
+        socket->deleteLater();
+    });
+}
+
+void TransferStreamPool::onStreamConnected(Stream *stream)
+{
+    QJsonObject message;
+    message["type"] = "stream_attach";
+    message["session_id"] = m_sessionId;
+    message["stream_token"] = m_token;
+    message["stream_id"] = stream->id;
+    stream->socket->sendTextMessage(QJsonDocument(message).toJson(QJsonDocument::Compact));
+}
+
+void TransferStreamPool::onStreamDisconnected(Stream *stream)
+{
+    auto it = std::find_if(m_streams.begin(), m_streams.end(), [stream](const std::unique_ptr<Stream> &candidate) {
+        return candidate.get() == stream;
+    });
+    if (it == m_streams.end()) {
+        return;
+    }
+    
+    // A stream that never attached was refused, do not ask for it again
+    if (!stream->attached) {
+        qWarning() << "Data stream" << stream->id << "was refused by the server";
+        m_grantedStreams = qMax(0, static_cast<int>(m_streams.size()) - 1);
+        m_targetStreams = qMin(m_targetStreams, m_grantedStreams);
+        m_isOpen = m_grantedStreams > 0;
+    } else if (m_attached.removeOne(stream)) {
+        qWarning() << "Data stream" << stream->id << "lost";
+        emit streamCountChanged(m_attached.size());
+    }
+    
+    // Destroyed once its signal handlers have returned
+    QWebSocket *socket = (*it)->socket.release();
+    socket->disconnect(this);
+    socket->deleteLater();
+    m_streams.erase(it);
+}
+
+void TransferStreamPool::onStreamTextMessage(Stream *stream, const QString &message)
+{
+    if (!stream->attached) {
+        QJsonObject reply = QJsonDocument::fromJson(message.toUtf8()).object();
+        if (reply["type"].toString() == "stream_attached" && reply["stream_id"].toInt() == stream->id) {
+            stream->attached = true;
+            m_attached.append(stream);
+            qDebug() << "Data stream" << stream->id << "attached (" << m_attached.size() << "open )";
+            emit streamCountChanged(m_attached.size());
+            return;
+        }
+    }
+    
+    emit textMessageReceived(message);
+}
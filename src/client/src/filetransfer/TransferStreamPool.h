@@ -0,0 +1,89 @@
+#ifndef TRANSFERSTREAMPOOL_H
+#define TRANSFERSTREAMPOOL_H
+
+#include <QObject>
+#include <QWebSocket>
+#include <QUrl>
+#include <QList>
+#include <memory>
+#include <vector>
+
+// Extra WebSocket connections that carry chunk data next to the control socket.
+//
+// Once open, chunks no longer share a connection with control messages, so
+// a large upload cannot hold up pause or cancel. Transfers of at least
+// STRIPE_MIN_SIZE are striped: runs of STRIPE_CHUNKS consecutive chunks go
+// round-robin over every attached stream, which keeps one lost segment from
+// stalling the whole transfer and lets high-BDP links use several TCP
+// windows. Smaller transfers stay on the first stream.
+//
+// Each stream attaches to the registered session with the token the server
+// handed out. The number of streams follows measured throughput: a stream is
+// kept while adding it paid off and dropped when it did not.
+class TransferStreamPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MAX_STREAMS = 8;
+    static const int DEFAULT_MAX_STREAMS = 4;
+    static const int STRIPE_CHUNKS = 16;
+    static const qint64 STRIPE_MIN_SIZE = 32 * 1024 * 1024; // 32MB
+    
+    explicit TransferStreamPool(QObject *parent = nullptr);
+    ~TransferStreamPool();
+    
+    // maxStreams is what the server granted, capped by setMaxStreams()
+    void open(const QUrl &url, const QString &sessionId, const QString &token, int maxStreams);
+    void close();
+    bool isOpen() const;
+    
+    void setMaxStreams(int streams);
+    int getMaxStreams() const;
+    int getStreamCount() const;   // attached streams
+    int getTargetStreamCount() const;
+    
+    // Socket for an outgoing chunk, nullptr while no stream is attached
+    QWebSocket *streamFor(int chunkIndex, bool striped) const;
+    
+    // Aggregate throughput of the last sampling period; streams are only
+    // tuned while a striped transfer is running
+    void sampleThroughput(qint64 bytesPerSecond, bool striping);
+
+signals:
+    void binaryMessageReceived(const QByteArray &data);
+    void textMessageReceived(const QString &message);
+    void streamCountChanged(int streams);
+
+private:
+    struct Stream {
+        std::unique_ptr<QWebSocket> socket;
+        int id;
+        bool attached;
+    };
+    
+    void rebalance();
+    void addStream();
+    void dropStream();
+    void onStreamConnected(Stream *stream);
+    void onStreamDisconnected(Stream *stream);
+    void onStreamTextMessage(Stream *stream, const QString &message);
+    
+    QUrl m_url;
+    QString m_sessionId;
+    QString m_token;
+    bool m_isOpen;
+    int m_grantedStreams;
+    int m_maxStreams;
+    int m_targetStreams;
+    int m_nextStreamId;
+    std::vector<std::unique_ptr<Stream>> m_streams;
+    QList<Stream *> m_attached; // In attach order, chunks are striped over these
+    
+    // Throughput hill climbing
+    qint64 m_lastThroughput;
+    int m_step;
+    int m_heldSamples;
+};
+
+#endif // TRANSFERSTREAMPOOL_H
@@ -0,0 +1,316 @@
+#include "TransferTelemetry.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QtAlgorithms>
+#include <QDebug>
+
+static const char *const COUNTER_NAMES[TransferTelemetry::COUNTER_COUNT] = {
+    "chunks_sent", "chunks_received", "retransmits", "timeouts", "checksum_failures"
+};
+
+static const char *const QUEUE_NAMES[TransferTelemetry::QUEUE_COUNT] = {
+    "send_queue", "send_backlog", "in_flight", "chunk_requests"
+};
+
+template <typename T>
+static T readAtomic(std::atomic<T> &value, bool reset)
+{
+    return reset ? value.exchange(0, std::memory_order_relaxed) : value.load(std::memory_order_relaxed);
+}
+
+// Upper bound of the bucket holding the given share of the samples
+static qint64 percentile(const std::array<quint64, TransferTelemetry::BUCKET_COUNT> &buckets, quint64 count, double share)
+{
+    quint64 rank = static_cast<quint64>(count * share);
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < TransferTelemetry::BUCKET_COUNT; ++bucket) {
+        seen += buckets[bucket];
+        if (seen > rank) {
+            return qint64(1) << bucket;
+        }
+    }
+    return qint64(1) << (TransferTelemetry::BUCKET_COUNT - 1);
+}
+
+TransferTelemetry::TransferTelemetry()
+    : m_enabled(false)
+    , m_tracing(false)
+    , m_periodStart(0)
+    , m_traceNext(0)
+{
+    m_clock.start();
+}
+
+void TransferTelemetry::setEnabled(bool enabled)
+{
+    m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool TransferTelemetry::isEnabled() const
+{
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+void TransferTelemetry::setTracingEnabled(bool enabled)
+{
+    m_tracing.store(enabled, std::memory_order_relaxed);
+}
+
+bool TransferTelemetry::isTracingEnabled() const
+{
+    return m_tracing.load(std::memory_order_relaxed);
+}
+
+qint64 TransferTelemetry::now() const
+{
+    if (!m_enabled.load(std::memory_order_relaxed)) {
+        return -1;
+    }
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+void TransferTelemetry::recordStage(Stage stage, qint64 start, const QString &transferId, int chunkIndex)
+{
+    // Started while disabled, or disabled since
+    if (start < 0 || !m_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    
+    qint64 duration = qMax<qint64>(0, m_clock.nsecsElapsed() / 1000 - start);
+    Histogram &histogram = m_stages[static_cast<int>(stage)];
+    histogram.buckets[bucketFor(duration)].fetch_add(1, std::memory_order_relaxed);
+    histogram.totalUs.fetch_add(static_cast<quint64>(duration), std::memory_order_relaxed);
+    
+    qint64 max = histogram.maxUs.load(std::memory_order_relaxed);
+    while (duration > max && !histogram.maxUs.compare_exchange_weak(max, duration, std::memory_order_relaxed)) {
+    }
+    
+    if (m_tracing.load(std::memory_order_relaxed)) {
+        appendTrace(stage, start, duration, transferId, chunkIndex);
+    }
+}
+
+void TransferTelemetry::increment(Counter counter, int count)
+{
+    if (!m_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    m_counters[static_cast<int>(counter)].fetch_add(static_cast<quint64>(count), std::memory_order_relaxed);
+}
+
+void TransferTelemetry::recordQueueDepth(Queue queue, qint64 depth)
+{
+    if (!m_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    
+    QueueDepth &entry = m_queues[static_cast<int>(queue)];
+    entry.last.store(depth, std::memory_order_relaxed);
+    qint64 max = entry.max.load(std::memory_order_relaxed);
+    while (depth > max && !entry.max.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {
+    }
+}
+
+QJsonObject TransferTelemetry::takeStats()
+{
+    return collectStats(true);
+}
+
+QJsonObject TransferTelemetry::getStats() const
+{
+    // Reading only, nothing is reset
+    return const_cast<TransferTelemetry *>(this)->collectStats(false);
+}
+
+void TransferTelemetry::reset()
+{
+    collectStats(true);
+}
+
+QJsonObject TransferTelemetry::getTraceEvents() const
+{
+    QMutexLocker locker(&m_traceMutex);
+    
+    QJsonArray events;
+    qint64 pid = QCoreApplication::applicationPid();
+    for (int i = 0; i < m_traceEvents.size(); ++i) {
+        const TraceEvent &event = m_traceEvents.at((m_traceNext + i) % m_traceEvents.size());
+        
+        QJsonObject args;
+        args["transfer_id"] = event.transferId;
+        args["chunk_index"] = event.chunkIndex;
+        
+        // Complete events, timestamps and durations in us
+        QJsonObject entry;
+        entry["name"] = stageName(event.stage);
+        entry["cat"] = "filetransfer";
+        entry["ph"] = "X";
+        entry["ts"] = event.start;
+        entry["dur"] = event.duration;
+        entry["pid"] = pid;
+        entry["tid"] = static_cast<qint64>(event.threadId);
+        entry["args"] = args;
+        events.append(entry);
+    }
+    
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+    return trace;
+}
+
+bool TransferTelemetry::writeTrace(const QString &filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to open trace file:" << filePath << file.errorString();
+        return false;
+    }
+    
+    QByteArray json = QJsonDocument(getTraceEvents()).toJson(QJsonDocument::Compact);
+    if (file.write(json) != json.size()) {
+        qWarning() << "Failed to write trace file:" << filePath << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void TransferTelemetry::clearTrace()
+{
+    QMutexLocker locker(&m_traceMutex);
+    m_traceEvents.clear();
+    m_traceNext = 0;
+}
+
+bool TransferTelemetry::isLogSampled(int chunkIndex, int totalChunks)
+{
+    return chunkIndex % LOG_SAMPLE_INTERVAL == 0 || chunkIndex == totalChunks - 1;
+}
+
+QString TransferTelemetry::stageName(Stage stage)
+{
+    switch (stage) {
+        case Stage::Read:
+            return "read";
+        case Stage::Hash:
+            return "hash";
+        case Stage::Frame:
+            return "frame";
+        case Stage::Send:
+            return "send";
+        case Stage::AckRtt:
+            return "ack_rtt";
+        case Stage::Write:
+            return "write";
+    }
+    return QString();
+}
+
+int TransferTelemetry::bucketFor(qint64 durationUs)
+{
+    // Bit width: 0 for 0us, b for [2^(b-1), 2^b)
+    if (durationUs <= 0) {
+        return 0;
+    }
+    int width = 64 - qCountLeadingZeroBits(static_cast<quint64>(durationUs));
+    return qMin(width, BUCKET_COUNT - 1);
+}
+
+QJsonObject TransferTelemetry::collectStats(bool reset)
+{
+    QJsonObject stages;
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        Histogram &histogram = m_stages[i];
+        
+        std::array<quint64, BUCKET_COUNT> buckets;
+        quint64 count = 0;
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            buckets[bucket] = readAtomic(histogram.buckets[bucket], reset);
+            count += buckets[bucket];
+        }
+        
+        // Sums are read separately, close enough for a stats period
+        quint64 totalUs = readAtomic(histogram.totalUs, reset);
+        qint64 maxUs = readAtomic(histogram.maxUs, reset);
+        if (count == 0) {
+            continue;
+        }
+        
+        // Trailing empty buckets are left out
+        int used = BUCKET_COUNT;
+        while (used > 0 && buckets[used - 1] == 0) {
+            --used;
+        }
+        QJsonArray bucketArray;
+        for (int bucket = 0; bucket < used; ++bucket) {
+            bucketArray.append(static_cast<qint64>(buckets[bucket]));
+        }
+        
+        QJsonObject stage;
+        stage["count"] = static_cast<qint64>(count);
+        stage["mean_us"] = static_cast<qint64>(totalUs / count);
+        stage["p50_us"] = percentile(buckets, count, 0.5);
+        stage["p90_us"] = percentile(buckets, count, 0.9);
+        stage["p99_us"] = percentile(buckets, count, 0.99);
+        stage["max_us"] = maxUs;
+        stage["buckets"] = bucketArray;
+        stages[stageName(static_cast<Stage>(i))] = stage;
+    }
+    
+    QJsonObject counters;
+    bool counted = false;
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        quint64 value = readAtomic(m_counters[i], reset);
+        counters[COUNTER_NAMES[i]] = static_cast<qint64>(value);
+        counted = counted || value > 0;
+    }
+    
+    // The level stays, the peak starts over from it
+    QJsonObject queues;
+    for (int i = 0; i < QUEUE_COUNT; ++i) {
+        qint64 last = m_queues[i].last.load(std::memory_order_relaxed);
+        qint64 max = reset ? m_queues[i].max.exchange(last, std::memory_order_relaxed)
+                           : m_queues[i].max.load(std::memory_order_relaxed);
+        
+        QJsonObject queue;
+        queue["current"] = last;
+        queue["max"] = max;
+        queues[QUEUE_NAMES[i]] = queue;
+    }
+    
+    qint64 nowMs = m_clock.elapsed();
+    qint64 periodMs = nowMs - m_periodStart;
+    if (reset) {
+        m_periodStart = nowMs;
+    }
+    
+    if (stages.isEmpty() && !counted) {
+        return QJsonObject();
+    }
+    
+    QJsonObject stats;
+    stats["period_ms"] = periodMs;
+    stats["bucket_unit"] = "log2_us";
+    stats["stages"] = stages;
+    stats["counters"] = counters;
+    stats["queues"] = queues;
+    return stats;
+}
+
+void TransferTelemetry::appendTrace(Stage stage, qint64 start, qint64 duration, const QString &transferId, int chunkIndex)
+{
+    TraceEvent event{stage, start, duration, reinterpret_cast<quintptr>(QThread::currentThreadId()), transferId, chunkIndex};
+    
+    QMutexLocker locker(&m_traceMutex);
+    if (m_traceEvents.size() < MAX_TRACE_EVENTS) {
+        m_traceEvents.append(event);
+        return;
+    }
+    
+    // Full, the oldest event makes room
+    m_traceEvents[m_traceNext] = event;
+    m_traceNext = (m_traceNext + 1) % MAX_TRACE_EVENTS;
+}
@@ -0,0 +1,130 @@
+#ifndef TRANSFERTELEMETRY_H
+#define TRANSFERTELEMETRY_H
+
+#include <QString>
+#include <QList>
+#include <QMutex>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <atomic>
+#include <array>
+
+// Pipeline instrumentation shared by the manager, sessions and workers.
+//
+// Every chunk stage (read, hash, frame, send, ack round trip, write) is
+// timed into a log2 histogram of microseconds; retransmits, timeouts and
+// checksum failures are counted and queue depths sampled. Writers on any
+// thread only touch atomics. Disabled, now() returns -1 without reading
+// the clock and every record call returns on that, so the hot path pays
+// one relaxed load per stage.
+//
+// Tracing additionally keeps the last MAX_TRACE_EVENTS timed stages as
+// Chrome trace events (chrome://tracing, Perfetto); it takes a lock per
+// event and is meant for diagnosing a single slow transfer.
+class TransferTelemetry
+{
+public:
+    enum class Stage {
+        Read,   // File or bundle read of an upload chunk
+        Hash,   // Chunk and file digests
+        Frame,  // Compression, sealing and header encode or decode
+        Send,   // Hand-off of a frame to the socket
+        AckRtt, // Chunk sent to ack, or request to chunk, first sends only
+        Write   // Buffered write of a download chunk, syncs included
+    };
+    static const int STAGE_COUNT = 6;
+    
+    enum class Counter {
+        ChunksSent,
+        ChunksReceived,
+        Retransmits,
+        Timeouts,
+        ChecksumFailures
+    };
+    static const int COUNTER_COUNT = 5;
+    
+    enum class Queue {
+        SendQueue,     // Frames waiting in the manager's send queues
+        SendBacklog,   // Bytes handed to sockets and not yet written
+        InFlight,      // Chunks of a transfer awaiting ack or data
+        ChunkRequests  // Download requests held back by the rate limit
+    };
+    static const int QUEUE_COUNT = 4;
+    
+    // Bucket b counts durations below 2^b us, the last one is open ended
+    static const int BUCKET_COUNT = 32;
+    static const int MAX_TRACE_EVENTS = 65536;
+    static const int LOG_SAMPLE_INTERVAL = 256; // chunks
+    
+    TransferTelemetry();
+    
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setTracingEnabled(bool enabled);
+    bool isTracingEnabled() const;
+    
+    // Stage start in us on the telemetry clock, -1 while disabled
+    qint64 now() const;
+    // Stage that began at start, measured up to now
+    void recordStage(Stage stage, qint64 start, const QString &transferId, int chunkIndex);
+    void increment(Counter counter, int count = 1);
+    void recordQueueDepth(Queue queue, qint64 depth);
+    
+    // Histograms, counters and queue depths since the last takeStats(), as
+    // the body of a transfer_stats message; empty if nothing was recorded
+    QJsonObject takeStats();
+    QJsonObject getStats() const;
+    void reset();
+    
+    // Recorded trace events, oldest first, in the Chrome trace format
+    QJsonObject getTraceEvents() const;
+    bool writeTrace(const QString &filePath) const;
+    void clearTrace();
+    
+    // Per-chunk debug output is limited to the first, the last and every
+    // LOG_SAMPLE_INTERVAL-th chunk of a transfer
+    static bool isLogSampled(int chunkIndex, int totalChunks);
+    
+    static QString stageName(Stage stage);
+    static int bucketFor(qint64 durationUs);
+
+private:
+    struct Histogram {
+        std::array<std::atomic<quint64>, BUCKET_COUNT> buckets{};
+        std::atomic<quint64> totalUs{0};
+        std::atomic<qint64> maxUs{0};
+    };
+    
+    struct QueueDepth {
+        std::atomic<qint64> last{0};
+        std::atomic<qint64> max{0};
+    };
+    
+    struct TraceEvent {
+        Stage stage;
+        qint64 start;
+        qint64 duration;
+        quintptr threadId;
+        QString transferId;
+        int chunkIndex;
+    };
+    
+    QJsonObject collectStats(bool reset);
+    void appendTrace(Stage stage, qint64 start, qint64 duration, const QString &transferId, int chunkIndex);
+    
+    std::atomic<bool> m_enabled;
+    std::atomic<bool> m_tracing;
+    QElapsedTimer m_clock;
+    qint64 m_periodStart; // ms on m_clock, changed by takeStats() only
+    
+    std::array<Histogram, STAGE_COUNT> m_stages;
+    std::array<std::atomic<quint64>, COUNTER_COUNT> m_counters{};
+    std::array<QueueDepth, QUEUE_COUNT> m_queues;
+    
+    // Ring buffer of trace events, m_traceNext is the oldest once full
+    QList<TraceEvent> m_traceEvents;
+    int m_traceNext;
+    mutable QMutex m_traceMutex;
+};
+
+#endif // TRANSFERTELEMETRY_H
@@ -0,0 +1,95 @@
+#include "TransferThreadPool.h"
+#include <QDebug>
+
+// Transfers are mostly waiting on the network, a few threads cover many
+static const int MIN_POOL_THREADS = 2;
+static const int MAX_POOL_THREADS = 8;
+static const int THREAD_SHUTDOWN_TIMEOUT = 5000; // 5 seconds
+
+TransferThreadPool::TransferThreadPool(int threadCount, QObject *parent)
+    : QObject(parent)
+    , m_threadCount(threadCount > 0 ? threadCount : qBound(MIN_POOL_THREADS, QThread::idealThreadCount(), MAX_POOL_THREADS))
+{
+}
+
+TransferThreadPool::~TransferThreadPool()
+{
+    shutdown();
+}
+
+int TransferThreadPool::getThreadCount() const
+{
+    return m_threadCount;
+}
+
+int TransferThreadPool::getActiveThreadCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_threads.size();
+}
+
+int TransferThreadPool::getWorkerCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    
+    int count = 0;
+    for (int workers : m_workerCounts) {
+        count += workers;
+    }
+    return count;
+}
+
+QThread *TransferThreadPool::acquireThread()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // Least loaded running thread
+    QThread *thread = nullptr;
+    for (QThread *candidate : m_threads) {
+        if (!thread || m_workerCounts.value(candidate) < m_workerCounts.value(thread)) {
+            thread = candidate;
+        }
+    }
+    
+    // Start another thread rather than doubling up while the pool has room
+    if ((!thread || m_workerCounts.value(thread) > 0) && m_threads.size() < m_threadCount) {
+        thread = new QThread(this);
+        thread->setObjectName(QString("FileTransfer-%1").arg(m_threads.size()));
+        thread->start();
+        m_threads.append(thread);
+        
+        qDebug() << "Transfer thread started:" << thread->objectName();
+    }
+    
+    m_workerCounts[thread]++;
+    return thread;
+}
+
+void TransferThreadPool::releaseThread(QThread *thread)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto it = m_workerCounts.find(thread);
+    if (it != m_workerCounts.end() && it.value() > 0) {
+        it.value()--;
+    }
+}
+
+void TransferThreadPool::shutdown()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // Objects still scheduled for deletion are destroyed as each thread finishes
+    for (QThread *thread : m_threads) {
+        thread->quit();
+        if (!thread->wait(THREAD_SHUTDOWN_TIMEOUT)) {
+            qWarning() << "Transfer thread did not stop in time:" << thread->objectName();
+        }
+    }
+    
+    qDeleteAll(m_threads);
+    m_threads.clear();
+    m_workerCounts.clear();
+}
+
+#include "TransferThreadPool.moc"
@@ -0,0 +1,40 @@
+#ifndef TRANSFERTHREADPOOL_H
+#define TRANSFERTHREADPOOL_H
+
+#include <QObject>
+#include <QThread>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+
+// Fixed set of threads shared by all transfer workers. Workers are event
+// driven, so each thread multiplexes many of them; a new worker is placed
+// on the thread currently serving the fewest transfers.
+class TransferThreadPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    // threadCount <= 0 sizes the pool from the number of cores
+    explicit TransferThreadPool(int threadCount = 0, QObject *parent = nullptr);
+    ~TransferThreadPool();
+    
+    int getThreadCount() const;
+    int getActiveThreadCount() const;
+    int getWorkerCount() const;
+    
+    // Threads are started lazily, up to the pool size
+    QThread *acquireThread();
+    void releaseThread(QThread *thread);
+    
+    void shutdown();
+
+private:
+    int m_threadCount;
+    QList<QThread *> m_threads;
+    QHash<QThread *, int> m_workerCounts;
+    
+    mutable QMutex m_mutex;
+};
+
+#endif // TRANSFERTHREADPOOL_H
@@ -24,7 +24,6 @@ ProgressWidget::ProgressWidget(const QString &transferId, const QString &filePat
     , m_bytesTransferred(0)
     , m_transferSpeed(0)
     , m_status(Pending)
-    , m_lastBytesTransferred(0)
     , m_mainLayout(nullptr)
     , m_topLayout(nullptr)
     , m_bottomLayout(nullptr)
@@ -43,7 +42,6 @@ ProgressWidget::ProgressWidget(const QString &transferId, const QString &filePat
     , m_cancelBtn(nullptr)
     , m_retryBtn(nullptr)
     , m_removeBtn(nullptr)
-    , m_updateTimer(new QTimer(this))
 {
     QFileInfo fileInfo(filePath);
     m_fileName = fileInfo.fileName();
@@ -51,26 +49,17 @@ ProgressWidget::ProgressWidget(const QString &transferId, const QString &filePat
     
     m_startTime = QDateTime::currentDateTime();
     m_lastUpdateTime = m_startTime;
-    m_lastSpeedUpdate = m_startTime;
     m_elapsedTimer.start();
     
     setupUI();
     connectSignals();
     
-    // Setup update timer
-    m_updateTimer->setInterval(UPDATE_INTERVAL);
-    connect(m_updateTimer, &QTimer::timeout, this, &ProgressWidget::updateDisplay);
-    m_updateTimer->start();
-    
     updateDisplay();
     updateButtonStates();
 }
 
 ProgressWidget::~ProgressWidget()
 {
-    if (m_updateTimer) {
-        m_updateTimer->stop();
-    }
 }
 
 void ProgressWidget::setupUI()
@@ -229,7 +218,8 @@ void ProgressWidget::connectSignals()
 void ProgressWidget::updateProgress(const FileTransferProgress &progress)
 {
     m_bytesTransferred = progress.bytesTransferred;
-    m_totalSize = progress.totalSize;
+    m_totalSize = progress.totalBytes;
+    m_transferSpeed = progress.speed;
     
     // Calculate progress percentage
     int percentage = 0;
@@ -239,34 +229,7 @@ void ProgressWidget::updateProgress(const FileTransferProgress &progress)
     
     m_progressBar->setValue(percentage);
     
-    // Update speed calculation
-    QDateTime currentTime = QDateTime::currentDateTime();
-    qint64 timeDiff = m_lastSpeedUpdate.msecsTo(currentTime);
-    
-    if (timeDiff >= 1000) { // Update speed every second
-        qint64 bytesDiff = m_bytesTransferred - m_lastBytesTransferred;
-        if (timeDiff > 0) {
-            m_transferSpeed = (bytesDiff * 1000) / timeDiff; // bytes per second
-            
-            // Add to speed history for smoothing
-            m_speedHistory.append(m_transferSpeed);
-            if (m_speedHistory.size() > SPEED_HISTORY_SIZE) {
-                m_speedHistory.removeFirst();
-            }
-            
-            // Calculate average speed
-            qint64 totalSpeed = 0;
-            for (qint64 speed : m_speedHistory) {
-                totalSpeed += speed;
-            }
-            m_transferSpeed = totalSpeed / m_speedHistory.size();
-        }
-        
-        m_lastBytesTransferred = m_bytesTransferred;
-        m_lastSpeedUpdate = currentTime;
-    }
-    
-    m_lastUpdateTime = currentTime;
+    m_lastUpdateTime = QDateTime::currentDateTime();
     
     if (m_status != Active) {
         m_status = Active;
@@ -286,10 +249,6 @@ void ProgressWidget::setCompleted()
     updateStatusDisplay();
     updateButtonStates();
     updateDisplay();
-    
-    if (m_updateTimer) {
-        m_updateTimer->stop();
-    }
 }
 
 void ProgressWidget::setFailed(const QString &errorMessage)
@@ -301,10 +260,6 @@ void ProgressWidget::setFailed(const QString &errorMessage)
     updateStatusDisplay();
     updateButtonStates();
     updateDisplay();
-    
-    if (m_updateTimer) {
-        m_updateTimer->stop();
-    }
 }
 
 void ProgressWidget::setCancelled()
@@ -315,10 +270,6 @@ void ProgressWidget::setCancelled()
     updateStatusDisplay();
     updateButtonStates();
     updateDisplay();
-    
-    if (m_updateTimer) {
-        m_updateTimer->stop();
-    }
 }
 
 void ProgressWidget::setPaused()
@@ -338,10 +289,6 @@ void ProgressWidget::setResumed()
     updateStatusDisplay();
     updateButtonStates();
     updateDisplay();
-    
-    if (m_updateTimer && !m_updateTimer->isActive()) {
-        m_updateTimer->start();
-    }
 }
 
 void ProgressWidget::reset()
@@ -350,12 +297,9 @@ void ProgressWidget::reset()
     m_transferSpeed = 0;
     m_status = Pending;
     m_errorMessage.clear();
-    m_speedHistory.clear();
     
     m_startTime = QDateTime::currentDateTime();
     m_lastUpdateTime = m_startTime;
-    m_lastSpeedUpdate = m_startTime;
-    m_lastBytesTransferred = 0;
     m_elapsedTimer.restart();
     
     m_progressBar->setValue(0);
@@ -363,10 +307,6 @@ void ProgressWidget::reset()
     updateStatusDisplay();
     updateButtonStates();
     updateDisplay();
-    
-    if (m_updateTimer && !m_updateTimer->isActive()) {
-        m_updateTimer->start();
-    }
 }
 
 void ProgressWidget::onPauseClicked()
@@ -103,7 +103,7 @@ public:
 public slots:
     /**
      * @brief Update transfer progress
-     * @param progress Progress information
+     * @param progress Progress information, speed and ETA as smoothed by the progress bus
      */
     void updateProgress(const FileTransferProgress &progress);
 
@@ -291,12 +291,6 @@ private:
     QDateTime m_lastUpdateTime;
     QElapsedTimer m_elapsedTimer;
     
-    // Speed calculation
-    qint64 m_lastBytesTransferred;
-    QDateTime m_lastSpeedUpdate;
-    QList<qint64> m_speedHistory;
-    static const int SPEED_HISTORY_SIZE = 10;
-    
     // UI components
     QVBoxLayout *m_mainLayout;
     QHBoxLayout *m_topLayout;
@@ -323,11 +317,7 @@ private:
     QPushButton *m_retryBtn;
     QPushButton *m_removeBtn;
     
-    // Update timer
-    QTimer *m_updateTimer;
-    
     // Constants
-    static const int UPDATE_INTERVAL = 1000; // 1 second
     static const int PROGRESS_BAR_HEIGHT = 20;
     static const int BUTTON_SIZE = 24;
 };
@@ -1,11 +1,16 @@
 #include "transfer_dialog.h"
-#include "progress_widget.h"
+#include "transfer_list_model.h"
+#include "transfer_item_delegate.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QFileInfo>
 #include <QDir>
+#include <QDirIterator>
+#include <QStyle>
 #include <QMimeData>
-#include <QScrollArea>
+#include <QListView>
+#include <QMenu>
+#include <QClipboard>
 #include <QSettings>
 #include <QCloseEvent>
 #include <QResizeEvent>
@@ -20,10 +25,53 @@
 #include <QDebug>
 
 // Constants
-static const int DEFAULT_CHUNK_SIZE = 64 * 1024; // 64KB
 static const int DEFAULT_MAX_CONCURRENT = 3;
-static const int UPDATE_INTERVAL = 1000; // 1 second
-static const qint64 MAX_FILE_SIZE = 100 * 1024 * 1024; // 100MB
+static const qint64 MAX_FILE_SIZE = 100 * 1024 * 1024; // 100MB, without a manager
+static const int MAX_BANDWIDTH_LIMIT_KB = 1024 * 1024; // 1GB/s
+
+// Background validation failures arriving within this window are shown together
+static const int VALIDATION_ERROR_DELAY = 500; // ms
+
+// Small files are sent together as one bundle transfer
+static const qint64 BUNDLE_MAX_FILE_SIZE = 1024 * 1024; // 1MB
+static const int BUNDLE_MIN_FILES = 8;
+
+// Every readable file below a folder, subfolders included
+static QStringList collectFolderFiles(const QString &folderPath)
+{
+    QStringList filePaths;
+    QDirIterator it(folderPath, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        filePaths.append(QFileInfo(it.next()).absoluteFilePath());
+    }
+    return filePaths;
+}
+
+// Deepest folder holding all of the files
+static QString commonFolder(const QStringList &filePaths)
+{
+    QString common = QFileInfo(filePaths.first()).absolutePath();
+    for (const QString &filePath : filePaths) {
+        QString folder = QFileInfo(filePath).absolutePath();
+        while (folder != common && !folder.startsWith(common.endsWith('/') ? common : common + '/')) {
+            QString parent = QFileInfo(common).path();
+            if (parent == common) {
+                break;
+            }
+            common = parent;
+        }
+    }
+    return common;
+}
+
+// Folder of a file, or a bundle's root folder itself
+static void openFileLocation(const QString &filePath)
+{
+    QFileInfo fileInfo(filePath);
+    if (fileInfo.exists()) {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(fileInfo.isDir() ? fileInfo.absoluteFilePath() : fileInfo.absolutePath()));
+    }
+}
 
 TransferDialog::TransferDialog(FileTransferManager *manager, const QString &sessionId, 
                              const QString &technician, QWidget *parent)
@@ -41,9 +89,10 @@ TransferDialog::TransferDialog(FileTransferManager *manager, const QString &sess
     , m_clearBtn(nullptr)
     , m_dropLabel(nullptr)
     , m_progressGroup(nullptr)
-    , m_progressScrollArea(nullptr)
-    , m_progressContainer(nullptr)
-    , m_progressLayout(nullptr)
+    , m_transferView(nullptr)
+    , m_transferModel(nullptr)
+    , m_transferDelegate(nullptr)
+    , m_clearFinishedBtn(nullptr)
     , m_controlsGroup(nullptr)
     , m_startBtn(nullptr)
     , m_pauseAllBtn(nullptr)
@@ -52,6 +101,9 @@ TransferDialog::TransferDialog(FileTransferManager *manager, const QString &sess
     , m_settingsGroup(nullptr)
     , m_chunkSizeSpinBox(nullptr)
     , m_maxConcurrentSpinBox(nullptr)
+    , m_bandwidthLimitSpinBox(nullptr)
+    , m_transferLimitSpinBox(nullptr)
+    , m_yieldCheckBox(nullptr)
     , m_encryptionCheckBox(nullptr)
     , m_compressionComboBox(nullptr)
     , m_statusGroup(nullptr)
@@ -68,12 +120,14 @@ TransferDialog::TransferDialog(FileTransferManager *manager, const QString &sess
     , m_failedTransfers(0)
     , m_totalBytesTransferred(0)
     , m_overallSpeed(0)
-    , m_chunkSize(DEFAULT_CHUNK_SIZE)
+    , m_chunkSize(ChunkSizeTuner::DEFAULT_CHUNK_SIZE)
     , m_maxConcurrentTransfers(DEFAULT_MAX_CONCURRENT)
+    , m_bandwidthLimit(0)
+    , m_transferBandwidthLimit(0)
+    , m_yieldToInteractive(false)
     , m_encryptionEnabled(true)
     , m_compressionEnabled(false)
     , m_isTransferring(false)
-    , m_updateTimer(new QTimer(this))
 {
     setWindowTitle(tr("File Transfer - Session %1").arg(sessionId));
     setWindowIcon(QIcon(":/icons/file_transfer.png"));
@@ -87,11 +141,6 @@ TransferDialog::TransferDialog(FileTransferManager *manager, const QString &sess
     connectSignals();
     loadSettings();
     
-    // Setup update timer
-    m_updateTimer->setInterval(UPDATE_INTERVAL);
-    connect(m_updateTimer, &QTimer::timeout, this, &TransferDialog::updateStatistics);
-    m_updateTimer->start();
-    
     updateUI();
 }
 
@@ -184,18 +233,25 @@ void TransferDialog::setupProgressArea()
     m_progressGroup = new QGroupBox(tr("Transfer Progress"));
     QVBoxLayout *layout = new QVBoxLayout(m_progressGroup);
     
-    // Scroll area for progress widgets
-    m_progressScrollArea = new QScrollArea();
-    m_progressScrollArea->setWidgetResizable(true);
-    m_progressScrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    m_progressScrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    // One painted row per transfer, only the visible rows are drawn
+    m_transferModel = new TransferListModel(this);
+    m_transferDelegate = new TransferItemDelegate(this);
     
-    m_progressContainer = new QWidget();
-    m_progressLayout = new QVBoxLayout(m_progressContainer);
-    m_progressLayout->addStretch();
+    m_transferView = new QListView();
+    m_transferView->setModel(m_transferModel);
+    m_transferView->setItemDelegate(m_transferDelegate);
+    m_transferView->setUniformItemSizes(true);
+    m_transferView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_transferView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    m_transferView->setContextMenuPolicy(Qt::CustomContextMenu);
+    layout->addWidget(m_transferView);
     
-    m_progressScrollArea->setWidget(m_progressContainer);
-    layout->addWidget(m_progressScrollArea);
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    m_clearFinishedBtn = new QPushButton(tr("Clear Finished"));
+    m_clearFinishedBtn->setIcon(QIcon(":/icons/clear.png"));
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_clearFinishedBtn);
+    layout->addLayout(buttonLayout);
 }
 
 void TransferDialog::setupControlsArea()
@@ -224,11 +280,12 @@ void TransferDialog::setupSettingsArea()
     m_settingsGroup = new QGroupBox(tr("Transfer Settings"));
     QFormLayout *layout = new QFormLayout(m_settingsGroup);
     
-    // Chunk size
+    // Chunk size, the starting point of adaptive sizing
     m_chunkSizeSpinBox = new QSpinBox();
-    m_chunkSizeSpinBox->setRange(1, 1024);
+    m_chunkSizeSpinBox->setRange(ChunkSizeTuner::MIN_CHUNK_SIZE / 1024, ChunkSizeTuner::MAX_CHUNK_SIZE / 1024);
     m_chunkSizeSpinBox->setValue(m_chunkSize / 1024);
     m_chunkSizeSpinBox->setSuffix(" KB");
+    m_chunkSizeSpinBox->setToolTip(tr("Initial chunk size; later transfers adapt it to the measured connection"));
     layout->addRow(tr("Chunk Size:"), m_chunkSizeSpinBox);
     
     // Max concurrent transfers
@@ -237,6 +294,27 @@ void TransferDialog::setupSettingsArea()
     m_maxConcurrentSpinBox->setValue(m_maxConcurrentTransfers);
     layout->addRow(tr("Max Concurrent:"), m_maxConcurrentSpinBox);
     
+    // Bandwidth limits, for all transfers together and for each one
+    m_bandwidthLimitSpinBox = new QSpinBox();
+    m_bandwidthLimitSpinBox->setRange(0, MAX_BANDWIDTH_LIMIT_KB);
+    m_bandwidthLimitSpinBox->setValue(static_cast<int>(m_bandwidthLimit / 1024));
+    m_bandwidthLimitSpinBox->setSuffix(" KB/s");
+    m_bandwidthLimitSpinBox->setSpecialValueText(tr("Unlimited"));
+    layout->addRow(tr("Bandwidth Limit:"), m_bandwidthLimitSpinBox);
+    
+    m_transferLimitSpinBox = new QSpinBox();
+    m_transferLimitSpinBox->setRange(0, MAX_BANDWIDTH_LIMIT_KB);
+    m_transferLimitSpinBox->setValue(static_cast<int>(m_transferBandwidthLimit / 1024));
+    m_transferLimitSpinBox->setSuffix(" KB/s");
+    m_transferLimitSpinBox->setSpecialValueText(tr("Unlimited"));
+    layout->addRow(tr("Per Transfer Limit:"), m_transferLimitSpinBox);
+    
+    // Back off while transfers add latency to the remote session
+    m_yieldCheckBox = new QCheckBox(tr("Yield to Interactive Traffic"));
+    m_yieldCheckBox->setChecked(m_yieldToInteractive);
+    m_yieldCheckBox->setToolTip(tr("Slow transfers down while they delay the remote desktop session"));
+    layout->addRow(m_yieldCheckBox);
+    
     // Encryption
     m_encryptionCheckBox = new QCheckBox(tr("Enable Encryption"));
     m_encryptionCheckBox->setChecked(m_encryptionEnabled);
@@ -292,6 +370,12 @@ void TransferDialog::connectSignals()
             this, &TransferDialog::onChunkSizeChanged);
     connect(m_maxConcurrentSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
             this, &TransferDialog::onMaxConcurrentChanged);
+    connect(m_bandwidthLimitSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &TransferDialog::onBandwidthLimitChanged);
+    connect(m_transferLimitSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &TransferDialog::onTransferBandwidthLimitChanged);
+    connect(m_yieldCheckBox, &QCheckBox::toggled,
+            this, &TransferDialog::onYieldToggled);
     connect(m_encryptionCheckBox, &QCheckBox::toggled,
             this, &TransferDialog::onEncryptionToggled);
     connect(m_compressionComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
@@ -309,13 +393,27 @@ void TransferDialog::connectSignals()
                 this, &TransferDialog::onTransferApproved);
         connect(m_manager, &FileTransferManager::transferRejected,
                 this, &TransferDialog::onTransferRejected);
-        connect(m_manager, &FileTransferManager::transferProgress,
-                this, &TransferDialog::onTransferProgress);
+        connect(m_manager, &FileTransferManager::transferProgressBatch,
+                this, &TransferDialog::onTransferProgressBatch);
         connect(m_manager, &FileTransferManager::transferCompleted,
                 this, &TransferDialog::onTransferCompleted);
         connect(m_manager, &FileTransferManager::transferFailed,
                 this, &TransferDialog::onTransferFailed);
+        connect(m_manager, &FileTransferManager::transferCancelled,
+                this, &TransferDialog::onTransferCancelled);
+        connect(m_manager, &FileTransferManager::fileValidationFailed,
+                this, &TransferDialog::onFileValidationFailed);
     }
+    
+    // Transfer list
+    connect(m_transferDelegate, &TransferItemDelegate::pauseRequested, this, &TransferDialog::onPauseTransfer);
+    connect(m_transferDelegate, &TransferItemDelegate::resumeRequested, this, &TransferDialog::onResumeTransfer);
+    connect(m_transferDelegate, &TransferItemDelegate::cancelRequested, this, &TransferDialog::onCancelTransfer);
+    connect(m_transferDelegate, &TransferItemDelegate::retryRequested, this, &TransferDialog::onRetryTransfer);
+    connect(m_transferDelegate, &TransferItemDelegate::removeRequested, this, &TransferDialog::onRemoveTransfer);
+    connect(m_transferView, &QListView::customContextMenuRequested, this, &TransferDialog::onTransferContextMenu);
+    connect(m_transferView, &QListView::doubleClicked, this, &TransferDialog::onTransferDoubleClicked);
+    connect(m_clearFinishedBtn, &QPushButton::clicked, this, &TransferDialog::onClearFinished);
 }
 
 void TransferDialog::dragEnterEvent(QDragEnterEvent *event)
@@ -348,14 +446,7 @@ void TransferDialog::dropEvent(QDropEvent *event)
                     filePaths.append(filePath);
                 } else if (fileInfo.isDir()) {
                     // Add all files from directory
-                    QDir dir(filePath);
-                    QStringList filters;
-                    filters << "*.*";
-                    QFileInfoList fileList = dir.entryInfoList(filters, QDir::Files | QDir::Readable);
-                    
-                    for (const QFileInfo &info : fileList) {
-                        filePaths.append(info.absoluteFilePath());
-                    }
+                    filePaths.append(collectFolderFiles(filePath));
                 }
             }
         }
@@ -373,14 +464,21 @@ void TransferDialog::addFiles(const QStringList &filePaths)
     QStringList validFiles;
     QStringList errors;
     
+    // Only stat based checks here; the manager sniffs and hashes the new
+    // files in the background and reports those that fail
     if (validateFiles(filePaths, validFiles, errors)) {
+        QStringList addedFiles;
         for (const QString &filePath : validFiles) {
-            if (!m_selectedFiles.contains(filePath)) {
+            if (!m_fileItems.contains(filePath)) {
                 addFileToList(filePath);
                 m_selectedFiles.append(filePath);
+                addedFiles.append(filePath);
             }
         }
         
+        if (m_manager && !addedFiles.isEmpty()) {
+            m_manager->prevalidateFiles(addedFiles);
+        }
         updateUI();
     }
     
@@ -416,15 +514,7 @@ void TransferDialog::onBrowseFolder()
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation));
     
     if (!folderPath.isEmpty()) {
-        QDir dir(folderPath);
-        QStringList filters;
-        filters << "*.*";
-        QFileInfoList fileList = dir.entryInfoList(filters, QDir::Files | QDir::Readable);
-        
-        QStringList filePaths;
-        for (const QFileInfo &info : fileList) {
-            filePaths.append(info.absoluteFilePath());
-        }
+        QStringList filePaths = collectFolderFiles(folderPath);
         
         if (!filePaths.isEmpty()) {
             addFiles(filePaths);
@@ -453,15 +543,31 @@ void TransferDialog::startSelectedTransfers()
     
     m_isTransferring = true;
     
+    // Small files share one bundle transfer: one request, one approval, one worker
+    QStringList singleFiles;
+    QStringList bundledFiles;
     for (const QString &filePath : m_selectedFiles) {
+        if (QFileInfo(filePath).size() <= BUNDLE_MAX_FILE_SIZE) {
+            bundledFiles.append(filePath);
+        } else {
+            singleFiles.append(filePath);
+        }
+    }
+    
+    if (bundledFiles.size() >= BUNDLE_MIN_FILES && m_manager->isBundleTransferAvailable()) {
+        QString rootPath = commonFolder(bundledFiles);
+        QString transferId = m_manager->requestBundleUpload(rootPath, bundledFiles, m_sessionId, m_technician);
+        if (!transferId.isEmpty()) {
+            addTransferToList(transferId, rootPath, m_manager->getBundleFiles(transferId));
+            bundledFiles.clear();
+        }
+    }
+    singleFiles.append(bundledFiles);
+    
+    for (const QString &filePath : singleFiles) {
         QString transferId = m_manager->requestFileUpload(filePath, m_sessionId, m_technician);
         if (!transferId.isEmpty()) {
-            // Create progress widget for this transfer
-            ProgressWidget *progressWidget = new ProgressWidget(transferId, filePath, this);
-            m_progressWidgets[transferId] = progressWidget;
-            
-            // Insert before the stretch
-            m_progressLayout->insertWidget(m_progressLayout->count() - 1, progressWidget);
+            addTransferToList(transferId, filePath);
         }
     }
     
@@ -552,6 +658,9 @@ bool TransferDialog::validateFiles(const QStringList &filePaths, QStringList &va
     validFiles.clear();
     errors.clear();
     
+    // The manager's limit follows its large-file mode
+    qint64 maxFileSize = m_manager ? m_manager->getEffectiveMaxFileSize() : MAX_FILE_SIZE;
+    
     for (const QString &filePath : filePaths) {
         QFileInfo fileInfo(filePath);
         
@@ -570,9 +679,9 @@ bool TransferDialog::validateFiles(const QStringList &filePaths, QStringList &va
             continue;
         }
         
-        if (fileInfo.size() > MAX_FILE_SIZE) {
+        if (fileInfo.size() > maxFileSize) {
             errors.append(tr("File too large (max %1): %2")
-                         .arg(formatFileSize(MAX_FILE_SIZE))
+                         .arg(formatFileSize(maxFileSize))
                          .arg(filePath));
             continue;
         }
@@ -595,32 +704,101 @@ void TransferDialog::addFileToList(const QString &filePath)
     item->setToolTip(filePath);
     
     m_fileList->addItem(item);
+    m_fileItems.insert(filePath, item);
 }
 
-void TransferDialog::onTransferProgress(const QString &transferId, const FileTransferProgress &progress)
+void TransferDialog::removeFileFromList(const QString &filePath)
 {
-    if (ProgressWidget *widget = findProgressWidget(transferId)) {
-        widget->updateProgress(progress);
+    m_selectedFiles.removeAll(filePath);
+    delete m_fileItems.take(filePath);
+}
+
+void TransferDialog::onFileValidationFailed(const QString &filePath, const QString &reason)
+{
+    // Also reported for files left out of a bundle, they were not sent either
+    if (!m_fileItems.contains(filePath)) {
+        return;
     }
     
-    updateStatistics();
+    removeFileFromList(filePath);
+    updateUI();
+    
+    if (m_validationErrors.isEmpty()) {
+        QTimer::singleShot(VALIDATION_ERROR_DELAY, this, [this]() {
+            // Failures arriving while the box is open wait for the next one
+            QStringList errors;
+            errors.swap(m_validationErrors);
+            QMessageBox::warning(this, tr("File Validation Errors"), errors.join("\n"));
+        });
+    }
+    m_validationErrors.append(tr("%1: %2").arg(filePath, reason));
 }
 
-ProgressWidget* TransferDialog::findProgressWidget(const QString &transferId)
+void TransferDialog::addTransferToList(const QString &transferId, const QString &filePath, const QStringList &bundleFiles)
 {
-    return m_progressWidgets.value(transferId, nullptr);
+    qint64 totalBytes = 0;
+    if (bundleFiles.isEmpty()) {
+        totalBytes = QFileInfo(filePath).size();
+    } else {
+        for (const QString &bundleFile : bundleFiles) {
+            totalBytes += QFileInfo(bundleFile).size();
+        }
+        m_bundleFiles[transferId] = bundleFiles;
+        m_bundleCompletedFiles[transferId] = 0;
+    }
+    
+    m_transferModel->addTransfer(transferId, filePath, totalBytes);
+}
+
+void TransferDialog::markBundleFilesCompleted(const QString &transferId, int completedFiles)
+{
+    // Only the files completed since the last update are touched
+    const QStringList files = m_bundleFiles.value(transferId);
+    int alreadyCompleted = m_bundleCompletedFiles.value(transferId);
+    
+    for (int i = alreadyCompleted; i < qMin(completedFiles, static_cast<int>(files.size())); ++i) {
+        if (QListWidgetItem *item = m_fileItems.value(files.at(i))) {
+            item->setIcon(style()->standardIcon(QStyle::SP_DialogApplyButton));
+        }
+    }
+    
+    m_bundleCompletedFiles[transferId] = qMax(alreadyCompleted, completedFiles);
+}
+
+void TransferDialog::onTransferProgressBatch(const QList<FileTransferProgress> &updates)
+{
+    // The rows that changed are repainted, the rest of the list is untouched
+    m_transferModel->applyProgress(updates);
+    
+    for (const FileTransferProgress &progress : updates) {
+        if (progress.totalFiles > 0) {
+            markBundleFilesCompleted(progress.transferId, progress.completedFiles);
+        }
+        
+        // A batch only carries the transfers that changed, totals are kept as deltas
+        m_totalBytesTransferred += progress.bytesTransferred - m_transferBytes.value(progress.transferId);
+        m_transferBytes[progress.transferId] = progress.bytesTransferred;
+        m_overallSpeed += progress.speed - m_transferSpeeds.value(progress.transferId);
+        m_transferSpeeds[progress.transferId] = progress.speed;
+    }
+    
+    // Statistics are redrawn once per batch
+    updateStatistics();
 }
 
 void TransferDialog::onTransferCompleted(const QString &transferId, const QString &filePath)
 {
     Q_UNUSED(filePath)
     
-    if (ProgressWidget *widget = findProgressWidget(transferId)) {
-        widget->setCompleted();
+    m_transferModel->setStatus(transferId, TransferStatus::Completed);
+    
+    if (m_bundleFiles.contains(transferId)) {
+        markBundleFilesCompleted(transferId, m_bundleFiles[transferId].size());
     }
     
     m_completedTransfers++;
     m_activeTransfers--;
+    m_overallSpeed -= m_transferSpeeds.take(transferId);
     
     updateStatistics();
     updateButtonStates();
@@ -628,17 +806,156 @@ void TransferDialog::onTransferCompleted(const QString &transferId, const QStrin
 
 void TransferDialog::onTransferFailed(const QString &transferId, const QString &error)
 {
-    if (ProgressWidget *widget = findProgressWidget(transferId)) {
-        widget->setFailed(error);
-    }
+    m_transferModel->setStatus(transferId, TransferStatus::Failed, error);
     
     m_failedTransfers++;
     m_activeTransfers--;
+    m_overallSpeed -= m_transferSpeeds.take(transferId);
     
     updateStatistics();
     updateButtonStates();
 }
 
+void TransferDialog::onTransferCancelled(const QString &transferId)
+{
+    // Only approved transfers that had not finished were counted as active
+    TransferStatus status = static_cast<TransferStatus>(
+        m_transferModel->indexForTransfer(transferId).data(TransferListModel::StatusRole).toInt());
+    if (m_transferModel->containsTransfer(transferId) && status != TransferStatus::Pending &&
+        !TransferListModel::isFinished(status)) {
+        m_activeTransfers--;
+    }
+    
+    m_transferModel->setStatus(transferId, TransferStatus::Cancelled);
+    m_overallSpeed -= m_transferSpeeds.take(transferId);
+    
+    updateStatistics();
+    updateButtonStates();
+}
+
+void TransferDialog::onPauseTransfer(const QString &transferId)
+{
+    if (m_manager) {
+        m_manager->pauseTransfer(transferId);
+    }
+}
+
+void TransferDialog::onResumeTransfer(const QString &transferId)
+{
+    if (m_manager) {
+        m_manager->resumeTransfer(transferId);
+    }
+}
+
+void TransferDialog::onCancelTransfer(const QString &transferId)
+{
+    if (m_manager) {
+        m_manager->cancelTransfer(transferId);
+    }
+}
+
+void TransferDialog::onRetryTransfer(const QString &transferId)
+{
+    if (!m_manager || !m_manager->isConnected()) {
+        QMessageBox::warning(this, tr("Connection Error"), 
+                           tr("Not connected to transfer server."));
+        return;
+    }
+    
+    // A retry is a new request for the same file, or the same bundle
+    QString filePath = m_transferModel->indexForTransfer(transferId).data(TransferListModel::FilePathRole).toString();
+    QStringList bundleFiles = m_bundleFiles.value(transferId);
+    QString retryId = bundleFiles.isEmpty()
+        ? m_manager->requestFileUpload(filePath, m_sessionId, m_technician)
+        : m_manager->requestBundleUpload(filePath, bundleFiles, m_sessionId, m_technician);
+    if (retryId.isEmpty()) {
+        return;
+    }
+    
+    // The new request is counted as active once it is approved
+    TransferStatus status = static_cast<TransferStatus>(
+        m_transferModel->indexForTransfer(transferId).data(TransferListModel::StatusRole).toInt());
+    if (status == TransferStatus::Failed) {
+        m_failedTransfers--;
+    }
+    
+    onRemoveTransfer(transferId);
+    addTransferToList(retryId, filePath, bundleFiles);
+    m_isTransferring = true;
+    updateStatistics();
+    updateButtonStates();
+}
+
+void TransferDialog::onRemoveTransfer(const QString &transferId)
+{
+    m_transferModel->removeTransfer(transferId);
+    m_bundleFiles.remove(transferId);
+    m_bundleCompletedFiles.remove(transferId);
+    m_transferSpeeds.remove(transferId);
+}
+
+void TransferDialog::onClearFinished()
+{
+    for (const QString &transferId : m_transferModel->getTransferIds()) {
+        TransferStatus status = static_cast<TransferStatus>(
+            m_transferModel->indexForTransfer(transferId).data(TransferListModel::StatusRole).toInt());
+        if (TransferListModel::isFinished(status)) {
+            m_bundleFiles.remove(transferId);
+            m_bundleCompletedFiles.remove(transferId);
+            m_transferSpeeds.remove(transferId);
+        }
+    }
+    m_transferModel->removeFinishedTransfers();
+}
+
+void TransferDialog::onTransferContextMenu(const QPoint &pos)
+{
+    QModelIndex index = m_transferView->indexAt(pos);
+    if (!index.isValid()) {
+        return;
+    }
+    
+    QString transferId = index.data(TransferListModel::TransferIdRole).toString();
+    QString filePath = index.data(TransferListModel::FilePathRole).toString();
+    TransferStatus status = static_cast<TransferStatus>(index.data(TransferListModel::StatusRole).toInt());
+    
+    QMenu contextMenu(this);
+    QAction *copyPathAction = contextMenu.addAction(QIcon(":/icons/copy.png"), tr("Copy File Path"));
+    connect(copyPathAction, &QAction::triggered, this, [filePath]() {
+        QApplication::clipboard()->setText(filePath);
+    });
+    
+    if (status == TransferStatus::Completed) {
+        QAction *openLocationAction = contextMenu.addAction(QIcon(":/icons/folder.png"), tr("Open File Location"));
+        connect(openLocationAction, &QAction::triggered, this, [filePath]() {
+            openFileLocation(filePath);
+        });
+    }
+    
+    // The same actions as the row's buttons
+    contextMenu.addSeparator();
+    for (TransferItemDelegate::Action action : TransferItemDelegate::getActions(status)) {
+        QAction *menuAction = contextMenu.addAction(TransferItemDelegate::getActionIcon(action),
+                                                    TransferItemDelegate::getActionText(action));
+        connect(menuAction, &QAction::triggered, this, [this, action, transferId]() {
+            m_transferDelegate->triggerAction(action, transferId);
+        });
+    }
+    
+    contextMenu.exec(m_transferView->viewport()->mapToGlobal(pos));
+}
+
+void TransferDialog::onTransferDoubleClicked(const QModelIndex &index)
+{
+    // Open the file location of a completed transfer
+    TransferStatus status = static_cast<TransferStatus>(index.data(TransferListModel::StatusRole).toInt());
+    if (status != TransferStatus::Completed) {
+        return;
+    }
+    
+    openFileLocation(index.data(TransferListModel::FilePathRole).toString());
+}
+
 void TransferDialog::onTransferRequested(const QString &transferId, const FileTransferRequest &request)
 {
     m_transferRequests[transferId] = request;
@@ -674,6 +991,7 @@ void TransferDialog::showApprovalDialog(const QString &transferId, const FileTra
 
 void TransferDialog::onTransferApproved(const QString &transferId)
 {
+    m_transferModel->setStatus(transferId, TransferStatus::Approved);
     m_activeTransfers++;
     updateButtonStates();
 }
@@ -693,6 +1011,7 @@ void TransferDialog::onRemoveSelected()
     for (QListWidgetItem *item : selectedItems) {
         QString filePath = item->data(Qt::UserRole).toString();
         m_selectedFiles.removeAll(filePath);
+        m_fileItems.remove(filePath);
         delete item;
     }
     
@@ -702,33 +1021,34 @@ void TransferDialog::onRemoveSelected()
 void TransferDialog::onClearAll()
 {
     m_fileList->clear();
+    m_fileItems.clear();
     m_selectedFiles.clear();
     updateUI();
 }
 
 void TransferDialog::onPauseAll()
 {
-    for (auto it = m_progressWidgets.begin(); it != m_progressWidgets.end(); ++it) {
+    for (const QString &transferId : m_transferModel->getTransferIds()) {
         if (m_manager) {
-            m_manager->pauseTransfer(it.key());
+            m_manager->pauseTransfer(transferId);
         }
     }
 }
 
 void TransferDialog::onResumeAll()
 {
-    for (auto it = m_progressWidgets.begin(); it != m_progressWidgets.end(); ++it) {
+    for (const QString &transferId : m_transferModel->getTransferIds()) {
         if (m_manager) {
-            m_manager->resumeTransfer(it.key());
+            m_manager->resumeTransfer(transferId);
         }
     }
 }
 
 void TransferDialog::onCancelAll()
 {
-    for (auto it = m_progressWidgets.begin(); it != m_progressWidgets.end(); ++it) {
+    for (const QString &transferId : m_transferModel->getTransferIds()) {
         if (m_manager) {
-            m_manager->cancelTransfer(it.key());
+            m_manager->cancelTransfer(transferId);
         }
     }
     
@@ -752,6 +1072,30 @@ void TransferDialog::onMaxConcurrentChanged(int count)
     }
 }
 
+void TransferDialog::onBandwidthLimitChanged(int limit)
+{
+    m_bandwidthLimit = static_cast<qint64>(limit) * 1024; // Convert KB/s to bytes/s
+    if (m_manager) {
+        m_manager->setBandwidthLimit(m_bandwidthLimit);
+    }
+}
+
+void TransferDialog::onTransferBandwidthLimitChanged(int limit)
+{
+    m_transferBandwidthLimit = static_cast<qint64>(limit) * 1024;
+    if (m_manager) {
+        m_manager->setTransferBandwidthLimit(m_transferBandwidthLimit);
+    }
+}
+
+void TransferDialog::onYieldToggled(bool enabled)
+{
+    m_yieldToInteractive = enabled;
+    if (m_manager) {
+        m_manager->setYieldToInteractiveEnabled(enabled);
+    }
+}
+
 void TransferDialog::onEncryptionToggled(bool enabled)
 {
     m_encryptionEnabled = enabled;
@@ -771,11 +1115,19 @@ void TransferDialog::loadSettings()
     QSettings settings;
     settings.beginGroup("FileTransfer");
     
-    m_chunkSize = settings.value("chunkSize", DEFAULT_CHUNK_SIZE).toInt();
+    m_chunkSize = settings.value("chunkSize", ChunkSizeTuner::DEFAULT_CHUNK_SIZE).toInt();
     m_maxConcurrentTransfers = settings.value("maxConcurrent", DEFAULT_MAX_CONCURRENT).toInt();
+    m_bandwidthLimit = settings.value("bandwidthLimit", 0).toLongLong();
+    m_transferBandwidthLimit = settings.value("transferBandwidthLimit", 0).toLongLong();
+    m_yieldToInteractive = settings.value("yieldToInteractive", false).toBool();
     m_encryptionEnabled = settings.value("encryption", true).toBool();
     m_compressionEnabled = settings.value("compression", false).toBool();
     
+    // The saved limits reach the manager through the widgets' change signals
+    m_bandwidthLimitSpinBox->setValue(static_cast<int>(m_bandwidthLimit / 1024));
+    m_transferLimitSpinBox->setValue(static_cast<int>(m_transferBandwidthLimit / 1024));
+    m_yieldCheckBox->setChecked(m_yieldToInteractive);
+    
     // Restore window geometry
     restoreGeometry(settings.value("geometry").toByteArray());
     
@@ -789,6 +1141,9 @@ void TransferDialog::saveSettings()
     
     settings.setValue("chunkSize", m_chunkSize);
     settings.setValue("maxConcurrent", m_maxConcurrentTransfers);
+    settings.setValue("bandwidthLimit", m_bandwidthLimit);
+    settings.setValue("transferBandwidthLimit", m_transferBandwidthLimit);
+    settings.setValue("yieldToInteractive", m_yieldToInteractive);
     settings.setValue("encryption", m_encryptionEnabled);
     settings.setValue("compression", m_compressionEnabled);
     
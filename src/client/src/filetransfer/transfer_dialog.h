@@ -22,8 +22,9 @@
 #include <QSplitter>
 #include "FileTransferManager.h"
 
-class ProgressWidget;
-class QScrollArea;
+class QListView;
+class TransferListModel;
+class TransferItemDelegate;
 
 class TransferDialog : public QDialog
 {
@@ -82,14 +83,29 @@ private slots:
     void onTransferRequested(const QString &transferId, const FileTransferRequest &request);
     void onTransferApproved(const QString &transferId);
     void onTransferRejected(const QString &transferId, const QString &reason);
-    void onTransferProgress(const QString &transferId, const FileTransferProgress &progress);
+    void onTransferProgressBatch(const QList<FileTransferProgress> &updates);
     void onTransferCompleted(const QString &transferId, const QString &filePath);
     void onTransferFailed(const QString &transferId, const QString &error);
+    void onTransferCancelled(const QString &transferId);
+    void onFileValidationFailed(const QString &filePath, const QString &reason);
+    
+    // Transfer list actions, from the row buttons and the context menu
+    void onPauseTransfer(const QString &transferId);
+    void onResumeTransfer(const QString &transferId);
+    void onCancelTransfer(const QString &transferId);
+    void onRetryTransfer(const QString &transferId);
+    void onRemoveTransfer(const QString &transferId);
+    void onClearFinished();
+    void onTransferContextMenu(const QPoint &pos);
+    void onTransferDoubleClicked(const QModelIndex &index);
     
     // Settings
     void onSettingsChanged();
     void onChunkSizeChanged(int size);
     void onMaxConcurrentChanged(int count);
+    void onBandwidthLimitChanged(int limit);
+    void onTransferBandwidthLimitChanged(int limit);
+    void onYieldToggled(bool enabled);
     void onEncryptionToggled(bool enabled);
     
     // UI updates
@@ -118,8 +134,9 @@ private:
     QString formatSpeed(qint64 bytesPerSecond) const;
     
     void addFileToList(const QString &filePath);
+    void addTransferToList(const QString &transferId, const QString &filePath, const QStringList &bundleFiles = QStringList());
+    void markBundleFilesCompleted(const QString &transferId, int completedFiles);
     void removeFileFromList(const QString &filePath);
-    ProgressWidget* findProgressWidget(const QString &transferId);
     
     // Member variables
     FileTransferManager *m_manager;
@@ -141,9 +158,10 @@ private:
     
     // Progress area
     QGroupBox *m_progressGroup;
-    QScrollArea *m_progressScrollArea;
-    QWidget *m_progressContainer;
-    QVBoxLayout *m_progressLayout;
+    QListView *m_transferView;
+    TransferListModel *m_transferModel;
+    TransferItemDelegate *m_transferDelegate;
+    QPushButton *m_clearFinishedBtn;
     
     // Controls area
     QGroupBox *m_controlsGroup;
@@ -156,6 +174,9 @@ private:
     QGroupBox *m_settingsGroup;
     QSpinBox *m_chunkSizeSpinBox;
     QSpinBox *m_maxConcurrentSpinBox;
+    QSpinBox *m_bandwidthLimitSpinBox;
+    QSpinBox *m_transferLimitSpinBox;
+    QCheckBox *m_yieldCheckBox;
     QCheckBox *m_encryptionCheckBox;
     QComboBox *m_compressionComboBox;
     
@@ -170,8 +191,13 @@ private:
     
     // Data
     QStringList m_selectedFiles;
-    QMap<QString, ProgressWidget*> m_progressWidgets;
     QMap<QString, FileTransferRequest> m_transferRequests;
+    QHash<QString, QListWidgetItem*> m_fileItems;
+    QStringList m_validationErrors; // Shown together, see onFileValidationFailed()
+    
+    // Bundle transfers: files in stream order and how many have been sent
+    QHash<QString, QStringList> m_bundleFiles;
+    QHash<QString, int> m_bundleCompletedFiles;
     
     // Statistics
     int m_totalFiles;
@@ -181,16 +207,20 @@ private:
     int m_failedTransfers;
     qint64 m_totalBytesTransferred;
     qint64 m_overallSpeed;
+    QHash<QString, qint64> m_transferBytes; // as of the last progress batch
+    QHash<QString, qint64> m_transferSpeeds;
     
     // Settings
     int m_chunkSize;
     int m_maxConcurrentTransfers;
+    qint64 m_bandwidthLimit; // bytes/s, 0 for none
+    qint64 m_transferBandwidthLimit;
+    bool m_yieldToInteractive;
     bool m_encryptionEnabled;
     bool m_compressionEnabled;
     
     // State
     bool m_isTransferring;
-    QTimer *m_updateTimer;
 };
 
 #endif // TRANSFER_DIALOG_H
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "transfer_item_delegate.h"
+#include "transfer_list_model.h"
+#include <QPainter>
+#include <QApplication>
+#include <QStyle>
+#include <QStyleOptionProgressBar>
+#include <QMouseEvent>
+#include <QFontMetrics>
+#include <QIcon>
+
+// Space between the lines of a row and between its buttons
+static const int SPACING = 4;
+static const int BUTTON_SPACING = 2;
+static const int ICON_SIZE = 16;
+
+TransferItemDelegate::TransferItemDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void TransferItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+    TransferStatus status = static_cast<TransferStatus>(index.data(TransferListModel::StatusRole).toInt());
+    qint64 bytesTransferred = index.data(TransferListModel::BytesTransferredRole).toLongLong();
+    qint64 totalBytes = index.data(TransferListModel::TotalBytesRole).toLongLong();
+    qint64 speed = index.data(TransferListModel::SpeedRole).toLongLong();
+    int totalFiles = index.data(TransferListModel::TotalFilesRole).toInt();
+    QList<Action> actions = getActions(status);
+    
+    painter->save();
+    
+    // Background, selection and focus as the style draws them for any item
+    QStyleOptionViewItem background = option;
+    initStyleOption(&background, index);
+    background.text.clear();
+    background.icon = QIcon();
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &background, painter, option.widget);
+    
+    QRect content = option.rect.adjusted(MARGIN, MARGIN, -MARGIN, -MARGIN);
+    painter->setPen(option.palette.color(option.state & QStyle::State_Selected ? QPalette::HighlightedText : QPalette::Text));
+    
+    // Top line: status icon, file name and the buttons
+    int buttonsWidth = actions.size() * (BUTTON_SIZE + BUTTON_SPACING);
+    QRect topLine(content.left(), content.top(), content.width(), BUTTON_SIZE);
+    QIcon statusIcon = index.data(Qt::DecorationRole).value<QIcon>();
+    statusIcon.paint(painter, QRect(topLine.left(), topLine.top() + (BUTTON_SIZE - ICON_SIZE) / 2, ICON_SIZE, ICON_SIZE));
+    
+    QFont nameFont = option.font;
+    nameFont.setBold(true);
+    painter->setFont(nameFont);
+    QRect nameRect = topLine.adjusted(ICON_SIZE + SPACING, 0, -buttonsWidth - SPACING, 0);
+    QString name = QFontMetrics(nameFont).elidedText(index.data(Qt::DisplayRole).toString(), Qt::ElideMiddle, nameRect.width());
+    painter->drawText(nameRect, Qt::AlignLeft | Qt::AlignVCenter, name);
+    
+    for (int i = 0; i < actions.size(); ++i) {
+        getActionIcon(actions.at(i)).paint(painter, buttonRect(option.rect, actions.size() - 1 - i));
+    }
+    
+    // Progress bar
+    QStyleOptionProgressBar bar;
+    bar.state = option.state | QStyle::State_Horizontal;
+    bar.direction = option.direction;
+    bar.palette = option.palette;
+    bar.fontMetrics = option.fontMetrics;
+    bar.rect = QRect(content.left(), topLine.bottom() + 1 + SPACING, content.width(), PROGRESS_BAR_HEIGHT);
+    bar.minimum = 0;
+    bar.maximum = 100;
+    bar.progress = index.data(TransferListModel::PercentageRole).toInt();
+    bar.text = QString("%1%").arg(bar.progress);
+    bar.textVisible = true;
+    style->drawControl(QStyle::CE_ProgressBar, &bar, painter, option.widget);
+    
+    // Bottom line: bytes on the left, speed and ETA or the status on the right
+    painter->setFont(option.font);
+    QFontMetrics fm(option.font);
+    QRect bottomLine(content.left(), bar.rect.bottom() + 1 + SPACING, content.width(), fm.height());
+    
+    QString bytesText = QString("%1 / %2").arg(formatFileSize(bytesTransferred), formatFileSize(totalBytes));
+    if (totalFiles > 0) {
+        bytesText += tr(" (%1 of %2 files)").arg(index.data(TransferListModel::CompletedFilesRole).toInt()).arg(totalFiles);
+    }
+    painter->drawText(bottomLine, Qt::AlignLeft | Qt::AlignVCenter, bytesText);
+    
+    QString stateText;
+    if (status == TransferStatus::InProgress) {
+        qint64 remainingTime = index.data(TransferListModel::RemainingTimeRole).toLongLong();
+        stateText = formatFileSize(speed) + "/s  " + (speed > 0 ? formatDuration(remainingTime) : QString("--:--"));
+    } else {
+        stateText = getStatusText(status, index.data(TransferListModel::ErrorMessageRole).toString());
+    }
+    stateText = fm.elidedText(stateText, Qt::ElideRight, bottomLine.width() - fm.horizontalAdvance(bytesText) - SPACING);
+    painter->drawText(bottomLine, Qt::AlignRight | Qt::AlignVCenter, stateText);
+    
+    painter->restore();
+}
+
+QSize TransferItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    Q_UNUSED(index)
+    
+    int height = 2 * MARGIN + BUTTON_SIZE + PROGRESS_BAR_HEIGHT + QFontMetrics(option.font).height() + 2 * SPACING;
+    return QSize(option.rect.width(), qMax(height, static_cast<int>(ROW_HEIGHT)));
+}
+
+QList<TransferItemDelegate::Action> TransferItemDelegate::getActions(TransferStatus status)
+{
+    switch (status) {
+        case TransferStatus::InProgress:
+            return {Pause, Cancel};
+        case TransferStatus::Paused:
+            return {Resume, Cancel};
+        case TransferStatus::Pending:
+        case TransferStatus::Approved:
+            return {Cancel};
+        case TransferStatus::Failed:
+            return {Retry, Remove};
+        case TransferStatus::Completed:
+        case TransferStatus::Cancelled:
+        case TransferStatus::Rejected:
+            return {Remove};
+    }
+    return {};
+}
+
+QIcon TransferItemDelegate::getActionIcon(Action action)
+{
+    switch (action) {
+        case Pause:
+            return QIcon(":/icons/pause.png");
+        case Resume:
+            return QIcon(":/icons/resume.png");
+        case Cancel:
+            return QIcon(":/icons/stop.png");
+        case Retry:
+            return QIcon(":/icons/retry.png");
+        case Remove:
+            return QIcon(":/icons/remove.png");
+    }
+    return QIcon();
+}
+
+QString TransferItemDelegate::getActionText(Action action)
+{
+    switch (action) {
+        case Pause:
+            return tr("Pause");
+        case Resume:
+            return tr("Resume");
+        case Cancel:
+            return tr("Cancel");
+        case Retry:
+            return tr("Retry");
+        case Remove:
+            return tr("Remove from List");
+    }
+    return QString();
+}
+
+void TransferItemDelegate::triggerAction(Action action, const QString &transferId)
+{
+    switch (action) {
+        case Pause:
+            emit pauseRequested(transferId);
+            break;
+        case Resume:
+            emit resumeRequested(transferId);
+            break;
+        case Cancel:
+            emit cancelRequested(transferId);
+            break;
+        case Retry:
+            emit retryRequested(transferId);
+            break;
+        case Remove:
+            emit removeRequested(transferId);
+            break;
+    }
+}
+
+bool TransferItemDelegate::editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                                       const QModelIndex &index)
+{
+    if (event->type() != QEvent::MouseButtonPress && event->type() != QEvent::MouseButtonRelease) {
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+    }
+    
+    QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(event);
+    if (mouseEvent->button() != Qt::LeftButton) {
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+    }
+    
+    TransferStatus status = static_cast<TransferStatus>(index.data(TransferListModel::StatusRole).toInt());
+    QList<Action> actions = getActions(status);
+    for (int i = 0; i < actions.size(); ++i) {
+        if (!buttonRect(option.rect, actions.size() - 1 - i).contains(mouseEvent->position().toPoint())) {
+            continue;
+        }
+        
+        // The press is swallowed too, so a click on a button does not change the selection
+        if (event->type() == QEvent::MouseButtonRelease) {
+            triggerAction(actions.at(i), index.data(TransferListModel::TransferIdRole).toString());
+        }
+        return true;
+    }
+    
+    return QStyledItemDelegate::editorEvent(event, model, option, index);
+}
+
+QRect TransferItemDelegate::buttonRect(const QRect &itemRect, int position)
+{
+    int right = itemRect.right() - MARGIN - position * (BUTTON_SIZE + BUTTON_SPACING);
+    return QRect(right - BUTTON_SIZE + 1, itemRect.top() + MARGIN, BUTTON_SIZE, BUTTON_SIZE);
+}
+
+QString TransferItemDelegate::formatFileSize(qint64 bytes)
+{
+    const qint64 KB = 1024;
+    const qint64 MB = KB * 1024;
+    const qint64 GB = MB * 1024;
+    
+    if (bytes >= GB) {
+        return QString("%1 GB").arg(bytes / (double)GB, 0, 'f', 2);
+    } else if (bytes >= MB) {
+        return QString("%1 MB").arg(bytes / (double)MB, 0, 'f', 2);
+    } else if (bytes >= KB) {
+        return QString("%1 KB").arg(bytes / (double)KB, 0, 'f', 2);
+    } else {
+        return QString("%1 B").arg(bytes);
+    }
+}
+
+QString TransferItemDelegate::formatDuration(qint64 seconds)
+{
+    if (seconds < 60) {
+        return QString("%1s").arg(seconds);
+    } else if (seconds < 3600) {
+        return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+    } else {
+        qint64 hours = seconds / 3600;
+        qint64 minutes = (seconds % 3600) / 60;
+        return QString("%1:%2:%3")
+               .arg(hours)
+               .arg(minutes, 2, 10, QChar('0'))
+               .arg(seconds % 60, 2, 10, QChar('0'));
+    }
+}
+
+QString TransferItemDelegate::getStatusText(TransferStatus status, const QString &errorMessage)
+{
+    switch (status) {
+        case TransferStatus::Pending:
+            return tr("Pending");
+        case TransferStatus::Approved:
+            return tr("Approved");
+        case TransferStatus::InProgress:
+            return tr("Transferring");
+        case TransferStatus::Paused:
+            return tr("Paused");
+        case TransferStatus::Completed:
+            return tr("Completed");
+        case TransferStatus::Failed:
+            return tr("Failed: %1").arg(errorMessage);
+        case TransferStatus::Cancelled:
+            return tr("Cancelled");
+        case TransferStatus::Rejected:
+            return tr("Rejected");
+    }
+    return tr("Unknown");
+}
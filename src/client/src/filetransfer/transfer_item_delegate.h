@@ -0,0 +1,92 @@
+#ifndef TRANSFER_ITEM_DELEGATE_H
+#define TRANSFER_ITEM_DELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QList>
+#include "FileTransferManager.h"
+
+/**
+ * @brief Paints a TransferListModel row as a progress entry
+ *
+ * Each row shows the file name, a progress bar, bytes, speed and ETA, and
+ * the control buttons that fit the transfer's status. Nothing is kept per
+ * row: the buttons are painted and hit-tested from the model data, and a
+ * click is reported through the request signals with the transfer ID.
+ */
+class TransferItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Actions offered on a transfer
+     */
+    enum Action {
+        Pause,
+        Resume,
+        Cancel,
+        Retry,
+        Remove
+    };
+    
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit TransferItemDelegate(QObject *parent = nullptr);
+    
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    
+    /**
+     * @brief Actions available in a status, in button order
+     * @param status Transfer status
+     * @return Actions, empty if none apply
+     */
+    static QList<Action> getActions(TransferStatus status);
+    
+    /**
+     * @brief Icon and label of an action, shared by buttons and menus
+     */
+    static QIcon getActionIcon(Action action);
+    static QString getActionText(Action action);
+    
+    /**
+     * @brief Emit the request signal of an action
+     * @param action Action taken
+     * @param transferId Transfer identifier
+     */
+    void triggerAction(Action action, const QString &transferId);
+
+signals:
+    void pauseRequested(const QString &transferId);
+    void resumeRequested(const QString &transferId);
+    void cancelRequested(const QString &transferId);
+    void retryRequested(const QString &transferId);
+    void removeRequested(const QString &transferId);
+
+protected:
+    /**
+     * @brief Trigger the action under a button click
+     */
+    bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                     const QModelIndex &index) override;
+
+private:
+    /**
+     * @brief Area of the button at a position, counted from the right
+     */
+    static QRect buttonRect(const QRect &itemRect, int position);
+    
+    static QString formatFileSize(qint64 bytes);
+    static QString formatDuration(qint64 seconds);
+    static QString getStatusText(TransferStatus status, const QString &errorMessage);
+    
+    // Constants
+    static const int ROW_HEIGHT = 64;
+    static const int MARGIN = 6;
+    static const int BUTTON_SIZE = 20;
+    static const int PROGRESS_BAR_HEIGHT = 16;
+};
+
+#endif // TRANSFER_ITEM_DELEGATE_H
@@ -0,0 +1,260 @@
+#include "transfer_list_model.h"
+#include <QFileInfo>
+#include <QIcon>
+#include <algorithm>
+
+TransferListModel::TransferListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int TransferListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_entries.size();
+}
+
+QVariant TransferListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.size()) {
+        return QVariant();
+    }
+    
+    const Entry &entry = m_entries.at(index.row());
+    switch (role) {
+        case Qt::DisplayRole:
+            return entry.fileName;
+        case Qt::ToolTipRole:
+            return entry.errorMessage.isEmpty() ? entry.filePath : entry.filePath + "\n" + entry.errorMessage;
+        case Qt::DecorationRole:
+            switch (entry.status) {
+                case TransferStatus::InProgress:
+                    return QIcon(":/icons/transfer_active.png");
+                case TransferStatus::Completed:
+                    return QIcon(":/icons/transfer_completed.png");
+                case TransferStatus::Failed:
+                case TransferStatus::Rejected:
+                    return QIcon(":/icons/transfer_failed.png");
+                case TransferStatus::Paused:
+                    return QIcon(":/icons/transfer_paused.png");
+                case TransferStatus::Cancelled:
+                    return QIcon(":/icons/transfer_cancelled.png");
+                default:
+                    return QIcon(":/icons/transfer_pending.png");
+            }
+        case TransferIdRole:
+            return entry.transferId;
+        case FilePathRole:
+            return entry.filePath;
+        case BytesTransferredRole:
+            return entry.bytesTransferred;
+        case TotalBytesRole:
+            return entry.totalBytes;
+        case PercentageRole:
+            if (entry.status == TransferStatus::Completed) {
+                return 100;
+            }
+            return entry.totalBytes > 0 ? qRound(static_cast<double>(entry.bytesTransferred) / entry.totalBytes * 100.0) : 0;
+        case SpeedRole:
+            return entry.speed;
+        case RemainingTimeRole:
+            return entry.remainingTime;
+        case StatusRole:
+            return static_cast<int>(entry.status);
+        case ErrorMessageRole:
+            return entry.errorMessage;
+        case CompletedFilesRole:
+            return entry.completedFiles;
+        case TotalFilesRole:
+            return entry.totalFiles;
+        default:
+            return QVariant();
+    }
+}
+
+QHash<int, QByteArray> TransferListModel::roleNames() const
+{
+    QHash<int, QByteArray> names = QAbstractListModel::roleNames();
+    names[TransferIdRole] = "transferId";
+    names[FilePathRole] = "filePath";
+    names[BytesTransferredRole] = "bytesTransferred";
+    names[TotalBytesRole] = "totalBytes";
+    names[PercentageRole] = "percentage";
+    names[SpeedRole] = "speed";
+    names[RemainingTimeRole] = "remainingTime";
+    names[StatusRole] = "status";
+    names[ErrorMessageRole] = "errorMessage";
+    names[CompletedFilesRole] = "completedFiles";
+    names[TotalFilesRole] = "totalFiles";
+    return names;
+}
+
+bool TransferListModel::addTransfer(const QString &transferId, const QString &filePath, qint64 totalBytes)
+{
+    if (m_rows.contains(transferId)) {
+        return false;
+    }
+    
+    Entry entry;
+    entry.transferId = transferId;
+    entry.filePath = filePath;
+    entry.fileName = QFileInfo(filePath).fileName();
+    entry.bytesTransferred = 0;
+    entry.totalBytes = totalBytes;
+    entry.speed = 0;
+    entry.remainingTime = 0;
+    entry.status = TransferStatus::Pending;
+    entry.completedFiles = 0;
+    entry.totalFiles = 0;
+    
+    int row = m_entries.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_entries.append(entry);
+    m_rows.insert(transferId, row);
+    endInsertRows();
+    return true;
+}
+
+void TransferListModel::removeTransfer(const QString &transferId)
+{
+    auto it = m_rows.constFind(transferId);
+    if (it == m_rows.cend()) {
+        return;
+    }
+    
+    int row = it.value();
+    beginRemoveRows(QModelIndex(), row, row);
+    m_entries.remove(row);
+    m_rows.remove(transferId);
+    reindexFrom(row);
+    endRemoveRows();
+}
+
+void TransferListModel::removeFinishedTransfers()
+{
+    // Back to front, so each removal leaves the rows still to visit in place
+    for (int row = m_entries.size() - 1; row >= 0; --row) {
+        if (!isFinished(m_entries.at(row).status)) {
+            continue;
+        }
+        
+        int first = row;
+        while (first > 0 && isFinished(m_entries.at(first - 1).status)) {
+            --first;
+        }
+        beginRemoveRows(QModelIndex(), first, row);
+        for (int i = first; i <= row; ++i) {
+            m_rows.remove(m_entries.at(i).transferId);
+        }
+        m_entries.remove(first, row - first + 1);
+        reindexFrom(first);
+        endRemoveRows();
+        row = first;
+    }
+}
+
+bool TransferListModel::containsTransfer(const QString &transferId) const
+{
+    return m_rows.contains(transferId);
+}
+
+QModelIndex TransferListModel::indexForTransfer(const QString &transferId) const
+{
+    auto it = m_rows.constFind(transferId);
+    return it != m_rows.cend() ? index(it.value()) : QModelIndex();
+}
+
+QStringList TransferListModel::getTransferIds() const
+{
+    QStringList transferIds;
+    transferIds.reserve(m_entries.size());
+    for (const Entry &entry : m_entries) {
+        transferIds.append(entry.transferId);
+    }
+    return transferIds;
+}
+
+void TransferListModel::applyProgress(const QList<FileTransferProgress> &updates)
+{
+    QList<int> changedRows;
+    changedRows.reserve(updates.size());
+    
+    for (const FileTransferProgress &progress : updates) {
+        auto it = m_rows.constFind(progress.transferId);
+        if (it == m_rows.cend()) {
+            continue;
+        }
+        
+        Entry &entry = m_entries[it.value()];
+        
+        // The final tick can land after completion or failure was reported
+        if (isFinished(entry.status)) {
+            continue;
+        }
+        entry.bytesTransferred = progress.bytesTransferred;
+        entry.totalBytes = progress.totalBytes;
+        entry.speed = progress.speed;
+        entry.remainingTime = progress.remainingTime;
+        entry.completedFiles = progress.completedFiles;
+        entry.totalFiles = progress.totalFiles;
+        entry.status = progress.status;
+        changedRows.append(it.value());
+    }
+    
+    emitRowsChanged(changedRows);
+}
+
+void TransferListModel::setStatus(const QString &transferId, TransferStatus status, const QString &errorMessage)
+{
+    auto it = m_rows.constFind(transferId);
+    if (it == m_rows.cend()) {
+        return;
+    }
+    
+    Entry &entry = m_entries[it.value()];
+    entry.status = status;
+    entry.errorMessage = errorMessage;
+    if (status != TransferStatus::InProgress) {
+        entry.speed = 0;
+        entry.remainingTime = 0;
+    }
+    if (status == TransferStatus::Completed) {
+        entry.bytesTransferred = entry.totalBytes;
+        entry.completedFiles = entry.totalFiles;
+    }
+    emitRowsChanged({it.value()});
+}
+
+bool TransferListModel::isFinished(TransferStatus status)
+{
+    return status == TransferStatus::Completed || status == TransferStatus::Failed ||
+           status == TransferStatus::Cancelled || status == TransferStatus::Rejected;
+}
+
+void TransferListModel::emitRowsChanged(QList<int> rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+    
+    // Views repaint the union of a range, so only adjacent rows are merged
+    std::sort(rows.begin(), rows.end());
+    int first = rows.first();
+    int last = first;
+    for (int i = 1; i <= rows.size(); ++i) {
+        if (i < rows.size() && rows.at(i) <= last + 1) {
+            last = rows.at(i);
+            continue;
+        }
+        emit dataChanged(index(first), index(last));
+        if (i < rows.size()) {
+            first = last = rows.at(i);
+        }
+    }
+}
+
+void TransferListModel::reindexFrom(int row)
+{
+    for (int i = row; i < m_entries.size(); ++i) {
+        m_rows[m_entries.at(i).transferId] = i;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef TRANSFER_LIST_MODEL_H
+#define TRANSFER_LIST_MODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include "FileTransferManager.h"
+
+/**
+ * @brief List model holding one row per file transfer
+ *
+ * Replaces a widget per transfer: the rows are plain data and a
+ * TransferItemDelegate paints only the ones in view, so the list stays
+ * cheap with thousands of entries. Progress batches are applied in place
+ * and announced as one dataChanged() per run of adjacent changed rows.
+ */
+class TransferListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Data roles beyond the standard display, tooltip and icon
+     */
+    enum Roles {
+        TransferIdRole = Qt::UserRole + 1,
+        FilePathRole,
+        BytesTransferredRole,
+        TotalBytesRole,
+        PercentageRole,
+        SpeedRole,
+        RemainingTimeRole,
+        StatusRole,
+        ErrorMessageRole,
+        CompletedFilesRole,
+        TotalFilesRole
+    };
+    
+    /**
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    explicit TransferListModel(QObject *parent = nullptr);
+    
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    
+    /**
+     * @brief Append a row for a new transfer
+     * @param transferId Transfer identifier
+     * @param filePath File, or bundle root folder, being transferred
+     * @param totalBytes Size shown until the first progress arrives
+     * @return False if the transfer is already listed
+     */
+    bool addTransfer(const QString &transferId, const QString &filePath, qint64 totalBytes);
+    
+    /**
+     * @brief Remove a transfer's row
+     * @param transferId Transfer identifier
+     */
+    void removeTransfer(const QString &transferId);
+    
+    /**
+     * @brief Remove the rows of completed, failed and cancelled transfers
+     */
+    void removeFinishedTransfers();
+    
+    bool containsTransfer(const QString &transferId) const;
+    QModelIndex indexForTransfer(const QString &transferId) const;
+    QStringList getTransferIds() const;
+    
+    /**
+     * @brief Apply one tick of the progress bus
+     * @param updates Progress of the transfers that changed
+     */
+    void applyProgress(const QList<FileTransferProgress> &updates);
+    
+    /**
+     * @brief Set a transfer's status, clearing its speed once it stops
+     * @param transferId Transfer identifier
+     * @param status New status
+     * @param errorMessage Reason shown for failed transfers
+     */
+    void setStatus(const QString &transferId, TransferStatus status, const QString &errorMessage = QString());
+    
+    /**
+     * @brief Whether a transfer in this status has finished for good
+     */
+    static bool isFinished(TransferStatus status);
+
+private:
+    struct Entry {
+        QString transferId;
+        QString filePath;
+        QString fileName;
+        qint64 bytesTransferred;
+        qint64 totalBytes;
+        qint64 speed;
+        qint64 remainingTime;
+        TransferStatus status;
+        QString errorMessage;
+        int completedFiles;
+        int totalFiles;
+    };
+    
+    void emitRowsChanged(QList<int> rows);
+    void reindexFrom(int row);
+    
+    QVector<Entry> m_entries;
+    QHash<QString, int> m_rows; // transfer ID to row
+};
+
+#endif // TRANSFER_LIST_MODEL_H
@@ -0,0 +1,749 @@
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QRandomGenerator>
+#include <memory>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include "../../../src/client/src/filetransfer/FileTransferManager.h"
+#include "../../../src/client/src/filetransfer/FileTransferSession.h"
+#include "../../../src/client/src/filetransfer/ChunkCodec.h"
+#include "../../../src/client/src/filetransfer/ControlCodec.h"
+#include "../../../src/client/src/filetransfer/ChunkIntegrity.h"
+#include "../../../src/client/src/filetransfer/ChunkBufferPool.h"
+
+// Benchmarks of the transfer pipeline, not run by ctest.
+//
+// Micro benchmarks use QBENCHMARK, so QtTest's own -csv or "-o file,xml"
+// output is machine-readable. Macro benchmarks run whole transfers over a
+// loopback WebSocket and report MB/s through QTest::setBenchmarkResult();
+// with FILETRANSFER_BENCHMARK_JSON set, they are also written to that file
+// with CPU time per GB and peak RSS. FILETRANSFER_BENCHMARK_MB sets the
+// macro transfer size and FILETRANSFER_BENCHMARK_DISK_DIR where the disk
+// benchmarks write (the build directory by default).
+
+static const int FILE_BENCHMARK_SIZE = 16 * 1024 * 1024; // 16MB
+static const int DEFAULT_MACRO_SIZE_MB = 64;
+static const int MACRO_TIMEOUT = 300000; // 5 minutes
+static const int RETRANSMISSION_TIMEOUT = 200; // Linux minimum TCP RTO, in ms
+
+struct ProcessUsage {
+    double cpuSeconds;
+    qint64 peakRssKb; // Since process start, 0 where unknown
+};
+
+static ProcessUsage processUsage()
+{
+    ProcessUsage usage{0.0, 0};
+#ifdef Q_OS_UNIX
+    struct rusage self;
+    if (getrusage(RUSAGE_SELF, &self) == 0) {
+        usage.cpuSeconds = self.ru_utime.tv_sec + self.ru_stime.tv_sec +
+                           (self.ru_utime.tv_usec + self.ru_stime.tv_usec) / 1e6;
+#ifdef Q_OS_MACOS
+        usage.peakRssKb = self.ru_maxrss / 1024; // Bytes on macOS
+#else
+        usage.peakRssKb = self.ru_maxrss;
+#endif
+    }
+#elif defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        auto seconds = [](const FILETIME &time) {
+            return ((static_cast<quint64>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 1e7;
+        };
+        usage.cpuSeconds = seconds(kernel) + seconds(user);
+    }
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        usage.peakRssKb = static_cast<qint64>(counters.PeakWorkingSetSize / 1024);
+    }
+#endif
+    return usage;
+}
+
+// Minimal transfer server for the loopback benchmarks: negotiates binary
+// chunk headers, approves every request, acknowledges uploaded chunks and
+// serves requested download chunks. Clients that take control frames get
+// one ack frame per interval, others a chunk_ack per chunk.
+//
+// Everything sent to the client goes through a FIFO link that adds the
+// configured round trip delay. WebSockets run over TCP, which repairs loss
+// by retransmitting, so a lost message is held back one retransmission
+// timeout rather than dropped, and stalls the messages behind it the way
+// head-of-line blocking does.
+class LoopbackPeer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoopbackPeer(QObject *parent = nullptr)
+        : QObject(parent)
+        , m_server("FileTransferBenchmark", QWebSocketServer::NonSecureMode)
+        , m_client(nullptr)
+        , m_latencyMs(0)
+        , m_lossRate(0.0)
+        , m_downloadSize(0)
+        , m_integrity(ChunkIntegrity::Algorithm::Crc32c)
+        , m_ackInterval(0)
+    {
+        connect(&m_server, &QWebSocketServer::newConnection, this, &LoopbackPeer::onNewConnection);
+        m_linkTimer.setSingleShot(true);
+        connect(&m_linkTimer, &QTimer::timeout, this, &LoopbackPeer::deliverDue);
+        m_ackTimer.setSingleShot(true);
+        connect(&m_ackTimer, &QTimer::timeout, this, &LoopbackPeer::sendAckFrame);
+        m_clock.start();
+        
+        // Every download chunk carries the same bytes
+        m_downloadChunk.resize(ChunkSizeTuner::MAX_CHUNK_SIZE);
+        QRandomGenerator generator(42);
+        generator.fillRange(reinterpret_cast<quint32 *>(m_downloadChunk.data()),
+                            m_downloadChunk.size() / static_cast<int>(sizeof(quint32)));
+    }
+    
+    bool listen()
+    {
+        return m_server.listen(QHostAddress::LocalHost, 0);
+    }
+    
+    QString url() const
+    {
+        return QString("ws://127.0.0.1:%1").arg(m_server.serverPort());
+    }
+    
+    void setLink(int latencyMs, double lossRate)
+    {
+        m_latencyMs = latencyMs;
+        m_lossRate = lossRate;
+    }
+    
+    void setDownloadSize(qint64 size)
+    {
+        m_downloadSize = size;
+    }
+
+private slots:
+    void onNewConnection()
+    {
+        // One client per benchmark
+        m_client = m_server.nextPendingConnection();
+        connect(m_client, &QWebSocket::textMessageReceived, this, &LoopbackPeer::onTextMessage);
+        connect(m_client, &QWebSocket::binaryMessageReceived, this, &LoopbackPeer::onBinaryMessage);
+    }
+    
+    void onTextMessage(const QString &text)
+    {
+        QJsonObject message = QJsonDocument::fromJson(text.toUtf8()).object();
+        QString type = message["type"].toString();
+        
+        if (type == "session_register") {
+            QJsonObject reply;
+            reply["type"] = "session_registered";
+            reply["chunk_header_version"] = ChunkCodec::BINARY_HEADER_VERSION;
+            reply["chunk_integrity"] = ChunkIntegrity::algorithmToString(m_integrity);
+            send(reply);
+            
+            if (message["control_frames"].toInt() >= ControlCodec::CONTROL_FRAME_VERSION) {
+                m_ackInterval = message["ack_interval"].toInt(ControlCodec::DEFAULT_ACK_INTERVAL);
+            }
+        } else if (type == "upload" || type == "download") {
+            // A file_transfer_request, its type field carries the direction
+            QString transferId = message["id"].toString();
+            quint32 handle = static_cast<quint32>(message["transfer_handle"].toVariant().toLongLong());
+            int chunkSize = message["chunk_size"].toInt(ChunkSizeTuner::DEFAULT_CHUNK_SIZE);
+            m_transfers.insert(handle, transferId);
+            
+            QJsonObject reply;
+            reply["type"] = "file_transfer_response";
+            reply["transfer_id"] = transferId;
+            reply["status"] = "approved";
+            reply["chunk_size"] = chunkSize;
+            if (type == "download") {
+                m_downloads.insert(transferId, Download{handle, chunkSize});
+                reply["file_size"] = m_downloadSize;
+            }
+            send(reply);
+        } else if (type == "chunk_request") {
+            serveChunk(message["transfer_id"].toString(), message["chunk_index"].toInt());
+        } else if (type == "ping") {
+            QJsonObject reply;
+            reply["type"] = "pong";
+            send(reply);
+        }
+    }
+    
+    void onBinaryMessage(const QByteArray &frame)
+    {
+        quint32 handle = 0;
+        FileChunk chunk;
+        if (!ChunkCodec::decodeBinaryFrame(frame, handle, chunk)) {
+            qWarning() << "Loopback peer received an undecodable chunk";
+            return;
+        }
+        
+        if (m_ackInterval <= 0) {
+            QJsonObject ack;
+            ack["type"] = "chunk_ack";
+            ack["transfer_id"] = m_transfers.value(handle);
+            ack["chunk_index"] = chunk.chunkIndex;
+            send(ack);
+            return;
+        }
+        
+        // Acknowledged with everything else received until the next frame
+        AckState &state = m_acks[handle];
+        if (chunk.chunkIndex >= state.received.size()) {
+            state.received.resize(chunk.chunkIndex + 1);
+        }
+        state.received.setBit(chunk.chunkIndex);
+        state.dirty = true;
+        if (!m_ackTimer.isActive()) {
+            m_ackTimer.start(m_ackInterval);
+        }
+    }
+    
+    void sendAckFrame()
+    {
+        QList<ControlCodec::ChunkAcks> acks;
+        for (auto it = m_acks.begin(); it != m_acks.end(); ++it) {
+            if (!it->dirty) {
+                continue;
+            }
+            ControlCodec::ChunkAcks entry = ControlCodec::chunkAcksFromBitmap(it.key(), it->received, it->cumulative);
+            it->cumulative = entry.cumulative;
+            it->dirty = false;
+            acks.append(entry);
+        }
+        if (!acks.isEmpty()) {
+            enqueue(true, ControlCodec::encodeChunkAcks(acks));
+        }
+    }
+    
+    void deliverDue()
+    {
+        qint64 now = m_clock.elapsed();
+        while (!m_outgoing.isEmpty() && m_outgoing.head().dueAt <= now) {
+            Outgoing next = m_outgoing.dequeue();
+            write(next.binary, next.payload);
+        }
+        if (!m_outgoing.isEmpty()) {
+            m_linkTimer.start(static_cast<int>(m_outgoing.head().dueAt - now));
+        }
+    }
+
+private:
+    struct Download {
+        quint32 handle;
+        int chunkSize;
+    };
+    
+    struct Outgoing {
+        qint64 dueAt;
+        bool binary;
+        QByteArray payload;
+    };
+    
+    struct AckState {
+        QBitArray received;
+        int cumulative = 0;
+        bool dirty = false;
+    };
+    
+    void serveChunk(const QString &transferId, int chunkIndex)
+    {
+        auto it = m_downloads.constFind(transferId);
+        if (it == m_downloads.cend()) {
+            return;
+        }
+        
+        qint64 offset = static_cast<qint64>(chunkIndex) * it->chunkSize;
+        int length = static_cast<int>(qBound<qint64>(0, m_downloadSize - offset, it->chunkSize));
+        
+        FileChunk chunk;
+        chunk.chunkIndex = chunkIndex;
+        chunk.data = QByteArray::fromRawData(m_downloadChunk.constData(), length);
+        chunk.isLast = offset + length >= m_downloadSize;
+        chunk.compressed = false;
+        chunk.cipher = ChunkCipher::Cipher::None;
+        
+        // Full chunks are all alike, their digest is computed once
+        auto digest = m_digests.constFind(length);
+        if (digest == m_digests.cend()) {
+            digest = m_digests.insert(length, ChunkIntegrity::digest(m_integrity, chunk.data));
+        }
+        chunk.checksum = digest.value();
+        
+        enqueue(true, ChunkCodec::encodeBinaryFrame(it->handle, chunk));
+    }
+    
+    void send(const QJsonObject &message)
+    {
+        enqueue(false, QJsonDocument(message).toJson(QJsonDocument::Compact));
+    }
+    
+    void enqueue(bool binary, const QByteArray &payload)
+    {
+        qint64 now = m_clock.elapsed();
+        qint64 dueAt = now + m_latencyMs;
+        if (m_lossRate > 0 && QRandomGenerator::global()->generateDouble() < m_lossRate) {
+            dueAt += RETRANSMISSION_TIMEOUT;
+        }
+        
+        // In order, as TCP delivers
+        if (!m_outgoing.isEmpty()) {
+            dueAt = qMax(dueAt, m_outgoing.last().dueAt);
+        } else if (dueAt <= now) {
+            write(binary, payload);
+            return;
+        }
+        
+        m_outgoing.enqueue(Outgoing{dueAt, binary, payload});
+        if (!m_linkTimer.isActive()) {
+            m_linkTimer.start(static_cast<int>(m_outgoing.head().dueAt - now));
+        }
+    }
+    
+    void write(bool binary, const QByteArray &payload)
+    {
+        if (!m_client) {
+            return;
+        }
+        if (binary) {
+            m_client->sendBinaryMessage(payload);
+        } else {
+            m_client->sendTextMessage(QString::fromUtf8(payload));
+        }
+    }
+    
+    QWebSocketServer m_server;
+    QWebSocket *m_client;
+    
+    // Link emulation
+    int m_latencyMs;
+    double m_lossRate;
+    QQueue<Outgoing> m_outgoing;
+    QTimer m_linkTimer;
+    QElapsedTimer m_clock;
+    
+    // Transfers by binary header handle, downloads by transfer ID
+    QHash<quint32, QString> m_transfers;
+    QHash<QString, Download> m_downloads;
+    QByteArray m_downloadChunk;
+    QHash<int, QByteArray> m_digests;
+    qint64 m_downloadSize;
+    ChunkIntegrity::Algorithm m_integrity;
+    
+    // Upload acks, batched per interval once the client takes ack frames
+    int m_ackInterval;
+    QHash<quint32, AckState> m_acks;
+    QTimer m_ackTimer;
+};
+
+class FileTransferBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    
+    // Micro benchmarks
+    void benchmarkChunkDigest_data();
+    void benchmarkChunkDigest();
+    void benchmarkBinaryFrameEncode_data();
+    void benchmarkBinaryFrameEncode();
+    void benchmarkBinaryHeaderInPlace();
+    void benchmarkBinaryFrameDecode_data();
+    void benchmarkBinaryFrameDecode();
+    void benchmarkReadChunk_data();
+    void benchmarkReadChunk();
+    void benchmarkWriteChunk_data();
+    void benchmarkWriteChunk();
+    
+    // Macro benchmarks, whole transfers through the manager
+    void benchmarkLoopbackUpload_data();
+    void benchmarkLoopbackUpload();
+    void benchmarkLoopbackDownload_data();
+    void benchmarkLoopbackDownload();
+
+private:
+    // Helper methods
+    void addChunkSizeRows();
+    void addStorageRows();
+    void addLinkRows();
+    QString storageDirectory(const QString &storage);
+    void runLoopbackTransfer(TransferType type);
+    
+    std::unique_ptr<QTemporaryDir> m_diskDir;
+    std::unique_ptr<QTemporaryDir> m_tmpfsDir;
+    QByteArray m_payload;
+    qint64 m_macroBytes;
+    QJsonArray m_results;
+};
+
+void FileTransferBenchmark::initTestCase()
+{
+    QString diskRoot = qEnvironmentVariable("FILETRANSFER_BENCHMARK_DISK_DIR", QCoreApplication::applicationDirPath());
+    m_diskDir = std::make_unique<QTemporaryDir>(diskRoot + "/filetransfer-bench-XXXXXX");
+    QVERIFY(m_diskDir->isValid());
+
+#ifdef Q_OS_LINUX
+    if (QFileInfo(QStringLiteral("/dev/shm")).isWritable()) {
+        m_tmpfsDir = std::make_unique<QTemporaryDir>(QStringLiteral("/dev/shm/filetransfer-bench-XXXXXX"));
+    }
+#endif
+
+    // Incompressible, like most files worth benchmarking a transfer with
+    m_payload.resize(ChunkSizeTuner::MAX_CHUNK_SIZE);
+    QRandomGenerator generator(7);
+    generator.fillRange(reinterpret_cast<quint32 *>(m_payload.data()), m_payload.size() / static_cast<int>(sizeof(quint32)));
+    
+    bool ok = false;
+    int megabytes = qEnvironmentVariableIntValue("FILETRANSFER_BENCHMARK_MB", &ok);
+    m_macroBytes = static_cast<qint64>(ok && megabytes > 0 ? megabytes : DEFAULT_MACRO_SIZE_MB) * 1024 * 1024;
+}
+
+void FileTransferBenchmark::cleanupTestCase()
+{
+    QString reportPath = qEnvironmentVariable("FILETRANSFER_BENCHMARK_JSON");
+    if (reportPath.isEmpty()) {
+        return;
+    }
+    
+    QJsonObject report;
+    report["benchmark"] = "file_transfer";
+    report["qt_version"] = QString::fromLatin1(qVersion());
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["results"] = m_results;
+    
+    QFile file(reportPath);
+    QVERIFY2(file.open(QIODevice::WriteOnly | QIODevice::Truncate), qPrintable(file.errorString()));
+    file.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+}
+
+void FileTransferBenchmark::benchmarkChunkDigest_data()
+{
+    QTest::addColumn<int>("algorithm");
+    QTest::addColumn<int>("chunkSize");
+    
+    for (ChunkIntegrity::Algorithm algorithm : {ChunkIntegrity::Algorithm::Sha256, ChunkIntegrity::Algorithm::Crc32c,
+                                                ChunkIntegrity::Algorithm::Blake2s}) {
+        for (int chunkSize : {64 * 1024, 1024 * 1024}) {
+            QString name = QString("%1/%2KB").arg(ChunkIntegrity::algorithmToString(algorithm)).arg(chunkSize / 1024);
+            QTest::newRow(qPrintable(name)) << static_cast<int>(algorithm) << chunkSize;
+        }
+    }
+}
+
+void FileTransferBenchmark::benchmarkChunkDigest()
+{
+    QFETCH(int, algorithm);
+    QFETCH(int, chunkSize);
+    
+    QByteArray data = QByteArray::fromRawData(m_payload.constData(), chunkSize);
+    QByteArray digest;
+    QBENCHMARK {
+        digest = ChunkIntegrity::digest(static_cast<ChunkIntegrity::Algorithm>(algorithm), data);
+    }
+    QVERIFY(!digest.isEmpty());
+}
+
+void FileTransferBenchmark::benchmarkBinaryFrameEncode_data()
+{
+    addChunkSizeRows();
+}
+
+void FileTransferBenchmark::benchmarkBinaryFrameEncode()
+{
+    QFETCH(int, chunkSize);
+    
+    // The copying fallback of sendBinaryChunk()
+    FileChunk chunk;
+    chunk.chunkIndex = 1;
+    chunk.data = QByteArray::fromRawData(m_payload.constData(), chunkSize);
+    chunk.checksum = ChunkIntegrity::digest(ChunkIntegrity::Algorithm::Crc32c, chunk.data);
+    chunk.isLast = false;
+    chunk.compressed = false;
+    chunk.cipher = ChunkCipher::Cipher::None;
+    
+    QByteArray frame;
+    QBENCHMARK {
+        frame = ChunkCodec::encodeBinaryFrame(1, chunk);
+    }
+    QCOMPARE(frame.size(), static_cast<qsizetype>(ChunkCodec::BINARY_HEADER_SIZE + chunkSize));
+}
+
+void FileTransferBenchmark::benchmarkBinaryHeaderInPlace()
+{
+    // What uploads do with a pooled frame buffer
+    FileChunk chunk;
+    chunk.chunkIndex = 1;
+    chunk.checksum = ChunkIntegrity::digest(ChunkIntegrity::Algorithm::Crc32c, m_payload);
+    chunk.isLast = false;
+    chunk.compressed = false;
+    chunk.cipher = ChunkCipher::Cipher::None;
+    
+    QByteArray frame(ChunkBufferPool::HEADROOM, Qt::Uninitialized);
+    uchar *header = reinterpret_cast<uchar *>(frame.data());
+    QBENCHMARK {
+        ChunkCodec::writeBinaryHeader(header, 1, chunk);
+    }
+    QVERIFY(ChunkCodec::isBinaryFrame(frame));
+}
+
+void FileTransferBenchmark::benchmarkBinaryFrameDecode_data()
+{
+    addChunkSizeRows();
+}
+
+void FileTransferBenchmark::benchmarkBinaryFrameDecode()
+{
+    QFETCH(int, chunkSize);
+    
+    // onWebSocketBinaryMessageReceived() on every downloaded chunk
+    FileChunk chunk;
+    chunk.chunkIndex = 1;
+    chunk.data = QByteArray::fromRawData(m_payload.constData(), chunkSize);
+    chunk.checksum = ChunkIntegrity::digest(ChunkIntegrity::Algorithm::Crc32c, chunk.data);
+    chunk.isLast = false;
+    chunk.compressed = false;
+    chunk.cipher = ChunkCipher::Cipher::None;
+    QByteArray frame = ChunkCodec::encodeBinaryFrame(1, chunk);
+    
+    quint32 handle = 0;
+    FileChunk decoded;
+    QBENCHMARK {
+        ChunkCodec::decodeBinaryFrame(frame, handle, decoded);
+    }
+    QCOMPARE(decoded.data.size(), static_cast<qsizetype>(chunkSize));
+}
+
+void FileTransferBenchmark::benchmarkReadChunk_data()
+{
+    addStorageRows();
+}
+
+void FileTransferBenchmark::benchmarkReadChunk()
+{
+    QFETCH(QString, storage);
+    QFETCH(int, chunkSize);
+    
+    QString directory = storageDirectory(storage);
+    if (directory.isEmpty()) {
+        QSKIP("No tmpfs mount available");
+    }
+    
+    QString path = directory + "/read.bin";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    for (qint64 written = 0; written < FILE_BENCHMARK_SIZE; written += m_payload.size()) {
+        file.write(m_payload);
+    }
+    file.close();
+    
+    FileTransferRequest request;
+    request.id = "benchmark-read";
+    request.type = TransferType::Upload;
+    request.localPath = path;
+    request.fileSize = FILE_BENCHMARK_SIZE;
+    
+    // The whole file through the upload read path, file digest included;
+    // later iterations read from the page cache
+    ChunkBufferPool pool;
+    QBENCHMARK {
+        FileTransferSession session(request);
+        QVERIFY(session.setChunkSize(chunkSize));
+        QVERIFY(session.openFile());
+        for (int chunkIndex = 0; chunkIndex < session.getTotalChunks(); ++chunkIndex) {
+            QByteArray frame = pool.acquire(chunkSize);
+            QVERIFY(session.readChunk(chunkIndex, frame));
+            pool.release(std::move(frame));
+        }
+        session.closeFile();
+    }
+}
+
+void FileTransferBenchmark::benchmarkWriteChunk_data()
+{
+    addStorageRows();
+}
+
+void FileTransferBenchmark::benchmarkWriteChunk()
+{
+    QFETCH(QString, storage);
+    QFETCH(int, chunkSize);
+    
+    QString directory = storageDirectory(storage);
+    if (directory.isEmpty()) {
+        QSKIP("No tmpfs mount available");
+    }
+    
+    FileTransferRequest request;
+    request.id = "benchmark-write";
+    request.type = TransferType::Download;
+    request.localPath = directory + "/write.bin";
+    request.fileSize = FILE_BENCHMARK_SIZE;
+    
+    // The whole file through the download write path with checkpoint syncs
+    QByteArray data = QByteArray::fromRawData(m_payload.constData(), chunkSize);
+    QBENCHMARK {
+        FileTransferSession session(request);
+        QVERIFY(session.setChunkSize(chunkSize));
+        QVERIFY(session.openFile());
+        for (int chunkIndex = 0; chunkIndex < session.getTotalChunks(); ++chunkIndex) {
+            QVERIFY(session.writeChunk(chunkIndex, data));
+        }
+        QVERIFY(session.flushWrites());
+        session.closeFile();
+    }
+}
+
+void FileTransferBenchmark::benchmarkLoopbackUpload_data()
+{
+    addLinkRows();
+}
+
+void FileTransferBenchmark::benchmarkLoopbackUpload()
+{
+    runLoopbackTransfer(TransferType::Upload);
+}
+
+void FileTransferBenchmark::benchmarkLoopbackDownload_data()
+{
+    addLinkRows();
+}
+
+void FileTransferBenchmark::benchmarkLoopbackDownload()
+{
+    runLoopbackTransfer(TransferType::Download);
+}
+
+void FileTransferBenchmark::addChunkSizeRows()
+{
+    QTest::addColumn<int>("chunkSize");
+    
+    QTest::newRow("64KB") << 64 * 1024;
+    QTest::newRow("1MB") << 1024 * 1024;
+}
+
+void FileTransferBenchmark::addStorageRows()
+{
+    QTest::addColumn<QString>("storage");
+    QTest::addColumn<int>("chunkSize");
+    
+    for (const QString &storage : {QStringLiteral("tmpfs"), QStringLiteral("disk")}) {
+        for (int chunkSize : {64 * 1024, 1024 * 1024}) {
+            QString name = QString("%1/%2KB").arg(storage).arg(chunkSize / 1024);
+            QTest::newRow(qPrintable(name)) << storage << chunkSize;
+        }
+    }
+}
+
+void FileTransferBenchmark::addLinkRows()
+{
+    QTest::addColumn<int>("latencyMs");
+    QTest::addColumn<double>("lossRate");
+    
+    QTest::newRow("loopback") << 0 << 0.0;
+    QTest::newRow("lan") << 1 << 0.0;
+    QTest::newRow("wan") << 40 << 0.0;
+    QTest::newRow("wan-lossy") << 40 << 0.01;
+}
+
+QString FileTransferBenchmark::storageDirectory(const QString &storage)
+{
+    if (storage == "tmpfs") {
+        return m_tmpfsDir && m_tmpfsDir->isValid() ? m_tmpfsDir->path() : QString();
+    }
+    return m_diskDir->path();
+}
+
+void FileTransferBenchmark::runLoopbackTransfer(TransferType type)
+{
+    QFETCH(int, latencyMs);
+    QFETCH(double, lossRate);
+    
+    LoopbackPeer peer;
+    peer.setLink(latencyMs, lossRate);
+    peer.setDownloadSize(m_macroBytes);
+    QVERIFY(peer.listen());
+    
+    // Upload source written up front, its size is what the manager validates against
+    QString uploadPath = m_diskDir->path() + "/upload.zip";
+    QString downloadPath = m_diskDir->path() + "/download.bin";
+    if (type == TransferType::Upload) {
+        QFile file(uploadPath);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        for (qint64 written = 0; written < m_macroBytes; written += m_payload.size()) {
+            file.write(m_payload.constData(), qMin<qint64>(m_payload.size(), m_macroBytes - written));
+        }
+    }
+    QFile::remove(downloadPath);
+    
+    // The size limit is a persisted setting, put back once done
+    FileTransferManager manager;
+    qint64 maxFileSize = manager.getMaxFileSize();
+    if (m_macroBytes > maxFileSize) {
+        manager.setMaxFileSize(m_macroBytes);
+    }
+    QSignalSpy connectedSpy(&manager, &FileTransferManager::connected);
+    QSignalSpy completedSpy(&manager, &FileTransferManager::transferCompleted);
+    QSignalSpy failedSpy(&manager, &FileTransferManager::transferFailed);
+    
+    manager.connectToServer(peer.url());
+    QTRY_COMPARE(connectedSpy.count(), 1);
+    manager.onSessionRegistered("benchmark-session");
+    
+    ProcessUsage before = processUsage();
+    QElapsedTimer elapsed;
+    elapsed.start();
+    
+    QString transferId = type == TransferType::Upload
+        ? manager.requestFileUpload(uploadPath, "benchmark-session", "benchmark")
+        : manager.requestFileDownload("download.bin", "benchmark-session", "benchmark", downloadPath);
+    QVERIFY(!transferId.isEmpty());
+    QTRY_VERIFY_WITH_TIMEOUT(completedSpy.count() == 1 || failedSpy.count() > 0, MACRO_TIMEOUT);
+    QVERIFY2(failedSpy.isEmpty(), failedSpy.isEmpty() ? "" : qPrintable(failedSpy.first().at(1).toString()));
+    
+    double seconds = qMax<qint64>(1, elapsed.elapsed()) / 1000.0;
+    ProcessUsage after = processUsage();
+    manager.disconnectFromServer();
+    manager.setMaxFileSize(maxFileSize);
+    
+    // CPU time includes the loopback peer, it runs in the same process
+    double gigabytes = m_macroBytes / (1024.0 * 1024.0 * 1024.0);
+    double bytesPerSecond = m_macroBytes / seconds;
+    QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+    
+    QJsonObject result;
+    result["name"] = QString("%1/%2").arg(QTest::currentTestFunction(), QTest::currentDataTag());
+    result["direction"] = type == TransferType::Upload ? "upload" : "download";
+    result["latency_ms"] = latencyMs;
+    result["loss_rate"] = lossRate;
+    result["bytes"] = m_macroBytes;
+    result["seconds"] = seconds;
+    result["mb_per_second"] = bytesPerSecond / (1024.0 * 1024.0);
+    result["cpu_seconds_per_gb"] = (after.cpuSeconds - before.cpuSeconds) / gigabytes;
+    result["peak_rss_kb"] = after.peakRssKb;
+    result["buffer_pool_hits"] = static_cast<qint64>(manager.getBufferPoolHitCount());
+    result["buffer_pool_misses"] = static_cast<qint64>(manager.getBufferPoolMissCount());
+    m_results.append(result);
+    
+    qInfo().noquote() << QJsonDocument(result).toJson(QJsonDocument::Compact);
+}
+
+QTEST_MAIN(FileTransferBenchmark)
+#include "FileTransferBenchmark.moc"